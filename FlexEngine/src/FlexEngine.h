@@ -122,6 +122,10 @@
 #include "FlexEngine/Wrapper/file.h"
 #include "FlexEngine/Wrapper/filelist.h"
 
+// Read-only memory map of a file.
+// Used to load binary scenes without copying the file into a buffer.
+#include "FlexEngine/Wrapper/mappedfile.h"
+
 /* |-----------------------------| */
 /* |---------- Renderer ---------| */
 /* |-----------------------------| */
@@ -132,6 +136,10 @@
 // The current implementation is exclusively for OpenGL. For 2D sprites
 #include "FlexEngine/Renderer/OpenGL/openglspriterenderer.h"
 
+// Collects sprites and sorts them into batches by layer, shader and texture.
+// Drawn with OpenGLSpriteRenderer::DrawSpriteBatch, one instanced call per batch.
+#include "FlexEngine/Renderer/spritebatch.h"
+
 // Stores one vertex for the mesh.
 // The current implementation is exclusively for OpenGL.
 #include "FlexEngine/Renderer/OpenGL/openglvertex.h"
@@ -168,6 +176,11 @@
 // This uses the Archetype-based Entity-Component-System architecture.
 #include "FlexEngine/FlexECS/datastructures.h"
 
+// Runs ECS systems in parallel.
+// Each system declares the components it reads and writes,
+// systems that do not conflict run at the same time on the thread pool.
+#include "FlexEngine/FlexECS/systemscheduler.h"
+
 // Two way queue for storing and executing functions.
 #include "FlexEngine/DataStructures/functionqueue.h"
 
@@ -181,6 +194,25 @@
 // Can also be used to store a range of values by getting min and max.
 #include "FlexEngine/DataStructures/range.h"
 
+// Growing byte buffer and bounds-checked reader for binary serialization.
+#include "FlexEngine/DataStructures/bytestream.h"
+
+// Work-stealing thread pool.
+// Use Submit and Wait with a TaskGroup, or ParallelFor to split a range.
+#include "FlexEngine/DataStructures/threadpool.h"
+
+/* |-----------------------------| */
+/* |---------- Physics ----------| */
+/* |-----------------------------| */
+
+// Finds the overlapping pairs of 2D bounding boxes.
+// Sweep and prune or a hashed uniform grid, each pair is reported once.
+#include "FlexEngine/Physics/broadphase.h"
+
+// SoA bounding boxes with SSE/AVX2 kernels.
+// Rebuilds bounds from centers and half extents, and tests one box against 8 at a time.
+#include "FlexEngine/Physics/bounds.h"
+
 /* |-----------------------------| */
 /* |------        FMOD     ------| */
 /* |-----------------------------| */
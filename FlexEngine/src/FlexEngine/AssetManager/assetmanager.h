@@ -20,8 +20,9 @@ namespace FlexEngine
   using AssetVariant = std::variant<Asset::Texture, Asset::Shader, Asset::Model, Asset::Sound>;
 
   // Helper macro to get an asset by its key.
+  // The key can be anything a std::string can be made from, like the std::string_view of the scene's string storage.
   // Example usage: FLX_ASSET_GET(Asset::Texture, R"(/images/flexengine/flexengine-256.png)")
-  #define FLX_ASSET_GET(TYPE, KEY) std::get<TYPE>(*AssetManager::Get(KEY))
+  #define FLX_ASSET_GET(TYPE, KEY) std::get<TYPE>(*AssetManager::Get(AssetKey(KEY)))
 
 
   // Asset Manager
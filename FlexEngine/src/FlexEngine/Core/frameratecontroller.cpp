@@ -1,10 +1,64 @@
 #include "frameratecontroller.h"
 
 #include <thread>
+#include <cmath>
+#include <algorithm>
 
 namespace FlexEngine
 {
 
+  #pragma region FixedTimestep
+
+  // Steps:
+  // 1. Add the frame time
+  // 2. Take as many whole steps as fit, at most the max steps
+  // 3. Drop the whole steps that didn't fit, keep the partial step for the next frame
+  void FixedTimestep::Advance(float delta_time)
+  {
+    // 1. Add the frame time, a negative delta can come from a clock that went backwards
+    m_accumulator += (std::max)(delta_time, 0.0f);
+
+    // 2. Take the steps
+    unsigned int step_count = static_cast<unsigned int>(m_accumulator / m_fixed_delta_time);
+    m_step_count = (std::min)(step_count, m_max_steps);
+    m_accumulator -= m_step_count * m_fixed_delta_time;
+
+    // 3. Drop what didn't fit
+    if (m_accumulator >= m_fixed_delta_time) m_accumulator = std::fmod(m_accumulator, m_fixed_delta_time);
+
+    m_alpha = (std::min)(m_accumulator / m_fixed_delta_time, 1.0f);
+  }
+
+  void FixedTimestep::Reset()
+  {
+    m_accumulator = 0.0f;
+    m_step_count = 0;
+    m_alpha = 0.0f;
+  }
+
+  void FixedTimestep::SetDeltaTime(float fixed_delta_time)
+  {
+    // guard: the step has to move time forward
+    if (!(fixed_delta_time > 0.0f)) return;
+
+    m_fixed_delta_time = fixed_delta_time;
+  }
+
+  void FixedTimestep::SetRate(unsigned int rate)
+  {
+    // guard: division by zero
+    if (rate == 0) return;
+
+    SetDeltaTime(1.0f / static_cast<float>(rate));
+  }
+
+  void FixedTimestep::SetMaxSteps(unsigned int max_steps)
+  {
+    m_max_steps = (std::max)(max_steps, 1u);
+  }
+
+  #pragma endregion
+
   void FramerateController::BeginFrame()
   {
     // Calculate delta time
@@ -22,6 +76,8 @@ namespace FlexEngine
       m_frame_counter = 0;
       m_frame_time_accumulator -= 1.0f;
     }
+
+    m_fixed_timestep.Advance(m_delta_time);
   }
 
   void FramerateController::EndFrame()
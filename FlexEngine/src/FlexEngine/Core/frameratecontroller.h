@@ -1,10 +1,60 @@
 #pragma once
 
+#include "flx_api.h"
+
 #include <chrono>
 
 namespace FlexEngine
 {
 
+  // Fixed timestep accumulator.
+  // Frame time is added with Advance, and consumed in whole fixed steps.
+  // The leftover time is the interpolation alpha between the last two steps,
+  // renderers can blend the previous and current simulation state with it.
+  //
+  // The number of steps per frame is clamped so a long frame doesn't make the next
+  // frames even longer, the time that doesn't fit is dropped and the simulation slows down.
+  //
+  // Usage:
+  // timestep.Advance(delta_time);
+  // for (unsigned int i = 0; i < timestep.GetStepCount(); i++) Simulate(timestep.GetDeltaTime());
+  // Render(timestep.GetAlpha());
+  class __FLX_API FixedTimestep
+  {
+    float m_fixed_delta_time = 1.0f / 60.0f;
+    unsigned int m_max_steps = 8;
+
+    float m_accumulator = 0.0f;
+    unsigned int m_step_count = 0;
+    float m_alpha = 0.0f;
+
+  public:
+    // Adds the frame time and works out the steps for this frame.
+    void Advance(float delta_time);
+
+    // Drops the accumulated time.
+    void Reset();
+
+    #pragma region Getter/Setter Functions
+
+    // Number of fixed steps to run this frame.
+    unsigned int GetStepCount() const { return m_step_count; }
+
+    // How far the frame is between the last step and the next one, in [0, 1).
+    float GetAlpha() const { return m_alpha; }
+
+    float GetDeltaTime() const { return m_fixed_delta_time; }
+    void SetDeltaTime(float fixed_delta_time);
+
+    // Steps per second, the same as SetDeltaTime(1.0f / rate).
+    void SetRate(unsigned int rate);
+
+    unsigned int GetMaxSteps() const { return m_max_steps; }
+    void SetMaxSteps(unsigned int max_steps);
+
+    #pragma endregion
+  };
+
   class FramerateController
   {
     std::chrono::time_point<std::chrono::high_resolution_clock> m_last_time = std::chrono::high_resolution_clock::now();
@@ -14,6 +64,8 @@ namespace FlexEngine
     unsigned int m_frame_counter = 0;
     unsigned int m_target_fps = 60;
 
+    FixedTimestep m_fixed_timestep;
+
   public:
     void BeginFrame();
     void EndFrame();
@@ -24,6 +76,9 @@ namespace FlexEngine
     unsigned int GetFPS() const;
     void SetTargetFPS(unsigned int fps = 0);
 
+    FixedTimestep& GetFixedTimestep() { return m_fixed_timestep; }
+    const FixedTimestep& GetFixedTimestep() const { return m_fixed_timestep; }
+
     #pragma endregion
   };
 
@@ -31,6 +31,11 @@ namespace FlexEngine
 
     // automatically updated by the layer stack
     virtual void Update() = 0;
+
+    // called by the layer stack at the fixed timestep, before Update
+    // runs zero or more times per frame, use it for the simulation
+    // see Window::GetFixedDeltaTime and Window::GetInterpolationAlpha
+    virtual void FixedUpdate() {}
   };
 
 }
\ No newline at end of file
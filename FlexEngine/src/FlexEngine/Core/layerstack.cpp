@@ -139,6 +139,12 @@ namespace FlexEngine
     m_overlays.erase(m_overlays.begin() + index);
   }
 
+  void LayerStack::FixedUpdate()
+  {
+    for (auto& overlay : m_overlays) overlay->FixedUpdate();
+    for (auto& layer : m_layers) layer->FixedUpdate();
+  }
+
   void LayerStack::Update()
   {
     for (auto& overlay : m_overlays) overlay->Update();
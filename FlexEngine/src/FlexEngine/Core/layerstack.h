@@ -31,6 +31,7 @@ namespace FlexEngine
     void RemoveLayer(size_t index);
     void RemoveOverlay(size_t index);
 
+    void FixedUpdate();
     void Update();
 
 #ifdef _DEBUG
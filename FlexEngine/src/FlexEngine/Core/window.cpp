@@ -114,6 +114,10 @@ namespace FlexEngine
     m_frameratecontroller.BeginFrame();
     ImGuiWrapper::BeginFrame();
 
+    // run the fixed steps that fit in the time since the last frame
+    unsigned int fixed_step_count = m_frameratecontroller.GetFixedTimestep().GetStepCount();
+    for (unsigned int i = 0; i < fixed_step_count; i++) m_layerstack.FixedUpdate();
+
     // update layer stack
     m_layerstack.Update();
 
@@ -123,6 +123,18 @@ namespace FlexEngine
 
     void SetTargetFPS(unsigned int fps = 0) { m_frameratecontroller.SetTargetFPS(fps); }
 
+    // Simulation code in Layer::FixedUpdate steps with the fixed delta time.
+    // The alpha is how far the frame is between the last two fixed steps,
+    // renderers blend the previous and current state with it.
+    float GetFixedDeltaTime() const { return m_frameratecontroller.GetFixedTimestep().GetDeltaTime(); }
+    float GetInterpolationAlpha() const { return m_frameratecontroller.GetFixedTimestep().GetAlpha(); }
+
+    // Fixed steps per second, 60 by default.
+    void SetFixedUpdateRate(unsigned int rate) { m_frameratecontroller.GetFixedTimestep().SetRate(rate); }
+
+    // A frame runs at most this many fixed steps, 8 by default.
+    void SetMaxFixedSteps(unsigned int max_steps) { m_frameratecontroller.GetFixedTimestep().SetMaxSteps(max_steps); }
+
     // passthrough functions for the layer stack
 
     void PushLayer(std::shared_ptr<Layer> layer) { m_layerstack.PushLayer(layer); }
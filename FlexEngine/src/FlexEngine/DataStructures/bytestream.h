@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <string>
+#include <vector>
+
+namespace FlexEngine
+{
+
+  // Growing byte buffer for binary serialization.
+  // Values are written in the byte order of the machine,
+  // so the data is meant to be read back by the same build.
+  struct ByteWriter
+  {
+    std::string buffer;
+
+    void Reserve(std::size_t size) { buffer.reserve(size); }
+
+    void WriteBytes(const void* data, std::size_t size)
+    {
+      buffer.append(static_cast<const char*>(data), size);
+    }
+
+    template <typename T>
+    void Write(const T& value)
+    {
+      WriteBytes(&value, sizeof(T));
+    }
+
+    // Zero-fills up to the next multiple of alignment
+    void WritePadding(std::size_t alignment)
+    {
+      buffer.resize((buffer.size() + alignment - 1) / alignment * alignment, '\0');
+    }
+
+    const uint8_t* data() const { return reinterpret_cast<const uint8_t*>(buffer.data()); }
+    std::size_t size() const { return buffer.size(); }
+  };
+
+  // Bounds-checked cursor over a byte buffer.
+  // Every read fails once the cursor runs past the end and returns a default value,
+  // so callers only need to check is_valid at the end of each section.
+  struct ByteReader
+  {
+    const uint8_t* data = nullptr;
+    std::size_t size = 0;
+    std::size_t offset = 0;
+    bool is_valid = true;
+
+    ByteReader() = default;
+    ByteReader(const void* _data, std::size_t _size)
+      : data(static_cast<const uint8_t*>(_data)), size(_size)
+    {
+    }
+    ByteReader(const ByteWriter& writer)
+      : ByteReader(writer.data(), writer.size())
+    {
+    }
+
+    std::size_t Remaining() const { return size - offset; }
+
+    const uint8_t* ReadBytes(std::size_t count)
+    {
+      if (!is_valid || count > size - offset)
+      {
+        is_valid = false;
+        return nullptr;
+      }
+      const uint8_t* bytes = data + offset;
+      offset += count;
+      return bytes;
+    }
+
+    // Reads count elements stored back to back.
+    // The count usually comes from the data, so it is checked before it is multiplied.
+    const uint8_t* ReadArray(std::size_t count, std::size_t element_size)
+    {
+      if (!is_valid || (element_size != 0 && count > (size - offset) / element_size))
+      {
+        is_valid = false;
+        return nullptr;
+      }
+      return ReadBytes(count * element_size);
+    }
+
+    template <typename T>
+    T Read()
+    {
+      T value{};
+      const uint8_t* bytes = ReadBytes(sizeof(T));
+      if (bytes != nullptr) std::memcpy(&value, bytes, sizeof(T));
+      return value;
+    }
+
+    // Reads count elements into the vector with one memcpy.
+    template <typename T>
+    bool ReadVector(std::vector<T>& out, std::size_t count)
+    {
+      const uint8_t* bytes = ReadArray(count, sizeof(T));
+      if (bytes == nullptr) return false;
+
+      out.resize(count);
+      if (count != 0) std::memcpy(out.data(), bytes, count * sizeof(T));
+      return true;
+    }
+
+    void SkipPadding(std::size_t alignment)
+    {
+      std::size_t aligned_offset = (offset + alignment - 1) / alignment * alignment;
+      ReadBytes(aligned_offset - offset);
+    }
+  };
+
+}
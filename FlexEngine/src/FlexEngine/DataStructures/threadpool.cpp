@@ -0,0 +1,269 @@
+#include "pch.h"
+
+#include "threadpool.h"
+
+namespace FlexEngine
+{
+
+  // The pool and queue index of the current thread.
+  // Kept out of the class because thread_local data cannot be exported.
+  static thread_local const ThreadPool* t_pool = nullptr;
+  static thread_local std::size_t t_queue_index = 0;
+
+  #pragma region TaskGroup
+
+  void TaskGroup::SetException(std::exception_ptr exception)
+  {
+    std::lock_guard<std::mutex> lock(m_exception_mutex);
+    if (!m_exception) m_exception = exception;
+  }
+
+  std::exception_ptr TaskGroup::TakeException()
+  {
+    std::lock_guard<std::mutex> lock(m_exception_mutex);
+    std::exception_ptr exception = m_exception;
+    m_exception = nullptr;
+    return exception;
+  }
+
+  #pragma endregion
+
+  ThreadPool::ThreadPool()
+    : ThreadPool((std::max)(std::thread::hardware_concurrency(), 2u) - 1)
+  {
+  }
+
+  ThreadPool::ThreadPool(std::size_t worker_count)
+  {
+    // one queue per worker and the shared queue
+    for (std::size_t i = 0; i < worker_count + 1; i++) m_queues.push_back(std::make_unique<WorkerQueue>());
+
+    m_threads.reserve(worker_count);
+    for (std::size_t i = 0; i < worker_count; i++) m_threads.emplace_back(&ThreadPool::Internal_WorkerLoop, this, i);
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_sleep_mutex);
+      m_stop = true;
+    }
+    m_sleep_condition.notify_all();
+
+    for (std::thread& thread : m_threads) thread.join();
+  }
+
+  ThreadPool& ThreadPool::GetDefault()
+  {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  void ThreadPool::Submit(Task task)
+  {
+    // count the task before it can be taken so the counter never drops below zero,
+    // the sleep mutex orders the increment against a worker checking the predicate
+    {
+      std::lock_guard<std::mutex> lock(m_sleep_mutex);
+      m_pending++;
+    }
+
+    WorkerQueue& queue = *m_queues[Internal_GetQueueIndex()];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+    }
+    m_sleep_condition.notify_one();
+  }
+
+  void ThreadPool::Submit(TaskGroup& group, Task task)
+  {
+    group.Add();
+    Submit(
+      [this, &group, task = std::move(task)]()
+      {
+        // a throwing task still finishes, the waiting thread rethrows
+        try
+        {
+          task();
+        }
+        catch (...)
+        {
+          group.SetException(std::current_exception());
+        }
+        Done(group);
+      }
+    );
+  }
+
+  // Steps:
+  // 1. Run queued tasks while the group is not done
+  // 2. Spin a little when there is nothing to run, the group is usually almost done
+  // 3. Then sleep until a task is submitted or the group is done
+  // 4. Rethrow the first exception of the group
+  void ThreadPool::Wait(TaskGroup& group)
+  {
+    // spinning is cheap enough to wait out the last few short tasks
+    constexpr int SPIN_COUNT = 64;
+
+    std::size_t index = Internal_GetQueueIndex();
+    int spins = 0;
+    while (!group.IsDone())
+    {
+      // 1. Help out instead of blocking
+      if (Internal_TryRunTask(index))
+      {
+        spins = 0;
+        continue;
+      }
+
+      // 2. Spin
+      if (spins++ < SPIN_COUNT)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      // 3. Sleep
+      // the timeout covers groups finished with TaskGroup::Done, which doesn't wake anyone
+      std::unique_lock<std::mutex> lock(m_sleep_mutex);
+      m_sleep_condition.wait_for(lock, std::chrono::milliseconds(1), [this, &group]() { return m_pending > 0 || group.IsDone(); });
+      spins = 0;
+    }
+
+    // 4. Rethrow
+    if (std::exception_ptr exception = group.TakeException()) std::rethrow_exception(exception);
+  }
+
+  void ThreadPool::Done(TaskGroup& group)
+  {
+    // guard: other tasks are still running
+    if (!group.Done()) return;
+
+    // the lock orders the wake up against a waiting thread checking the group
+    {
+      std::lock_guard<std::mutex> lock(m_sleep_mutex);
+    }
+    m_sleep_condition.notify_all();
+  }
+
+  // Steps:
+  // 1. Split the range into tasks
+  // 2. Run the tasks and wait for them
+  void ThreadPool::ParallelFor(std::size_t count, std::size_t grain_size, const std::function<void(std::size_t, std::size_t)>& fn)
+  {
+    // guard
+    if (count == 0) return;
+    if (grain_size == 0) grain_size = 1;
+
+    // guard: not worth splitting
+    if (count <= grain_size)
+    {
+      fn(0, count);
+      return;
+    }
+
+    // 1. Split the range into tasks
+    // the calling thread runs the first range itself
+    TaskGroup group;
+    for (std::size_t begin = grain_size; begin < count; begin += grain_size)
+    {
+      std::size_t end = (std::min)(begin + grain_size, count);
+      Submit(group, [&fn, begin, end]() { fn(begin, end); });
+    }
+
+    // 2. Run the tasks and wait for them
+    // the tasks reference fn and the group, so wait for them even if the first range throws
+    try
+    {
+      fn(0, grain_size);
+    }
+    catch (...)
+    {
+      group.SetException(std::current_exception());
+    }
+    Wait(group);
+  }
+
+  #pragma region Internal Functions
+
+  void ThreadPool::Internal_WorkerLoop(std::size_t index)
+  {
+    t_pool = this;
+    t_queue_index = index;
+
+    while (true)
+    {
+      if (Internal_TryRunTask(index)) continue;
+
+      // nothing to run, sleep until a task is submitted
+      std::unique_lock<std::mutex> lock(m_sleep_mutex);
+      m_sleep_condition.wait(lock, [this]() { return m_stop || m_pending > 0; });
+      if (m_stop && m_pending == 0) return;
+    }
+  }
+
+  // Steps:
+  // 1. Take the newest task from the thread's own queue
+  // 2. Steal the oldest task from the other queues, starting with the next one
+  // 3. Run the task outside of the lock
+  //    Tracked tasks catch their own exceptions, see Submit(TaskGroup&, Task).
+  //    Untracked tasks have no one to rethrow to, so their exceptions are logged.
+  bool ThreadPool::Internal_TryRunTask(std::size_t index)
+  {
+    // guard: nothing queued anywhere
+    if (m_pending.load(std::memory_order_acquire) == 0) return false;
+
+    Task task;
+
+    // 1. Take the newest task from the thread's own queue
+    {
+      WorkerQueue& queue = *m_queues[index];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tasks.empty())
+      {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+      }
+    }
+
+    // 2. Steal the oldest task from the other queues
+    for (std::size_t i = 1; !task && i < m_queues.size(); i++)
+    {
+      WorkerQueue& queue = *m_queues[(index + i) % m_queues.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tasks.empty())
+      {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+      }
+    }
+
+    if (!task) return false;
+
+    // 3. Run the task outside of the lock
+    m_pending--;
+    try
+    {
+      task();
+    }
+    catch (const std::exception& e)
+    {
+      Log::Error(std::string("ThreadPool: An untracked task threw an exception: ") + e.what());
+    }
+    catch (...)
+    {
+      Log::Error("ThreadPool: An untracked task threw an unknown exception.");
+    }
+    return true;
+  }
+
+  std::size_t ThreadPool::Internal_GetQueueIndex() const
+  {
+    // threads outside the pool share the last queue
+    return (t_pool == this) ? t_queue_index : m_queues.size() - 1;
+  }
+
+  #pragma endregion
+
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "flx_api.h"
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <functional>
+
+namespace FlexEngine
+{
+
+  // Counts the tasks that are still running.
+  // Pass it to ThreadPool::Submit and wait for all of them with ThreadPool::Wait.
+  // If a task throws, the first exception is rethrown by ThreadPool::Wait.
+  class __FLX_API TaskGroup
+  {
+    std::atomic<std::size_t> m_count = 0;
+
+    std::mutex m_exception_mutex;
+    std::exception_ptr m_exception;
+
+  public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    // Adds to the number of tasks the group waits for.
+    // Only needed when tasks are finished manually with Done().
+    void Add(std::size_t count = 1) { m_count.fetch_add(count, std::memory_order_relaxed); }
+
+    // Marks one task of the group as finished.
+    // Prefer ThreadPool::Done, which also wakes the threads waiting on the group.
+    // Returns true for the last task.
+    bool Done() { return m_count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+    bool IsDone() const { return m_count.load(std::memory_order_acquire) == 0; }
+
+    // Keeps the first exception thrown by a task of the group.
+    void SetException(std::exception_ptr exception);
+
+    // Returns the kept exception and clears it.
+    std::exception_ptr TakeException();
+  };
+
+  // Work-stealing thread pool
+  //
+  // Each worker owns a queue and takes its newest task first,
+  // when it runs out it steals the oldest task from another worker.
+  // Tasks submitted from outside the pool go into a shared queue.
+  //
+  // Threads that wait on a TaskGroup run queued tasks while they wait,
+  // so tasks can submit and wait on other tasks without deadlocking.
+  // When there is nothing to run they spin briefly, then sleep until a task is
+  // submitted or the group is done.
+  //
+  // Usage:
+  // TaskGroup group;
+  // pool.Submit(group, []() { ... });
+  // pool.Wait(group);
+  class __FLX_API ThreadPool
+  {
+  public:
+    using Task = std::function<void()>;
+
+  private:
+    struct WorkerQueue
+    {
+      std::mutex mutex;
+      std::deque<Task> tasks;
+    };
+
+    std::vector<std::thread> m_threads;
+
+    // One queue per worker, the last one is shared by the threads outside the pool
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+    // Number of tasks that are queued and not yet taken
+    std::atomic<std::size_t> m_pending = 0;
+    std::atomic<bool> m_stop = false;
+
+    // Idle workers sleep here until a task is submitted,
+    // waiting threads also wake up when a group is done
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_sleep_condition;
+
+  public:
+    // One worker per hardware thread, minus the thread that waits.
+    ThreadPool();
+
+    // With 0 workers every task runs on the thread that waits for it.
+    explicit ThreadPool(std::size_t worker_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // The pool shared by the engine systems.
+    static ThreadPool& GetDefault();
+
+    // Number of threads that run tasks, including the thread that waits.
+    std::size_t GetThreadCount() const { return m_threads.size() + 1; }
+
+    // Queues a task without tracking it.
+    // Exceptions thrown by the task are logged and dropped.
+    void Submit(Task task);
+
+    // Queues a task that is tracked by the group.
+    void Submit(TaskGroup& group, Task task);
+
+    // Blocks until all the tasks of the group are done.
+    // The waiting thread runs queued tasks in the meantime.
+    // Rethrows the first exception thrown by a task of the group.
+    void Wait(TaskGroup& group);
+
+    // Finishes one task of a group that was counted with TaskGroup::Add.
+    void Done(TaskGroup& group);
+
+    // Splits [0, count) into ranges of at most grain_size and runs them in parallel.
+    // Blocks until all the ranges are done.
+    // Usage: pool.ParallelFor(1000, 64, [](std::size_t begin, std::size_t end) { ... });
+    void ParallelFor(std::size_t count, std::size_t grain_size, const std::function<void(std::size_t, std::size_t)>& fn);
+
+  private:
+    // INTERNAL FUNCTION
+    void Internal_WorkerLoop(std::size_t index);
+
+    // INTERNAL FUNCTION
+    // Takes a task from the thread's own queue, or steals one from another queue.
+    // Returns false if there is nothing to run.
+    bool Internal_TryRunTask(std::size_t index);
+
+    // INTERNAL FUNCTION
+    // Returns the queue index of the calling thread.
+    std::size_t Internal_GetQueueIndex() const;
+  };
+
+}
@@ -1,5 +1,642 @@
 #include "datastructures.h"
 
+#include <mutex> // std::mutex
+#include <atomic> // std::atomic
+#include <deque> // std::deque
+
+namespace FlexEngine
+{
+  namespace Reflection
+  {
+
+    // TypeDescriptor for FlexECS::Column.
+    // The column is serialized as its element layout followed by the raw
+    // component bytes encoded in base64, so the whole column is one json string.
+    struct __FLX_API TypeDescriptor_Column : TypeDescriptor
+    {
+      TypeDescriptor_Column()
+        : TypeDescriptor{ "Column", sizeof(FlexECS::Column), alignof(FlexECS::Column) }
+      {
+      }
+
+      virtual void Dump(const void* obj, std::ostream& os, int) const override
+      {
+        const auto& column = *(const FlexECS::Column*)obj;
+        os << "Column{" << column.size() << " x " << column.GetElementSize() << " bytes}";
+      }
+
+      virtual void Serialize(const void* obj, std::ostream& os) const override
+      {
+        const auto& column = *(const FlexECS::Column*)obj;
+
+        std::string serialized_data = Base64::Encode(column.data(), column.size() * column.GetElementSize());
+
+        os
+          << R"({"type":"Column","data":[)"
+          << R"({"type":"uint64_t","data":)" << column.GetElementSize() << "},"
+          << R"({"type":"uint64_t","data":)" << column.GetElementAlignment() << "},"
+          << R"({"type":"uint64_t","data":)" << column.size() << "},"
+          << R"({"type":"std::string","data":")" << serialized_data << R"("}]})"
+        ;
+      }
+
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        const auto& column = *(const FlexECS::Column*)obj;
+
+        std::string serialized_data = Base64::Encode(column.data(), column.size() * column.GetElementSize());
+
+        writer.StartObject();
+        writer.Key("type"); writer.String("Column");
+        writer.Key("data"); writer.StartArray();
+        for (uint64_t value : { (uint64_t)column.GetElementSize(), (uint64_t)column.GetElementAlignment(), (uint64_t)column.size() })
+        {
+          writer.StartObject();
+          writer.Key("type"); writer.String("uint64_t");
+          writer.Key("data"); writer.Uint64(value);
+          writer.EndObject();
+        }
+        writer.StartObject();
+        writer.Key("type"); writer.String("std::string");
+        writer.Key("data"); writer.String(serialized_data.c_str(), static_cast<SizeType>(serialized_data.size()));
+        writer.EndObject();
+        writer.EndArray();
+        writer.EndObject();
+      }
+
+      // A column that fails to load is left empty with no element size,
+      // Scene::Load checks the columns against their entities and fails the load.
+      virtual void Deserialize(void* obj, const json& value) const override
+      {
+        *(FlexECS::Column*)obj = FlexECS::Column();
+
+        // guard: not a column
+        if (!value.IsObject() || !value.HasMember("data") || !value["data"].IsArray())
+        {
+          Log::Error("Failed to deserialize column, the data is not an array. This is most likely caused by a corrupted .flx file");
+          return;
+        }
+
+        const auto& arr = value["data"].GetArray();
+
+        // saves from before the columns were contiguous store one std::shared_ptr<void> per component
+        if (value.HasMember("type") && value["type"].IsString() && std::strcmp(value["type"].GetString(), "std::vector<std::shared_ptr<void>>") == 0)
+        {
+          Internal_DeserializeLegacy(obj, arr);
+          return;
+        }
+
+        // guard: the layout is [element size, alignment, count, data]
+        if (
+          arr.Size() != 4 ||
+          !arr[0].IsObject() || !arr[0]["data"].IsUint64() ||
+          !arr[1].IsObject() || !arr[1]["data"].IsUint64() ||
+          !arr[2].IsObject() || !arr[2]["data"].IsUint64() ||
+          !arr[3].IsObject() || !arr[3]["data"].IsString()
+        )
+        {
+          Log::Error("Failed to deserialize column, the layout does not match. This is most likely caused by a corrupted .flx file");
+          return;
+        }
+
+        std::size_t element_size = arr[0]["data"].Get<uint64_t>();
+        std::size_t element_alignment = arr[1]["data"].Get<uint64_t>();
+        std::size_t count = arr[2]["data"].Get<uint64_t>();
+
+        // decode straight from the json string
+        const json& encoded_data = arr[3]["data"];
+        std::vector<BYTE> decoded_data(Base64::DecodedSize(encoded_data.GetStringLength()));
+        std::size_t decoded_size = 0;
+        bool is_decoded = Base64::Decode(encoded_data.GetString(), encoded_data.GetStringLength(), decoded_data.data(), decoded_size);
+        if (!is_decoded || decoded_size != count * element_size)
+        {
+          Log::Error("Failed to deserialize column, the data size does not match. This is most likely caused by a corrupted .flx file");
+          return;
+        }
+
+        FlexECS::Column column(element_size, element_alignment);
+        column.PushBackRange(decoded_data.data(), count);
+
+        *(FlexECS::Column*)obj = std::move(column);
+      }
+
+      // Each legacy component is base64 of its size as a 64-bit std::size_t followed by its bytes,
+      // see the old FlexECS::Internal_CreateComponentData.
+      // The alignment was not saved, the column uses the default.
+      // An empty legacy column has no element size, Scene::Load takes it from the type descriptor.
+      static void Internal_DeserializeLegacy(void* obj, const json::ConstArray& arr)
+      {
+        std::size_t element_size = 0;
+        std::vector<BYTE> bytes;
+        for (const json& element : arr)
+        {
+          // guard: null components were never written by the ECS
+          if (!element.IsObject() || !element.HasMember("data") || !element["data"].IsString())
+          {
+            Log::Error("Failed to deserialize legacy column, a component has no data. This is most likely caused by a corrupted .flx file");
+            return;
+          }
+
+          std::vector<BYTE> decoded_data = Base64::Decode(element["data"].GetString());
+          uint64_t size = 0;
+          if (decoded_data.size() >= sizeof(uint64_t)) memcpy(&size, decoded_data.data(), sizeof(uint64_t));
+
+          // guard: every component in a column has the same size
+          if (decoded_data.size() < sizeof(uint64_t) || decoded_data.size() - sizeof(uint64_t) != size || (element_size != 0 && size != element_size))
+          {
+            Log::Error("Failed to deserialize legacy column, the component sizes do not match. This is most likely caused by a corrupted .flx file");
+            return;
+          }
+
+          element_size = static_cast<std::size_t>(size);
+          bytes.insert(bytes.end(), decoded_data.begin() + sizeof(uint64_t), decoded_data.end());
+        }
+
+        FlexECS::Column column(element_size);
+        if (element_size != 0) column.PushBackRange(bytes.data(), arr.Size());
+        *(FlexECS::Column*)obj = std::move(column);
+      }
+
+      // The column bytes are stored as is after the element layout
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        const auto& column = *(const FlexECS::Column*)obj;
+        writer.Write<uint64_t>(column.GetElementSize());
+        writer.Write<uint64_t>(column.GetElementAlignment());
+        writer.Write<uint64_t>(column.size());
+        writer.WriteBytes(column.data(), column.size() * column.GetElementSize());
+      }
+
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        std::size_t element_size = static_cast<std::size_t>(reader.Read<uint64_t>());
+        std::size_t element_alignment = static_cast<std::size_t>(reader.Read<uint64_t>());
+        std::size_t count = static_cast<std::size_t>(reader.Read<uint64_t>());
+        const uint8_t* bytes = reader.ReadArray(count, element_size);
+        if (bytes == nullptr) return;
+
+        FlexECS::Column column(element_size, element_alignment);
+        column.PushBackRange(bytes, count);
+        *(FlexECS::Column*)obj = std::move(column);
+      }
+    };
+    template <>
+    __FLX_API TypeDescriptor* GetPrimitiveDescriptor<FlexECS::Column>()
+    {
+      static TypeDescriptor_Column type_desc;
+      if (TYPE_DESCRIPTOR_LOOKUP.count(type_desc.name) == 0)
+      {
+        TYPE_DESCRIPTOR_LOOKUP[type_desc.name] = &type_desc;
+      }
+      return &type_desc;
+    }
+
+
+
+    // TypeDescriptor for FlexECS::ComponentIDList.
+    // ComponentIDs are only valid for the running process, so the list is
+    // serialized by component name in the same format as a std::vector<std::string>.
+    // The order of the list is kept, Scene::Load sorts it again afterwards.
+    struct __FLX_API TypeDescriptor_ComponentIDList : TypeDescriptor
+    {
+      TypeDescriptor_ComponentIDList()
+        : TypeDescriptor{ "ComponentIDList", sizeof(FlexECS::ComponentIDList), alignof(FlexECS::ComponentIDList) }
+      {
+      }
+
+      virtual void Dump(const void* obj, std::ostream& os, int) const override
+      {
+        const auto& list = *(const FlexECS::ComponentIDList*)obj;
+        os << "ComponentIDList{";
+        for (std::size_t i = 0; i < list.size(); i++)
+        {
+          if (i != 0) os << ", ";
+          os << FlexECS::GetComponentName(list[i]);
+        }
+        os << "}";
+      }
+
+      virtual void Serialize(const void* obj, std::ostream& os) const override
+      {
+        const auto& list = *(const FlexECS::ComponentIDList*)obj;
+        os << R"({"type":"std::vector<std::string>","data":[)";
+        for (std::size_t i = 0; i < list.size(); i++)
+        {
+          if (i != 0) os << ",";
+          os << R"({"type":"std::string","data":")" << FlexECS::GetComponentName(list[i]) << R"("})";
+        }
+        os << "]}";
+      }
+
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        const auto& list = *(const FlexECS::ComponentIDList*)obj;
+        writer.StartObject();
+        writer.Key("type"); writer.String("std::vector<std::string>");
+        writer.Key("data"); writer.StartArray();
+        for (FlexECS::ComponentID component : list)
+        {
+          const std::string& component_name = FlexECS::GetComponentName(component);
+          writer.StartObject();
+          writer.Key("type"); writer.String("std::string");
+          writer.Key("data"); writer.String(component_name.c_str(), static_cast<SizeType>(component_name.size()));
+          writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+      }
+
+      virtual void Deserialize(void* obj, const json& value) const override
+      {
+        auto& list = *(FlexECS::ComponentIDList*)obj;
+        const auto& arr = value["data"].GetArray();
+
+        list.clear();
+        list.reserve(arr.Size());
+        for (SizeType i = 0; i < arr.Size(); i++)
+        {
+          list.push_back(FlexECS::Internal_RegisterComponent(arr[i]["data"].Get<std::string>()));
+        }
+      }
+
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        const auto& list = *(const FlexECS::ComponentIDList*)obj;
+        writer.Write<uint64_t>(list.size());
+        for (FlexECS::ComponentID component : list)
+        {
+          const std::string& component_name = FlexECS::GetComponentName(component);
+          writer.Write<uint64_t>(component_name.size());
+          writer.WriteBytes(component_name.data(), component_name.size());
+        }
+      }
+
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        auto& list = *(FlexECS::ComponentIDList*)obj;
+        std::size_t count = static_cast<std::size_t>(reader.Read<uint64_t>());
+
+        list.clear();
+        for (std::size_t i = 0; i < count && reader.is_valid; i++)
+        {
+          std::size_t length = static_cast<std::size_t>(reader.Read<uint64_t>());
+          const uint8_t* name = reader.ReadBytes(length);
+          if (name != nullptr) list.push_back(FlexECS::Internal_RegisterComponent(std::string(reinterpret_cast<const char*>(name), length)));
+        }
+      }
+    };
+    template <>
+    __FLX_API TypeDescriptor* GetPrimitiveDescriptor<FlexECS::ComponentIDList>()
+    {
+      static TypeDescriptor_ComponentIDList type_desc;
+      if (TYPE_DESCRIPTOR_LOOKUP.count(type_desc.name) == 0)
+      {
+        TYPE_DESCRIPTOR_LOOKUP[type_desc.name] = &type_desc;
+      }
+      return &type_desc;
+    }
+
+    // TypeDescriptor for FlexECS::EntityIndex.
+    // Serialized as a list of [EntityID, EntityRecord] pairs like the std::unordered_map it replaced.
+    struct __FLX_API TypeDescriptor_EntityIndex : TypeDescriptor
+    {
+      TypeDescriptor_EntityIndex()
+        : TypeDescriptor{ "EntityIndex", sizeof(FlexECS::EntityIndex), alignof(FlexECS::EntityIndex) }
+      {
+      }
+
+      virtual void Dump(const void* obj, std::ostream& os, int) const override
+      {
+        const auto& entity_index = *(const FlexECS::EntityIndex*)obj;
+        os << "EntityIndex{" << entity_index.size() << " entities}";
+      }
+
+      virtual void Serialize(const void* obj, std::ostream& os) const override
+      {
+        const auto& entity_index = *(const FlexECS::EntityIndex*)obj;
+        TypeDescriptor* key_type = TypeResolver<FlexECS::EntityID>::Get();
+        TypeDescriptor* value_type = TypeResolver<FlexECS::EntityRecord>::Get();
+
+        os << R"({"type":"EntityIndex","data":[)";
+        bool first = true;
+        for (const auto& [entity, entity_record] : entity_index)
+        {
+          if (!first) os << ",";
+          first = false;
+          os << "[";
+          key_type->Serialize(&entity, os);
+          os << ",";
+          value_type->Serialize(&entity_record, os);
+          os << "]";
+        }
+        os << "]}";
+      }
+
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        const auto& entity_index = *(const FlexECS::EntityIndex*)obj;
+        TypeDescriptor* key_type = TypeResolver<FlexECS::EntityID>::Get();
+        TypeDescriptor* value_type = TypeResolver<FlexECS::EntityRecord>::Get();
+
+        writer.StartObject();
+        writer.Key("type"); writer.String("EntityIndex");
+        writer.Key("data"); writer.StartArray();
+        for (const auto& [entity, entity_record] : entity_index)
+        {
+          writer.StartArray();
+          key_type->Serialize(&entity, writer);
+          value_type->Serialize(&entity_record, writer);
+          writer.EndArray();
+        }
+        writer.EndArray();
+        writer.EndObject();
+      }
+
+      virtual void Deserialize(void* obj, const json& value) const override
+      {
+        auto& entity_index = *(FlexECS::EntityIndex*)obj;
+        TypeDescriptor* key_type = TypeResolver<FlexECS::EntityID>::Get();
+        TypeDescriptor* value_type = TypeResolver<FlexECS::EntityRecord>::Get();
+
+        const auto& arr = value["data"].GetArray();
+        for (SizeType i = 0; i < arr.Size(); i++)
+        {
+          FlexECS::EntityID entity = 0;
+          FlexECS::EntityRecord entity_record{};
+          key_type->Deserialize(&entity, arr[i][0]);
+          value_type->Deserialize(&entity_record, arr[i][1]);
+          entity_index.Insert(entity, entity_record);
+        }
+      }
+
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        const auto& entity_index = *(const FlexECS::EntityIndex*)obj;
+        TypeDescriptor* value_type = TypeResolver<FlexECS::EntityRecord>::Get();
+
+        writer.Write<uint64_t>(entity_index.size());
+        for (const auto& [entity, entity_record] : entity_index)
+        {
+          writer.Write<FlexECS::EntityID>(entity);
+          value_type->SerializeBinary(&entity_record, writer);
+        }
+      }
+
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        auto& entity_index = *(FlexECS::EntityIndex*)obj;
+        TypeDescriptor* value_type = TypeResolver<FlexECS::EntityRecord>::Get();
+
+        std::size_t count = static_cast<std::size_t>(reader.Read<uint64_t>());
+        for (std::size_t i = 0; i < count && reader.is_valid; i++)
+        {
+          FlexECS::EntityID entity = reader.Read<FlexECS::EntityID>();
+          FlexECS::EntityRecord entity_record{};
+          value_type->DeserializeBinary(&entity_record, reader);
+          if (reader.is_valid) entity_index.Insert(entity, entity_record);
+        }
+      }
+    };
+    template <>
+    __FLX_API TypeDescriptor* GetPrimitiveDescriptor<FlexECS::EntityIndex>()
+    {
+      static TypeDescriptor_EntityIndex type_desc;
+      if (TYPE_DESCRIPTOR_LOOKUP.count(type_desc.name) == 0)
+      {
+        TYPE_DESCRIPTOR_LOOKUP[type_desc.name] = &type_desc;
+      }
+      return &type_desc;
+    }
+
+    // TypeDescriptor for FlexECS::StringTable.
+    // Serialized as a list of strings like the std::vector<std::string> it replaced,
+    // the reference counts are rebuilt from the components when the scene is loaded.
+    struct __FLX_API TypeDescriptor_StringTable : TypeDescriptor
+    {
+      TypeDescriptor_StringTable()
+        : TypeDescriptor{ "StringTable", sizeof(FlexECS::StringTable), alignof(FlexECS::StringTable) }
+      {
+      }
+
+      virtual void Dump(const void* obj, std::ostream& os, int) const override
+      {
+        const auto& string_table = *(const FlexECS::StringTable*)obj;
+        os << "StringTable{" << string_table.size() << " strings, " << string_table.GetArenaSize() << " bytes}";
+      }
+
+      virtual void Serialize(const void* obj, std::ostream& os) const override
+      {
+        const auto& string_table = *(const FlexECS::StringTable*)obj;
+        TypeDescriptor* string_type = TypeResolver<std::string>::Get();
+
+        os << R"({"type":"StringTable","data":[)";
+        for (std::size_t i = 0; i < string_table.size(); i++)
+        {
+          if (i != 0) os << ",";
+          std::string str(string_table.Get(i));
+          string_type->Serialize(&str, os);
+        }
+        os << "]}";
+      }
+
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        const auto& string_table = *(const FlexECS::StringTable*)obj;
+        TypeDescriptor* string_type = TypeResolver<std::string>::Get();
+
+        writer.StartObject();
+        writer.Key("type"); writer.String("StringTable");
+        writer.Key("data"); writer.StartArray();
+        std::string str;
+        for (std::size_t i = 0; i < string_table.size(); i++)
+        {
+          str = string_table.Get(i);
+          string_type->Serialize(&str, writer);
+        }
+        writer.EndArray();
+        writer.EndObject();
+      }
+
+      virtual void Deserialize(void* obj, const json& value) const override
+      {
+        auto& string_table = *(FlexECS::StringTable*)obj;
+        TypeDescriptor* string_type = TypeResolver<std::string>::Get();
+
+        const auto& arr = value["data"].GetArray();
+        std::string str;
+        for (SizeType i = 0; i < arr.Size(); i++)
+        {
+          string_type->Deserialize(&str, arr[i]);
+          string_table.Append(str);
+        }
+      }
+
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        const auto& string_table = *(const FlexECS::StringTable*)obj;
+
+        writer.Write<uint64_t>(string_table.size());
+        for (std::size_t i = 0; i < string_table.size(); i++)
+        {
+          std::string_view str = string_table.Get(i);
+          writer.Write<uint64_t>(str.size());
+          writer.WriteBytes(str.data(), str.size());
+        }
+      }
+
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        auto& string_table = *(FlexECS::StringTable*)obj;
+
+        std::size_t count = static_cast<std::size_t>(reader.Read<uint64_t>());
+        for (std::size_t i = 0; i < count && reader.is_valid; i++)
+        {
+          std::size_t length = static_cast<std::size_t>(reader.Read<uint64_t>());
+          const uint8_t* str = reader.ReadBytes(length);
+          if (str != nullptr) string_table.Append({ reinterpret_cast<const char*>(str), length });
+        }
+      }
+    };
+    template <>
+    __FLX_API TypeDescriptor* GetPrimitiveDescriptor<FlexECS::StringTable>()
+    {
+      static TypeDescriptor_StringTable type_desc;
+      if (TYPE_DESCRIPTOR_LOOKUP.count(type_desc.name) == 0)
+      {
+        TYPE_DESCRIPTOR_LOOKUP[type_desc.name] = &type_desc;
+      }
+      return &type_desc;
+    }
+
+    // TypeDescriptor for FlexECS::ResourceStorage.
+    // Serialized as a list of [resource name, Column] pairs,
+    // the ids are process-local so the resources are matched by name when they are loaded.
+    struct __FLX_API TypeDescriptor_ResourceStorage : TypeDescriptor
+    {
+      TypeDescriptor_ResourceStorage()
+        : TypeDescriptor{ "ResourceStorage", sizeof(FlexECS::ResourceStorage), alignof(FlexECS::ResourceStorage) }
+      {
+      }
+
+      virtual void Dump(const void* obj, std::ostream& os, int) const override
+      {
+        const auto& resources = *(const FlexECS::ResourceStorage*)obj;
+        os << "ResourceStorage{" << resources.size() << " resources}";
+      }
+
+      virtual void Serialize(const void* obj, std::ostream& os) const override
+      {
+        const auto& resources = *(const FlexECS::ResourceStorage*)obj;
+        TypeDescriptor* name_type = TypeResolver<std::string>::Get();
+        TypeDescriptor* column_type = TypeResolver<FlexECS::Column>::Get();
+
+        os << R"({"type":"ResourceStorage","data":[)";
+        bool first = true;
+        resources.Each(
+          [&](FlexECS::ComponentID resource, const FlexECS::Column& column)
+          {
+            if (!first) os << ",";
+            first = false;
+            os << "[";
+            name_type->Serialize(&FlexECS::GetComponentName(resource), os);
+            os << ",";
+            column_type->Serialize(&column, os);
+            os << "]";
+          }
+        );
+        os << "]}";
+      }
+
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        const auto& resources = *(const FlexECS::ResourceStorage*)obj;
+        TypeDescriptor* name_type = TypeResolver<std::string>::Get();
+        TypeDescriptor* column_type = TypeResolver<FlexECS::Column>::Get();
+
+        writer.StartObject();
+        writer.Key("type"); writer.String("ResourceStorage");
+        writer.Key("data"); writer.StartArray();
+        resources.Each(
+          [&](FlexECS::ComponentID resource, const FlexECS::Column& column)
+          {
+            writer.StartArray();
+            name_type->Serialize(&FlexECS::GetComponentName(resource), writer);
+            column_type->Serialize(&column, writer);
+            writer.EndArray();
+          }
+        );
+        writer.EndArray();
+        writer.EndObject();
+      }
+
+      virtual void Deserialize(void* obj, const json& value) const override
+      {
+        auto& resources = *(FlexECS::ResourceStorage*)obj;
+        TypeDescriptor* name_type = TypeResolver<std::string>::Get();
+        TypeDescriptor* column_type = TypeResolver<FlexECS::Column>::Get();
+
+        const auto& arr = value["data"].GetArray();
+        for (SizeType i = 0; i < arr.Size(); i++)
+        {
+          std::string name;
+          FlexECS::Column column;
+          name_type->Deserialize(&name, arr[i][0]);
+          column_type->Deserialize(&column, arr[i][1]);
+          if (column.size() != 1) continue;
+
+          resources.Set(FlexECS::Internal_RegisterComponent(name), column.Get(0), column.GetElementSize(), column.GetElementAlignment());
+        }
+      }
+
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        const auto& resources = *(const FlexECS::ResourceStorage*)obj;
+        TypeDescriptor* name_type = TypeResolver<std::string>::Get();
+        TypeDescriptor* column_type = TypeResolver<FlexECS::Column>::Get();
+
+        writer.Write<uint64_t>(resources.size());
+        resources.Each(
+          [&](FlexECS::ComponentID resource, const FlexECS::Column& column)
+          {
+            name_type->SerializeBinary(&FlexECS::GetComponentName(resource), writer);
+            column_type->SerializeBinary(&column, writer);
+          }
+        );
+      }
+
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        auto& resources = *(FlexECS::ResourceStorage*)obj;
+        TypeDescriptor* name_type = TypeResolver<std::string>::Get();
+        TypeDescriptor* column_type = TypeResolver<FlexECS::Column>::Get();
+
+        std::size_t count = static_cast<std::size_t>(reader.Read<uint64_t>());
+        for (std::size_t i = 0; i < count && reader.is_valid; i++)
+        {
+          std::string name;
+          FlexECS::Column column;
+          name_type->DeserializeBinary(&name, reader);
+          column_type->DeserializeBinary(&column, reader);
+          if (!reader.is_valid || column.size() != 1) continue;
+
+          resources.Set(FlexECS::Internal_RegisterComponent(name), column.Get(0), column.GetElementSize(), column.GetElementAlignment());
+        }
+      }
+    };
+    template <>
+    __FLX_API TypeDescriptor* GetPrimitiveDescriptor<FlexECS::ResourceStorage>()
+    {
+      static TypeDescriptor_ResourceStorage type_desc;
+      if (TYPE_DESCRIPTOR_LOOKUP.count(type_desc.name) == 0)
+      {
+        TYPE_DESCRIPTOR_LOOKUP[type_desc.name] = &type_desc;
+      }
+      return &type_desc;
+    }
+
+  }
+}
+
 namespace FlexEngine
 {
   namespace FlexECS
@@ -30,42 +667,397 @@ namespace FlexEngine
       FLX_REFL_REGISTER_PROPERTY(_flx_id_unused)
       FLX_REFL_REGISTER_PROPERTY(archetype_index)
       FLX_REFL_REGISTER_PROPERTY(entity_index)
-      FLX_REFL_REGISTER_PROPERTY(component_index)
+      //FLX_REFL_REGISTER_PROPERTY(component_index) // rebuilt on load
       FLX_REFL_REGISTER_PROPERTY(string_storage)
-      FLX_REFL_REGISTER_PROPERTY(string_storage_free_list)
+      FLX_REFL_REGISTER_PROPERTY(resources) // missing in older saves
     FLX_REFL_REGISTER_END;
 
     #pragma endregion
 
-    __FLX_API ComponentData<void> Internal_CreateComponentData(std::size_t size, void* data)
+    #pragma region Component Registry
+
+    // The registry is stored in function-local statics
+    // to avoid the static initialization order fiasco.
+    // Systems on other threads may register components while it is read, so every access takes the mutex.
+    // The names are in a deque so that GetComponentName can return a reference that stays valid.
+    struct ComponentRegistry
+    {
+      std::mutex mutex;
+      std::deque<std::string> names;
+      std::vector<Reflection::TypeDescriptor*> type_descriptors;
+      std::unordered_map<std::string, ComponentID> ids;
+    };
+
+    static ComponentRegistry& Internal_GetComponentRegistry()
+    {
+      static ComponentRegistry registry;
+      return registry;
+    }
+
+    __FLX_API ComponentID Internal_RegisterComponent(const std::string& name)
+    {
+      ComponentRegistry& registry = Internal_GetComponentRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+
+      auto it = registry.ids.find(name);
+      if (it != registry.ids.end()) return it->second;
+
+      ComponentID id = static_cast<ComponentID>(registry.names.size());
+      registry.names.push_back(name);
+      registry.type_descriptors.push_back(nullptr); // resolved lazily, the type may not be registered yet
+      registry.ids[name] = id;
+      return id;
+    }
+
+    __FLX_API const std::string& GetComponentName(ComponentID component)
+    {
+      ComponentRegistry& registry = Internal_GetComponentRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      return registry.names[component];
+    }
+
+    __FLX_API Reflection::TypeDescriptor* GetComponentTypeDescriptor(ComponentID component)
+    {
+      ComponentRegistry& registry = Internal_GetComponentRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      Reflection::TypeDescriptor*& type_desc = registry.type_descriptors[component];
+      if (type_desc == nullptr)
+      {
+        auto it = TYPE_DESCRIPTOR_LOOKUP.find(registry.names[component]);
+        if (it != TYPE_DESCRIPTOR_LOOKUP.end()) type_desc = it->second;
+      }
+      return type_desc;
+    }
+
+    __FLX_API std::size_t GetComponentCount()
+    {
+      ComponentRegistry& registry = Internal_GetComponentRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      return registry.names.size();
+    }
+
+    __FLX_API QueryID Internal_NextQueryID()
+    {
+      static std::atomic<QueryID> next_query_id = 0;
+      return next_query_id++;
+    }
+
+    static thread_local QueryCallerID current_query_caller = 0;
+
+    __FLX_API QueryCallerID Internal_NextQueryCallerID()
+    {
+      static std::atomic<QueryCallerID> next_query_caller_id = 1;
+      return next_query_caller_id++;
+    }
+
+    __FLX_API QueryCallerID GetQueryCaller()
+    {
+      return current_query_caller;
+    }
+
+    __FLX_API QueryCallerID SetQueryCaller(QueryCallerID caller)
+    {
+      QueryCallerID previous = current_query_caller;
+      current_query_caller = caller;
+      return previous;
+    }
+
+    #pragma endregion
+
+    #pragma region EntityIndex
+
+    void EntityIndex::Insert(EntityID entity, const EntityRecord& record)
+    {
+      std::size_t slot = Internal_GetSlot(entity);
+      if (slot >= m_slots.size()) m_slots.resize(slot + 1);
+
+      if (m_slots[slot].id == 0) m_size++;
+      m_slots[slot].id = entity;
+      m_slots[slot].record = record;
+    }
+
+    void EntityIndex::Reserve(std::size_t slot_count)
+    {
+      if (slot_count > m_slots.size()) m_slots.resize(slot_count);
+    }
+
+    void EntityIndex::Erase(EntityID entity)
+    {
+      // guard: stale handles must not empty the slot of a newer entity
+      if (!Contains(entity)) return;
+
+      m_slots[Internal_GetSlot(entity)] = Slot();
+      m_size--;
+    }
+
+    #pragma endregion
+
+    #pragma region Column
+
+    std::atomic<uint64_t> Column::s_change_tick = 1;
+
+    Column::Column(std::size_t element_size, std::size_t element_alignment)
+      : m_element_size(element_size)
+      , m_element_alignment(std::max(element_alignment, alignof(std::max_align_t)))
+    {
+    }
+
+    Column::~Column()
+    {
+      Internal_Free();
+    }
+
+    Column::Column(const Column& other)
+      : m_element_size(other.m_element_size)
+      , m_element_alignment(other.m_element_alignment)
+      , m_chunk_versions(other.m_chunk_versions)
+      , m_version(other.m_version)
+    {
+      Internal_Reallocate(other.m_size);
+      if (other.m_size != 0) memcpy(m_data, other.m_data, other.m_size * m_element_size);
+      m_size = other.m_size;
+    }
+
+    Column::Column(Column&& other) noexcept
+      : m_element_size(other.m_element_size)
+      , m_element_alignment(other.m_element_alignment)
+      , m_size(other.m_size)
+      , m_capacity(other.m_capacity)
+      , m_data(other.m_data)
+      , m_chunk_versions(std::move(other.m_chunk_versions))
+      , m_version(other.m_version)
+    {
+      other.m_size = 0;
+      other.m_capacity = 0;
+      other.m_data = nullptr;
+    }
+
+    Column& Column::operator=(const Column& other)
     {
-      // Create a new data structure
-      void* ptr = new char[sizeof(std::size_t) + size];
-      if (!ptr)
+      if (this == &other) return *this;
+
+      Internal_Free();
+      m_element_size = other.m_element_size;
+      m_element_alignment = other.m_element_alignment;
+      Internal_Reallocate(other.m_size);
+      if (other.m_size != 0) memcpy(m_data, other.m_data, other.m_size * m_element_size);
+      m_size = other.m_size;
+      m_chunk_versions = other.m_chunk_versions;
+      m_version = other.m_version;
+
+      return *this;
+    }
+
+    Column& Column::operator=(Column&& other) noexcept
+    {
+      if (this == &other) return *this;
+
+      Internal_Free();
+      m_element_size = other.m_element_size;
+      m_element_alignment = other.m_element_alignment;
+      m_size = other.m_size;
+      m_capacity = other.m_capacity;
+      m_data = other.m_data;
+      m_chunk_versions = std::move(other.m_chunk_versions);
+      m_version = other.m_version;
+
+      other.m_size = 0;
+      other.m_capacity = 0;
+      other.m_data = nullptr;
+
+      return *this;
+    }
+
+    void Column::Reserve(std::size_t capacity)
+    {
+      if (capacity <= m_capacity) return;
+      Internal_Reallocate(capacity);
+    }
+
+    void* Column::PushBack(const void* element)
+    {
+      // grow geometrically
+      if (m_size == m_capacity)
       {
-        FLX_ASSERT(false, "Failed to allocate memory for component data!");
-        return nullptr;
+        // the element might be inside the buffer that is about to be freed
+        const uint8_t* src = static_cast<const uint8_t*>(element);
+        bool is_internal = (src >= m_data && src < m_data + m_size * m_element_size);
+        std::size_t offset = is_internal ? static_cast<std::size_t>(src - m_data) : 0;
+
+        Internal_Reallocate(m_capacity == 0 ? 8 : m_capacity * 2);
+
+        if (is_internal) element = m_data + offset;
       }
 
-      // Copy the size of the data
-      memcpy(ptr, &size, sizeof(std::size_t));
+      void* destination = m_data + m_size * m_element_size;
+      memcpy(destination, element, m_element_size);
+      m_size++;
+      MarkChanged(m_size - 1);
 
-      // Copy the data
-      memcpy(reinterpret_cast<std::size_t*>(ptr) + 1, data, size);
+      return destination;
+    }
+
+    void Column::PushBackRepeated(const void* element, std::size_t count)
+    {
+      // guard: nothing to copy
+      if (count == 0) return;
+
+      if (m_size + count > m_capacity)
+      {
+        // the element might be inside the buffer that is about to be freed
+        const uint8_t* src = static_cast<const uint8_t*>(element);
+        bool is_internal = (src != nullptr && src >= m_data && src < m_data + m_size * m_element_size);
+        std::size_t offset = is_internal ? static_cast<std::size_t>(src - m_data) : 0;
 
-      return ComponentData<void>(ptr, [](void* ptr) { delete[] reinterpret_cast<char*>(ptr); });
+        Internal_Reallocate(std::max(m_size + count, m_capacity * 2));
+
+        if (is_internal) element = m_data + offset;
+      }
+
+      uint8_t* destination = m_data + m_size * m_element_size;
+      std::size_t total_bytes = count * m_element_size;
+
+      if (element == nullptr)
+      {
+        memset(destination, 0, total_bytes);
+      }
+      else
+      {
+        // copy the first element, then keep doubling the copied block
+        memcpy(destination, element, m_element_size);
+        std::size_t copied_bytes = m_element_size;
+        while (copied_bytes < total_bytes)
+        {
+          std::size_t chunk = std::min(copied_bytes, total_bytes - copied_bytes);
+          memcpy(destination + copied_bytes, destination, chunk);
+          copied_bytes += chunk;
+        }
+      }
+
+      m_size += count;
+      MarkChanged(m_size - count, count);
+    }
+
+    void Column::PushBackRange(const void* elements, std::size_t count)
+    {
+      // guard: nothing to copy
+      if (count == 0) return;
+
+      if (m_size + count > m_capacity) Internal_Reallocate(std::max(m_size + count, m_capacity * 2));
+
+      memcpy(m_data + m_size * m_element_size, elements, count * m_element_size);
+      m_size += count;
+      MarkChanged(m_size - count, count);
+    }
+
+    void Column::PopBack()
+    {
+      FLX_ASSERT(m_size != 0, "Column::PopBack called on an empty column!");
+      m_size--;
     }
 
-    __FLX_API std::pair<std::size_t, void*> Internal_GetComponentData(ComponentData<void> data)
+    void Column::SwapRemove(std::size_t row)
     {
-      std::size_t* size_ptr = reinterpret_cast<std::size_t*>(data.get());
-      return {
-        // Get the size of the data
-        *size_ptr,
-        // Get the data pointer
-        reinterpret_cast<void*>(size_ptr + 1)
-      };
+      std::size_t last_row = m_size - 1;
+      if (row != last_row)
+      {
+        memcpy(m_data + row * m_element_size, m_data + last_row * m_element_size, m_element_size);
+
+        // the row holds another entity now, which the queries have not seen in this chunk
+        MarkChanged(row);
+      }
+      m_size--;
     }
 
+    void Column::Clear()
+    {
+      m_size = 0;
+    }
+
+    void Column::MarkChanged(std::size_t first_row, std::size_t count)
+    {
+      // guard: nothing to stamp
+      if (count == 0) return;
+
+      const uint64_t tick = GetChangeTick();
+      const std::size_t first_chunk = first_row >> CHANGE_CHUNK_SHIFT;
+      const std::size_t last_chunk = (first_row + count - 1) >> CHANGE_CHUNK_SHIFT;
+
+      // new rows are always stamped, so this only grows when rows are added
+      if (last_chunk >= m_chunk_versions.size()) m_chunk_versions.resize(last_chunk + 1, 0);
+
+      for (std::size_t chunk = first_chunk; chunk <= last_chunk; chunk++) m_chunk_versions[chunk].StoreMax(tick);
+      m_version.StoreMax(tick);
+    }
+
+    void Column::Version::StoreMax(uint64_t tick)
+    {
+      uint64_t current = value.load(std::memory_order_relaxed);
+      while (current < tick && !value.compare_exchange_weak(current, tick, std::memory_order_relaxed));
+    }
+
+    void Column::Internal_Reallocate(std::size_t capacity)
+    {
+      if (capacity == 0 || m_element_size == 0)
+      {
+        m_capacity = capacity;
+        return;
+      }
+
+      uint8_t* new_data = static_cast<uint8_t*>(
+        ::operator new(capacity * m_element_size, std::align_val_t{ m_element_alignment })
+      );
+      if (m_data)
+      {
+        if (m_size != 0) memcpy(new_data, m_data, m_size * m_element_size);
+        ::operator delete(m_data, std::align_val_t{ m_element_alignment });
+      }
+
+      m_data = new_data;
+      m_capacity = capacity;
+    }
+
+    void Column::Internal_Free()
+    {
+      if (m_data) ::operator delete(m_data, std::align_val_t{ m_element_alignment });
+      m_data = nullptr;
+      m_size = 0;
+      m_capacity = 0;
+    }
+
+    #pragma endregion
+
+    #pragma region ResourceStorage
+
+    void* ResourceStorage::Set(ComponentID resource, const void* data, std::size_t element_size, std::size_t element_alignment)
+    {
+      if (resource >= m_resources.size()) m_resources.resize(resource + 1);
+
+      // overwrite the existing resource
+      Column& column = m_resources[resource];
+      if (!column.empty() && column.GetElementSize() == element_size)
+      {
+        std::memmove(column.Get(0), data, element_size);
+        column.MarkChanged(0);
+        return column.Get(0);
+      }
+
+      if (column.empty()) m_count++;
+      column = Column(element_size, element_alignment);
+      return column.PushBack(data);
+    }
+
+    bool ResourceStorage::Remove(ComponentID resource)
+    {
+      // guard: the scene does not have the resource
+      if (!Contains(resource)) return false;
+
+      m_resources[resource] = Column();
+      m_count--;
+      return true;
+    }
+
+    #pragma endregion
+
   }
 }
\ No newline at end of file
@@ -10,10 +10,20 @@
 #include "Reflection/base.h"  // "Wrapper/flexassert.h" <rapidjson/document.h>
                               // <cstddef> <iostream> <string> <sstream> <vector> <map> <unordered_map> <functional>
 #include "Wrapper/file.h" // "Wrapper/path.h" <fstream>
+#include "DataStructures/threadpool.h" // <thread> <mutex> <functional>
+#include "FlexMath/matrix4x4.h"
 
 #include <algorithm> // std::sort
 #include <typeindex> // std::type_index
 #include <memory> // std::shared_ptr
+#include <new> // std::align_val_t
+#include <utility> // std::index_sequence
+#include <type_traits> // std::is_invocable_v
+#include <cstring> // std::memcpy
+#include <deque> // std::deque
+#include <mutex> // std::mutex
+#include <atomic> // std::atomic
+#include <string_view> // std::string_view
 
 namespace FlexEngine
 {
@@ -35,6 +45,7 @@ namespace FlexEngine
 
     class Scene;
     class Entity;
+    class EntityCommandBuffer;
     struct ArchetypeEdge;
 
 
@@ -48,18 +59,106 @@ namespace FlexEngine
     // Use FlexECS::ID functions to manage the ID
     using EntityID = uint64_t;
 
-    // Stringified type descriptor for components
-    // Use TYPE_DESCRIPTOR_LOOKUP to convert the string back to the TypeDescriptor
-    using ComponentID = std::string;
+    // Dense integer identifier for component types
+    // Assigned the first time a component type is used, see GetComponentID<T>()
+    // The ids are only stable for the lifetime of the process,
+    // the type name is what gets serialized.
+    using ComponentID = uint32_t;
 
     // Just a unique identifier for an archetype counting up from 0
     using ArchetypeID = uint64_t;
 
+    // Dense integer identifier for a query (an ordered list of component types)
+    // Assigned the first time a query is used, see GetQueryID<Ts...>()
+    using QueryID = uint32_t;
 
-    // A vector of ComponentIDs
+    // Identifies who runs a query, so that each caller of a Changed<T> query
+    // gets its own last run tick instead of consuming the changes seen by the others.
+    // SystemScheduler gives each system its own caller while it runs,
+    // queries made outside of a system share caller 0.
+    using QueryCallerID = uint64_t;
+
+
+    // A sorted list of ComponentIDs
     // Unique identifier for an archetype
     // Make sure to sort the list of component ids before using it as a key
-    using ComponentIDList = std::vector<ComponentID>;
+    // 
+    // This is a distinct type instead of an alias so that the reflection system
+    // can serialize it by component name instead of by the process-local id.
+    class ComponentIDList : public std::vector<ComponentID>
+    {
+    public:
+      using std::vector<ComponentID>::vector;
+    };
+
+    #pragma region Component Registry
+
+    // Registers a component type by its reflected type name and returns its id.
+    // Registering the same name twice returns the same id.
+    // Prefer GetComponentID<T>() which caches the id per type.
+    __FLX_API ComponentID Internal_RegisterComponent(const std::string& name);
+
+    // Returns the reflected type name of the component.
+    // Only used for serialization and debugging.
+    __FLX_API const std::string& GetComponentName(ComponentID component);
+
+    // Returns the type descriptor of the component.
+    // Returns nullptr if the type is not registered with the reflection system.
+    __FLX_API Reflection::TypeDescriptor* GetComponentTypeDescriptor(ComponentID component);
+
+    // Returns the number of registered component types.
+    __FLX_API std::size_t GetComponentCount();
+
+    // Returns the id of the component type.
+    // The lookup by name only happens on the first call for each type.
+    // const T has the same id as T.
+    // Usage: ComponentID id = GetComponentID<Transform>();
+    template <typename T>
+    ComponentID GetComponentID()
+    {
+      static const ComponentID id = Internal_RegisterComponent(Reflection::TypeResolver<std::remove_const_t<T>>::Get()->name);
+      return id;
+    }
+
+    // Returns a new query id.
+    // Prefer GetQueryID<Ts...>() which caches the id per component list.
+    __FLX_API QueryID Internal_NextQueryID();
+
+    // Returns the id of the query for the component list.
+    // The order of the components matters because the cached columns are stored in that order.
+    // Usage: QueryID id = GetQueryID<Position, Rigidbody>();
+    template <typename... Ts>
+    QueryID GetQueryID()
+    {
+      static const QueryID id = Internal_NextQueryID();
+      return id;
+    }
+
+    // Returns a new query caller id, never 0.
+    __FLX_API QueryCallerID Internal_NextQueryCallerID();
+
+    // Returns the query caller of the current thread.
+    __FLX_API QueryCallerID GetQueryCaller();
+
+    // Sets the query caller of the current thread and returns the previous one.
+    // Prefer QueryCallerScope which restores the previous caller.
+    __FLX_API QueryCallerID SetQueryCaller(QueryCallerID caller);
+
+    // Runs the queries of the current thread as the caller until the end of the scope.
+    // Usage: QueryCallerScope scope(caller);
+    class QueryCallerScope
+    {
+      QueryCallerID m_previous;
+
+    public:
+      explicit QueryCallerScope(QueryCallerID caller) : m_previous(SetQueryCaller(caller)) {}
+      ~QueryCallerScope() { SetQueryCaller(m_previous); }
+
+      QueryCallerScope(const QueryCallerScope&) = delete;
+      QueryCallerScope& operator=(const QueryCallerScope&) = delete;
+    };
+
+    #pragma endregion
 
     #pragma region Specializations for std::hash and std::equal_to
 
@@ -70,15 +169,15 @@ namespace std
 {
 
   // Specialize std::hash for FlexEngine::FlexECS::ComponentIDList
+  // Combines the ids in order so that different lists don't cancel each other out.
   template <>
   struct hash<FlexEngine::FlexECS::ComponentIDList>
   {
     std::size_t operator()(const FlexEngine::FlexECS::ComponentIDList& list) const
     {
-      // Implement the hash function
-      std::size_t hash_value = 0;
+      std::size_t hash_value = list.size();
       for (const auto& id : list)
-        hash_value ^= std::hash<FlexEngine::FlexECS::ComponentID>()(id);
+        hash_value ^= std::hash<FlexEngine::FlexECS::ComponentID>()(id) + 0x9e3779b9 + (hash_value << 6) + (hash_value >> 2);
       return hash_value;
     }
   };
@@ -109,22 +208,144 @@ namespace FlexEngine
 
     // Component table
 
-    // ComponentData<void> is a special internal type that can hold any component data.
-    // The void* it holds is type erased and must be cast to the correct type.
-    // The first sizeof(std::size_t) bytes are used to store the size of the data.
-    template <typename T = void>
-    using ComponentData = std::shared_ptr<T>;
+    // Type-erased contiguous storage for a single component type in an archetype.
+    // The component data is stored back to back in one buffer, so iterating over a
+    // column walks linear memory instead of chasing a heap pointer per entity.
+    // 
+    // The element size and alignment come from the component's TypeDescriptor.
+    // Components are moved around with memcpy, so they must be trivially relocatable.
+    // This was already assumed by the old shared_ptr<void> storage.
+    // 
+    // Each column also tracks when its rows were last written.
+    // The rows are grouped into change chunks of CHANGE_CHUNK_SIZE rows,
+    // every write stamps the chunk with the current change tick.
+    // Mutable access through the ECS stamps the rows, see Scene::Each and Entity::GetComponent,
+    // and the Changed<T> query filter skips the chunks that were not stamped since the query last ran.
+    class __FLX_API Column
+    {
+      std::size_t m_element_size = 0;
+      std::size_t m_element_alignment = alignof(std::max_align_t);
+      std::size_t m_size = 0;
+      std::size_t m_capacity = 0;
+      uint8_t* m_data = nullptr;
+
+      // Change versions are written from the threads that run queries and systems,
+      // see Entity::GetComponent, so they are atomic.
+      // Copying only happens on structural changes, which never run in parallel.
+      struct Version
+      {
+        std::atomic<uint64_t> value;
 
-    // Create a new ComponentData<void>
-    __FLX_API ComponentData<void> Internal_CreateComponentData(std::size_t size, void* data);
+        Version(uint64_t tick = 0) : value(tick) {}
+        Version(const Version& other) : value(other.value.load(std::memory_order_relaxed)) {}
+        Version& operator=(const Version& other) { value.store(other.value.load(std::memory_order_relaxed), std::memory_order_relaxed); return *this; }
 
-    // Get the size and data pointer from a ComponentData<void>
-    __FLX_API std::pair<std::size_t, void*> Internal_GetComponentData(ComponentData<void> data);
+        uint64_t Load() const { return value.load(std::memory_order_relaxed); }
 
+        // Keeps the newest tick if another thread stamped a newer one in between
+        void StoreMax(uint64_t tick);
+      };
 
-    using Column = std::vector<ComponentData<void>>;
-    using Row = std::vector<Column>;
-    using ArchetypeTable = Row;
+      // Newest change tick of each change chunk, and of the whole column
+      std::vector<Version> m_chunk_versions;
+      Version m_version;
+
+      // Shared by every column so that ticks can be compared across archetypes and scenes.
+      static std::atomic<uint64_t> s_change_tick;
+
+    public:
+      // Number of rows that share one change version
+      static constexpr std::size_t CHANGE_CHUNK_SHIFT = 10;
+      static constexpr std::size_t CHANGE_CHUNK_SIZE = std::size_t(1) << CHANGE_CHUNK_SHIFT;
+
+      Column() = default;
+      Column(std::size_t element_size, std::size_t element_alignment = alignof(std::max_align_t));
+      ~Column();
+
+      Column(const Column& other);
+      Column(Column&& other) noexcept;
+      Column& operator=(const Column& other);
+      Column& operator=(Column&& other) noexcept;
+
+      #pragma region Passthrough Functions
+
+      std::size_t size() const { return m_size; }
+      std::size_t capacity() const { return m_capacity; }
+      bool empty() const { return m_size == 0; }
+
+      void* data() { return m_data; }
+      const void* data() const { return m_data; }
+
+      #pragma endregion
+
+      std::size_t GetElementSize() const { return m_element_size; }
+      std::size_t GetElementAlignment() const { return m_element_alignment; }
+
+      // Returns a pointer to the component data in the row.
+      // There is no bounds checking.
+      void* Get(std::size_t row) { return m_data + row * m_element_size; }
+      const void* Get(std::size_t row) const { return m_data + row * m_element_size; }
+
+      // Grows the buffer to fit at least the requested number of elements.
+      void Reserve(std::size_t capacity);
+
+      // Copies one element to the end of the column and returns a pointer to it.
+      // The element may point into this column.
+      void* PushBack(const void* element);
+
+      // Copies one element to the end of the column count times.
+      // The buffer grows at most once. A nullptr element zero-initializes the new rows.
+      // The element may point into this column.
+      void PushBackRepeated(const void* element, std::size_t count);
+
+      // Copies count elements that are stored back to back to the end of the column.
+      // The buffer grows at most once. The elements must not point into this column.
+      void PushBackRange(const void* elements, std::size_t count);
+
+      // Removes the last element.
+      void PopBack();
+
+      // Removes the element by moving the last element into its row.
+      // Using swap-and-pop is more performant than erase() since it does not
+      // shift all subsequent elements forward.
+      void SwapRemove(std::size_t row);
+
+      // Removes all elements but keeps the buffer.
+      void Clear();
+
+      #pragma region Change Tracking
+
+      // The change tick starts at 1, so a query that never ran (last run tick 0) sees every row.
+      static uint64_t GetChangeTick() { return s_change_tick.load(std::memory_order_relaxed); }
+
+      // Starts a new tick and returns it.
+      // Writes made before this call are older than the returned tick.
+      static uint64_t AdvanceChangeTick() { return s_change_tick.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+      // Stamps the rows with the current change tick.
+      // Call this after writing to the rows through Get or data().
+      // Safe to call from several threads on existing rows,
+      // the chunk versions only grow when rows are added.
+      void MarkChanged(std::size_t row) { MarkChanged(row, 1); }
+      void MarkChanged(std::size_t first_row, std::size_t count);
+
+      // Newest change tick of any row in the column
+      uint64_t GetVersion() const { return m_version.Load(); }
+
+      // Newest change tick of the change chunk
+      uint64_t GetChunkVersion(std::size_t chunk) const { return m_chunk_versions[chunk].Load(); }
+
+      // Number of change chunks covering the rows
+      std::size_t GetChunkCount() const { return m_chunk_versions.size(); }
+
+      #pragma endregion
+
+    private:
+      void Internal_Reallocate(std::size_t capacity);
+      void Internal_Free();
+    };
+
+    using ArchetypeTable = std::vector<Column>;
 
     // Type used to store each unique component list only once
     // This is the main data structure used to store entities and components
@@ -139,10 +360,26 @@ namespace FlexEngine
 
     // Edges to other archetypes
     // Use pointers instead of references for lazy initialization
+    // Each direction also caches where the columns of this archetype go in the other archetype,
+    // so moving an entity along an edge is one copy per column without any index lookups.
+    // Edges are linked in both directions when an archetype is created, see Entity::Internal_LinkArchetypes
     struct ArchetypeEdge
     {
+      // Marks the column of the removed component in remove_columns
+      static constexpr std::size_t NO_COLUMN = static_cast<std::size_t>(-1);
+
       Archetype* add = nullptr;
       Archetype* remove = nullptr;
+
+      // add_columns[i] is the column in add for column i of this archetype
+      std::vector<std::size_t> add_columns;
+      // The column of the added component in add
+      std::size_t add_component_column = 0;
+
+      // remove_columns[i] is the column in remove for column i of this archetype,
+      // NO_COLUMN for the removed component
+      std::vector<std::size_t> remove_columns;
+
       //ArchetypeID archetype_id_add = 0;     // used during deserialization to reconnect the archetype ptr
       //ArchetypeID archetype_id_remove = 0;  // used during deserialization to reconnect the archetype ptr
     };
@@ -161,6 +398,96 @@ namespace FlexEngine
       std::size_t row;
     };
 
+    // Dense entity index keyed by ID::GetID(entity)
+    // Replaces std::unordered_map<EntityID, EntityRecord> so that a lookup is a single array access.
+    // 
+    // Each slot stores the full id of the entity that owns it.
+    // A handle is only valid if its id and generation match the slot,
+    // so a handle from a destroyed entity is rejected in O(1).
+    // The flags are not part of the key, changing them does not move the record.
+    // 
+    // Slots are reused through the scene's _flx_id_unused free list (see ID::Create and ID::Destroy).
+    class __FLX_API EntityIndex
+    {
+    public:
+      struct Slot
+      {
+        EntityID id = 0; // 0 if the slot is empty
+        EntityRecord record{};
+      };
+
+      // Iterates over the occupied slots only
+      // Usage: for (auto& [entity, entity_record] : entity_index) { ... }
+      template <typename SlotType>
+      class Iterator
+      {
+        SlotType* m_current;
+        SlotType* m_end;
+
+        void Internal_SkipEmpty() { while (m_current != m_end && m_current->id == 0) m_current++; }
+
+      public:
+        Iterator(SlotType* current, SlotType* end) : m_current(current), m_end(end) { Internal_SkipEmpty(); }
+
+        SlotType& operator*() const { return *m_current; }
+        SlotType* operator->() const { return m_current; }
+        Iterator& operator++() { m_current++; Internal_SkipEmpty(); return *this; }
+        bool operator==(const Iterator& other) const { return m_current == other.m_current; }
+        bool operator!=(const Iterator& other) const { return m_current != other.m_current; }
+      };
+
+    private:
+      // Masks out the flags, leaving the id and the generation
+      static constexpr EntityID MASK_KEY = ~(static_cast<EntityID>(ID::MASK_FLAGS) << ID::SHIFT_FLAGS);
+
+      std::vector<Slot> m_slots;
+      std::size_t m_size = 0;
+
+      static std::size_t Internal_GetSlot(EntityID entity) { return static_cast<std::size_t>(entity & ID::MASK_ID); }
+
+    public:
+      // Returns true if the entity exists and the handle is not stale
+      bool Contains(EntityID entity) const
+      {
+        std::size_t slot = Internal_GetSlot(entity);
+        return entity != 0 && slot < m_slots.size() && ((m_slots[slot].id ^ entity) & MASK_KEY) == 0;
+      }
+
+      // Returns nullptr if the entity does not exist or the handle is stale
+      EntityRecord* Find(EntityID entity) { return Contains(entity) ? &m_slots[Internal_GetSlot(entity)].record : nullptr; }
+
+      // Unchecked lookup, the entity must exist
+      // Use Contains or Find if the handle may be stale
+      EntityRecord& operator[](EntityID entity)
+      {
+        #ifdef _DEBUG
+        FLX_ASSERT(Contains(entity), "Entity does not exist or the handle is stale: " + std::to_string(entity));
+        #endif
+        return m_slots[Internal_GetSlot(entity)].record;
+      }
+
+      // Adds the entity or overwrites the record in its slot
+      // Also used to update the flags stored in the slot
+      void Insert(EntityID entity, const EntityRecord& record);
+
+      // Grows the slot array to fit ids up to slot_count - 1
+      // Used before inserting many entities at once
+      void Reserve(std::size_t slot_count);
+
+      // Empties the slot of the entity
+      // Stale handles are ignored
+      void Erase(EntityID entity);
+
+      std::size_t size() const { return m_size; }
+      bool empty() const { return m_size == 0; }
+      void clear() { m_slots.clear(); m_size = 0; }
+
+      Iterator<Slot> begin() { return { m_slots.data(), m_slots.data() + m_slots.size() }; }
+      Iterator<Slot> end() { return { m_slots.data() + m_slots.size(), m_slots.data() + m_slots.size() }; }
+      Iterator<const Slot> begin() const { return { m_slots.data(), m_slots.data() + m_slots.size() }; }
+      Iterator<const Slot> end() const { return { m_slots.data() + m_slots.size(), m_slots.data() + m_slots.size() }; }
+    };
+
 
 
 
@@ -174,32 +501,381 @@ namespace FlexEngine
     // Used to lookup components in archetypes
     using ArchetypeMap = std::unordered_map<ArchetypeID, ArchetypeRecord>;
 
+
+
+
+
+    #pragma region Query Filters
+
+    // Query filter that only visits the rows where the component was written
+    // since the last time the same caller ran the same query, see QueryCallerID.
+    // The component is still passed to the function, use Changed<const T> for read-only access.
+    // With several Changed terms a row is visited if any of them changed.
+    // 
+    // Changes are tracked per change chunk (see Column), so the unchanged neighbors
+    // of a changed row in the same chunk are visited as well.
+    // Usage: scene->Each<Changed<const Position>, Transform>([](const Position& position, Transform& transform) { ... });
+    template <typename T>
+    struct Changed
+    {
+      using type = T;
+    };
+
+    // Strips the query filter from a query term.
+    template <typename T>
+    struct QueryTerm
+    {
+      using type = T;
+      static constexpr bool is_changed = false;
+    };
+
+    template <typename T>
+    struct QueryTerm<Changed<T>>
+    {
+      using type = T;
+      static constexpr bool is_changed = true;
+    };
+
+    // The component type of a query term, may be const
+    template <typename T>
+    using QueryComponent = typename QueryTerm<T>::type;
+
+    #pragma endregion
+
+    // Cached result of a query
+    // Stores the archetypes that have all of the components in the query
+    // and the column of each component in those archetypes.
+    // New archetypes are tested against the cached queries when they are created,
+    // so resolving a query only costs a full scan the first time it is used.
+    struct __FLX_API QueryCache
+    {
+      bool is_initialized = false;
+      ComponentIDList components; // in query order, not sorted
+      std::vector<Archetype*> archetypes;
+      std::vector<std::size_t> columns; // archetypes.size() * components.size(), in query order
+
+      // Number of archetypes tested against this query
+      // Should be 0 every frame once the archetypes have settled
+      std::size_t match_count = 0;
+      std::size_t match_count_last_frame = 0;
+
+      // Change tick of the last run of each caller, for queries with a Changed<T> filter
+      // Guarded by the mutex of the QueryCacheList, see Scene::Internal_ExchangeLastRunTick
+      std::vector<std::pair<QueryCallerID, uint64_t>> last_run_ticks;
+    };
+
+    // Indexed by QueryID
+    // The caches point into the archetype index of their scene,
+    // so a copied list starts empty and the copy rebuilds its own caches.
+    // 
+    // This is a deque so that growing the list does not move the caches,
+    // a system can keep iterating a cache while another system resolves a new query.
+    // The mutex guards the lookup in Scene::GetQueryCache.
+    class QueryCacheList : public std::deque<QueryCache>
+    {
+    public:
+      std::mutex mutex;
+
+      QueryCacheList() = default;
+      // the caches are rebuilt by the copy, not copied
+      QueryCacheList(const QueryCacheList&) : std::deque<QueryCache>() {}
+      QueryCacheList& operator=(const QueryCacheList&) { clear(); return *this; }
+      QueryCacheList(QueryCacheList&& other) noexcept : std::deque<QueryCache>(std::move(other)) {}
+      QueryCacheList& operator=(QueryCacheList&& other) noexcept { std::deque<QueryCache>::operator=(std::move(other)); return *this; }
+    };
+
+    // Parent-child transform hierarchy stored in flat arrays.
+    // 
+    // The entities are kept sorted by depth, so every parent comes before its children
+    // and the world matrices are rebuilt in one linear pass without walking parent chains.
+    // Only the entities that are dirty and their descendants are recomputed,
+    // the pass starts at the first dirty entity.
+    // 
+    // The hierarchy does not know the components of the game.
+    // Systems push the local matrix and the parent of each entity, usually from Changed<T> queries,
+    // call Update, and read the world matrices back.
+    // The world matrices are stored back to back in sorted order and each Matrix4x4 is 64 byte aligned,
+    // so renderers can use the array directly.
+    // 
+    // Usage:
+    // hierarchy.SetLocalMatrix(entity, local_matrix);
+    // hierarchy.SetParent(child, entity);
+    // hierarchy.Update();
+    // hierarchy.EachChanged([](EntityID entity, const Matrix4x4& world_matrix) { ... });
+    class __FLX_API TransformHierarchy
+    {
+    public:
+      // Marks a root in the parent indexes
+      static constexpr uint32_t NO_PARENT = static_cast<uint32_t>(-1);
+
+    private:
+      // Dense arrays in sorted order
+      std::vector<EntityID> m_entities;
+      std::vector<EntityID> m_parents; // 0 for roots
+      std::vector<uint32_t> m_parent_indexes; // NO_PARENT for roots, only valid while sorted
+      std::vector<Matrix4x4> m_local_matrices;
+      std::vector<Matrix4x4> m_world_matrices;
+      std::vector<uint8_t> m_is_dirty; // REMOVED until the next compaction for removed entities
+      std::vector<uint8_t> m_is_changed; // the world matrix was recomputed in the last Update
+
+      // Entity slot to dense index + 1, 0 if the entity is not in the hierarchy
+      std::vector<uint32_t> m_lookup;
+
+      bool m_is_sorted = true;
+      std::size_t m_first_dirty = 0; // size() if nothing is dirty
+      std::size_t m_changed_count = 0;
+      std::size_t m_removed_count = 0; // removed entities still in the arrays
+
+    public:
+      // Adds the entity as a root if it is not in the hierarchy yet.
+      void Add(EntityID entity);
+
+      // Sets the parent of the entity, 0 or Entity::Null makes it a root.
+      // Both entities are added if they are not in the hierarchy yet.
+      // Parenting an entity to one of its descendants is reported when the hierarchy is sorted
+      // and the entity becomes a root.
+      void SetParent(EntityID entity, EntityID parent);
+
+      // Sets the local matrix of the entity and marks it dirty.
+      // The entity is added as a root if it is not in the hierarchy yet.
+      void SetLocalMatrix(EntityID entity, const Matrix4x4& local_matrix);
+
+      // Removes the entity, its children become roots.
+      // The entity is only flagged, it stays in the dense arrays until the next Update,
+      // so removing many entities costs one compaction.
+      // Children whose parent is removed and added again before the Update keep their parent.
+      void Remove(EntityID entity);
+
+      // Removes every entity that no longer exists in the entity index,
+      // for entities that were destroyed without being removed.
+      // Compacts right away, together with the entities flagged by Remove.
+      void RemoveDestroyed(const EntityIndex& entity_index);
+
+      void Clear();
+
+      // Sorts the entities if the hierarchy changed,
+      // then recomputes the world matrices of the dirty entities and their descendants.
+      void Update();
+
+      bool Contains(EntityID entity) const;
+
+      // Returns the identity matrix if the entity is not in the hierarchy.
+      const Matrix4x4& GetWorldMatrix(EntityID entity) const;
+
+      #pragma region Passthrough Functions
+
+      std::size_t size() const { return m_entities.size(); }
+      bool empty() const { return m_entities.empty(); }
+
+      #pragma endregion
+
+      // Dense arrays in sorted order, size() elements each.
+      // Valid until the next call that changes the hierarchy.
+      // Removed entities are still listed until the next Update.
+      const EntityID* GetEntities() const { return m_entities.data(); }
+      const Matrix4x4* GetWorldMatrices() const { return m_world_matrices.data(); }
+
+      // Number of world matrices recomputed in the last Update
+      std::size_t GetChangedCount() const { return m_changed_count; }
+
+      // Calls the function for every entity whose world matrix was recomputed in the last Update.
+      // Usage: hierarchy.EachChanged([](EntityID entity, const Matrix4x4& world_matrix) { ... });
+      template <typename Fn>
+      void EachChanged(Fn&& fn) const
+      {
+        // guard: nothing changed
+        if (m_changed_count == 0) return;
+
+        for (std::size_t i = 0; i < m_entities.size(); i++)
+        {
+          if (m_is_changed[i]) fn(m_entities[i], m_world_matrices[i]);
+        }
+      }
+
+    private:
+      // INTERNAL FUNCTION
+      // Returns the dense index of the entity, NO_PARENT if it is not in the hierarchy.
+      uint32_t Internal_Find(EntityID entity) const;
+
+      // INTERNAL FUNCTION
+      // Sorts the entities by depth and rebuilds the parent indexes.
+      void Internal_Sort();
+
+      // INTERNAL FUNCTION
+      // Flags the entity at the dense index as removed, see Internal_Compact.
+      void Internal_FlagRemoved(std::size_t index);
+
+      // INTERNAL FUNCTION
+      // Removes the flagged entities, keeping the order of the rest.
+      // Children of removed entities become roots.
+      void Internal_Compact();
+
+      // INTERNAL FUNCTION
+      void Internal_MarkDirty(std::size_t index);
+    };
+
+    // Interning table for the strings of a scene.
+    //
+    // The characters of every string are stored back to back in one arena, each followed by a null terminator.
+    // A hash index maps the characters to the index of the string, so equal strings share one index
+    // and Intern only adds the string if it is not stored yet.
+    //
+    // Every Intern adds a reference and every Release removes one.
+    // A string that is released is not overwritten or reused, copies of the index that were made
+    // without Intern (like cloned entities) keep reading the same characters.
+    // The space is only given back by Compact, which the scene runs with the real reference counts.
+    class __FLX_API StringTable
+    {
+    public:
+      using Index = std::size_t;
+
+      // Returned by Compact for the strings that were dropped
+      static constexpr Index NO_INDEX = static_cast<Index>(-1);
+
+      struct Entry
+      {
+        uint64_t offset = 0;
+        uint32_t length = 0;
+        uint32_t refcount = 0;
+        std::size_t hash = 0;
+      };
+
+    private:
+      std::vector<char> m_arena;
+      std::vector<Entry> m_entries;
+
+      // Open addressing with linear probing, stores index + 1, 0 is an empty bucket.
+      // The size is a power of two and is kept at most half full.
+      std::vector<Index> m_buckets;
+
+    public:
+      // The view points into the arena and is null-terminated.
+      // It is valid until the next Intern, Append or Compact.
+      std::string_view Get(Index index) const
+      {
+        const Entry& entry = m_entries[index];
+        return { m_arena.data() + entry.offset, entry.length };
+      }
+
+      // Returns the index of the string, adding it if it is not stored yet.
+      // Adds a reference to the string.
+      Index Intern(std::string_view str);
+
+      // Adds the string without looking for an equal one and without a reference.
+      // Used to load the strings of a scene where the indexes are already stored in the components.
+      Index Append(std::string_view str);
+
+      // Removes a reference, strings without references stay readable until Compact.
+      void Release(Index index);
+
+      uint32_t GetRefCount(Index index) const { return m_entries[index].refcount; }
+
+      // Rebuilds the table with the strings that have references, equal strings are merged.
+      // references holds the new reference count of each index.
+      // Returns the new index of each old index, NO_INDEX for the dropped strings.
+      std::vector<Index> Compact(const std::vector<uint32_t>& references);
+
+      // Number of characters in the arena, including the null terminators
+      std::size_t GetArenaSize() const { return m_arena.size(); }
+
+      std::size_t size() const { return m_entries.size(); }
+      bool empty() const { return m_entries.empty(); }
+      void clear() { m_arena.clear(); m_entries.clear(); m_buckets.clear(); }
+
+    private:
+      // INTERNAL FUNCTION
+      // Returns the bucket with the string or the empty bucket where it would go.
+      std::size_t Internal_FindBucket(std::string_view str, std::size_t hash) const;
+
+      // INTERNAL FUNCTION
+      // Stores the characters and adds the entry, does not touch the hash index.
+      Index Internal_Push(std::string_view str, std::size_t hash);
+
+      // INTERNAL FUNCTION
+      // Grows the hash index and reinserts every entry.
+      void Internal_Rehash(std::size_t bucket_count);
+    };
+
+    // One instance of each resource type of a scene, indexed by ComponentID.
+    //
+    // Resources are the singleton data of a scene, like the state of a battle,
+    // so there is no entity to look for before the data can be used.
+    // They share the ids of the component registry, each lookup is an index into an array
+    // and they are serialized by type name like the components.
+    // Each resource is stored in a column with one element, so it must be trivially relocatable like a component.
+    class __FLX_API ResourceStorage
+    {
+      // An empty column means the scene does not have the resource
+      std::vector<Column> m_resources;
+      std::size_t m_count = 0;
+
+    public:
+      bool Contains(ComponentID resource) const { return resource < m_resources.size() && !m_resources[resource].empty(); }
+
+      // Returns nullptr if the scene does not have the resource
+      void* Find(ComponentID resource) { return Contains(resource) ? m_resources[resource].Get(0) : nullptr; }
+      const void* Find(ComponentID resource) const { return Contains(resource) ? m_resources[resource].Get(0) : nullptr; }
+
+      // Copies the data into the resource, adding the resource if the scene does not have it yet.
+      // Returns the stored data.
+      void* Set(ComponentID resource, const void* data, std::size_t element_size, std::size_t element_alignment);
+
+      // Returns false if the scene did not have the resource
+      bool Remove(ComponentID resource);
+
+      // Calls the function with the id and the column of each resource
+      // Usage: resources.Each([](ComponentID resource, const Column& column) { ... });
+      template <typename Fn>
+      void Each(Fn&& fn) const
+      {
+        for (std::size_t i = 0; i < m_resources.size(); i++)
+        {
+          if (!m_resources[i].empty()) fn(static_cast<ComponentID>(i), m_resources[i]);
+        }
+      }
+
+      template <typename Fn>
+      void Each(Fn&& fn)
+      {
+        for (std::size_t i = 0; i < m_resources.size(); i++)
+        {
+          if (!m_resources[i].empty()) fn(static_cast<ComponentID>(i), m_resources[i]);
+        }
+      }
+
+      std::size_t size() const { return m_count; }
+      bool empty() const { return m_count == 0; }
+      void clear() { m_resources.clear(); m_count = 0; }
+    };
+
     #pragma endregion
 
 
     #pragma region Classes
 
-    // Macros for access to the ECS data structures
+    // Macros for access to the ECS data structures of the active scene
+    // These are a convenience layer, the ECS functions take the scene explicitly.
+    // They go through a reference so there is no shared_ptr copy on each use.
 
     // Find an archetype by its list of component ids
-    #define ARCHETYPE_INDEX FlexEngine::FlexECS::Scene::GetActiveScene()->archetype_index
+    #define ARCHETYPE_INDEX FlexEngine::FlexECS::Scene::GetActiveSceneRef().archetype_index
 
     // Find the archetype for an entity
-    #define ENTITY_INDEX FlexEngine::FlexECS::Scene::GetActiveScene()->entity_index
+    #define ENTITY_INDEX FlexEngine::FlexECS::Scene::GetActiveSceneRef().entity_index
 
     // Find the column for a component in an archetype
-    #define COMPONENT_INDEX FlexEngine::FlexECS::Scene::GetActiveScene()->component_index
+    #define COMPONENT_INDEX FlexEngine::FlexECS::Scene::GetActiveSceneRef().component_index
 
 
     // The scene holds all the entities and components.
     class __FLX_API Scene
     { FLX_REFL_SERIALIZABLE FLX_ID_SETUP
 
-      // TODO: Implement reusing entity ids
-      //EntityID next_entity_id = 0;
-
       static std::shared_ptr<Scene> s_active_scene;
 
+      // Reserves entity ids ahead of playback
+      friend class FlexECS::EntityCommandBuffer;
+
     public:
 
       // Null scene for when the active scene is set to null
@@ -208,8 +884,21 @@ namespace FlexEngine
       // ECS data structures
 
       std::unordered_map<ComponentIDList, Archetype> archetype_index;
-      std::unordered_map<EntityID, EntityRecord> entity_index;
-      std::unordered_map<ComponentID, ArchetypeMap> component_index;
+      EntityIndex entity_index;
+
+      // Indexed by ComponentID.
+      // This is not serialized because the ids are process-local,
+      // it is rebuilt from the archetype types when a scene is loaded.
+      std::vector<ArchetypeMap> component_index;
+
+      // Indexed by QueryID.
+      // Not serialized, the caches are rebuilt the first time each query is used.
+      QueryCacheList query_cache;
+
+      // World matrices of the entities.
+      // Not serialized, the transform systems fill it from the components with Changed<T> queries,
+      // which visit every entity the first time they run in a scene.
+      TransformHierarchy transform_hierarchy;
 
       #pragma region String Storage
 
@@ -218,21 +907,58 @@ namespace FlexEngine
 
     private:
       // String storage to prevent strings from being freed.
-      // Components that are strings should store the index of the string in this vector.
-      std::vector<std::string> string_storage;
-
-      // Strings that are removed from the string storage are added to this list.
-      // New strings will always use the first available index in this list.
-      std::vector<StringIndex> string_storage_free_list;
+      // Components that are strings should store the index of the string in this table.
+      // Equal strings share one index.
+      StringTable string_storage;
 
     public:
-      std::string& Internal_StringStorage_Get(StringIndex index);
+      // The view is null-terminated and valid until the next New or Compact,
+      // copy it into a std::string to keep it.
+      std::string_view Internal_StringStorage_Get(StringIndex index) const;
 
-      StringIndex Internal_StringStorage_New(const std::string& str);
+      // Returns the index of an equal string if there is one.
+      StringIndex Internal_StringStorage_New(std::string_view str);
+
+      // The string stays readable until the next compaction,
+      // other components may still hold a copy of the index.
       void Internal_StringStorage_Delete(StringIndex index);
 
-      // Defragment the string storage by moving all strings to the front of the vector
-      // void Internal_StringStorage_Defragment();
+      // Drops the strings that no component refers to, merges equal strings and packs the arena.
+      // The string indexes in the components are rewritten, the components are found through reflection:
+      // the name component and the members registered with FLX_REFL_REGISTER_STRING_INDEX.
+      // Indexes held outside the components are invalid afterwards.
+      // Does nothing if a component is not registered with the reflection system.
+      void Internal_StringStorage_Compact();
+
+      // Size of the interned strings in bytes
+      std::size_t Internal_StringStorage_GetSize() const { return string_storage.GetArenaSize(); }
+
+      #pragma endregion
+
+      #pragma region Resources
+
+    public:
+      // Singleton data of the scene, see ResourceStorage.
+      // Serialized with the scene.
+      ResourceStorage resources;
+
+      // Sets the resource, adding it if the scene does not have it yet.
+      // Returns the stored resource.
+      // Usage: scene.SetResource<BattleState>({});
+      template <typename T>
+      T& SetResource(const T& data = T());
+
+      // Returns nullptr if the scene does not have the resource.
+      // This is an index into the resources by the component id of the type, no archetypes are searched.
+      // Usage: BattleState& battle_state = *scene.GetResource<BattleState>();
+      template <typename T>
+      T* GetResource();
+
+      template <typename T>
+      bool HasResource() const;
+
+      template <typename T>
+      void RemoveResource();
 
       #pragma endregion
 
@@ -244,6 +970,106 @@ namespace FlexEngine
       std::vector<Entity> View();
       //#define FLX_ECS_VIEW(...) for (FlexEngine::FlexECS::Entity& entity : FlexEngine::FlexECS::Scene::GetActiveScene()->View<__VA_ARGS__>())
 
+      // Calls the function for every entity that has all the requested components.
+      // The components are passed by reference straight from the archetype columns,
+      // so there are no per-entity lookups and no entity list is built.
+      // Do not add/remove components or create/destroy entities inside the function.
+      // The rows of the non-const components are marked as changed, pass const T for the components that are only read.
+      // Wrap a component in Changed<T> to only visit the rows that changed since the query last ran.
+      // Usage: scene->Each<Position, Rigidbody>([](Position& position, Rigidbody& rigidbody) { ... });
+      // Usage: scene->Each<Position>([](Entity entity, Position& position) { ... });
+      // Usage: scene->Each<Changed<const Position>, Transform>([](const Position& position, Transform& transform) { ... });
+      template <typename... Ts, typename Fn>
+      void Each(Fn&& fn);
+
+      // Same as Each, but calls the function once per matching archetype
+      // with the entity ids and the column arrays for the requested components.
+      // Usage: scene->EachChunk<Position>([](std::size_t count, const EntityID* entities, Position* positions) { ... });
+      template <typename... Ts, typename Fn>
+      void EachChunk(Fn&& fn);
+
+      // Same as EachChunk, but the archetypes are split into chunks of at most chunk_size rows
+      // and the chunks run in parallel on the thread pool.
+      // Blocks until every chunk is done.
+      // The function is called from several threads at once, it must only touch its own rows.
+      // Do not add/remove components or create/destroy entities inside the function.
+      // Usage: scene->ParallelEachChunk<Position>([](std::size_t count, const EntityID* entities, Position* positions) { ... });
+      template <typename... Ts, typename Fn>
+      void ParallelEachChunk(Fn&& fn, std::size_t chunk_size = DEFAULT_CHUNK_SIZE, ThreadPool& pool = ThreadPool::GetDefault());
+
+      // Same as Each, but the rows are split into chunks that run in parallel on the thread pool.
+      // Use it for per-entity work that only touches the entity's own components,
+      // like integrating positions or rebuilding transform matrices.
+      // The function is called from several threads at once.
+      // This relies on no structural changes happening during iteration,
+      // record them in an EntityCommandBuffer and play it back afterwards.
+      // Usage: scene->ParallelEach<Position, Rigidbody>([](Position& position, Rigidbody& rigidbody) { ... });
+      template <typename... Ts, typename Fn>
+      void ParallelEach(Fn&& fn, std::size_t chunk_size = DEFAULT_CHUNK_SIZE, ThreadPool& pool = ThreadPool::GetDefault());
+
+      // Number of rows per task for ParallelEach and ParallelEachChunk.
+      static constexpr std::size_t DEFAULT_CHUNK_SIZE = 4096;
+
+      // Returns the number of entities that have all the requested components.
+      // Changed<T> filters are ignored.
+      template <typename... Ts>
+      std::size_t Count();
+
+      // Returns the cached query for the component list.
+      // The first call for each query scans all the archetypes,
+      // after that only newly created archetypes are tested.
+      template <typename... Ts>
+      QueryCache& GetQueryCache();
+
+      // All the query caches of the scene, indexed by QueryID.
+      // Uninitialized entries are queries that were not used in this scene.
+      const QueryCacheList& GetQueryCaches() const;
+
+      // Moves the match count of each query into match_count_last_frame.
+      // Call once per frame.
+      void ResetQueryMatchCounts();
+
+      // INTERNAL FUNCTION
+      // Tests a newly created archetype against the cached queries.
+      void Internal_OnArchetypeCreated(Archetype& archetype);
+
+    private:
+      // Returned by Internal_FindColumn if the archetype does not have the component.
+      static constexpr std::size_t NO_COLUMN = static_cast<std::size_t>(-1);
+
+      // INTERNAL FUNCTION
+      // Binary search for the column of a component in the sorted archetype type.
+      static std::size_t Internal_FindColumn(const Archetype& archetype, ComponentID component);
+
+      // INTERNAL FUNCTION
+      // Fills a query cache by testing all the archetypes of the scene.
+      void Internal_InitializeQueryCache(QueryCache& cache, const ComponentIDList& components);
+
+      // INTERNAL FUNCTION
+      // Stores the tick as the last run of the current query caller and returns the previous one.
+      // Returns 0 if the caller never ran the query.
+      uint64_t Internal_ExchangeLastRunTick(QueryCache& cache, uint64_t tick);
+
+      // INTERNAL FUNCTION
+      // Tests an archetype against a query and caches it if it has all the components.
+      static void Internal_MatchQuery(QueryCache& cache, Archetype& archetype);
+
+      // INTERNAL FUNCTION
+      // Expands the column indexes into typed column pointers for EachChunk.
+      template <typename... Ts, typename Fn, std::size_t... Is>
+      static void Internal_InvokeChunk(Archetype& archetype, const std::size_t* columns, std::size_t first_row, std::size_t count, Fn& fn, std::index_sequence<Is...>);
+
+      // INTERNAL FUNCTION
+      // Marks the rows of the non-const components as changed.
+      template <typename... Ts, std::size_t... Is>
+      static void Internal_MarkChanged(Archetype& archetype, const std::size_t* columns, std::size_t first_row, std::size_t count, std::index_sequence<Is...>);
+
+      // INTERNAL FUNCTION
+      // Calls the function with each range of rows that passes the Changed<T> filters of the query.
+      // Without filters this is one range with all the rows of the archetype.
+      template <typename... Ts, typename Fn>
+      static void Internal_ForEachChangedRange(const Archetype& archetype, const std::size_t* columns, uint64_t since, Fn&& fn);
+
       #pragma endregion
 
       #pragma region Scene management functions
@@ -254,26 +1080,77 @@ namespace FlexEngine
       static void SetActiveScene(const Scene& scene);
       static void SetActiveScene(std::shared_ptr<Scene> scene);
 
+      // Returns the active scene without copying the shared_ptr.
+      // The reference is valid until the active scene is changed.
+      // Use this in hot paths, GetActiveScene does an atomic refcount increment and decrement.
+      static Scene& GetActiveSceneRef() { return (s_active_scene != nullptr) ? *s_active_scene : *GetActiveScene(); }
+
       #pragma endregion
 
       #pragma region Entity management functions
 
     public:
+      // Every function has a version that takes the scene explicitly
+      // and a passthrough version that uses the active scene.
+      // Use the explicit versions to work on several scenes without swapping the active scene.
+
       // Creates a new entity and gives it the default archetype which is for storing the entity's name.
       // Entities are registered this way. They are not stored in the scene, but in the actual ECS.
       static Entity CreateEntity(const std::string& name = "New Entity");
+      static Entity CreateEntity(Scene& scene, const std::string& name = "New Entity");
 
       // Removes an entity from the ECS
       static void DestroyEntity(EntityID entity);
+      static void DestroyEntity(Scene& scene, EntityID entity);
 
       // Passthrough functions to edit the entity's flags.
-      // They only work on the current active scene.
       static void SetEntityFlags(EntityID& entity, const uint8_t flags);
+      static void SetEntityFlags(Scene& scene, EntityID& entity, const uint8_t flags);
 
       static EntityID CloneEntity(EntityID entityToCopy);
+      static EntityID CloneEntity(Scene& scene, EntityID entity_to_copy);
 
       static void SaveEntityAsPrefab(EntityID entityToSave, const std::string& prefabName);
 
+      // Clones the entity count times.
+      // The row is copied in bulk and each column grows at most once.
+      static std::vector<EntityID> CloneEntity(EntityID entity_to_copy, std::size_t count);
+      static std::vector<EntityID> CloneEntity(Scene& scene, EntityID entity_to_copy, std::size_t count);
+
+      // Creates count entities directly in the archetype for the component list,
+      // instead of moving each entity through one archetype per component.
+      // prototype holds one pointer per component with the data to copy into every entity,
+      // a missing or nullptr entry zero-initializes the component.
+      // The name component is added if the list does not have one,
+      // all the entities share the same name string like cloned entities do.
+      // Usage: Scene::CreateEntities(1000, { GetComponentID<Position>() }, { &position });
+      static std::vector<EntityID> CreateEntities(
+        std::size_t count,
+        const ComponentIDList& components,
+        const std::vector<const void*>& prototype = {},
+        const std::string& name = "New Entity"
+      );
+      static std::vector<EntityID> CreateEntities(
+        Scene& scene,
+        std::size_t count,
+        const ComponentIDList& components,
+        const std::vector<const void*>& prototype = {},
+        const std::string& name = "New Entity"
+      );
+
+      // Typed version of CreateEntities
+      // Usage: Scene::CreateEntities(1000, Position{ { 0, 0 } }, Rigidbody{});
+      template <typename... Ts>
+      static std::vector<EntityID> CreateEntities(std::size_t count, const Ts&... prototype);
+      template <typename... Ts>
+      static std::vector<EntityID> CreateEntities(Scene& scene, std::size_t count, const Ts&... prototype);
+
+    private:
+      // INTERNAL FUNCTION
+      // Appends count entities to the archetype and registers them in the entity index.
+      // row_data holds one pointer per column with the data to copy, nullptr zero-initializes.
+      static std::vector<EntityID> Internal_CreateEntitiesInArchetype(Scene& scene, Archetype& archetype, std::size_t count, const std::vector<const void*>& row_data);
+
       #pragma endregion
 
       #pragma region Scene serialization functions
@@ -286,14 +1163,41 @@ namespace FlexEngine
       static std::shared_ptr<Scene> Load(File& file);
       static void SaveActiveScene(File& file);
 
+      // Binary scene format (.flbscene)
+      // Each column is stored as one raw block of component data, so loading is
+      // a memory map and one memcpy per column instead of parsing json and decoding base64.
+      // The json format is kept for editor saves because it can be diffed.
+      // See scenebinary.cpp for the file layout.
+
+      void SaveBinary(File& file);
+      static std::shared_ptr<Scene> LoadBinary(File& file);
+
       #pragma endregion
 
     private:
+      // INTERNAL FUNCTION
+      // After reconstructing the ECS from a saved state, the component ids in the archetype types
+      // are in the order they were saved in, which may not match the ids of this process.
+      // This sorts the types, reorders the columns to match, and rebuilds the component_index.
+      void Internal_RebuildArchetypeIndex();
+
+      // INTERNAL FUNCTION
+      // Checks the columns of a loaded scene against its archetypes.
+      // Logs the first mismatch and returns false, the scene must not be used.
+      bool Internal_ValidateArchetypeTables();
+
       // INTERNAL FUNCTION
       // After reconstructing the ECS from a saved state, the archetype pointers in the entity_index
       // need to be reconnected to the archetype_index.
+      // Uses a table from archetype id to archetype, so this is one linear pass over the entities.
       void Internal_RelinkEntityArchetypePointers();
 
+      // INTERNAL FUNCTION
+      // Archetype edges are not saved, this rebuilds them from the archetype types
+      // so there is no edge discovery during the first frames after loading.
+      // Each archetype is linked to the archetypes with one component less, which covers every edge.
+      void Internal_RebuildArchetypeEdges();
+
 #ifdef _DEBUG
     public:
       void Dump() const;
@@ -335,13 +1239,23 @@ namespace FlexEngine
 
       #pragma region Component Management
 
+      // The functions without a scene parameter work on the active scene.
+      // Pass the scene explicitly to work on a scene that is not active,
+      // or to skip looking up the active scene on each call.
+
       // Checks if an entity has a component
       template <typename T>
       bool HasComponent();
+      template <typename T>
+      bool HasComponent(Scene& scene);
 
       // Returns a nullptr if the component is not found
+      // The row is marked as changed for the Changed<T> query filter,
+      // use GetComponent<const T> to read without marking it.
       template <typename T>
       T* GetComponent();
+      template <typename T>
+      T* GetComponent(Scene& scene);
 
       // Specialization to get a component safely
       // out is not modified if the component is not found
@@ -354,25 +1268,151 @@ namespace FlexEngine
       // Usage: entity.AddComponent(Transform(1, 2, 3));
       template <typename T>
       void AddComponent(const T& data);
+      template <typename T>
+      void AddComponent(Scene& scene, const T& data);
 
       // Remove a component from an entity
       // Usage: entity.RemoveComponent<Transform>();
       template <typename T>
       void RemoveComponent();
+      template <typename T>
+      void RemoveComponent(Scene& scene);
 
       #pragma endregion
 
     private:
       // Allow the scene class to access internal functions
       friend class FlexECS::Scene;
+      friend class FlexECS::EntityCommandBuffer;
 
       // INTERNAL FUNCTION
       // Used to create a new archetype
-      static Archetype& Internal_CreateArchetype(ComponentIDList type);
+      static Archetype& Internal_CreateArchetype(Scene& scene, ComponentIDList type);
 
       // INTERNAL FUNCTION
       // Used to move an entity from one archetype to another
-      static void Internal_MoveEntity(EntityID entity, Archetype& from, size_t from_row, Archetype& to);
+      // Looks up the destination column of each component, prefer the edge version below.
+      static void Internal_MoveEntity(Scene& scene, EntityID entity, Archetype& from, size_t from_row, Archetype& to);
+
+      // INTERNAL FUNCTION
+      // Used to move an entity along an archetype edge
+      // column_map[i] is the destination column of column i in from, ArchetypeEdge::NO_COLUMN to drop it.
+      static void Internal_MoveEntity(Scene& scene, EntityID entity, Archetype& from, size_t from_row, Archetype& to, const std::vector<std::size_t>& column_map);
+
+      // INTERNAL FUNCTION
+      // Connects the add edge of from and the remove edge of to for the component,
+      // and precomputes the column maps of both directions.
+      // The type of to must be the type of from plus the component.
+      static void Internal_LinkArchetypes(Archetype& from, Archetype& to, ComponentID component);
+
+      // INTERNAL FUNCTION
+      // Links the archetype with every archetype in the scene that has exactly one component more or less.
+      static void Internal_LinkArchetypeNeighbors(Scene& scene, Archetype& archetype);
+    };
+
+    // Records structural changes and applies them later at a sync point.
+    // 
+    // Every AddComponent/RemoveComponent on an Entity moves the entity to another archetype.
+    // The command buffer collects all the changes for an entity and moves it once,
+    // straight to its final archetype, when Playback is called.
+    // This also makes structural changes safe while iterating a View or Each.
+    // 
+    // The commands are applied to the scene the buffer was created for, the active scene by default.
+    // Component data is copied into the buffer when it is recorded.
+    // 
+    // Usage:
+    // EntityCommandBuffer commands;
+    // Entity entity = commands.CreateEntity("Enemy");
+    // commands.AddComponent<Position>(entity, { { 0, 0 } });
+    // commands.DestroyEntity(other_entity);
+    // commands.Playback();
+    class __FLX_API EntityCommandBuffer
+    {
+      enum class CommandType : uint8_t
+      {
+        Create,
+        Destroy,
+        AddComponent,
+        RemoveComponent
+      };
+
+      struct Command
+      {
+        CommandType type;
+        EntityID entity;
+        ComponentID component;
+        std::size_t data_offset; // into m_data for AddComponent, into m_names for Create
+      };
+
+      Scene* m_scene;
+      std::vector<Command> m_commands;
+      std::vector<uint8_t> m_data;
+
+      // Interned on playback, so discarded or destroyed entities never hold a string
+      std::vector<std::string> m_names;
+
+    public:
+      EntityCommandBuffer(Scene& scene = Scene::GetActiveSceneRef());
+
+      // Releases the ids reserved by CreateEntity if the buffer was not played back.
+      ~EntityCommandBuffer();
+
+      EntityCommandBuffer(const EntityCommandBuffer&) = delete;
+      EntityCommandBuffer& operator=(const EntityCommandBuffer&) = delete;
+
+      // The entity id is reserved immediately so that components can be recorded for it,
+      // but the entity is only added to the scene on Playback.
+      // Do not use the entity outside of the command buffer until then.
+      EntityID CreateEntity(const std::string& name = "New Entity");
+
+      void DestroyEntity(EntityID entity);
+
+      // Adding a component that the entity already has overwrites the data
+      template <typename T>
+      void AddComponent(EntityID entity, const T& data);
+
+      template <typename T>
+      void RemoveComponent(EntityID entity);
+
+      // Applies the recorded commands grouped by entity and clears the buffer.
+      // The commands of each entity are applied in the order they were recorded
+      // and the entity is moved at most once, the order between entities is not kept.
+      void Playback();
+
+      // Discards all the recorded commands and releases the ids reserved by CreateEntity.
+      void Clear();
+
+      bool IsEmpty() const;
+
+    private:
+      // INTERNAL FUNCTION
+      // Applies the commands of a single entity.
+      // The commands are given as indexes into m_commands, in the order they were recorded.
+      void Internal_ApplyEntityCommands(const std::size_t* first, const std::size_t* last);
+    };
+
+    // Typed query over the archetypes of a scene.
+    // This is a thin handle that binds a component list to a scene,
+    // the matching archetypes are cached in the scene (see Scene::GetQueryCache).
+    // Usage: Query<Position, Rigidbody>(*scene).Each([](Position& position, Rigidbody& rigidbody) { ... });
+    template <typename... Ts>
+    class Query
+    {
+      Scene& m_scene;
+
+    public:
+      explicit Query(Scene& scene) : m_scene(scene) {}
+
+      template <typename Fn>
+      void Each(Fn&& fn) { m_scene.template Each<Ts...>(std::forward<Fn>(fn)); }
+
+      template <typename Fn>
+      void EachChunk(Fn&& fn) { m_scene.template EachChunk<Ts...>(std::forward<Fn>(fn)); }
+
+      std::size_t Count() { return m_scene.template Count<Ts...>(); }
+
+      // Number of archetypes tested against this query in the last frame
+      std::size_t GetMatchCountLastFrame() { return m_scene.template GetQueryCache<Ts...>().match_count_last_frame; }
     };
 
     #pragma endregion
@@ -385,3 +1425,6 @@ namespace FlexEngine
 
 // Template implementations for Entity
 #include "entity.inl"
+
+// Template implementations for EntityCommandBuffer
+#include "entitycommandbuffer.inl"
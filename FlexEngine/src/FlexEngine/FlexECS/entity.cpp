@@ -63,29 +63,123 @@ namespace FlexEngine
 
     // Assume the component is not in the archetype and
     // the ComponentIDList is sorted
-    Archetype& Entity::Internal_CreateArchetype(ComponentIDList type)
+    Archetype& Entity::Internal_CreateArchetype(Scene& scene, ComponentIDList type)
     {
       FLX_FLOW_FUNCTION();
 
+      auto& component_index = scene.component_index;
+
       // create a new archetype
-      Archetype& archetype = ARCHETYPE_INDEX[type];
+      Archetype& archetype = scene.archetype_index[type];
 
-      archetype.id = ARCHETYPE_INDEX.size() - 1;
+      archetype.id = scene.archetype_index.size() - 1;
       archetype.type = type;
       archetype.archetype_table.reserve(type.size());
-      // edges are lazily instantiated
 
       // create a new archetype record for each component
       for (std::size_t i = 0; i < archetype.type.size(); i++)
       {
         //Log::Flow("Create new column (" + std::to_string(i) + ")");
-        COMPONENT_INDEX[archetype.type[i]][archetype.id] = { i };
-        archetype.archetype_table.push_back(Column()); // create a column for each component
+        if (archetype.type[i] >= component_index.size()) component_index.resize(archetype.type[i] + 1);
+        component_index[archetype.type[i]][archetype.id] = { i };
+
+        // create a column for each component
+        // the column layout comes from the type descriptor of the component
+        Reflection::TypeDescriptor* type_desc = GetComponentTypeDescriptor(archetype.type[i]);
+        FLX_NULLPTR_ASSERT(type_desc, "Component type is not registered with the reflection system: " + GetComponentName(archetype.type[i]));
+        archetype.archetype_table.push_back(Column(type_desc->size, type_desc->alignment));
       }
 
+      // connect the archetype graph in both directions
+      Internal_LinkArchetypeNeighbors(scene, archetype);
+
+      // update the cached queries
+      scene.Internal_OnArchetypeCreated(archetype);
+
       return archetype;
     }
 
+    // Steps:
+    // 1. Map each column of from to its column in to, the types are sorted so this is a merge
+    // 2. Map each column of to back to from, the added component has no column in from
+    void Entity::Internal_LinkArchetypes(Archetype& from, Archetype& to, ComponentID component)
+    {
+      ArchetypeEdge& add_edge = from.edges[component];
+      ArchetypeEdge& remove_edge = to.edges[component];
+
+      add_edge.add = &to;
+      remove_edge.remove = &from;
+
+      // 1. Map each column of from to its column in to
+      add_edge.add_columns.resize(from.type.size());
+      for (std::size_t i = 0, j = 0; i < from.type.size(); i++, j++)
+      {
+        // skip over the added component
+        if (to.type[j] == component) j++;
+        add_edge.add_columns[i] = j;
+      }
+      add_edge.add_component_column = static_cast<std::size_t>(
+        std::lower_bound(to.type.begin(), to.type.end(), component) - to.type.begin()
+      );
+
+      // 2. Map each column of to back to from
+      remove_edge.remove_columns.resize(to.type.size());
+      for (std::size_t i = 0, j = 0; i < to.type.size(); i++)
+      {
+        if (to.type[i] == component) remove_edge.remove_columns[i] = ArchetypeEdge::NO_COLUMN;
+        else remove_edge.remove_columns[i] = j++;
+      }
+    }
+
+    // Steps:
+    // 1. Link to the archetypes with one component less by looking up each subset of the type
+    // 2. Link to the archetypes with one component more by scanning for supersets of the type
+    // Archetypes are rarely created, so the scan is cheaper than discovering the edges during gameplay.
+    void Entity::Internal_LinkArchetypeNeighbors(Scene& scene, Archetype& archetype)
+    {
+      auto& archetype_index = scene.archetype_index;
+
+      // 1. Link to the archetypes with one component less
+      ComponentIDList subset_type;
+      for (std::size_t i = 0; i < archetype.type.size(); i++)
+      {
+        subset_type = archetype.type;
+        subset_type.erase(subset_type.begin() + i);
+
+        auto it = archetype_index.find(subset_type);
+        if (it != archetype_index.end()) Internal_LinkArchetypes(it->second, archetype, archetype.type[i]);
+      }
+
+      // 2. Link to the archetypes with one component more
+      for (auto& [type, other] : archetype_index)
+      {
+        if (type.size() != archetype.type.size() + 1) continue;
+        if (!std::includes(type.begin(), type.end(), archetype.type.begin(), archetype.type.end())) continue;
+
+        // find the extra component
+        std::size_t i = 0;
+        while (i < archetype.type.size() && archetype.type[i] == type[i]) i++;
+        Internal_LinkArchetypes(archetype, other, type[i]);
+      }
+    }
+
+
+    // Builds the column map and moves the entity with it
+    // The same as moving along an edge, but without the cached map
+    void Entity::Internal_MoveEntity(Scene& scene, EntityID entity, Archetype& from, size_t from_row, Archetype& to)
+    {
+      std::vector<std::size_t> column_map(from.type.size());
+      for (size_t i = 0; i < from.type.size(); i++)
+      {
+        // The destination archetype does not have the component
+        // This means the component is being removed from the entity
+        ArchetypeMap& archetype_map = scene.component_index[from.type[i]];
+        auto it = archetype_map.find(to.id);
+        column_map[i] = (it != archetype_map.end()) ? it->second.column : ArchetypeEdge::NO_COLUMN;
+      }
+
+      Internal_MoveEntity(scene, entity, from, from_row, to, column_map);
+    }
 
     // Three steps required to move an entity to a new archetype
     // 1. Add the entity to the destination archetype's columns and entities vector
@@ -94,7 +188,7 @@ namespace FlexEngine
     // 
     // This is a slower process, if the component just needs to be disabled
     // like in the properties inspector, use flags instead
-    void Entity::Internal_MoveEntity(EntityID entity, Archetype& from, size_t from_row, Archetype& to)
+    void Entity::Internal_MoveEntity(Scene& scene, EntityID entity, Archetype& from, size_t from_row, Archetype& to, const std::vector<std::size_t>& column_map)
     {
       FLX_FLOW_FUNCTION();
 
@@ -105,16 +199,11 @@ namespace FlexEngine
       for (size_t i = 0; i < from.archetype_table.size(); i++)
       {
         // guard
-        // The destination archetype does not have the component
-        // This means the component is being removed from the entity
-        if (COMPONENT_INDEX[from.type[i]].count(to.id) == 0) continue;
-
-        // Get the source component data
-        ComponentData<void> source_data = from.archetype_table[i][from_row];
+        // The component is being removed from the entity
+        if (column_map[i] == ArchetypeEdge::NO_COLUMN) continue;
 
         // Copy the source component data to the destination archetype
-        size_t destination_column_index = COMPONENT_INDEX[from.type[i]][to.id].column;
-        to.archetype_table[destination_column_index].push_back(source_data);
+        to.archetype_table[column_map[i]].PushBack(from.archetype_table[i].Get(from_row));
       }
 
       // Add the entity to the entities vector
@@ -129,37 +218,27 @@ namespace FlexEngine
       // This is by design to avoid the overhead of creating and destroying archetypes frequently.
       #pragma region Step 2
 
-      size_t last_row_index = from.archetype_table[0].size() - 1;
+      size_t last_row_index = from.entities.size() - 1;
 
-      // Handle the case where the entity is the last entity in the archetype
-      if (from_row == last_row_index)
+      // Swap the entity with the last entity in the archetype and pop it
+      // Using swap-and-pop is more performant than erase() since it requires shifting
+      // all subsequent elements forward.
+      // O(1) complexity for swap-and-pop vs O(n) complexity for erase()
+      for (size_t i = 0; i < from.archetype_table.size(); i++)
       {
-        for (size_t i = 0; i < from.archetype_table.size(); i++)
-        {
-          from.archetype_table[i].pop_back();
-        }
+        from.archetype_table[i].SwapRemove(from_row);
       }
-      else
+
+      auto& entity_index = scene.entity_index;
+
+      // Update entity_index for the swapped entity if necessary
+      if (from_row < last_row_index)
       {
-        // Swap the entity with the last entity in the archetype and pop it
-        // Using swap-and-pop is more performant than erase() since it requires shifting
-        // all subsequent elements forward.
-        // O(1) complexity for swap-and-pop vs O(n) complexity for erase()
-        for (size_t i = 0; i < from.archetype_table.size(); i++)
-        {
-          std::swap(from.archetype_table[i][from_row], from.archetype_table[i][last_row_index]);
-          from.archetype_table[i].pop_back();
-        }
-
-        // Update entity_index for the swapped entity if necessary
-        if (from_row < last_row_index)
-        {
-          EntityID swapped_entity = from.entities[last_row_index];
-          ENTITY_INDEX[swapped_entity].row = from_row;
-
-          // Replace the entity's row in the entities vector
-          from.entities[from_row] = swapped_entity;
-        }
+        EntityID swapped_entity = from.entities[last_row_index];
+        entity_index[swapped_entity].row = from_row;
+
+        // Replace the entity's row in the entities vector
+        from.entities[from_row] = swapped_entity;
       }
 
       // Pop the entity from the entities vector
@@ -169,9 +248,10 @@ namespace FlexEngine
 
 
       // 3. Update entity_index to reflect the entity's new archetype and row
-      ENTITY_INDEX[entity].archetype = &to;
-      ENTITY_INDEX[entity].archetype_id = to.id;
-      ENTITY_INDEX[entity].row = to.entities.size() - 1;
+      EntityRecord& entity_record = entity_index[entity];
+      entity_record.archetype = &to;
+      entity_record.archetype_id = to.id;
+      entity_record.row = to.entities.size() - 1;
     }
 
     #pragma endregion
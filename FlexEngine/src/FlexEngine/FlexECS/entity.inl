@@ -2,24 +2,29 @@
 
 template <typename T>
 bool FlexEngine::FlexECS::Entity::HasComponent()
+{
+  return HasComponent<T>(Scene::GetActiveSceneRef());
+}
+
+template <typename T>
+bool FlexEngine::FlexECS::Entity::HasComponent(Scene& scene)
 {
   // cache the entity id
   EntityID entity = entity_id;
 
   // get the component id
-  ComponentID component = Reflection::TypeResolver<T>::Get()->name;
+  ComponentID component = GetComponentID<T>();
 
   // guard: check if the component is in the index
   // provides an early exit because if it's not in the index, it's not in any archetype
-  // this also prevents component_index[component] from creating a new entry
-  if (COMPONENT_INDEX.count(component) == 0) return false;
+  if (component >= scene.component_index.size()) return false;
 
   // figure out the archetype for the entity
-  EntityRecord& entity_record = ENTITY_INDEX[entity];
+  EntityRecord& entity_record = scene.entity_index[entity];
   Archetype& archetype = *entity_record.archetype;
 
   // check if the component is in the archetype
-  ArchetypeMap& archetype_map = COMPONENT_INDEX[component];
+  ArchetypeMap& archetype_map = scene.component_index[component];
   return (archetype_map.count(archetype.id) != 0);
 }
 
@@ -29,12 +34,18 @@ bool FlexEngine::FlexECS::Entity::HasComponent()
 // This performs two lookups in the entity_index and two lookups in the component_index.
 template <typename T>
 T* FlexEngine::FlexECS::Entity::GetComponent()
+{
+  return GetComponent<T>(Scene::GetActiveSceneRef());
+}
+
+template <typename T>
+T* FlexEngine::FlexECS::Entity::GetComponent(Scene& scene)
 {
   // cache the entity id
   EntityID entity = entity_id;
 
   // get the component id
-  ComponentID component = Reflection::TypeResolver<T>::Get()->name;
+  ComponentID component = GetComponentID<T>();
 
   // guard: HasComponent
   // This has some repeated lookups, so it can be further optimized by copying the HasComponent code here
@@ -43,19 +54,18 @@ T* FlexEngine::FlexECS::Entity::GetComponent()
 
   // guard: check if the component is in the index
   // provides an early exit because if it's not in the index, it's not in any archetype
-  // this also prevents component_index[component] from creating a new entry
-  if (COMPONENT_INDEX.count(component) == 0)
+  if (component >= scene.component_index.size())
   {
     Log::Error("Component not found in the index");
     return nullptr;
   }
 
   // figure out the archetype for the entity
-  EntityRecord& entity_record = ENTITY_INDEX[entity];
+  EntityRecord& entity_record = scene.entity_index[entity];
   Archetype& archetype = *entity_record.archetype;
 
   // check if the component is in the archetype
-  ArchetypeMap& archetype_map = COMPONENT_INDEX[component];
+  ArchetypeMap& archetype_map = scene.component_index[component];
   if (archetype_map.count(archetype.id) == 0)
   {
     Log::Error("Component not found in the archetype");
@@ -65,10 +75,14 @@ T* FlexEngine::FlexECS::Entity::GetComponent()
   #pragma endregion
 
   // get the component data
+  // this points directly into the column buffer
   ArchetypeRecord& archetype_record = archetype_map[archetype.id];
-  ComponentData<void> component_data = archetype.archetype_table[archetype_record.column][entity_record.row];
-  void* data = Internal_GetComponentData(component_data).second;
+  Column& column = archetype.archetype_table[archetype_record.column];
+  void* data = column.Get(entity_record.row);
   T* out_component = reinterpret_cast<T*>(data);
+
+  // mutable access counts as a write for the Changed<T> query filter
+  if constexpr (!std::is_const_v<T>) column.MarkChanged(entity_record.row);
   return out_component;
 }
 
@@ -87,12 +101,19 @@ bool FlexEngine::FlexECS::Entity::TryGetComponent(T* out)
 // - Perform type erasure on the component data
 // - Find or create the archetype that has the component we want to add
 //   in addition to the components the entity already had.
+//   The archetype edge caches it along with the column map for the move.
 // - Insert a new row into the destination archetype.
 // - Move overlapping components over to the destination archetype.
 // - Remove the entity from the current archetype.
 // - Update the entity's archetype and row in entity_index.
 template <typename T>
 void FlexEngine::FlexECS::Entity::AddComponent(const T& data)
+{
+  AddComponent<T>(Scene::GetActiveSceneRef(), data);
+}
+
+template <typename T>
+void FlexEngine::FlexECS::Entity::AddComponent(Scene& scene, const T& data)
 {
   FLX_FLOW_BEGINSCOPE();
 
@@ -100,90 +121,59 @@ void FlexEngine::FlexECS::Entity::AddComponent(const T& data)
   EntityID entity = entity_id;
 
   // get component id
-  ComponentID component = Reflection::TypeResolver<T>::Get()->name;
+  ComponentID component = GetComponentID<T>();
 
   // type erasure
+  // the column copies the bytes of data_copy into its buffer
   T data_copy = data;
-  void* data_copy_ptr = reinterpret_cast<void*>(&data_copy);
-  ComponentData<void> data_ptr = Internal_CreateComponentData(sizeof(T), data_copy_ptr);
+  const void* data_copy_ptr = reinterpret_cast<const void*>(&data_copy);
 
   // figure out the current archetype for the entity
-  EntityRecord& entity_record = ENTITY_INDEX[entity];
+  EntityRecord& entity_record = scene.entity_index[entity];
   Archetype& archetype = *entity_record.archetype;
 
-
   // find or create the archetype that has the component we want to add
   // in addition to the components the entity already had
+  ArchetypeEdge& edge = archetype.edges[component];
 
-
-  // graph traversal skip
-  if (
-    archetype.edges.count(component) != 0 &&  // check if the edge exists
-    archetype.edges[component].add != nullptr // check if the archetype exists
-  )
+  // the edge is missing, find or create the archetype
+  if (edge.add == nullptr)
   {
-    Log::Flow("Graph traversal using edges");
-
-    // get the archetype
-    Archetype& next_archetype = *archetype.edges[component].add;
-
-    // move the entity to the new archetype
-    Internal_MoveEntity(entity, archetype, entity_record.row, next_archetype);
-
-    // store the component data in the archetype
-    ArchetypeRecord& archetype_record = COMPONENT_INDEX[component][next_archetype.id];
-    next_archetype.archetype_table[archetype_record.column].push_back(data_ptr);
-  }
-  // find or create the archetype
-  else
-  {
-
     // create the archetype type
     ComponentIDList new_type = archetype.type; // make copy
     new_type.push_back(component);
     std::sort(new_type.begin(), new_type.end());
 
     // find the archetype
-    if (ARCHETYPE_INDEX.count(new_type) != 0)
+    auto it = scene.archetype_index.find(new_type);
+    if (it != scene.archetype_index.end())
     {
       Log::Flow("Find archetype using archetype_index");
 
-      // get the archetype
-      Archetype& next_archetype = ARCHETYPE_INDEX[new_type];
-
-      // move the entity to the new archetype
-      Internal_MoveEntity(entity, archetype, entity_record.row, next_archetype);
-
-      // store the component data in the archetype
-      ArchetypeRecord& archetype_record = COMPONENT_INDEX[component][next_archetype.id];
-      next_archetype.archetype_table[archetype_record.column].push_back(data_ptr);
-
       // update archetype graph
-      archetype.edges[component].add = &next_archetype;    // adding the component to the current archetype will lead to the next archetype
-      next_archetype.edges[component].remove = &archetype; // removing the component in the next archetype will lead back to the current archetype
+      Internal_LinkArchetypes(archetype, it->second, component);
     }
     // archetype doesn't exist, create it
+    // new archetypes are linked to their neighbors when they are created
     else
     {
       Log::Flow("Create a new archetype");
+      Internal_CreateArchetype(scene, new_type);
+    }
+  }
+  else
+  {
+    Log::Flow("Graph traversal using edges");
+  }
 
-      // create a new archetype
-      // add the component to the type
-      Archetype& new_archetype = Internal_CreateArchetype(new_type);
-
-      // move the entity to the new archetype
-      Internal_MoveEntity(entity, archetype, entity_record.row, new_archetype);
-
-      // store the component data in the archetype
-      ArchetypeRecord& archetype_record = COMPONENT_INDEX[component][new_archetype.id];
-      new_archetype.archetype_table[archetype_record.column].push_back(data_ptr);
+  // get the archetype
+  Archetype& next_archetype = *edge.add;
 
-      // update archetype graph
-      archetype.edges[component].add = &new_archetype;
-      new_archetype.edges[component].remove = &archetype;
-    }
+  // move the entity to the new archetype
+  Internal_MoveEntity(scene, entity, archetype, entity_record.row, next_archetype, edge.add_columns);
 
-  }
+  // store the component data in the archetype
+  next_archetype.archetype_table[edge.add_component_column].PushBack(data_copy_ptr);
 
   FLX_FLOW_ENDSCOPE();
 }
@@ -191,6 +181,12 @@ void FlexEngine::FlexECS::Entity::AddComponent(const T& data)
 // Do the opposite of AddComponent
 template <typename T>
 void FlexEngine::FlexECS::Entity::RemoveComponent()
+{
+  RemoveComponent<T>(Scene::GetActiveSceneRef());
+}
+
+template <typename T>
+void FlexEngine::FlexECS::Entity::RemoveComponent(Scene& scene)
 {
   FLX_FLOW_BEGINSCOPE();
 
@@ -198,69 +194,49 @@ void FlexEngine::FlexECS::Entity::RemoveComponent()
   EntityID entity = entity_id;
 
   // get component id
-  ComponentID component = Reflection::TypeResolver<T>::Get()->name;
+  ComponentID component = GetComponentID<T>();
 
   // figure out the current archetype for the entity
-  EntityRecord& entity_record = ENTITY_INDEX[entity];
+  EntityRecord& entity_record = scene.entity_index[entity];
   Archetype& archetype = *entity_record.archetype;
 
-  // graph traversal skip
-  if (
-    archetype.edges.count(component) != 0 &&  // check if the edge exists
-    archetype.edges[component].remove != nullptr // check if the archetype exists
-  )
-  {
-    Log::Flow("Graph traversal using edges");
-
-    // get the archetype
-    Archetype& next_archetype = *archetype.edges[component].remove;
-
-    // move the entity to the new archetype
-    Internal_MoveEntity(entity, archetype, entity_record.row, next_archetype);
-  }
   // find or create the archetype that is a copy of the current archetype
   // without the component we want to remove
-  else
-  {
+  ArchetypeEdge& edge = archetype.edges[component];
 
+  // the edge is missing, find or create the archetype
+  if (edge.remove == nullptr)
+  {
     // create the archetype type
     ComponentIDList new_type = archetype.type; // make copy
     new_type.erase(std::remove(new_type.begin(), new_type.end(), component), new_type.end());
     std::sort(new_type.begin(), new_type.end());
 
     // find the archetype
-    if (ARCHETYPE_INDEX.count(new_type) != 0)
+    auto it = scene.archetype_index.find(new_type);
+    if (it != scene.archetype_index.end())
     {
       Log::Flow("Find archetype using archetype_index");
 
-      // get the archetype
-      Archetype& next_archetype = ARCHETYPE_INDEX[new_type];
-
-      // move the entity to the new archetype
-      Internal_MoveEntity(entity, archetype, entity_record.row, next_archetype);
-
       // update archetype graph
-      archetype.edges[component].remove = &next_archetype; // removing the component in the current archetype will lead to the next archetype
-      next_archetype.edges[component].add = &archetype;    // adding the component to the next archetype will lead back to the current archetype
+      Internal_LinkArchetypes(it->second, archetype, component);
     }
     // archetype doesn't exist, create it
+    // new archetypes are linked to their neighbors when they are created
     else
     {
       Log::Flow("Create a new archetype");
-
-      // create a new archetype
-      // add the component to the type
-      Archetype& new_archetype = Internal_CreateArchetype(new_type);
-
-      // move the entity to the new archetype
-      Internal_MoveEntity(entity, archetype, entity_record.row, new_archetype);
-
-      // update archetype graph
-      archetype.edges[component].remove = &new_archetype;
-      new_archetype.edges[component].add = &archetype;
+      Internal_CreateArchetype(scene, new_type);
     }
-
   }
+  else
+  {
+    Log::Flow("Graph traversal using edges");
+  }
+
+  // move the entity to the new archetype
+  // the column of the removed component is dropped
+  Internal_MoveEntity(scene, entity, archetype, entity_record.row, *edge.remove, edge.remove_columns);
 
   FLX_FLOW_ENDSCOPE();
-}
\ No newline at end of file
+}
@@ -0,0 +1,243 @@
+#include "datastructures.h"
+
+#include <numeric> // std::iota
+#include <utility> // std::make_pair
+
+namespace FlexEngine
+{
+  namespace FlexECS
+  {
+
+    EntityCommandBuffer::EntityCommandBuffer(Scene& scene)
+      : m_scene(&scene)
+    {
+    }
+
+    EntityCommandBuffer::~EntityCommandBuffer()
+    {
+      Clear();
+    }
+
+    #pragma region Recording
+
+    EntityID EntityCommandBuffer::CreateEntity(const std::string& name)
+    {
+      // reserve the entity id
+      // this does not change the archetypes so it is safe during iteration
+      Scene& scene = *m_scene;
+      EntityID entity = ID::Create(ID::Flags::Flag_None, scene._flx_id_next, scene._flx_id_unused);
+
+      // the name component is added on playback, see Internal_ApplyEntityCommands
+      m_commands.push_back({ CommandType::Create, entity, 0, m_names.size() });
+      m_names.push_back(name);
+
+      return entity;
+    }
+
+    void EntityCommandBuffer::DestroyEntity(EntityID entity)
+    {
+      m_commands.push_back({ CommandType::Destroy, entity, 0, 0 });
+    }
+
+    void EntityCommandBuffer::Clear()
+    {
+      // the created entities never made it into the scene
+      for (const Command& command : m_commands)
+      {
+        EntityID entity = command.entity;
+        if (command.type == CommandType::Create) ID::Destroy(entity, m_scene->_flx_id_unused);
+      }
+
+      m_commands.clear();
+      m_data.clear();
+      m_names.clear();
+    }
+
+    bool EntityCommandBuffer::IsEmpty() const
+    {
+      return m_commands.empty();
+    }
+
+    #pragma endregion
+
+    #pragma region Playback
+
+    // Steps:
+    // 1. Group the commands by entity, keeping the order they were recorded in
+    //    The flags are ignored, they can differ between handles of the same entity.
+    // 2. Apply the commands of each entity in one go
+    void EntityCommandBuffer::Playback()
+    {
+      FLX_FLOW_FUNCTION();
+
+      // 1. Group the commands by entity
+      auto get_key = [this](std::size_t index)
+      {
+        EntityID entity = m_commands[index].entity;
+        return std::make_pair(ID::GetID(entity), ID::GetGeneration(entity));
+      };
+
+      std::vector<std::size_t> order(m_commands.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(
+        order.begin(), order.end(),
+        [&get_key](std::size_t a, std::size_t b) { return get_key(a) < get_key(b); }
+      );
+
+      // 2. Apply the commands of each entity
+      std::size_t first = 0;
+      while (first < order.size())
+      {
+        std::size_t last = first + 1;
+        while (last < order.size() && get_key(order[last]) == get_key(order[first])) last++;
+
+        Internal_ApplyEntityCommands(order.data() + first, order.data() + last);
+        first = last;
+      }
+
+      // the created entities are in the scene now, so Clear must not release their ids
+      m_commands.clear();
+      Clear();
+    }
+
+    // Steps:
+    // 1. Collapse the commands into the final state of the entity
+    // 2. Handle destroyed entities
+    // 3. Give created entities their name
+    // 4. Compute the final archetype type
+    // 5. Move the entity to the final archetype once
+    // 6. Write the added component data
+    void EntityCommandBuffer::Internal_ApplyEntityCommands(const std::size_t* first, const std::size_t* last)
+    {
+      EntityID entity = m_commands[*first].entity;
+
+      // 1. Collapse the commands into the final state of the entity
+      // added holds the latest data for each added component
+      bool is_created = false;
+      bool is_destroyed = false;
+      std::size_t name = 0;
+      std::vector<std::pair<ComponentID, std::size_t>> added;
+      ComponentIDList removed;
+
+      for (const std::size_t* it = first; it != last; it++)
+      {
+        const Command& command = m_commands[*it];
+        switch (command.type)
+        {
+        case CommandType::Create:
+          is_created = true;
+          name = command.data_offset;
+          break;
+        case CommandType::Destroy:
+          is_destroyed = true;
+          break;
+        case CommandType::AddComponent:
+        {
+          removed.erase(std::remove(removed.begin(), removed.end(), command.component), removed.end());
+          auto existing = std::find_if(added.begin(), added.end(), [&command](auto& pair) { return pair.first == command.component; });
+          if (existing != added.end()) existing->second = command.data_offset;
+          else added.push_back({ command.component, command.data_offset });
+          break;
+        }
+        case CommandType::RemoveComponent:
+          added.erase(std::remove_if(added.begin(), added.end(), [&command](auto& pair) { return pair.first == command.component; }), added.end());
+          if (std::find(removed.begin(), removed.end(), command.component) == removed.end()) removed.push_back(command.component);
+          break;
+        }
+      }
+
+      Scene& scene = *m_scene;
+
+      // 2. Handle destroyed entities
+      if (is_destroyed)
+      {
+        // the entity never made it into the scene, just release the id
+        if (is_created) ID::Destroy(entity, scene._flx_id_unused);
+        else Scene::DestroyEntity(scene, entity);
+        return;
+      }
+
+      // guard: the entity was destroyed before playback or the handle is stale
+      if (!is_created && !scene.entity_index.Contains(entity))
+      {
+        Log::Warning("EntityCommandBuffer: Attempted to modify an entity that does not exist.");
+        return;
+      }
+
+      // 3. Give created entities their name
+      // every entity has a name component, see Scene::CreateEntity
+      // skipped if the name component was added or removed by a later command
+      if (is_created)
+      {
+        ComponentID name_component = GetComponentID<Scene::StringIndex>();
+        bool is_name_recorded =
+          std::find_if(added.begin(), added.end(), [name_component](auto& pair) { return pair.first == name_component; }) != added.end() ||
+          std::find(removed.begin(), removed.end(), name_component) != removed.end();
+
+        if (!is_name_recorded)
+        {
+          Scene::StringIndex index = scene.Internal_StringStorage_New(m_names[name]);
+          added.push_back({ name_component, m_data.size() });
+          m_data.insert(m_data.end(), reinterpret_cast<const uint8_t*>(&index), reinterpret_cast<const uint8_t*>(&index) + sizeof(index));
+        }
+      }
+
+      // 4. Compute the final archetype type
+      Archetype* from = is_created ? nullptr : scene.entity_index[entity].archetype;
+      std::size_t from_row = is_created ? 0 : scene.entity_index[entity].row;
+
+      ComponentIDList type;
+      if (from != nullptr)
+      {
+        for (ComponentID component : from->type)
+        {
+          if (std::find(removed.begin(), removed.end(), component) == removed.end()) type.push_back(component);
+        }
+      }
+      for (auto& [component, data_offset] : added) type.push_back(component);
+      std::sort(type.begin(), type.end());
+      type.erase(std::unique(type.begin(), type.end()), type.end());
+
+      // 5. Move the entity to the final archetype once
+      Archetype* to = nullptr;
+      if (from != nullptr && type == from->type)
+      {
+        // no structural change, only the data is overwritten
+        to = from;
+      }
+      else
+      {
+        auto it = scene.archetype_index.find(type);
+        to = (it != scene.archetype_index.end()) ? &it->second : &Entity::Internal_CreateArchetype(scene, type);
+
+        if (from != nullptr)
+        {
+          Entity::Internal_MoveEntity(scene, entity, *from, from_row, *to);
+        }
+        else
+        {
+          to->entities.push_back(entity);
+          scene.entity_index.Insert(entity, { to, to->id, to->entities.size() - 1 });
+        }
+      }
+
+      // 6. Write the added component data
+      // Components the entity already had were copied by Internal_MoveEntity and are overwritten,
+      // new components are pushed into their column.
+      std::size_t row = scene.entity_index[entity].row;
+      for (auto& [component, data_offset] : added)
+      {
+        Column& column = to->archetype_table[scene.component_index[component][to->id].column];
+        if (column.size() > row)
+        {
+          std::memcpy(column.Get(row), m_data.data() + data_offset, column.GetElementSize());
+          column.MarkChanged(row);
+        }
+        else column.PushBack(m_data.data() + data_offset);
+      }
+    }
+
+    #pragma endregion
+
+  }
+}
@@ -0,0 +1,22 @@
+// inline functions for EntityCommandBuffer class
+
+// The component data is copied into the buffer as bytes,
+// the same way the columns store it.
+template <typename T>
+void FlexEngine::FlexECS::EntityCommandBuffer::AddComponent(EntityID entity, const T& data)
+{
+  // type erasure
+  T data_copy = data;
+
+  std::size_t data_offset = m_data.size();
+  m_data.resize(data_offset + sizeof(T));
+  std::memcpy(m_data.data() + data_offset, &data_copy, sizeof(T));
+
+  m_commands.push_back({ CommandType::AddComponent, entity, GetComponentID<T>(), data_offset });
+}
+
+template <typename T>
+void FlexEngine::FlexECS::EntityCommandBuffer::RemoveComponent(EntityID entity)
+{
+  m_commands.push_back({ CommandType::RemoveComponent, entity, GetComponentID<T>(), 0 });
+}
@@ -0,0 +1,364 @@
+#include "datastructures.h"
+
+#include "Wrapper/simd.h"
+
+namespace FlexEngine
+{
+  namespace FlexECS
+  {
+
+    #pragma region Helper Functions
+
+    // m_is_dirty value of entities that are waiting for Internal_Compact
+    static constexpr uint8_t REMOVED = 2;
+
+    static std::size_t Internal_GetSlot(EntityID entity)
+    {
+      return static_cast<std::size_t>(entity & ID::MASK_ID);
+    }
+
+    // Compares the id and the generation, the flags may change while the entity is in the hierarchy
+    static bool Internal_IsSameEntity(EntityID a, EntityID b)
+    {
+      constexpr EntityID MASK_KEY = ~(static_cast<EntityID>(ID::MASK_FLAGS) << ID::SHIFT_FLAGS);
+      return ((a ^ b) & MASK_KEY) == 0;
+    }
+
+    // out = a * b
+    // Each column of the result is the columns of a weighted by one column of b.
+    // Both matrices are column-major and 64 byte aligned.
+    static void Internal_Multiply(const Matrix4x4& a, const Matrix4x4& b, Matrix4x4& out)
+    {
+      const SIMD_128BIT a0 = _mm_load_ps(&a.data[0]);
+      const SIMD_128BIT a1 = _mm_load_ps(&a.data[4]);
+      const SIMD_128BIT a2 = _mm_load_ps(&a.data[8]);
+      const SIMD_128BIT a3 = _mm_load_ps(&a.data[12]);
+
+      for (std::size_t column = 0; column < 4; column++)
+      {
+        const float* b_column = &b.data[column * 4];
+
+        SIMD_128BIT result = SIMD_MUL(a0, _mm_set1_ps(b_column[0]));
+        result = SIMD_ADD(result, SIMD_MUL(a1, _mm_set1_ps(b_column[1])));
+        result = SIMD_ADD(result, SIMD_MUL(a2, _mm_set1_ps(b_column[2])));
+        result = SIMD_ADD(result, SIMD_MUL(a3, _mm_set1_ps(b_column[3])));
+
+        _mm_store_ps(&out.data[column * 4], result);
+      }
+    }
+
+    #pragma endregion
+
+    #pragma region TransformHierarchy
+
+    uint32_t TransformHierarchy::Internal_Find(EntityID entity) const
+    {
+      std::size_t slot = Internal_GetSlot(entity);
+      if (entity == 0 || slot >= m_lookup.size() || m_lookup[slot] == 0) return NO_PARENT;
+
+      // the slot may belong to an older generation of the entity
+      uint32_t index = m_lookup[slot] - 1;
+      return Internal_IsSameEntity(m_entities[index], entity) ? index : NO_PARENT;
+    }
+
+    bool TransformHierarchy::Contains(EntityID entity) const
+    {
+      return Internal_Find(entity) != NO_PARENT;
+    }
+
+    const Matrix4x4& TransformHierarchy::GetWorldMatrix(EntityID entity) const
+    {
+      uint32_t index = Internal_Find(entity);
+      return (index != NO_PARENT) ? m_world_matrices[index] : Matrix4x4::Identity;
+    }
+
+    void TransformHierarchy::Internal_MarkDirty(std::size_t index)
+    {
+      m_is_dirty[index] = 1;
+      m_first_dirty = (std::min)(m_first_dirty, index);
+    }
+
+    void TransformHierarchy::Add(EntityID entity)
+    {
+      // guard: already added
+      if (entity == 0 || Internal_Find(entity) != NO_PARENT) return;
+
+      std::size_t slot = Internal_GetSlot(entity);
+      if (slot >= m_lookup.size()) m_lookup.resize(slot + 1, 0);
+
+      // an older generation of the entity was destroyed without being removed
+      if (m_lookup[slot] != 0) Remove(m_entities[m_lookup[slot] - 1]);
+
+      // new entities are roots at the end, which keeps the order sorted
+      std::size_t index = m_entities.size();
+      m_lookup[slot] = static_cast<uint32_t>(index + 1);
+      m_entities.push_back(entity);
+      m_parents.push_back(0);
+      m_parent_indexes.push_back(NO_PARENT);
+      m_local_matrices.push_back(Matrix4x4::Identity);
+      m_world_matrices.push_back(Matrix4x4::Identity);
+      m_is_dirty.push_back(0);
+      m_is_changed.push_back(0);
+
+      // the first Update reports the new entity as changed
+      if (m_first_dirty > index) m_first_dirty = index;
+      m_is_dirty[index] = 1;
+    }
+
+    void TransformHierarchy::SetParent(EntityID entity, EntityID parent)
+    {
+      Add(entity);
+      if (parent != 0) Add(parent);
+
+      uint32_t index = Internal_Find(entity);
+      uint32_t parent_index = Internal_Find(parent);
+
+      // guard: nothing changed
+      if (m_parents[index] == 0 ? parent == 0 : (parent != 0 && Internal_IsSameEntity(m_parents[index], parent))) return;
+
+      m_parents[index] = parent;
+      m_parent_indexes[index] = parent_index;
+      Internal_MarkDirty(index);
+
+      // the order is still sorted if the parent already comes before the child,
+      // which is the case for children that were created after their parent
+      if (parent_index != NO_PARENT && parent_index > index) m_is_sorted = false;
+    }
+
+    void TransformHierarchy::SetLocalMatrix(EntityID entity, const Matrix4x4& local_matrix)
+    {
+      Add(entity);
+
+      uint32_t index = Internal_Find(entity);
+      m_local_matrices[index] = local_matrix;
+      Internal_MarkDirty(index);
+    }
+
+    void TransformHierarchy::Remove(EntityID entity)
+    {
+      uint32_t index = Internal_Find(entity);
+
+      // guard: not in the hierarchy
+      if (index == NO_PARENT) return;
+
+      // compacted by the next Update
+      Internal_FlagRemoved(index);
+    }
+
+    void TransformHierarchy::RemoveDestroyed(const EntityIndex& entity_index)
+    {
+      for (std::size_t i = 0; i < m_entities.size(); i++)
+      {
+        if (m_is_dirty[i] != REMOVED && !entity_index.Contains(m_entities[i])) Internal_FlagRemoved(i);
+      }
+
+      if (m_removed_count != 0) Internal_Compact();
+    }
+
+    void TransformHierarchy::Internal_FlagRemoved(std::size_t index)
+    {
+      // the lookup is cleared right away so the entity can't be found or added twice
+      m_lookup[Internal_GetSlot(m_entities[index])] = 0;
+      m_is_dirty[index] = REMOVED;
+      if (m_is_changed[index])
+      {
+        m_is_changed[index] = 0;
+        m_changed_count--;
+      }
+      m_removed_count++;
+    }
+
+    void TransformHierarchy::Clear()
+    {
+      m_entities.clear();
+      m_parents.clear();
+      m_parent_indexes.clear();
+      m_local_matrices.clear();
+      m_world_matrices.clear();
+      m_is_dirty.clear();
+      m_is_changed.clear();
+      m_lookup.clear();
+      m_is_sorted = true;
+      m_first_dirty = 0;
+      m_changed_count = 0;
+      m_removed_count = 0;
+    }
+
+    // Steps:
+    // 1. Move the kept entities forward
+    // 2. Detach the children of removed entities and rebuild the parent indexes
+    // Removing entities from a sorted order leaves it sorted, so this does not sort.
+    // A parent that was removed and added again comes after its children though,
+    // which is left to the next Internal_Sort.
+    void TransformHierarchy::Internal_Compact()
+    {
+      // 1. Move the kept entities forward
+      // the lookup of the removed entities was cleared when they were flagged
+      std::size_t count = 0;
+      for (std::size_t i = 0; i < m_entities.size(); i++)
+      {
+        if (m_is_dirty[i] == REMOVED) continue;
+
+        m_entities[count] = m_entities[i];
+        m_parents[count] = m_parents[i];
+        m_local_matrices[count] = m_local_matrices[i];
+        m_world_matrices[count] = m_world_matrices[i];
+        m_is_dirty[count] = m_is_dirty[i];
+        m_is_changed[count] = m_is_changed[i];
+        m_lookup[Internal_GetSlot(m_entities[count])] = static_cast<uint32_t>(count + 1);
+        count++;
+      }
+
+      m_entities.resize(count);
+      m_parents.resize(count);
+      m_parent_indexes.resize(count);
+      m_local_matrices.resize(count);
+      m_world_matrices.resize(count);
+      m_is_dirty.resize(count);
+      m_is_changed.resize(count);
+      m_removed_count = 0;
+
+      // 2. Detach the children of removed entities and rebuild the parent indexes
+      // this needs the complete lookup, so it is a second pass
+      m_first_dirty = count;
+      for (std::size_t i = 0; i < count; i++)
+      {
+        m_parent_indexes[i] = Internal_Find(m_parents[i]);
+        if (m_parents[i] != 0 && m_parent_indexes[i] == NO_PARENT)
+        {
+          m_parents[i] = 0;
+          m_is_dirty[i] = 1;
+        }
+
+        // the parent was added again after the child
+        if (m_parent_indexes[i] != NO_PARENT && m_parent_indexes[i] > i) m_is_sorted = false;
+
+        if (m_is_dirty[i] && m_first_dirty > i) m_first_dirty = i;
+      }
+    }
+
+    // Steps:
+    // 1. Find the parent index of each entity
+    // 2. Compute the depth of each entity, breaking cycles
+    // 3. Counting sort by depth, stable so siblings keep their order
+    // 4. Reorder the arrays and rebuild the lookup
+    void TransformHierarchy::Internal_Sort()
+    {
+      const std::size_t count = m_entities.size();
+
+      // 1. Find the parent index of each entity
+      for (std::size_t i = 0; i < count; i++) m_parent_indexes[i] = Internal_Find(m_parents[i]);
+
+      // 2. Compute the depth of each entity
+      // Each walk up the parent chain stops at the first entity with a known depth,
+      // so every entity is visited once.
+      constexpr uint32_t UNKNOWN = static_cast<uint32_t>(-1);
+      constexpr uint32_t VISITING = UNKNOWN - 1;
+      std::vector<uint32_t> depths(count, UNKNOWN);
+      std::vector<uint32_t> chain;
+      uint32_t max_depth = 0;
+      for (std::size_t i = 0; i < count; i++)
+      {
+        uint32_t current = static_cast<uint32_t>(i);
+        while (current != NO_PARENT && depths[current] == UNKNOWN)
+        {
+          depths[current] = VISITING;
+          chain.push_back(current);
+          current = m_parent_indexes[current];
+        }
+
+        uint32_t depth = 0;
+        if (current != NO_PARENT && depths[current] == VISITING)
+        {
+          // the chain looped back onto itself, the last entity walked becomes a root
+          Log::Error("Transform hierarchy has a cycle, detaching entity " + std::to_string(m_entities[chain.back()]));
+          m_parents[chain.back()] = 0;
+          m_parent_indexes[chain.back()] = NO_PARENT;
+          Internal_MarkDirty(chain.back());
+        }
+        else if (current != NO_PARENT)
+        {
+          depth = depths[current] + 1;
+        }
+
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) depths[*it] = depth++;
+        if (!chain.empty()) max_depth = (std::max)(max_depth, depth - 1);
+        chain.clear();
+      }
+
+      // 3. Counting sort by depth
+      std::vector<std::size_t> offsets(static_cast<std::size_t>(max_depth) + 2, 0);
+      for (std::size_t i = 0; i < count; i++) offsets[depths[i] + 1]++;
+      for (std::size_t depth = 1; depth < offsets.size(); depth++) offsets[depth] += offsets[depth - 1];
+
+      std::vector<uint32_t> order(count);
+      for (std::size_t i = 0; i < count; i++) order[offsets[depths[i]]++] = static_cast<uint32_t>(i);
+
+      // 4. Reorder the arrays and rebuild the lookup
+      auto reorder = [&order](auto& values)
+      {
+        std::remove_reference_t<decltype(values)> sorted_values;
+        sorted_values.reserve(values.size());
+        for (uint32_t index : order) sorted_values.push_back(values[index]);
+        values.swap(sorted_values);
+      };
+      reorder(m_entities);
+      reorder(m_parents);
+      reorder(m_local_matrices);
+      reorder(m_world_matrices);
+      reorder(m_is_dirty);
+      reorder(m_is_changed);
+
+      m_first_dirty = count;
+      for (std::size_t i = 0; i < count; i++)
+      {
+        m_lookup[Internal_GetSlot(m_entities[i])] = static_cast<uint32_t>(i + 1);
+        if (m_is_dirty[i] && m_first_dirty > i) m_first_dirty = i;
+      }
+      for (std::size_t i = 0; i < count; i++) m_parent_indexes[i] = Internal_Find(m_parents[i]);
+
+      m_is_sorted = true;
+    }
+
+    // Steps:
+    // 1. Compact the removed entities
+    // 2. Sort the entities if the hierarchy changed
+    // 3. Walk the entities from the first dirty one,
+    //    recompute the entities that are dirty or whose parent was recomputed
+    void TransformHierarchy::Update()
+    {
+      // 1. Compact the removed entities
+      if (m_removed_count != 0) Internal_Compact();
+
+      // 2. Sort the entities if the hierarchy changed
+      if (!m_is_sorted) Internal_Sort();
+
+      // the changes of the last update were consumed
+      if (m_changed_count != 0) std::fill(m_is_changed.begin(), m_is_changed.end(), uint8_t(0));
+      m_changed_count = 0;
+
+      // 3. Walk the entities from the first dirty one
+      // parents come first, so nothing before the first dirty entity can change
+      for (std::size_t i = m_first_dirty; i < m_entities.size(); i++)
+      {
+        const uint32_t parent_index = m_parent_indexes[i];
+        const bool is_parent_changed = (parent_index != NO_PARENT && m_is_changed[parent_index]);
+
+        // guard: up to date
+        if (!m_is_dirty[i] && !is_parent_changed) continue;
+
+        if (parent_index == NO_PARENT) m_world_matrices[i] = m_local_matrices[i];
+        else Internal_Multiply(m_world_matrices[parent_index], m_local_matrices[i], m_world_matrices[i]);
+
+        m_is_dirty[i] = 0;
+        m_is_changed[i] = 1;
+        m_changed_count++;
+      }
+
+      m_first_dirty = m_entities.size();
+    }
+
+    #pragma endregion
+
+  }
+}
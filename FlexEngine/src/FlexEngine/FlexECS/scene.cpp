@@ -11,44 +11,159 @@ namespace FlexEngine
 
     #pragma region String Storage
 
-    std::string& Scene::Internal_StringStorage_Get(StringIndex index)
+    std::string_view Scene::Internal_StringStorage_Get(StringIndex index) const
     {
-      return string_storage[index];
+      return string_storage.Get(index);
     }
 
-    Scene::StringIndex Scene::Internal_StringStorage_New(const std::string& str)
+    Scene::StringIndex Scene::Internal_StringStorage_New(std::string_view str)
     {
-      StringIndex index = 1;
+      return string_storage.Intern(str);
+    }
 
-      // check if there are any free indices
-      if (!string_storage_free_list.empty())
+    void Scene::Internal_StringStorage_Delete(StringIndex index)
+    {
+      string_storage.Release(index);
+    }
+
+    // Collects the offsets of the members registered with FLX_REFL_REGISTER_STRING_INDEX,
+    // including the members of nested structs.
+    static void Internal_FindStringIndexMembers(const Reflection::TypeDescriptor_Struct& type_desc, std::size_t base_offset, std::vector<std::size_t>& offsets)
+    {
+      for (const Reflection::TypeDescriptor_Struct::Member& member : type_desc.members)
       {
-        index = string_storage_free_list.back();
-        string_storage_free_list.pop_back();
+        if (member.is_string_index)
+        {
+          offsets.push_back(base_offset + member.offset);
+        }
+        else if (auto nested = dynamic_cast<const Reflection::TypeDescriptor_Struct*>(member.type))
+        {
+          Internal_FindStringIndexMembers(*nested, base_offset + member.offset, offsets);
+        }
+      }
+    }
 
-        // store the string
-        string_storage[index] = str;
+    // Steps:
+    // 1. Find the string index members of each component and resource type through reflection
+    // 2. Count the references to each string
+    // 3. Compact the string table
+    // 4. Rewrite the indexes that moved
+    void Scene::Internal_StringStorage_Compact()
+    {
+      FLX_FLOW_FUNCTION();
+
+      // 1. Find the string index members
+      // The name component is the index itself.
+      // Types that are not registered with the reflection system can't be read,
+      // their strings are not counted and are dropped if nothing else uses them.
+      ComponentID name_component = GetComponentID<StringIndex>();
+      std::vector<std::vector<std::size_t>> string_members(GetComponentCount());
+      std::vector<uint8_t> is_resolved(GetComponentCount(), false);
+      std::string unregistered_types;
+      auto resolve = [&](ComponentID component)
+      {
+        if (is_resolved[component]) return;
+        is_resolved[component] = true;
+
+        if (component == name_component)
+        {
+          string_members[component].push_back(0);
+          return;
+        }
+
+        Reflection::TypeDescriptor* type_desc = GetComponentTypeDescriptor(component);
+        if (type_desc == nullptr)
+        {
+          unregistered_types += (unregistered_types.empty() ? "" : ", ") + GetComponentName(component);
+          return;
+        }
+
+        if (auto struct_desc = dynamic_cast<const Reflection::TypeDescriptor_Struct*>(type_desc))
+        {
+          Internal_FindStringIndexMembers(*struct_desc, 0, string_members[component]);
+        }
+      };
+      for (auto& [type, archetype] : archetype_index)
+      {
+        for (ComponentID component : archetype.type) resolve(component);
       }
-      // get the next index
-      else
+      resources.Each([&](ComponentID resource, const Column&) { resolve(resource); });
+
+      if (!unregistered_types.empty())
+      {
+        Log::Warning("String storage compaction skipped the types that are not registered with the reflection system: " + unregistered_types);
+      }
+
+      // Calls the function with each string index in the column
+      auto for_each_index = [&string_members](ComponentID component, Column& column, auto&& fn)
+      {
+        const std::vector<std::size_t>& offsets = string_members[component];
+        if (offsets.empty()) return;
+
+        for (std::size_t row = 0; row < column.size(); row++)
+        {
+          uint8_t* element = static_cast<uint8_t*>(column.Get(row));
+          for (std::size_t offset : offsets) fn(*reinterpret_cast<StringIndex*>(element + offset), row);
+        }
+      };
+
+      // 2. Count the references
+      std::vector<uint32_t> references(string_storage.size(), 0);
+      auto count_references = [&references](StringIndex& index, std::size_t)
       {
-        // store the string
-        string_storage.push_back(str);
-        index = string_storage.size() - 1;
+        if (index < references.size()) references[index]++;
+      };
+      for (auto& [type, archetype] : archetype_index)
+      {
+        for (std::size_t i = 0; i < archetype.type.size(); i++) for_each_index(archetype.type[i], archetype.archetype_table[i], count_references);
       }
+      resources.Each([&](ComponentID resource, Column& column) { for_each_index(resource, column, count_references); });
+
+      // 3. Compact the string table
+      std::vector<StringIndex> remap = string_storage.Compact(references);
+
+      // 4. Rewrite the indexes
+      auto rewrite = [&](ComponentID component, Column& column)
+      {
+        for_each_index(
+          component, column,
+          [&remap, &column](StringIndex& index, std::size_t row)
+          {
+            if (index >= remap.size() || remap[index] == index) return;
 
-      // return the index
-      return index;
+            index = remap[index];
+            column.MarkChanged(row);
+          }
+        );
+      };
+      for (auto& [type, archetype] : archetype_index)
+      {
+        for (std::size_t i = 0; i < archetype.type.size(); i++) rewrite(archetype.type[i], archetype.archetype_table[i]);
+      }
+      resources.Each(rewrite);
     }
 
-    void Scene::Internal_StringStorage_Delete(StringIndex index)
+    #pragma endregion
+
+
+    #pragma region Query Cache
+
+    const QueryCacheList& Scene::GetQueryCaches() const
     {
-      // add the index to the free list
-      string_storage_free_list.push_back(index);
+      return query_cache;
     }
 
-    #pragma endregion
+    void Scene::ResetQueryMatchCounts()
+    {
+      std::lock_guard<std::mutex> lock(query_cache.mutex);
+      for (QueryCache& cache : query_cache)
+      {
+        cache.match_count_last_frame = cache.match_count;
+        cache.match_count = 0;
+      }
+    }
 
+    #pragma endregion
 
     #pragma region Scene Management Functions
 
@@ -105,6 +220,11 @@ namespace FlexEngine
 
     // Creates a new entity by giving it a name
     Entity Scene::CreateEntity(const std::string& name)
+    {
+      return CreateEntity(GetActiveSceneRef(), name);
+    }
+
+    Entity Scene::CreateEntity(Scene& scene, const std::string& name)
     {
       FLX_FLOW_FUNCTION();
 
@@ -112,48 +232,52 @@ namespace FlexEngine
 
       // manually register a name component
       // this is to register the entity in the entity index and archetype
-      ComponentID component = Reflection::TypeResolver<T>::Get()->name;
+      ComponentID component = GetComponentID<T>();
 
       // type erasure
-      T data_copy = Scene::GetActiveScene()->Internal_StringStorage_New(name);
-      void* data_copy_ptr = reinterpret_cast<void*>(&data_copy);
-      ComponentData<void> data_ptr = Internal_CreateComponentData(sizeof(T), data_copy_ptr);
+      T data_copy = scene.Internal_StringStorage_New(name);
+      const void* data_copy_ptr = reinterpret_cast<const void*>(&data_copy);
 
       // Get the archetype for the entity
       ComponentIDList type = { component };
 
       // create a new archetype if it doesn't exist
-      if (ARCHETYPE_INDEX.count(type) == 0)
+      if (scene.archetype_index.count(type) == 0)
       {
-        Entity::Internal_CreateArchetype(type);
+        Entity::Internal_CreateArchetype(scene, type);
       }
 
       // create entity id
-      EntityID entity_id = ID::Create(ID::Flags::Flag_None, Scene::GetActiveScene()->_flx_id_next, Scene::GetActiveScene()->_flx_id_unused);
+      EntityID entity_id = ID::Create(ID::Flags::Flag_None, scene._flx_id_next, scene._flx_id_unused);
 
       // update entity vector
-      Archetype& archetype = ARCHETYPE_INDEX[type];
+      Archetype& archetype = scene.archetype_index[type];
       archetype.entities.push_back(entity_id);
 
       // update entity records
       EntityRecord entity_record = { &archetype, archetype.id, archetype.entities.size() - 1 };
-      ENTITY_INDEX[entity_id] = entity_record;
+      scene.entity_index.Insert(entity_id, entity_record);
 
       // store the component data in the archetype
       //ArchetypeMap& archetype_map = COMPONENT_INDEX[component];
       //ArchetypeRecord& archetype_record = archetype_map[archetype.id];
       //archetype.archetype_table[archetype_record.column].push_back(data_ptr);
-      archetype.archetype_table[0].push_back(data_ptr); // there is only one component in this archetype
+      archetype.archetype_table[0].PushBack(data_copy_ptr); // there is only one component in this archetype
 
       return entity_id;
     }
 
     void Scene::DestroyEntity(EntityID entity)
+    {
+      DestroyEntity(GetActiveSceneRef(), entity);
+    }
+
+    void Scene::DestroyEntity(Scene& scene, EntityID entity)
     {
       FLX_FLOW_FUNCTION();
 
-      // guard: entity does not exist
-      if (ENTITY_INDEX.count(entity) == 0)
+      // guard: entity does not exist or the handle is stale
+      if (!scene.entity_index.Contains(entity))
       {
         Log::Warning("Attempted to destroy entity that does not exist.");
         return;
@@ -161,69 +285,61 @@ namespace FlexEngine
 
       // Get the important data
       // The entity's archetype and row are needed to remove the entity from the archetype
-      EntityRecord& entity_record = ENTITY_INDEX[entity];
+      EntityRecord& entity_record = scene.entity_index[entity];
       Archetype& archetype = *entity_record.archetype;
       std::size_t row = entity_record.row;
 
       // Remove the entity from the source archetype's columns and entities vector
       // The same code is being used in Internal_MoveEntity
-      std::size_t last_row_index = archetype.archetype_table[0].size() - 1;
+      std::size_t last_row_index = archetype.entities.size() - 1;
 
-      // Handle the case where the entity is the last entity in the archetype
-      if (row == last_row_index)
+      // Swap the entity with the last entity in the archetype and pop it
+      // Using swap-and-pop is more performant than erase() since it requires shifting
+      // all subsequent elements forward.
+      // O(1) complexity for swap-and-pop vs O(n) complexity for erase()
+      for (std::size_t i = 0; i < archetype.archetype_table.size(); i++)
       {
-        for (std::size_t i = 0; i < archetype.archetype_table.size(); i++)
-        {
-          archetype.archetype_table[i].pop_back();
-        }
+        archetype.archetype_table[i].SwapRemove(row);
       }
-      else
-      {
-        // Swap the entity with the last entity in the archetype and pop it
-        // Using swap-and-pop is more performant than erase() since it requires shifting
-        // all subsequent elements forward.
-        // O(1) complexity for swap-and-pop vs O(n) complexity for erase()
-        for (std::size_t i = 0; i < archetype.archetype_table.size(); i++)
-        {
-          std::swap(archetype.archetype_table[i][row], archetype.archetype_table[i][last_row_index]);
-          archetype.archetype_table[i].pop_back();
-        }
 
-        // Update entity_index for the swapped entity if necessary
-        if (row < last_row_index)
-        {
-          EntityID swapped_entity = archetype.entities[last_row_index];
-          ENTITY_INDEX[swapped_entity].row = row;
+      // Update entity_index for the swapped entity if necessary
+      if (row < last_row_index)
+      {
+        EntityID swapped_entity = archetype.entities[last_row_index];
+        scene.entity_index[swapped_entity].row = row;
 
-          // Replace the entity's row in the entities vector
-          archetype.entities[row] = swapped_entity;
-        }
+        // Replace the entity's row in the entities vector
+        archetype.entities[row] = swapped_entity;
       }
 
       // Pop the entity from the entities vector
       archetype.entities.pop_back();
 
       // Remove the entity from the entity index
-      ENTITY_INDEX.erase(entity);
+      scene.entity_index.Erase(entity);
 
       // Destroy the entity id
-      ID::Destroy(entity, Scene::GetActiveScene()->_flx_id_unused);
+      ID::Destroy(entity, scene._flx_id_unused);
     }
 
     void Scene::SetEntityFlags(EntityID& entity, const uint8_t flags)
+    {
+      SetEntityFlags(GetActiveSceneRef(), entity, flags);
+    }
+
+    void Scene::SetEntityFlags(Scene& scene, EntityID& entity, const uint8_t flags)
     {
       EntityID updated_entity = entity;
       ID::SetFlags(updated_entity, flags);
 
       // update the entity in the archetype entity vector
-      EntityRecord& entity_record = ENTITY_INDEX[entity];
+      EntityRecord& entity_record = scene.entity_index[entity];
       Archetype& archetype = *entity_record.archetype;
       std::size_t row = entity_record.row;
       archetype.entities[row] = updated_entity;
 
-      // move the entity record to the new key
-      ENTITY_INDEX[updated_entity] = entity_record;
-      ENTITY_INDEX.erase(entity);
+      // the flags are not part of the key, so the record stays in the same slot
+      scene.entity_index.Insert(updated_entity, entity_record);
 
       entity = updated_entity;
     }
@@ -234,33 +350,161 @@ namespace FlexEngine
       \return EntityID of the cloned entity.
     */
     EntityID Scene::CloneEntity(EntityID entity_to_copy)
+    {
+      return CloneEntity(GetActiveSceneRef(), entity_to_copy);
+    }
+
+    EntityID Scene::CloneEntity(Scene& scene, EntityID entity_to_copy)
     {
       // Get the archetype of the entity to copy
-      EntityRecord& entity_record = ENTITY_INDEX[entity_to_copy];
+      // The row is copied out because inserting the new entity can grow the entity index
+      EntityRecord& entity_record = scene.entity_index[entity_to_copy];
       Archetype& archetype = *entity_record.archetype;
+      std::size_t row = entity_record.row;
 
       // First we need to assign this new entity an ID
-      EntityID new_entity = ID::Create(ID::Flags::Flag_None, Scene::GetActiveScene()->_flx_id_next, Scene::GetActiveScene()->_flx_id_unused);
+      EntityID new_entity = ID::Create(ID::Flags::Flag_None, scene._flx_id_next, scene._flx_id_unused);
       
       // Secondly, we update the scene's archetype by telling it we want to add one more entity of this index...
       archetype.entities.push_back(new_entity);
 
       // ... then update entity records of this new entity
       EntityRecord new_entity_record = { &archetype, archetype.id, archetype.entities.size() - 1 };
-      ENTITY_INDEX[new_entity] = new_entity_record;
+      scene.entity_index.Insert(new_entity, new_entity_record);
 
       // Now, after the setup is complete, we copy the entire row over
+      // The columns store the component data directly, so this is a plain byte copy.
       for (std::size_t i{}; i < archetype.archetype_table.size(); i++)
       {
-        // Perform deep copy, after all, the data inside is actually just a pointer, so we need to reserve memory to store the new one.
-        std::pair<size_t, void*> old_data = Internal_GetComponentData(archetype.archetype_table[i][entity_record.row]);
-        ComponentData<void> new_data_instance = Internal_CreateComponentData(old_data.first, old_data.second);
-        archetype.archetype_table[i].push_back(new_data_instance);
+        archetype.archetype_table[i].PushBack(archetype.archetype_table[i].Get(row));
       }
 
       return new_entity;
     }
 
+    std::vector<EntityID> Scene::CloneEntity(EntityID entity_to_copy, std::size_t count)
+    {
+      return CloneEntity(GetActiveSceneRef(), entity_to_copy, count);
+    }
+
+    std::vector<EntityID> Scene::CloneEntity(Scene& scene, EntityID entity_to_copy, std::size_t count)
+    {
+      FLX_FLOW_FUNCTION();
+
+      // guard: entity does not exist
+      if (!scene.entity_index.Contains(entity_to_copy))
+      {
+        Log::Warning("Attempted to clone entity that does not exist.");
+        return {};
+      }
+
+      // the source row is copied into every new row
+      // the column handles the source being inside its own buffer
+      EntityRecord& entity_record = scene.entity_index[entity_to_copy];
+      Archetype& archetype = *entity_record.archetype;
+
+      std::vector<const void*> row_data(archetype.archetype_table.size());
+      for (std::size_t i = 0; i < archetype.archetype_table.size(); i++)
+      {
+        row_data[i] = archetype.archetype_table[i].Get(entity_record.row);
+      }
+
+      return Internal_CreateEntitiesInArchetype(scene, archetype, count, row_data);
+    }
+
+    // Steps:
+    // 1. Build the archetype type with the name component
+    // 2. Sort the type and the prototype data together
+    // 3. Find or create the archetype
+    // 4. Create the entities in bulk
+    std::vector<EntityID> Scene::CreateEntities(
+      std::size_t count,
+      const ComponentIDList& components,
+      const std::vector<const void*>& prototype,
+      const std::string& name
+    )
+    {
+      return CreateEntities(GetActiveSceneRef(), count, components, prototype, name);
+    }
+
+    std::vector<EntityID> Scene::CreateEntities(
+      Scene& scene,
+      std::size_t count,
+      const ComponentIDList& components,
+      const std::vector<const void*>& prototype,
+      const std::string& name
+    )
+    {
+      FLX_FLOW_FUNCTION();
+
+      // 1. Build the archetype type with the name component
+      std::vector<std::pair<ComponentID, const void*>> entries;
+      entries.reserve(components.size() + 1);
+      for (std::size_t i = 0; i < components.size(); i++)
+      {
+        entries.push_back({ components[i], i < prototype.size() ? prototype[i] : nullptr });
+      }
+
+      StringIndex name_index = 0;
+      ComponentID name_component = GetComponentID<StringIndex>();
+      if (std::find(components.begin(), components.end(), name_component) == components.end())
+      {
+        name_index = scene.Internal_StringStorage_New(name);
+        entries.push_back({ name_component, &name_index });
+      }
+
+      // 2. Sort the type and the prototype data together
+      std::sort(entries.begin(), entries.end(), [](auto& a, auto& b) { return a.first < b.first; });
+
+      ComponentIDList type;
+      std::vector<const void*> row_data;
+      type.reserve(entries.size());
+      row_data.reserve(entries.size());
+      for (auto& [component, data] : entries)
+      {
+        // guard: duplicate components
+        if (!type.empty() && type.back() == component) continue;
+        type.push_back(component);
+        row_data.push_back(data);
+      }
+
+      // 3. Find or create the archetype
+      auto it = scene.archetype_index.find(type);
+      Archetype& archetype = (it != scene.archetype_index.end()) ? it->second : Entity::Internal_CreateArchetype(scene, type);
+
+      // 4. Create the entities in bulk
+      return Internal_CreateEntitiesInArchetype(scene, archetype, count, row_data);
+    }
+
+    std::vector<EntityID> Scene::Internal_CreateEntitiesInArchetype(Scene& scene, Archetype& archetype, std::size_t count, const std::vector<const void*>& row_data)
+    {
+      // copy the rows in bulk, each column grows at most once
+      for (std::size_t i = 0; i < archetype.archetype_table.size(); i++)
+      {
+        archetype.archetype_table[i].PushBackRepeated(row_data[i], count);
+      }
+
+      // create the entity ids
+      std::vector<EntityID> entities;
+      entities.reserve(count);
+      for (std::size_t i = 0; i < count; i++)
+      {
+        entities.push_back(ID::Create(ID::Flags::Flag_None, scene._flx_id_next, scene._flx_id_unused));
+      }
+
+      // register the entities
+      // new ids are counted up from _flx_id_next, so that is the highest slot
+      std::size_t first_row = archetype.entities.size();
+      archetype.entities.insert(archetype.entities.end(), entities.begin(), entities.end());
+      scene.entity_index.Reserve(scene._flx_id_next);
+      for (std::size_t i = 0; i < count; i++)
+      {
+        scene.entity_index.Insert(entities[i], { &archetype, archetype.id, first_row + i });
+      }
+
+      return entities;
+    }
+
     /*!
       \brief Saves an entity as a .flxprefab file
       \param entityToSave ID of entity to save as prefab.
@@ -269,7 +513,7 @@ namespace FlexEngine
     void Scene::SaveEntityAsPrefab(EntityID entityToSave, const std::string& prefabName)
     {
       // Get the current entity to write to prefab
-      EntityRecord& entity_record = ENTITY_INDEX[entityToSave];
+      EntityRecord& entity_record = GetActiveSceneRef().entity_index[entityToSave];
       Archetype& archetype = *entity_record.archetype;
 
       // Create a new prefab file in asset manager directory, then open this file
@@ -283,8 +527,8 @@ namespace FlexEngine
       for (std::size_t i{}; i < archetype.archetype_table.size(); i++) // For component in the archetype...
       {
         // Automatic serialization as long as a type is provided.
-        Reflection::TypeDescriptor* type = TYPE_DESCRIPTOR_LOOKUP[archetype.type[i]];
-        type->Serialize(Internal_GetComponentData(archetype.archetype_table[i][entity_record.row]).second, data_stream);
+        Reflection::TypeDescriptor* type = GetComponentTypeDescriptor(archetype.type[i]);
+        type->Serialize(archetype.archetype_table[i].Get(entity_record.row), data_stream);
         
         if (i != archetype.archetype_table.size() - 1) data_stream << ","; // Add a comma to separate components.
       }
@@ -303,26 +547,48 @@ namespace FlexEngine
 
     #pragma region Scene Serialization Functions
 
+    // The scene members are matched by position, so members that are not registered anymore
+    // are dropped from older saves to keep the later members in place.
+    // The entry at position is dropped if its type name contains type.
+    static void Internal_RemoveLegacySceneMember(Document& document, SizeType position, std::string_view type)
+    {
+      // guard: not a scene
+      if (!document.IsObject() || !document.HasMember("data") || !document["data"].IsArray()) return;
+
+      auto& members = document["data"];
+      if (members.Size() <= position) return;
+
+      const auto& member = members[position];
+      if (!member.IsObject() || !member.HasMember("type") || !member["type"].IsString()) return;
+
+      if (std::string_view(member["type"].GetString()).find(type) == std::string_view::npos) return;
+
+      members.Erase(members.Begin() + position);
+    }
+
     // save the scene to a File
     // the flx formatter is wrapped here
     void Scene::Save(File& file)
     {
       Reflection::TypeDescriptor* type_desc = Reflection::TypeResolver<FlexECS::Scene>::Get();
 
-      std::stringstream ss;
-      type_desc->Serialize(this, ss);
+      // the whole scene is written into one growing buffer
+      rapidjson::StringBuffer buffer;
+      Reflection::TypeDescriptor::json_writer writer(buffer);
+      type_desc->Serialize(this, writer);
+      std::string data(buffer.GetString(), buffer.GetSize());
 
       // check if we need to create a new flx file or overwrite the existing one
       FlxFmtFile flxfmtfile = FlexFormatter::Parse(file, FlxFmtFileType::Scene);
       if (flxfmtfile == FlxFmtFile::Null)
       {
         // make a new flx file
-        flxfmtfile = FlexFormatter::Create(ss.str(), true);
+        flxfmtfile = FlexFormatter::Create(data, true);
       }
       else
       {
         // update the data
-        flxfmtfile.data = ss.str();
+        flxfmtfile.data = std::move(data);
       }
 
       file.Write(flxfmtfile.Save());
@@ -346,18 +612,41 @@ namespace FlexEngine
         return std::make_shared<Scene>(Scene::Null);
       }
 
+      // the component index is rebuilt on load, it was saved after the entity index
+      // the old type is std::unordered_map<std::string, std::unordered_map<uint64_t, ArchetypeRecord>>
+      Internal_RemoveLegacySceneMember(document, 4, "ArchetypeRecord");
+
+      // the string storage free list was saved after the string storage, it is always empty
+      Internal_RemoveLegacySceneMember(document, 5, "std::vector<");
+
       std::shared_ptr<Scene> deserialized_scene = std::make_shared<Scene>();
       type_desc->Deserialize(deserialized_scene.get(), document);
 
+      // sort the archetype types with this process' component ids
+      deserialized_scene->Internal_RebuildArchetypeIndex();
+
+      // guard: a column failed to load, see TypeDescriptor_Column
+      if (!deserialized_scene->Internal_ValidateArchetypeTables())
+      {
+        Log::Error("Failed to load scene: " + std::to_string(file.path));
+        return std::make_shared<Scene>(Scene::Null);
+      }
+
       // relink entity archetype pointers
       deserialized_scene->Internal_RelinkEntityArchetypePointers();
 
+      // connect the archetype graph
+      deserialized_scene->Internal_RebuildArchetypeEdges();
+
+      // count the string references, this also merges the duplicate strings of older saves
+      deserialized_scene->Internal_StringStorage_Compact();
+
       return deserialized_scene;
     }
 
     void Scene::SaveActiveScene(File& file)
     {
-      Scene::GetActiveScene()->Save(file);
+      GetActiveSceneRef().Save(file);
     }
 
     #pragma endregion
@@ -365,24 +654,169 @@ namespace FlexEngine
 
     #pragma region Internal Functions
 
+    std::size_t Scene::Internal_FindColumn(const Archetype& archetype, ComponentID component)
+    {
+      auto it = std::lower_bound(archetype.type.begin(), archetype.type.end(), component);
+      if (it == archetype.type.end() || *it != component) return NO_COLUMN;
+      return static_cast<std::size_t>(it - archetype.type.begin());
+    }
+
+    void Scene::Internal_InitializeQueryCache(QueryCache& cache, const ComponentIDList& components)
+    {
+      cache.is_initialized = true;
+      cache.components = components;
+      cache.archetypes.clear();
+      cache.columns.clear();
+
+      for (auto& [type, archetype] : archetype_index) Internal_MatchQuery(cache, archetype);
+    }
+
+    uint64_t Scene::Internal_ExchangeLastRunTick(QueryCache& cache, uint64_t tick)
+    {
+      const QueryCallerID caller = GetQueryCaller();
+
+      // systems on other threads may run the same query at the same time
+      std::lock_guard<std::mutex> lock(query_cache.mutex);
+      for (auto& [last_caller, last_run_tick] : cache.last_run_ticks)
+      {
+        if (last_caller == caller) return std::exchange(last_run_tick, tick);
+      }
+
+      cache.last_run_ticks.emplace_back(caller, tick);
+      return 0;
+    }
+
+    void Scene::Internal_MatchQuery(QueryCache& cache, Archetype& archetype)
+    {
+      cache.match_count++;
+
+      // all the components must be found before anything is cached
+      std::size_t first_column = cache.columns.size();
+      for (ComponentID component : cache.components)
+      {
+        std::size_t column = Internal_FindColumn(archetype, component);
+        if (column == NO_COLUMN)
+        {
+          cache.columns.resize(first_column);
+          return;
+        }
+        cache.columns.push_back(column);
+      }
+
+      cache.archetypes.push_back(&archetype);
+    }
+
+    void Scene::Internal_OnArchetypeCreated(Archetype& archetype)
+    {
+      // a system on another thread may be resolving a new query, see GetQueryCache
+      std::lock_guard<std::mutex> lock(query_cache.mutex);
+      for (QueryCache& cache : query_cache)
+      {
+        if (cache.is_initialized) Internal_MatchQuery(cache, archetype);
+      }
+    }
+
+    // The saved archetype types are in the order of the component ids of the process that saved them.
+    // For each archetype, sort the type by the current ids, reorder the columns the same way,
+    // and reinsert it into the archetype_index with the sorted type as the key.
+    // The component_index is then rebuilt from scratch.
+    void Scene::Internal_RebuildArchetypeIndex()
+    {
+      std::unordered_map<ComponentIDList, Archetype> old_archetype_index = std::move(archetype_index);
+      archetype_index.clear();
+      component_index.clear();
+      query_cache.clear(); // the cached archetype pointers are invalidated
+
+      for (auto& [old_type, archetype] : old_archetype_index)
+      {
+        // find the sorted order of the columns
+        std::vector<std::size_t> order(archetype.type.size());
+        for (std::size_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&archetype](std::size_t a, std::size_t b) { return archetype.type[a] < archetype.type[b]; });
+
+        // reorder the type and the columns
+        ComponentIDList sorted_type;
+        ArchetypeTable sorted_table;
+        sorted_type.reserve(order.size());
+        sorted_table.reserve(order.size());
+        for (std::size_t i : order)
+        {
+          sorted_type.push_back(archetype.type[i]);
+          sorted_table.push_back(std::move(archetype.archetype_table[i]));
+        }
+        archetype.type = sorted_type;
+        archetype.archetype_table = std::move(sorted_table);
+
+        // rebuild the component index
+        for (std::size_t i = 0; i < archetype.type.size(); i++)
+        {
+          if (archetype.type[i] >= component_index.size()) component_index.resize(archetype.type[i] + 1);
+          component_index[archetype.type[i]][archetype.id] = { i };
+        }
+
+        archetype_index[sorted_type] = std::move(archetype);
+      }
+    }
+
+    // Steps:
+    // 1. Check that every component has a column
+    // 2. Give the empty columns of older saves their element layout
+    // 3. Check that the columns have a row for every entity and match the component layout
+    bool Scene::Internal_ValidateArchetypeTables()
+    {
+      for (auto& [type, archetype] : archetype_index)
+      {
+        // 1. Check that every component has a column
+        if (archetype.archetype_table.size() != archetype.type.size())
+        {
+          Log::Error("Archetype " + std::to_string(archetype.id) + " has " + std::to_string(archetype.archetype_table.size()) + " columns for " + std::to_string(archetype.type.size()) + " components");
+          return false;
+        }
+
+        for (std::size_t i = 0; i < archetype.type.size(); i++)
+        {
+          Column& column = archetype.archetype_table[i];
+          Reflection::TypeDescriptor* type_desc = GetComponentTypeDescriptor(archetype.type[i]);
+
+          // 2. Give the empty columns their element layout
+          if (column.GetElementSize() == 0 && column.empty() && type_desc != nullptr) column = Column(type_desc->size, type_desc->alignment);
+
+          // 3. Check the rows and the layout
+          if (column.size() != archetype.entities.size())
+          {
+            Log::Error("Column " + GetComponentName(archetype.type[i]) + " has " + std::to_string(column.size()) + " rows for " + std::to_string(archetype.entities.size()) + " entities");
+            return false;
+          }
+          if (type_desc != nullptr && !column.empty() && column.GetElementSize() != type_desc->size)
+          {
+            Log::Error("Column " + GetComponentName(archetype.type[i]) + " does not match the component layout");
+            return false;
+          }
+        }
+      }
+
+      return true;
+    }
+
     // relink entity archetype pointers
     // for each entity in the entity index, set the archetype pointer to the archetype in the archetype index
     void Scene::Internal_RelinkEntityArchetypePointers()
     {
-      for (auto& [uuid, entity_record] : entity_index)
+      // build the archetype id lookup table
+      // archetype ids are handed out in order and archetypes are never removed, so the table is dense
+      std::vector<Archetype*> archetypes_by_id(archetype_index.size(), nullptr);
+      for (auto& [type, archetype] : archetype_index)
       {
-        auto it = std::find_if(
-          archetype_index.begin(), archetype_index.end(),
-          [&entity_record](auto& archetype_record)
-          {
-            return archetype_record.second.id == entity_record.archetype_id;
-          }
-        );
+        if (archetype.id < archetypes_by_id.size()) archetypes_by_id[archetype.id] = &archetype;
+      }
 
-        if (it != archetype_index.end())
+      for (auto& [uuid, entity_record] : entity_index)
+      {
+        Archetype* archetype = (entity_record.archetype_id < archetypes_by_id.size()) ? archetypes_by_id[entity_record.archetype_id] : nullptr;
+        if (archetype != nullptr)
         {
           // relink
-          entity_record.archetype = &it->second;
+          entity_record.archetype = archetype;
         }
         else
         {
@@ -391,6 +825,22 @@ namespace FlexEngine
       }
     }
 
+    void Scene::Internal_RebuildArchetypeEdges()
+    {
+      ComponentIDList subset_type;
+      for (auto& [type, archetype] : archetype_index)
+      {
+        for (std::size_t i = 0; i < archetype.type.size(); i++)
+        {
+          subset_type = archetype.type;
+          subset_type.erase(subset_type.begin() + i);
+
+          auto it = archetype_index.find(subset_type);
+          if (it != archetype_index.end()) Entity::Internal_LinkArchetypes(it->second, archetype, archetype.type[i]);
+        }
+      }
+    }
+
     #pragma endregion
 
 
@@ -414,7 +864,7 @@ namespace FlexEngine
 
         for (std::size_t i = 0; i < archetype_storage.archetype_table.size(); i++)
         {
-          Log::Debug("  Component(" + std::to_string(i) + "): " + archetype_storage.type[i]);
+          Log::Debug("  Component(" + std::to_string(i) + "): " + GetComponentName(archetype_storage.type[i]));
           //Log::Debug("    Entities in component: " + std::to_string(archetype_storage.archetype_table[i].size()));
         }
       }
@@ -435,9 +885,12 @@ namespace FlexEngine
     void Scene::DumpComponentIndex() const
     {
       Log::Info("Dumping component_index");
-      for (auto& [component_id, archetype_map] : component_index)
+      for (ComponentID component_id = 0; component_id < component_index.size(); component_id++)
       {
-        Log::Debug("Component: " + component_id);
+        const ArchetypeMap& archetype_map = component_index[component_id];
+        if (archetype_map.empty()) continue;
+
+        Log::Debug("Component: " + GetComponentName(component_id));
         for (auto& [archetype, archetype_record] : archetype_map)
         {
           Log::Debug("  Archetype ID: " + std::to_string(archetype));
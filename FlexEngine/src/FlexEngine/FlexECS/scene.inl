@@ -1,32 +1,334 @@
 // inline functions for Scene class
 
 // Steps:
-// 1. Loop through each archetype and check if the archetype has the requested components
-// 2. Get the entities from the archetype
+// 1. Get the cached archetypes that have the requested components
+// 2. Get the entities from the archetypes
 template <typename... Ts>
 std::vector<FlexEngine::FlexECS::Entity> FlexEngine::FlexECS::Scene::View()
 {
   std::vector<Entity> entities;
 
-  // 1. Loop through each archetype and check if the archetype has the requested components
-  for (auto& [archetype, archetype_storage] : ARCHETYPE_INDEX)
+  // 1. Get the cached archetypes that have the requested components
+  QueryCache& cache = GetQueryCache<Ts...>();
+  for (Archetype* archetype : cache.archetypes)
   {
-    // find the type in the archetype
-    bool has_requested_components = (
-      (std::find(
-        archetype_storage.type.begin(),
-        archetype_storage.type.end(),
-        Reflection::TypeResolver<Ts>::Get()->name
-      ) != archetype_storage.type.end()) && ...
+    // 2. Get the entities from the archetype
+    entities.insert(entities.end(), archetype->entities.begin(), archetype->entities.end());
+  }
+
+  return entities;
+}
+
+template <typename... Ts>
+std::vector<FlexEngine::FlexECS::EntityID> FlexEngine::FlexECS::Scene::CreateEntities(std::size_t count, const Ts&... prototype)
+{
+  return CreateEntities(GetActiveSceneRef(), count, prototype...);
+}
+
+template <typename... Ts>
+std::vector<FlexEngine::FlexECS::EntityID> FlexEngine::FlexECS::Scene::CreateEntities(Scene& scene, std::size_t count, const Ts&... prototype)
+{
+  return CreateEntities(scene, count, { GetComponentID<Ts>()... }, { static_cast<const void*>(&prototype)... });
+}
+
+template <typename... Ts>
+FlexEngine::FlexECS::QueryCache& FlexEngine::FlexECS::Scene::GetQueryCache()
+{
+  const QueryID id = GetQueryID<Ts...>();
+
+  // systems on other threads may resolve queries at the same time, see SystemScheduler
+  std::lock_guard<std::mutex> lock(query_cache.mutex);
+  if (id >= query_cache.size()) query_cache.resize(id + 1);
+
+  QueryCache& cache = query_cache[id];
+  if (!cache.is_initialized) Internal_InitializeQueryCache(cache, { GetComponentID<QueryComponent<Ts>>()... });
+
+  // still valid after the lock is released, growing the deque does not move the caches
+  return cache;
+}
+
+// Steps:
+// 1. Get the cached archetypes and columns of the requested components
+// 2. Find the rows that pass the Changed<T> filters, all the rows if there are none
+// 3. Mark the mutable components as changed
+// 4. Pass the entity ids and the typed column pointers to the function
+template <typename... Ts, typename Fn>
+void FlexEngine::FlexECS::Scene::EachChunk(Fn&& fn)
+{
+  static_assert(sizeof...(Ts) > 0, "EachChunk requires at least one component type.");
+  constexpr bool has_changed_filter = (QueryTerm<Ts>::is_changed || ...);
+
+  // 1. Get the cached archetypes and columns of the requested components
+  QueryCache& cache = GetQueryCache<Ts...>();
+
+  // The query runs in a new change tick,
+  // so the writes it makes are not reported to its own next run.
+  // Each caller has its own last run, see QueryCallerID.
+  uint64_t since = 0;
+  if constexpr (has_changed_filter) since = Internal_ExchangeLastRunTick(cache, Column::AdvanceChangeTick());
+
+  // The function must not make structural changes, use an EntityCommandBuffer instead.
+  // A new archetype would grow the cache and move the columns this loop points into.
+  const std::size_t archetype_count = cache.archetypes.size();
+  for (std::size_t i = 0; i < archetype_count; i++)
+  {
+    Archetype& archetype = *cache.archetypes[i];
+    const std::size_t* columns = &cache.columns[i * sizeof...(Ts)];
+
+    // guard: nothing to iterate
+    if (archetype.entities.empty()) continue;
+
+    // 2. Find the rows that pass the filters
+    Internal_ForEachChangedRange<Ts...>(
+      archetype, columns, since,
+      [&](std::size_t first_row, std::size_t count)
+      {
+        // 3. Mark the mutable components as changed
+        Internal_MarkChanged<Ts...>(archetype, columns, first_row, count, std::index_sequence_for<Ts...>{});
+
+        // 4. Pass the columns to the function
+        Internal_InvokeChunk<Ts...>(archetype, columns, first_row, count, fn, std::index_sequence_for<Ts...>{});
+
+#ifdef _DEBUG
+        FLX_CORE_ASSERT(cache.archetypes.size() == archetype_count, "EachChunk: The function created an archetype, structural changes are not allowed during iteration.");
+#endif
+      }
+    );
+  }
+
+  // writes after this point are newer than the last run
+  if constexpr (has_changed_filter) Column::AdvanceChangeTick();
+}
+
+// Steps:
+// 1. Get the cached archetypes and columns of the requested components
+// 2. Split the rows that pass the filters into chunks of at most chunk_size rows
+// 3. Run the chunks on the thread pool and wait for them
+template <typename... Ts, typename Fn>
+void FlexEngine::FlexECS::Scene::ParallelEachChunk(Fn&& fn, std::size_t chunk_size, ThreadPool& pool)
+{
+  static_assert(sizeof...(Ts) > 0, "ParallelEachChunk requires at least one component type.");
+  constexpr bool has_changed_filter = (QueryTerm<Ts>::is_changed || ...);
+
+  // 1. Get the cached archetypes and columns of the requested components
+  QueryCache& cache = GetQueryCache<Ts...>();
+
+  // see EachChunk
+  uint64_t since = 0;
+  if constexpr (has_changed_filter) since = Internal_ExchangeLastRunTick(cache, Column::AdvanceChangeTick());
+
+  // guard
+  if (chunk_size == 0) chunk_size = 1;
+
+  // The calling thread runs the last chunk itself,
+  // so a query that fits in one chunk never goes through the pool.
+  struct Chunk
+  {
+    Archetype* archetype = nullptr;
+    const std::size_t* columns = nullptr;
+    std::size_t first_row = 0;
+    std::size_t count = 0;
+  } last_chunk;
+
+  TaskGroup group;
+
+  for (std::size_t i = 0; i < cache.archetypes.size(); i++)
+  {
+    Archetype& archetype = *cache.archetypes[i];
+    const std::size_t* columns = &cache.columns[i * sizeof...(Ts)];
+
+    // guard: nothing to iterate
+    if (archetype.entities.empty()) continue;
+
+    Internal_ForEachChangedRange<Ts...>(
+      archetype, columns, since,
+      [&](std::size_t range_first_row, std::size_t range_count)
+      {
+        // the rows are marked here so that the tasks never write to the change versions
+        Internal_MarkChanged<Ts...>(archetype, columns, range_first_row, range_count, std::index_sequence_for<Ts...>{});
+
+        // 2. Split the range into chunks
+        const std::size_t range_end = range_first_row + range_count;
+        for (std::size_t first_row = range_first_row; first_row < range_end; first_row += chunk_size)
+        {
+          // 3. Run the chunks on the thread pool
+          if (last_chunk.archetype != nullptr)
+          {
+            pool.Submit(
+              group,
+              [&fn, chunk = last_chunk]()
+              {
+                Internal_InvokeChunk<Ts...>(*chunk.archetype, chunk.columns, chunk.first_row, chunk.count, fn, std::index_sequence_for<Ts...>{});
+              }
+            );
+          }
+
+          last_chunk = { &archetype, columns, first_row, (std::min)(chunk_size, range_end - first_row) };
+        }
+      }
     );
+  }
 
-    // check if the archetype has the requested components
-    if (has_requested_components)
+  // guard: nothing to iterate
+  if (last_chunk.archetype == nullptr)
+  {
+    if constexpr (has_changed_filter) Column::AdvanceChangeTick();
+    return;
+  }
+
+  // the tasks reference fn and the group, so wait for them even if this chunk throws
+  try
+  {
+    Internal_InvokeChunk<Ts...>(*last_chunk.archetype, last_chunk.columns, last_chunk.first_row, last_chunk.count, fn, std::index_sequence_for<Ts...>{});
+  }
+  catch (...)
+  {
+    group.SetException(std::current_exception());
+  }
+
+  // the calling thread runs the other chunks while it waits
+  pool.Wait(group);
+
+  // writes after this point are newer than the last run
+  if constexpr (has_changed_filter) Column::AdvanceChangeTick();
+}
+
+template <typename... Ts, typename Fn>
+void FlexEngine::FlexECS::Scene::ParallelEach(Fn&& fn, std::size_t chunk_size, ThreadPool& pool)
+{
+  ParallelEachChunk<Ts...>(
+    [&fn](std::size_t count, const EntityID* entities, QueryComponent<Ts>*... components)
+    {
+      for (std::size_t row = 0; row < count; row++)
+      {
+        // the entity is optional in the function signature
+        if constexpr (std::is_invocable_v<Fn&, Entity, QueryComponent<Ts>&...>) fn(Entity(entities[row]), components[row]...);
+        else fn(components[row]...);
+      }
+    },
+    chunk_size, pool
+  );
+}
+
+template <typename... Ts, typename Fn, std::size_t... Is>
+void FlexEngine::FlexECS::Scene::Internal_InvokeChunk(Archetype& archetype, const std::size_t* columns, std::size_t first_row, std::size_t count, Fn& fn, std::index_sequence<Is...>)
+{
+  fn(
+    count,
+    static_cast<const EntityID*>(archetype.entities.data()) + first_row,
+    reinterpret_cast<QueryComponent<Ts>*>(archetype.archetype_table[columns[Is]].data()) + first_row...
+  );
+}
+
+template <typename... Ts, std::size_t... Is>
+void FlexEngine::FlexECS::Scene::Internal_MarkChanged(Archetype& archetype, const std::size_t* columns, std::size_t first_row, std::size_t count, std::index_sequence<Is...>)
+{
+  // const components are only read
+  ((std::is_const_v<QueryComponent<Ts>> ? void() : archetype.archetype_table[columns[Is]].MarkChanged(first_row, count)), ...);
+}
+
+// Steps:
+// 1. Skip the archetype if none of the filtered columns changed
+// 2. Test the change chunks of the filtered columns
+// 3. Merge consecutive changed chunks into one range
+template <typename... Ts, typename Fn>
+void FlexEngine::FlexECS::Scene::Internal_ForEachChangedRange(const Archetype& archetype, const std::size_t* columns, uint64_t since, Fn&& fn)
+{
+  const std::size_t row_count = archetype.entities.size();
+
+  // guard: no filter, every row passes
+  if constexpr (!(QueryTerm<Ts>::is_changed || ...))
+  {
+    (void)columns;
+    (void)since;
+    fn(0, row_count);
+  }
+  else
+  {
+    constexpr bool is_changed[] = { QueryTerm<Ts>::is_changed... };
+
+    // 1. Skip the archetype if none of the filtered columns changed
+    bool is_archetype_changed = false;
+    for (std::size_t i = 0; i < sizeof...(Ts); i++)
     {
-      // 2. Get the entities from the archetype
-      entities.insert(entities.end(), archetype_storage.entities.begin(), archetype_storage.entities.end());
+      if (is_changed[i] && archetype.archetype_table[columns[i]].GetVersion() > since) is_archetype_changed = true;
     }
+    if (!is_archetype_changed) return;
+
+    // 2. Test the change chunks of the filtered columns
+    std::size_t range_first_row = 0;
+    std::size_t range_count = 0;
+    for (std::size_t first_row = 0; first_row < row_count; first_row += Column::CHANGE_CHUNK_SIZE)
+    {
+      const std::size_t chunk = first_row >> Column::CHANGE_CHUNK_SHIFT;
+      const std::size_t count = (std::min)(Column::CHANGE_CHUNK_SIZE, row_count - first_row);
+
+      bool is_chunk_changed = false;
+      for (std::size_t i = 0; i < sizeof...(Ts); i++)
+      {
+        if (is_changed[i] && archetype.archetype_table[columns[i]].GetChunkVersion(chunk) > since) is_chunk_changed = true;
+      }
+
+      // 3. Merge consecutive changed chunks into one range
+      if (is_chunk_changed)
+      {
+        if (range_count == 0) range_first_row = first_row;
+        range_count += count;
+      }
+      else if (range_count != 0)
+      {
+        fn(range_first_row, range_count);
+        range_count = 0;
+      }
+    }
+    if (range_count != 0) fn(range_first_row, range_count);
   }
+}
 
-  return entities;
+template <typename... Ts, typename Fn>
+void FlexEngine::FlexECS::Scene::Each(Fn&& fn)
+{
+  EachChunk<Ts...>(
+    [&fn](std::size_t count, const EntityID* entities, QueryComponent<Ts>*... components)
+    {
+      for (std::size_t row = 0; row < count; row++)
+      {
+        // the entity is optional in the function signature
+        if constexpr (std::is_invocable_v<Fn&, Entity, QueryComponent<Ts>&...>) fn(Entity(entities[row]), components[row]...);
+        else fn(components[row]...);
+      }
+    }
+  );
+}
+
+template <typename... Ts>
+std::size_t FlexEngine::FlexECS::Scene::Count()
+{
+  // reads the archetype sizes directly, so the rows are not marked as changed
+  std::size_t count = 0;
+  for (Archetype* archetype : GetQueryCache<Ts...>().archetypes) count += archetype->entities.size();
+  return count;
+}
+template <typename T>
+T& FlexEngine::FlexECS::Scene::SetResource(const T& data)
+{
+  return *static_cast<T*>(resources.Set(GetComponentID<T>(), &data, sizeof(T), alignof(T)));
+}
+
+template <typename T>
+T* FlexEngine::FlexECS::Scene::GetResource()
+{
+  return static_cast<T*>(resources.Find(GetComponentID<T>()));
+}
+
+template <typename T>
+bool FlexEngine::FlexECS::Scene::HasResource() const
+{
+  return resources.Contains(GetComponentID<T>());
+}
+
+template <typename T>
+void FlexEngine::FlexECS::Scene::RemoveResource()
+{
+  resources.Remove(GetComponentID<T>());
 }
@@ -0,0 +1,275 @@
+#include "datastructures.h"
+
+#include "Wrapper/mappedfile.h"
+#include "DataStructures/bytestream.h"
+
+#include <numeric> // std::iota
+
+// Binary scene format (.flbscene)
+//
+// Values are stored in the byte order of the machine that saved the file.
+// Component ids are only valid for the running process, so archetypes refer to
+// components by their index in the component table, which stores the names.
+//
+// Header
+//   char[4]    magic "FLBS"
+//   uint32_t   format version
+//   uint64_t   _flx_id_next
+// Component table
+//   uint32_t   component count
+//   for each component: uint32_t name length, name, uint64_t element size
+// Archetypes
+//   uint32_t   archetype count
+//   for each archetype:
+//     uint32_t   component count, uint32_t component table index for each column
+//     uint64_t   entity count
+//     EntityID   entities[entity count]
+//     for each column: padding to FLBSCENE_BLOCK_ALIGNMENT, element size * entity count bytes
+// String storage
+//   uint64_t   string count, for each string: uint64_t length, characters
+// Unused ids
+//   uint64_t   count, uint64_t _flx_id_unused[count]
+// Resources (version 2)
+//   uint64_t   resource count
+//   for each resource: uint64_t name length, name, uint64_t element size, uint64_t alignment, uint64_t 1, element
+//
+// The entity index and component index are not stored, they are rebuilt from the archetypes.
+
+#define FLBSCENE_MAGIC "FLBS"
+#define FLBSCENE_VERSION 2
+
+// Column blocks start on this alignment in the file.
+// The mapped file starts on a page boundary, so the blocks are aligned in memory too.
+#define FLBSCENE_BLOCK_ALIGNMENT 16
+
+namespace FlexEngine
+{
+  namespace FlexECS
+  {
+
+    // Steps:
+    // 1. Build the component table from the archetype types
+    // 2. Write the header and the component table
+    // 3. Write each archetype with its entities and raw column blocks
+    // 4. Write the string storage and the unused ids
+    // 5. Write the resources
+    void Scene::SaveBinary(File& file)
+    {
+      FLX_FLOW_FUNCTION();
+      FLX_SCOPED_TIMER(__FUNCTION__ + std::string(" ") + std::to_string(file.path));
+
+      // 1. Build the component table
+      static constexpr uint32_t NO_INDEX = static_cast<uint32_t>(-1);
+      std::vector<uint32_t> table_index(GetComponentCount(), NO_INDEX);
+      ComponentIDList components;
+
+      std::size_t estimated_size = 64;
+      for (auto& [type, archetype] : archetype_index)
+      {
+        for (std::size_t i = 0; i < archetype.type.size(); i++)
+        {
+          ComponentID component = archetype.type[i];
+          if (table_index[component] == NO_INDEX)
+          {
+            table_index[component] = static_cast<uint32_t>(components.size());
+            components.push_back(component);
+          }
+          estimated_size += archetype.archetype_table[i].size() * archetype.archetype_table[i].GetElementSize() + FLBSCENE_BLOCK_ALIGNMENT;
+        }
+        estimated_size += archetype.entities.size() * sizeof(EntityID) + archetype.type.size() * sizeof(uint32_t) + 16;
+      }
+
+      ByteWriter writer;
+      writer.Reserve(estimated_size);
+
+      // 2. Write the header and the component table
+      writer.WriteBytes(FLBSCENE_MAGIC, 4);
+      writer.Write<uint32_t>(FLBSCENE_VERSION);
+      writer.Write<uint64_t>(_flx_id_next);
+
+      writer.Write<uint32_t>(static_cast<uint32_t>(components.size()));
+      for (ComponentID component : components)
+      {
+        const std::string& name = GetComponentName(component);
+        writer.Write<uint32_t>(static_cast<uint32_t>(name.size()));
+        writer.WriteBytes(name.data(), name.size());
+
+        Reflection::TypeDescriptor* type_desc = GetComponentTypeDescriptor(component);
+        writer.Write<uint64_t>((type_desc != nullptr) ? type_desc->size : 0);
+      }
+
+      // 3. Write each archetype
+      writer.Write<uint32_t>(static_cast<uint32_t>(archetype_index.size()));
+      for (auto& [type, archetype] : archetype_index)
+      {
+        writer.Write<uint32_t>(static_cast<uint32_t>(archetype.type.size()));
+        for (ComponentID component : archetype.type) writer.Write<uint32_t>(table_index[component]);
+
+        writer.Write<uint64_t>(archetype.entities.size());
+        writer.WriteBytes(archetype.entities.data(), archetype.entities.size() * sizeof(EntityID));
+
+        for (const Column& column : archetype.archetype_table)
+        {
+          writer.WritePadding(FLBSCENE_BLOCK_ALIGNMENT);
+          writer.WriteBytes(column.data(), column.size() * column.GetElementSize());
+        }
+      }
+
+      // 4. Write the string storage and the unused ids
+      writer.Write<uint64_t>(string_storage.size());
+      for (StringIndex index = 0; index < string_storage.size(); index++)
+      {
+        std::string_view str = string_storage.Get(index);
+        writer.Write<uint64_t>(str.size());
+        writer.WriteBytes(str.data(), str.size());
+      }
+      writer.Write<uint64_t>(_flx_id_unused.size());
+      writer.WriteBytes(_flx_id_unused.data(), _flx_id_unused.size() * sizeof(uint64_t));
+
+      // 5. Write the resources
+      Reflection::TypeResolver<ResourceStorage>::Get()->SerializeBinary(&resources, writer);
+
+      file.Write(writer.buffer);
+    }
+
+    // Steps:
+    // 1. Map the file and check the header
+    // 2. Resolve the component table to the component ids of this process
+    // 3. Create each archetype with its sorted type and copy the column blocks in
+    // 4. Rebuild the entity index from the archetype rows
+    // 5. Read the string storage and the unused ids
+    // 6. Read the resources, version 1 files do not have them
+    // 7. Compact the string storage
+    // static function
+    std::shared_ptr<Scene> Scene::LoadBinary(File& file)
+    {
+      FLX_FLOW_FUNCTION();
+      FLX_SCOPED_TIMER(__FUNCTION__ + std::string(" ") + std::to_string(file.path));
+
+      // 1. Map the file and check the header
+      MappedFile mapped_file(file.path);
+      if (!mapped_file.IsOpen())
+      {
+        Log::Error("Failed to map scene file: " + std::to_string(file.path));
+        return std::make_shared<Scene>(Scene::Null);
+      }
+
+      ByteReader reader(mapped_file.data(), mapped_file.size());
+
+      const uint8_t* magic = reader.ReadBytes(4);
+      uint32_t version = reader.Read<uint32_t>();
+      if (magic == nullptr || std::memcmp(magic, FLBSCENE_MAGIC, 4) != 0 || version == 0 || version > FLBSCENE_VERSION)
+      {
+        Log::Error("Unsupported binary scene file: " + std::to_string(file.path));
+        return std::make_shared<Scene>(Scene::Null);
+      }
+
+      std::shared_ptr<Scene> scene = std::make_shared<Scene>();
+      scene->_flx_id_next = reader.Read<uint64_t>();
+
+      // 2. Resolve the component table
+      uint32_t component_count = reader.Read<uint32_t>();
+      std::vector<ComponentID> components;
+      std::vector<std::size_t> element_sizes;
+      for (uint32_t i = 0; i < component_count && reader.is_valid; i++)
+      {
+        uint32_t name_length = reader.Read<uint32_t>();
+        const uint8_t* name = reader.ReadBytes(name_length);
+        std::size_t element_size = static_cast<std::size_t>(reader.Read<uint64_t>());
+        if (name == nullptr) break;
+
+        ComponentID component = Internal_RegisterComponent(std::string(reinterpret_cast<const char*>(name), name_length));
+
+        // guard: the component layout changed since the scene was saved
+        Reflection::TypeDescriptor* type_desc = GetComponentTypeDescriptor(component);
+        if (type_desc == nullptr || type_desc->size != element_size)
+        {
+          Log::Error("Component layout does not match the binary scene file: " + GetComponentName(component));
+          return std::make_shared<Scene>(Scene::Null);
+        }
+
+        components.push_back(component);
+        element_sizes.push_back(element_size);
+      }
+
+      // 3. Create each archetype and copy the column blocks in
+      uint32_t archetype_count = reader.Read<uint32_t>();
+      for (uint32_t a = 0; a < archetype_count && reader.is_valid; a++)
+      {
+        uint32_t column_count = reader.Read<uint32_t>();
+        if (column_count > components.size()) reader.is_valid = false;
+        if (!reader.is_valid) break;
+
+        std::vector<uint32_t> saved_type(column_count);
+        for (uint32_t& index : saved_type)
+        {
+          index = reader.Read<uint32_t>();
+          if (index >= components.size()) reader.is_valid = false;
+        }
+        if (!reader.is_valid) break;
+
+        // sort the type with this process' component ids
+        std::vector<std::size_t> order(column_count);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) { return components[saved_type[lhs]] < components[saved_type[rhs]]; });
+
+        ComponentIDList type(column_count);
+        std::vector<std::size_t> sorted_column(column_count);
+        for (std::size_t i = 0; i < column_count; i++)
+        {
+          type[i] = components[saved_type[order[i]]];
+          sorted_column[order[i]] = i;
+        }
+
+        Archetype& archetype = Entity::Internal_CreateArchetype(*scene, type);
+
+        // entities
+        std::size_t entity_count = static_cast<std::size_t>(reader.Read<uint64_t>());
+        if (!reader.ReadVector(archetype.entities, entity_count)) break;
+
+        // one memcpy per column
+        for (std::size_t i = 0; i < column_count; i++)
+        {
+          reader.SkipPadding(FLBSCENE_BLOCK_ALIGNMENT);
+          const uint8_t* block = reader.ReadArray(entity_count, element_sizes[saved_type[i]]);
+          if (block == nullptr) break;
+          archetype.archetype_table[sorted_column[i]].PushBackRange(block, entity_count);
+        }
+
+        // 4. Rebuild the entity index from the archetype rows
+        scene->entity_index.Reserve(scene->_flx_id_next);
+        for (std::size_t row = 0; row < entity_count; row++)
+        {
+          scene->entity_index.Insert(archetype.entities[row], { &archetype, archetype.id, row });
+        }
+      }
+
+      // 5. Read the string storage and the unused ids
+      std::size_t string_count = static_cast<std::size_t>(reader.Read<uint64_t>());
+      for (std::size_t i = 0; i < string_count && reader.is_valid; i++)
+      {
+        std::size_t length = static_cast<std::size_t>(reader.Read<uint64_t>());
+        const uint8_t* str = reader.ReadBytes(length);
+        if (str != nullptr) scene->string_storage.Append({ reinterpret_cast<const char*>(str), length });
+      }
+
+      reader.ReadVector(scene->_flx_id_unused, static_cast<std::size_t>(reader.Read<uint64_t>()));
+
+      // 6. Read the resources
+      if (version >= 2) Reflection::TypeResolver<ResourceStorage>::Get()->DeserializeBinary(&scene->resources, reader);
+
+      // guard: the file was cut short
+      if (!reader.is_valid)
+      {
+        Log::Error("Binary scene file is truncated or corrupted: " + std::to_string(file.path));
+        return std::make_shared<Scene>(Scene::Null);
+      }
+
+      // 7. Compact the string storage
+      scene->Internal_StringStorage_Compact();
+
+      return scene;
+    }
+
+  }
+}
@@ -0,0 +1,136 @@
+#include "datastructures.h"
+
+namespace FlexEngine
+{
+  namespace FlexECS
+  {
+
+    StringTable::Index StringTable::Intern(std::string_view str)
+    {
+      std::size_t hash = std::hash<std::string_view>()(str);
+
+      // keep the hash index at most half full
+      if ((m_entries.size() + 1) * 2 > m_buckets.size()) Internal_Rehash((std::max)(m_buckets.size() * 2, std::size_t(16)));
+
+      // the string is already stored
+      std::size_t bucket = Internal_FindBucket(str, hash);
+      if (m_buckets[bucket] != 0)
+      {
+        Index index = m_buckets[bucket] - 1;
+        m_entries[index].refcount++;
+        return index;
+      }
+
+      Index index = Internal_Push(str, hash);
+      m_entries[index].refcount = 1;
+      m_buckets[bucket] = index + 1;
+      return index;
+    }
+
+    StringTable::Index StringTable::Append(std::string_view str)
+    {
+      std::size_t hash = std::hash<std::string_view>()(str);
+
+      if ((m_entries.size() + 1) * 2 > m_buckets.size()) Internal_Rehash((std::max)(m_buckets.size() * 2, std::size_t(16)));
+
+      // only the first of the equal strings is in the hash index
+      std::size_t bucket = Internal_FindBucket(str, hash);
+      Index index = Internal_Push(str, hash);
+      if (m_buckets[bucket] == 0) m_buckets[bucket] = index + 1;
+      return index;
+    }
+
+    void StringTable::Release(Index index)
+    {
+      // guard: more releases than references, cloned indexes are not counted
+      if (m_entries[index].refcount == 0) return;
+
+      m_entries[index].refcount--;
+    }
+
+    // Steps:
+    // 1. Copy the strings with references into a new table, merging the equal strings
+    // 2. Replace this table with the new one
+    std::vector<StringTable::Index> StringTable::Compact(const std::vector<uint32_t>& references)
+    {
+      std::vector<Index> remap(m_entries.size(), NO_INDEX);
+
+      // 1. Copy the strings with references
+      StringTable compacted;
+      for (Index index = 0; index < m_entries.size() && index < references.size(); index++)
+      {
+        if (references[index] == 0) continue;
+
+        std::string_view str = Get(index);
+        std::size_t hash = m_entries[index].hash;
+
+        if ((compacted.m_entries.size() + 1) * 2 > compacted.m_buckets.size())
+        {
+          compacted.Internal_Rehash((std::max)(compacted.m_buckets.size() * 2, std::size_t(16)));
+        }
+
+        std::size_t bucket = compacted.Internal_FindBucket(str, hash);
+        if (compacted.m_buckets[bucket] == 0)
+        {
+          compacted.m_buckets[bucket] = compacted.Internal_Push(str, hash) + 1;
+        }
+
+        Index new_index = compacted.m_buckets[bucket] - 1;
+        compacted.m_entries[new_index].refcount += references[index];
+        remap[index] = new_index;
+      }
+
+      // 2. Replace this table
+      compacted.m_arena.shrink_to_fit();
+      compacted.m_entries.shrink_to_fit();
+      *this = std::move(compacted);
+
+      return remap;
+    }
+
+    std::size_t StringTable::Internal_FindBucket(std::string_view str, std::size_t hash) const
+    {
+      std::size_t mask = m_buckets.size() - 1;
+      std::size_t bucket = hash & mask;
+      while (m_buckets[bucket] != 0)
+      {
+        Index index = m_buckets[bucket] - 1;
+        if (m_entries[index].hash == hash && Get(index) == str) break;
+        bucket = (bucket + 1) & mask;
+      }
+      return bucket;
+    }
+
+    StringTable::Index StringTable::Internal_Push(std::string_view str, std::size_t hash)
+    {
+      // the view may point into the arena, which moves when it grows
+      const char* arena_begin = m_arena.data();
+      bool is_in_arena = !m_arena.empty() && str.data() >= arena_begin && str.data() < arena_begin + m_arena.size();
+      std::size_t source_offset = is_in_arena ? static_cast<std::size_t>(str.data() - arena_begin) : 0;
+
+      std::size_t offset = m_arena.size();
+      m_arena.resize(offset + str.size() + 1);
+      if (!str.empty()) std::memcpy(m_arena.data() + offset, is_in_arena ? m_arena.data() + source_offset : str.data(), str.size());
+      m_arena[offset + str.size()] = '\0';
+
+      Entry entry;
+      entry.offset = offset;
+      entry.length = static_cast<uint32_t>(str.size());
+      entry.hash = hash;
+      m_entries.push_back(entry);
+
+      return m_entries.size() - 1;
+    }
+
+    void StringTable::Internal_Rehash(std::size_t bucket_count)
+    {
+      m_buckets.assign(bucket_count, 0);
+      for (Index index = 0; index < m_entries.size(); index++)
+      {
+        std::size_t bucket = Internal_FindBucket(Get(index), m_entries[index].hash);
+        if (m_buckets[bucket] == 0) m_buckets[bucket] = index + 1;
+      }
+    }
+
+  }
+}
@@ -0,0 +1,180 @@
+#include "systemscheduler.h"
+
+namespace FlexEngine
+{
+  namespace FlexECS
+  {
+
+    #pragma region SystemAccess
+
+    // Both lists are sorted, so the overlap test is a merge.
+    static bool Internal_HasOverlap(const ComponentIDList& a, const ComponentIDList& b)
+    {
+      auto it_a = a.begin();
+      auto it_b = b.begin();
+      while (it_a != a.end() && it_b != b.end())
+      {
+        if (*it_a < *it_b) it_a++;
+        else if (*it_b < *it_a) it_b++;
+        else return true;
+      }
+      return false;
+    }
+
+    bool SystemAccess::ConflictsWith(const SystemAccess& other) const
+    {
+      if (is_exclusive || other.is_exclusive) return true;
+
+      return
+        Internal_HasOverlap(writes, other.writes) ||
+        Internal_HasOverlap(writes, other.reads) ||
+        Internal_HasOverlap(reads, other.writes);
+    }
+
+    #pragma endregion
+
+    SystemScheduler::SystemScheduler(ThreadPool& pool)
+      : m_pool(pool)
+    {
+    }
+
+    void SystemScheduler::AddSystem(const std::string& name, SystemAccess access, SystemFunction function)
+    {
+      // guard
+      if (!function)
+      {
+        Log::Warning("SystemScheduler: Attempted to add an empty system: " + name);
+        return;
+      }
+
+      // the conflict test needs sorted lists
+      std::sort(access.reads.begin(), access.reads.end());
+      std::sort(access.writes.begin(), access.writes.end());
+
+      m_systems.emplace_back(name, std::move(access), std::move(function), Internal_NextQueryCallerID());
+      m_is_graph_dirty = true;
+    }
+
+    void SystemScheduler::AddExclusiveSystem(const std::string& name, SystemFunction function)
+    {
+      SystemAccess access;
+      access.is_exclusive = true;
+      AddSystem(name, std::move(access), std::move(function));
+    }
+
+    void SystemScheduler::Clear()
+    {
+      m_systems.clear();
+      m_is_graph_dirty = true;
+    }
+
+    // Steps:
+    // 1. Rebuild the job graph if a system was added
+    // 2. Reset the dependency counters
+    // 3. Queue the systems without dependencies, the rest are queued as their dependencies finish
+    // 4. Wait for every system
+    void SystemScheduler::Run()
+    {
+      FLX_FLOW_FUNCTION();
+
+      // guard
+      if (m_systems.empty()) return;
+
+      // 1. Rebuild the job graph
+      if (m_is_graph_dirty) Internal_BuildGraph();
+
+      // 2. Reset the dependency counters
+      for (std::size_t i = 0; i < m_systems.size(); i++)
+      {
+        m_remaining_dependencies[i].store(m_systems[i].dependency_count, std::memory_order_relaxed);
+      }
+
+      // 3. Queue the systems without dependencies
+      // every system finishes the group once, see Internal_RunSystem
+      TaskGroup group;
+      group.Add(m_systems.size());
+      for (std::size_t i = 0; i < m_systems.size(); i++)
+      {
+        if (m_systems[i].dependency_count == 0) m_pool.Submit([this, i, &group]() { Internal_RunSystem(i, group); });
+      }
+
+      // 4. Wait for every system
+      m_pool.Wait(group);
+    }
+
+    std::vector<std::string> SystemScheduler::GetDependencies(const std::string& name)
+    {
+      if (m_is_graph_dirty) Internal_BuildGraph();
+
+      std::vector<std::string> dependencies;
+      for (std::size_t i = 0; i < m_systems.size(); i++)
+      {
+        if (m_systems[i].name == name) break;
+
+        const std::vector<std::size_t>& dependents = m_systems[i].dependents;
+        for (std::size_t dependent : dependents)
+        {
+          if (m_systems[dependent].name == name) dependencies.push_back(m_systems[i].name);
+        }
+      }
+      return dependencies;
+    }
+
+    #pragma region Internal Functions
+
+    // Every system depends on the systems added before it that it conflicts with.
+    // Edges only point forward, so the graph can never have a cycle.
+    void SystemScheduler::Internal_BuildGraph()
+    {
+      for (System& system : m_systems)
+      {
+        system.dependents.clear();
+        system.dependency_count = 0;
+      }
+
+      for (std::size_t i = 0; i < m_systems.size(); i++)
+      {
+        for (std::size_t j = i + 1; j < m_systems.size(); j++)
+        {
+          if (!m_systems[i].access.ConflictsWith(m_systems[j].access)) continue;
+
+          m_systems[i].dependents.push_back(j);
+          m_systems[j].dependency_count++;
+        }
+      }
+
+      m_remaining_dependencies = std::make_unique<std::atomic<std::size_t>[]>(m_systems.size());
+      m_is_graph_dirty = false;
+    }
+
+    void SystemScheduler::Internal_RunSystem(std::size_t index, TaskGroup& group)
+    {
+      System& system = m_systems[index];
+      try
+      {
+        // restored after the system, this thread may be waiting inside another system
+        QueryCallerScope caller_scope(system.caller);
+        system.function();
+      }
+      catch (...)
+      {
+        // the dependents still run so the group finishes, Run rethrows after every system is done
+        group.SetException(std::current_exception());
+      }
+
+      // the last dependency to finish queues the dependent
+      for (std::size_t dependent : system.dependents)
+      {
+        if (m_remaining_dependencies[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+          m_pool.Submit([this, dependent, &group]() { Internal_RunSystem(dependent, group); });
+        }
+      }
+
+      m_pool.Done(group);
+    }
+
+    #pragma endregion
+
+  }
+}
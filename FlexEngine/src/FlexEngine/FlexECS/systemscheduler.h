@@ -0,0 +1,142 @@
+#pragma once
+
+#include "flx_api.h"
+
+#include "datastructures.h" // "DataStructures/threadpool.h"
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <functional>
+
+namespace FlexEngine
+{
+  namespace FlexECS
+  {
+
+    // Component access tags for SystemScheduler::AddSystem
+    // Usage: scheduler.AddSystem<Read<Rigidbody>, Write<Position>>("UpdatePositions", UpdatePositions);
+    template <typename... Ts> struct Read {};
+    template <typename... Ts> struct Write {};
+
+    // The components a system reads and writes.
+    // Two systems conflict if one of them writes a component the other one reads or writes,
+    // conflicting systems run in the order they were added.
+    struct __FLX_API SystemAccess
+    {
+      ComponentIDList reads;  // sorted
+      ComponentIDList writes; // sorted
+
+      // Exclusive systems run alone.
+      // Use this for systems that add/remove components or create/destroy entities,
+      // or that touch data outside of the ECS.
+      bool is_exclusive = false;
+
+      bool ConflictsWith(const SystemAccess& other) const;
+    };
+
+    // Runs systems on a thread pool.
+    //
+    // Each system declares the components it reads and writes.
+    // The scheduler builds a job graph where every system waits for the systems
+    // added before it that it conflicts with, and the rest run in parallel.
+    //
+    // Systems that do not conflict run at the same time, so they must not make
+    // structural changes (unless they are exclusive) and must only touch the components they declared.
+    // Use Scene::ParallelEachChunk inside a system to split its work further.
+    //
+    // Usage:
+    // SystemScheduler scheduler;
+    // scheduler.AddSystem<Read<Rigidbody>, Write<Position>>("UpdatePositions", UpdatePositions);
+    // scheduler.AddSystem<Read<Position>, Write<OnHover>>("Targeting", GetTargetSelection);
+    // scheduler.Run(); // every frame
+    class __FLX_API SystemScheduler
+    {
+    public:
+      using SystemFunction = std::function<void()>;
+
+    private:
+      struct System
+      {
+        System(const std::string& name, SystemAccess access, SystemFunction function, QueryCallerID caller)
+          : name(name), access(std::move(access)), function(std::move(function)), caller(caller)
+        {
+        }
+
+        std::string name;
+        SystemAccess access;
+        SystemFunction function;
+
+        // Each system has its own last run of its Changed<T> queries
+        QueryCallerID caller = 0;
+
+        // job graph, rebuilt when a system is added
+        std::vector<std::size_t> dependents;
+        std::size_t dependency_count = 0;
+      };
+
+      ThreadPool& m_pool;
+      std::vector<System> m_systems;
+      bool m_is_graph_dirty = false;
+
+      // Number of dependencies each system is still waiting for during Run
+      std::unique_ptr<std::atomic<std::size_t>[]> m_remaining_dependencies;
+
+    public:
+      SystemScheduler(ThreadPool& pool = ThreadPool::GetDefault());
+
+      // Adds a system with the components it reads and writes.
+      void AddSystem(const std::string& name, SystemAccess access, SystemFunction function);
+
+      // Adds a system using the Read<...> and Write<...> tags.
+      // Usage: scheduler.AddSystem<Read<Rigidbody>, Write<Position>>("UpdatePositions", UpdatePositions);
+      template <typename ReadList, typename WriteList = Write<>>
+      void AddSystem(const std::string& name, SystemFunction function);
+
+      // Adds a system that runs alone, after every system before it
+      // and before every system after it.
+      void AddExclusiveSystem(const std::string& name, SystemFunction function);
+
+      // Removes all the systems.
+      void Clear();
+
+      // Runs every system once and blocks until they are all done.
+      // Call once per frame.
+      // If a system throws, the others still run and the first exception is rethrown.
+      void Run();
+
+      std::size_t GetSystemCount() const { return m_systems.size(); }
+
+      // Returns the names of the systems that have to finish before the system can run.
+      // Used for debugging the job graph.
+      std::vector<std::string> GetDependencies(const std::string& name);
+
+    private:
+      // INTERNAL FUNCTION
+      void Internal_BuildGraph();
+
+      // INTERNAL FUNCTION
+      // Runs the system, then queues the dependents that have no more dependencies.
+      void Internal_RunSystem(std::size_t index, TaskGroup& group);
+
+      // INTERNAL FUNCTION
+      template <typename... Ts>
+      static ComponentIDList Internal_GetComponentIDs(Read<Ts...>) { return { GetComponentID<Ts>()... }; }
+
+      // INTERNAL FUNCTION
+      template <typename... Ts>
+      static ComponentIDList Internal_GetComponentIDs(Write<Ts...>) { return { GetComponentID<Ts>()... }; }
+    };
+
+    template <typename ReadList, typename WriteList>
+    void SystemScheduler::AddSystem(const std::string& name, SystemFunction function)
+    {
+      SystemAccess access;
+      access.reads = Internal_GetComponentIDs(ReadList{});
+      access.writes = Internal_GetComponentIDs(WriteList{});
+      AddSystem(name, std::move(access), std::move(function));
+    }
+
+  }
+}
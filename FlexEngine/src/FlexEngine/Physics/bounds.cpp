@@ -0,0 +1,327 @@
+#include "pch.h"
+
+#include "bounds.h"
+#include "Wrapper/cpufeatures.h" // FLX_SIMD_X86, FLX_SIMD_TARGET
+
+#include <limits>
+
+// SoA bounding box kernels with SSE and AVX2 fast paths.
+//
+// The AVX2 path is picked at runtime, see Wrapper/cpufeatures.h.
+// The overlap kernels rely on the padding of BoundsSoA to read whole blocks,
+// ComputeBounds leaves the tail to the scalar path instead.
+
+namespace FlexEngine
+{
+  namespace Physics
+  {
+
+    #pragma region Internal Functions
+
+    static Implementation Internal_DetectImplementation()
+    {
+    #ifdef FLX_SIMD_X86
+      // SSE2 is part of x64
+      return GetCPUFeatures().has_avx2 ? Implementation::AVX2 : Implementation::SSE;
+    #else
+      return Implementation::Scalar;
+    #endif
+    }
+
+    static Implementation& Internal_GetImplementation()
+    {
+      static Implementation implementation = Internal_DetectImplementation();
+      return implementation;
+    }
+
+    // Appends the set bits of the mask as indexes starting at index
+    static void Internal_AppendMask(uint32_t mask, std::size_t index, std::vector<uint32_t>& out)
+    {
+      for (uint32_t lane = 0; mask != 0; lane++, mask >>= 1)
+      {
+        if (mask & 1) out.push_back(static_cast<uint32_t>(index + lane));
+      }
+    }
+
+    #pragma endregion
+
+    #pragma region Scalar
+
+    static void Internal_ComputeBoundsScalar(
+      std::size_t begin, std::size_t count,
+      const float* center_x, const float* center_y, const float* half_x, const float* half_y,
+      float* min_x, float* min_y, float* max_x, float* max_y
+    )
+    {
+      for (std::size_t i = begin; i < count; i++)
+      {
+        min_x[i] = center_x[i] - half_x[i];
+        min_y[i] = center_y[i] - half_y[i];
+        max_x[i] = center_x[i] + half_x[i];
+        max_y[i] = center_y[i] + half_y[i];
+      }
+    }
+
+    static uint32_t Internal_OverlapMaskScalar(const Vector2& min, const Vector2& max, const BoundsSoA& bounds, std::size_t index)
+    {
+      uint32_t mask = 0;
+      for (uint32_t lane = 0; lane < BoundsSoA::LANES; lane++)
+      {
+        std::size_t i = index + lane;
+        if (bounds.min_x[i] > max.x || bounds.max_x[i] < min.x || bounds.min_y[i] > max.y || bounds.max_y[i] < min.y) continue;
+        mask |= 1u << lane;
+      }
+      return mask;
+    }
+
+    static void Internal_FindOverlapsScalar(
+      const Vector2& min, const Vector2& max,
+      const BoundsSoA& bounds, std::size_t begin, std::size_t end,
+      std::vector<uint32_t>& out, bool is_sorted_by_min_x
+    )
+    {
+      for (std::size_t i = begin; i < end; i++)
+      {
+        if (bounds.min_x[i] > max.x)
+        {
+          if (is_sorted_by_min_x) break;
+          continue;
+        }
+        if (bounds.max_x[i] < min.x || bounds.min_y[i] > max.y || bounds.max_y[i] < min.y) continue;
+
+        out.push_back(static_cast<uint32_t>(i));
+      }
+    }
+
+    #pragma endregion
+
+  #ifdef FLX_SIMD_X86
+
+    #pragma region SSE
+
+    // Returns the number of boxes computed, the tail is left to the scalar path
+    FLX_SIMD_TARGET("sse2")
+    static std::size_t Internal_ComputeBoundsSSE(
+      std::size_t count,
+      const float* center_x, const float* center_y, const float* half_x, const float* half_y,
+      float* min_x, float* min_y, float* max_x, float* max_y
+    )
+    {
+      std::size_t i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+        __m128 cx = _mm_loadu_ps(center_x + i);
+        __m128 cy = _mm_loadu_ps(center_y + i);
+        __m128 hx = _mm_loadu_ps(half_x + i);
+        __m128 hy = _mm_loadu_ps(half_y + i);
+        _mm_storeu_ps(min_x + i, _mm_sub_ps(cx, hx));
+        _mm_storeu_ps(min_y + i, _mm_sub_ps(cy, hy));
+        _mm_storeu_ps(max_x + i, _mm_add_ps(cx, hx));
+        _mm_storeu_ps(max_y + i, _mm_add_ps(cy, hy));
+      }
+      return i;
+    }
+
+    // Two blocks of 4
+    FLX_SIMD_TARGET("sse2")
+    static inline uint32_t Internal_OverlapMaskSSE(const Vector2& min, const Vector2& max, const BoundsSoA& bounds, std::size_t index)
+    {
+      __m128 box_min_x = _mm_set1_ps(min.x);
+      __m128 box_min_y = _mm_set1_ps(min.y);
+      __m128 box_max_x = _mm_set1_ps(max.x);
+      __m128 box_max_y = _mm_set1_ps(max.y);
+
+      uint32_t mask = 0;
+      for (std::size_t half = 0; half < 2; half++)
+      {
+        std::size_t i = index + half * 4;
+        __m128 overlap_x = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&bounds.min_x[i]), box_max_x), _mm_cmpge_ps(_mm_loadu_ps(&bounds.max_x[i]), box_min_x));
+        __m128 overlap_y = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&bounds.min_y[i]), box_max_y), _mm_cmpge_ps(_mm_loadu_ps(&bounds.max_y[i]), box_min_y));
+        mask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_and_ps(overlap_x, overlap_y))) << (half * 4);
+      }
+      return mask;
+    }
+
+    FLX_SIMD_TARGET("sse2")
+    static void Internal_FindOverlapsSSE(
+      const Vector2& min, const Vector2& max,
+      const BoundsSoA& bounds, std::size_t begin, std::size_t end,
+      std::vector<uint32_t>& out, bool is_sorted_by_min_x
+    )
+    {
+      for (std::size_t i = begin; i < end; i += BoundsSoA::LANES)
+      {
+        uint32_t mask = Internal_OverlapMaskSSE(min, max, bounds, i);
+        if (end - i < BoundsSoA::LANES) mask &= (1u << (end - i)) - 1;
+        Internal_AppendMask(mask, i, out);
+
+        // the rest of the boxes start past this one
+        if (is_sorted_by_min_x && bounds.min_x[i + BoundsSoA::LANES - 1] > max.x) break;
+      }
+    }
+
+    #pragma endregion
+
+    #pragma region AVX2
+
+    FLX_SIMD_TARGET("avx2")
+    static std::size_t Internal_ComputeBoundsAVX2(
+      std::size_t count,
+      const float* center_x, const float* center_y, const float* half_x, const float* half_y,
+      float* min_x, float* min_y, float* max_x, float* max_y
+    )
+    {
+      std::size_t i = 0;
+      for (; i + 8 <= count; i += 8)
+      {
+        __m256 cx = _mm256_loadu_ps(center_x + i);
+        __m256 cy = _mm256_loadu_ps(center_y + i);
+        __m256 hx = _mm256_loadu_ps(half_x + i);
+        __m256 hy = _mm256_loadu_ps(half_y + i);
+        _mm256_storeu_ps(min_x + i, _mm256_sub_ps(cx, hx));
+        _mm256_storeu_ps(min_y + i, _mm256_sub_ps(cy, hy));
+        _mm256_storeu_ps(max_x + i, _mm256_add_ps(cx, hx));
+        _mm256_storeu_ps(max_y + i, _mm256_add_ps(cy, hy));
+      }
+      return i;
+    }
+
+    FLX_SIMD_TARGET("avx2")
+    static inline uint32_t Internal_OverlapMaskAVX2(const Vector2& min, const Vector2& max, const BoundsSoA& bounds, std::size_t index)
+    {
+      __m256 box_min_x = _mm256_set1_ps(min.x);
+      __m256 box_min_y = _mm256_set1_ps(min.y);
+      __m256 box_max_x = _mm256_set1_ps(max.x);
+      __m256 box_max_y = _mm256_set1_ps(max.y);
+
+      __m256 overlap_x = _mm256_and_ps(
+        _mm256_cmp_ps(_mm256_loadu_ps(&bounds.min_x[index]), box_max_x, _CMP_LE_OQ),
+        _mm256_cmp_ps(_mm256_loadu_ps(&bounds.max_x[index]), box_min_x, _CMP_GE_OQ)
+      );
+      __m256 overlap_y = _mm256_and_ps(
+        _mm256_cmp_ps(_mm256_loadu_ps(&bounds.min_y[index]), box_max_y, _CMP_LE_OQ),
+        _mm256_cmp_ps(_mm256_loadu_ps(&bounds.max_y[index]), box_min_y, _CMP_GE_OQ)
+      );
+      return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_and_ps(overlap_x, overlap_y)));
+    }
+
+    FLX_SIMD_TARGET("avx2")
+    static void Internal_FindOverlapsAVX2(
+      const Vector2& min, const Vector2& max,
+      const BoundsSoA& bounds, std::size_t begin, std::size_t end,
+      std::vector<uint32_t>& out, bool is_sorted_by_min_x
+    )
+    {
+      for (std::size_t i = begin; i < end; i += BoundsSoA::LANES)
+      {
+        uint32_t mask = Internal_OverlapMaskAVX2(min, max, bounds, i);
+        if (end - i < BoundsSoA::LANES) mask &= (1u << (end - i)) - 1;
+        Internal_AppendMask(mask, i, out);
+
+        // the rest of the boxes start past this one
+        if (is_sorted_by_min_x && bounds.min_x[i + BoundsSoA::LANES - 1] > max.x) break;
+      }
+    }
+
+    #pragma endregion
+
+  #endif
+
+    #pragma region BoundsSoA
+
+    BoundsSoA::BoundsSoA()
+    {
+      Resize(0);
+    }
+
+    void BoundsSoA::Resize(std::size_t size)
+    {
+      constexpr float infinity = std::numeric_limits<float>::infinity();
+
+      // the boxes past the old size are padding, they are already empty
+      std::size_t padded_size = size + LANES;
+      min_x.resize(padded_size, infinity);
+      min_y.resize(padded_size, infinity);
+      max_x.resize(padded_size, -infinity);
+      max_y.resize(padded_size, -infinity);
+
+      // shrinking turns the removed boxes into padding
+      for (std::size_t i = size; i < padded_size && i < m_size + LANES; i++)
+      {
+        min_x[i] = infinity;
+        min_y[i] = infinity;
+        max_x[i] = -infinity;
+        max_y[i] = -infinity;
+      }
+
+      m_size = size;
+    }
+
+    #pragma endregion
+
+    __FLX_API Implementation GetImplementation()
+    {
+      return Internal_GetImplementation();
+    }
+
+    __FLX_API void SetImplementation(Implementation implementation)
+    {
+      // clamp to what the CPU supports
+      Implementation supported = Internal_DetectImplementation();
+      Internal_GetImplementation() = (implementation > supported) ? supported : implementation;
+    }
+
+    __FLX_API void ComputeBounds(
+      std::size_t count,
+      const float* center_x, const float* center_y, const float* half_x, const float* half_y,
+      float* min_x, float* min_y, float* max_x, float* max_y
+    )
+    {
+      // the fast paths compute whole blocks, the tail is computed by the scalar path
+      std::size_t computed = 0;
+    #ifdef FLX_SIMD_X86
+      switch (Internal_GetImplementation())
+      {
+      case Implementation::AVX2: computed = Internal_ComputeBoundsAVX2(count, center_x, center_y, half_x, half_y, min_x, min_y, max_x, max_y); break;
+      case Implementation::SSE: computed = Internal_ComputeBoundsSSE(count, center_x, center_y, half_x, half_y, min_x, min_y, max_x, max_y); break;
+      default: break;
+      }
+    #endif
+
+      Internal_ComputeBoundsScalar(computed, count, center_x, center_y, half_x, half_y, min_x, min_y, max_x, max_y);
+    }
+
+    __FLX_API uint32_t OverlapMask8(const Vector2& min, const Vector2& max, const BoundsSoA& bounds, std::size_t index)
+    {
+    #ifdef FLX_SIMD_X86
+      switch (Internal_GetImplementation())
+      {
+      case Implementation::AVX2: return Internal_OverlapMaskAVX2(min, max, bounds, index);
+      case Implementation::SSE: return Internal_OverlapMaskSSE(min, max, bounds, index);
+      default: break;
+      }
+    #endif
+
+      return Internal_OverlapMaskScalar(min, max, bounds, index);
+    }
+
+    __FLX_API void FindOverlaps(
+      const Vector2& min, const Vector2& max,
+      const BoundsSoA& bounds, std::size_t begin, std::size_t end,
+      std::vector<uint32_t>& out, bool is_sorted_by_min_x
+    )
+    {
+    #ifdef FLX_SIMD_X86
+      switch (Internal_GetImplementation())
+      {
+      case Implementation::AVX2: Internal_FindOverlapsAVX2(min, max, bounds, begin, end, out, is_sorted_by_min_x); return;
+      case Implementation::SSE: Internal_FindOverlapsSSE(min, max, bounds, begin, end, out, is_sorted_by_min_x); return;
+      default: break;
+      }
+    #endif
+
+      Internal_FindOverlapsScalar(min, max, bounds, begin, end, out, is_sorted_by_min_x);
+    }
+
+  }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "flx_api.h"
+
+#include "FlexMath/vector2.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace FlexEngine
+{
+  namespace Physics
+  {
+
+    // The bounds kernels pick the fastest implementation the CPU supports.
+    // SetImplementation is for tests and benchmarks,
+    // asking for an unsupported implementation falls back to the best supported one.
+    enum class Implementation
+    {
+      Scalar,
+      SSE,
+      AVX2
+    };
+
+    __FLX_API Implementation GetImplementation();
+    __FLX_API void SetImplementation(Implementation implementation);
+
+    // Axis-aligned bounding boxes stored as SoA float arrays.
+    //
+    // The arrays are followed by LANES empty boxes (min = +inf, max = -inf),
+    // so the kernels can always read a whole block of 8 and the padding never overlaps anything.
+    class __FLX_API BoundsSoA
+    {
+    public:
+      static constexpr std::size_t LANES = 8;
+
+      std::vector<float> min_x;
+      std::vector<float> min_y;
+      std::vector<float> max_x;
+      std::vector<float> max_y;
+
+    private:
+      std::size_t m_size = 0;
+
+    public:
+      BoundsSoA();
+
+      // New boxes are empty until they are set.
+      void Resize(std::size_t size);
+      void Clear() { Resize(0); }
+
+      void Set(std::size_t index, const Vector2& min, const Vector2& max)
+      {
+        min_x[index] = min.x;
+        min_y[index] = min.y;
+        max_x[index] = max.x;
+        max_y[index] = max.y;
+      }
+
+      Vector2 GetMin(std::size_t index) const { return Vector2(min_x[index], min_y[index]); }
+      Vector2 GetMax(std::size_t index) const { return Vector2(max_x[index], max_y[index]); }
+
+      std::size_t size() const { return m_size; }
+      bool empty() const { return m_size == 0; }
+    };
+
+    // Rebuilds count boxes from their centers and half extents.
+    // min = center - half, max = center + half
+    // The output arrays don't need padding.
+    __FLX_API void ComputeBounds(
+      std::size_t count,
+      const float* center_x, const float* center_y, const float* half_x, const float* half_y,
+      float* min_x, float* min_y, float* max_x, float* max_y
+    );
+
+    // Tests one box against the 8 boxes starting at index.
+    // Bit i of the result is set if box index + i overlaps, touching boxes count as overlapping.
+    // The padding makes this safe up to the last box.
+    __FLX_API uint32_t OverlapMask8(const Vector2& min, const Vector2& max, const BoundsSoA& bounds, std::size_t index);
+
+    // Appends the indexes in [begin, end) of the boxes that overlap the box.
+    // If the boxes are sorted by min x the search stops at the first block that starts past the box.
+    __FLX_API void FindOverlaps(
+      const Vector2& min, const Vector2& max,
+      const BoundsSoA& bounds, std::size_t begin, std::size_t end,
+      std::vector<uint32_t>& out, bool is_sorted_by_min_x = false
+    );
+
+  }
+}
@@ -0,0 +1,417 @@
+#include "pch.h"
+
+#include "broadphase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+namespace FlexEngine
+{
+  namespace Physics
+  {
+
+    #pragma region Helper Functions
+
+    enum : uint8_t
+    {
+      FLAG_ACTIVE = 1 << 0,
+      FLAG_STATIC = 1 << 1,
+      FLAG_SORTED = 1 << 2, // the proxy is in m_sorted
+      FLAG_OVERSIZED = 1 << 3 // the proxy is in m_oversized, set for one UniformGrid pass
+    };
+
+    // Far enough from the int32_t limits that the cell ranges can't overflow
+    static constexpr float CELL_LIMIT = 1.0e9f;
+
+    static int32_t Internal_GetCell(float value, float cell_size)
+    {
+      float cell = std::floor(value / cell_size);
+
+      // guard: NaN or past what an int32_t can hold, the cast would be undefined
+      if (!(cell > -CELL_LIMIT)) return static_cast<int32_t>(-CELL_LIMIT);
+      if (!(cell < CELL_LIMIT)) return static_cast<int32_t>(CELL_LIMIT);
+
+      return static_cast<int32_t>(cell);
+    }
+
+    static bool Internal_IsFinite(const Vector2& min, const Vector2& max)
+    {
+      return std::isfinite(min.x) && std::isfinite(min.y) && std::isfinite(max.x) && std::isfinite(max.y);
+    }
+
+    static bool Internal_IsPairLess(const Broadphase::Pair& lhs, const Broadphase::Pair& rhs)
+    {
+      return lhs.a != rhs.a ? lhs.a < rhs.a : lhs.b < rhs.b;
+    }
+
+    static std::size_t Internal_HashCell(int32_t x, int32_t y)
+    {
+      return (static_cast<std::size_t>(static_cast<uint32_t>(x)) * 73856093u) ^ (static_cast<std::size_t>(static_cast<uint32_t>(y)) * 19349663u);
+    }
+
+    #pragma endregion
+
+    #pragma region Proxies
+
+    Broadphase::Proxy Broadphase::Add(const Vector2& min, const Vector2& max, uint64_t user_data, bool is_static)
+    {
+      Proxy proxy;
+      if (!m_free_list.empty())
+      {
+        proxy = m_free_list.back();
+        m_free_list.pop_back();
+      }
+      else
+      {
+        proxy = static_cast<Proxy>(m_flags.size());
+        m_bounds.Resize(m_flags.size() + 1);
+        m_user_data.push_back(0);
+        m_flags.push_back(0);
+      }
+
+      // a reused proxy can still be in the sorted order if the grid was used since it was removed
+      m_flags[proxy] = static_cast<uint8_t>((m_flags[proxy] & FLAG_SORTED) | FLAG_ACTIVE | (is_static ? FLAG_STATIC : 0));
+      m_user_data[proxy] = user_data;
+
+      // empty until Update accepts the bounds, so rejected bounds overlap nothing
+      const float inf = std::numeric_limits<float>::infinity();
+      m_bounds.Set(proxy, Vector2(inf, inf), Vector2(-inf, -inf));
+      Update(proxy, min, max);
+
+      m_count++;
+      m_is_sorted_dirty = true;
+      return proxy;
+    }
+
+    void Broadphase::Update(Proxy proxy, const Vector2& min, const Vector2& max)
+    {
+      // guard: NaN would break the sort order and infinity would span every cell
+      if (!Internal_IsFinite(min, max))
+      {
+        Log::Warning("Broadphase bounds must be finite, proxy " + std::to_string(proxy) + " keeps its previous bounds");
+        return;
+      }
+
+      m_bounds.Set(proxy, min, max);
+    }
+
+    void Broadphase::SetStatic(Proxy proxy, bool is_static)
+    {
+      if (is_static) m_flags[proxy] |= FLAG_STATIC;
+      else m_flags[proxy] &= ~FLAG_STATIC;
+    }
+
+    void Broadphase::Remove(Proxy proxy)
+    {
+      // guard: the proxy was already removed
+      if (!IsValid(proxy)) return;
+
+      m_flags[proxy] &= ~FLAG_ACTIVE;
+      m_removed.push_back(proxy);
+
+      m_count--;
+      m_is_sorted_dirty = true;
+    }
+
+    void Broadphase::Clear()
+    {
+      m_bounds.Clear();
+      m_user_data.clear();
+      m_flags.clear();
+      m_free_list.clear();
+      m_removed.clear();
+      m_count = 0;
+
+      m_sorted.clear();
+      m_is_sorted_dirty = false;
+      m_pairs.clear();
+      m_previous_pairs.clear();
+      m_added_pairs.clear();
+      m_removed_pairs.clear();
+    }
+
+    bool Broadphase::IsValid(Proxy proxy) const
+    {
+      return proxy < m_flags.size() && (m_flags[proxy] & FLAG_ACTIVE);
+    }
+
+    bool Broadphase::IsStatic(Proxy proxy) const
+    {
+      return (m_flags[proxy] & FLAG_STATIC) != 0;
+    }
+
+    void Broadphase::SetMethod(Method method)
+    {
+      m_method = method;
+    }
+
+    void Broadphase::SetCellSize(float cell_size)
+    {
+      // guard: the cells must have an area
+      if (!(cell_size > 0.0f))
+      {
+        Log::Warning("Broadphase cell size must be positive, keeping " + std::to_string(m_cell_size));
+        return;
+      }
+
+      m_cell_size = cell_size;
+    }
+
+    #pragma endregion
+
+    // Steps:
+    // 1. Find the pairs with the current method
+    // 2. Sort them and compare with the last frame
+    // 3. The removed proxies can be reused now that their pairs were reported as ended
+    const std::vector<Broadphase::Pair>& Broadphase::FindPairs()
+    {
+      // 1. Find the pairs
+      m_pairs.swap(m_previous_pairs);
+      m_pairs.clear();
+
+      switch (m_method)
+      {
+      case Method::SweepAndPrune:
+        Internal_SweepAndPrune();
+        break;
+      case Method::UniformGrid:
+        Internal_UniformGrid();
+        break;
+      }
+
+      // 2. Compare with the last frame
+      Internal_DiffPairs();
+
+      // 3. Reuse the removed proxies
+      m_free_list.insert(m_free_list.end(), m_removed.begin(), m_removed.end());
+      m_removed.clear();
+
+      return m_pairs;
+    }
+
+    // Both lists are sorted, so the difference is a merge.
+    // Most pairs persist from frame to frame, so the sort is mostly ordered runs.
+    void Broadphase::Internal_DiffPairs()
+    {
+      std::sort(m_pairs.begin(), m_pairs.end(), Internal_IsPairLess);
+
+      m_added_pairs.clear();
+      m_removed_pairs.clear();
+      std::set_difference(m_pairs.begin(), m_pairs.end(), m_previous_pairs.begin(), m_previous_pairs.end(), std::back_inserter(m_added_pairs), Internal_IsPairLess);
+      std::set_difference(m_previous_pairs.begin(), m_previous_pairs.end(), m_pairs.begin(), m_pairs.end(), std::back_inserter(m_removed_pairs), Internal_IsPairLess);
+    }
+
+    #pragma region Sweep And Prune
+
+    // Steps:
+    // 1. Drop the removed proxies and append the added ones
+    // 2. Insertion sort, the order from the last frame is almost sorted already
+    // 3. Fall back to a full sort if the insertion sort does too much work
+    void Broadphase::Internal_SortProxies()
+    {
+      // 1. Drop the removed proxies and append the added ones
+      if (m_is_sorted_dirty)
+      {
+        std::size_t kept = 0;
+        for (Proxy proxy : m_sorted)
+        {
+          if (m_flags[proxy] & FLAG_ACTIVE) m_sorted[kept++] = proxy;
+          else m_flags[proxy] &= ~FLAG_SORTED;
+        }
+        m_sorted.resize(kept);
+
+        for (Proxy proxy = 0; proxy < m_flags.size(); proxy++)
+        {
+          if ((m_flags[proxy] & FLAG_ACTIVE) && !(m_flags[proxy] & FLAG_SORTED))
+          {
+            m_flags[proxy] |= FLAG_SORTED;
+            m_sorted.push_back(proxy);
+          }
+        }
+
+        m_is_sorted_dirty = false;
+      }
+
+      // 2. Insertion sort
+      // The budget is a few moves per proxy, enough for bodies that moved past some neighbours.
+      // A new scene or a teleport costs more than that and is handled by the full sort.
+      const float* min_x = m_bounds.min_x.data();
+      std::size_t budget = m_sorted.size() * 8 + 64;
+      std::size_t moves = 0;
+      bool is_over_budget = false;
+      for (std::size_t i = 1; i < m_sorted.size() && !is_over_budget; i++)
+      {
+        Proxy proxy = m_sorted[i];
+        float key = min_x[proxy];
+
+        std::size_t j = i;
+        while (j > 0 && min_x[m_sorted[j - 1]] > key)
+        {
+          m_sorted[j] = m_sorted[j - 1];
+          j--;
+
+          if (++moves > budget)
+          {
+            is_over_budget = true;
+            break;
+          }
+        }
+        m_sorted[j] = proxy;
+      }
+
+      // 3. Full sort
+      if (is_over_budget)
+      {
+        std::sort(
+          m_sorted.begin(), m_sorted.end(),
+          [min_x](Proxy a, Proxy b) { return min_x[a] < min_x[b]; }
+        );
+      }
+    }
+
+    void Broadphase::Internal_SweepAndPrune()
+    {
+      Internal_SortProxies();
+
+      // copy the bounds in sorted order so the sweep reads them in sequence
+      std::size_t count = m_sorted.size();
+      m_sorted_bounds.Resize(count);
+      for (std::size_t i = 0; i < count; i++)
+      {
+        Proxy proxy = m_sorted[i];
+        m_sorted_bounds.min_x[i] = m_bounds.min_x[proxy];
+        m_sorted_bounds.min_y[i] = m_bounds.min_y[proxy];
+        m_sorted_bounds.max_x[i] = m_bounds.max_x[proxy];
+        m_sorted_bounds.max_y[i] = m_bounds.max_y[proxy];
+      }
+
+      // each pair is found once, from the body that starts first along x
+      for (std::size_t i = 0; i < count; i++)
+      {
+        m_overlaps.clear();
+        FindOverlaps(m_sorted_bounds.GetMin(i), m_sorted_bounds.GetMax(i), m_sorted_bounds, i + 1, count, m_overlaps, true);
+
+        Proxy a = m_sorted[i];
+        for (uint32_t j : m_overlaps)
+        {
+          Proxy b = m_sorted[j];
+          if ((m_flags[a] & m_flags[b] & FLAG_STATIC) != 0) continue;
+
+          m_pairs.push_back(a < b ? Pair{ a, b } : Pair{ b, a });
+        }
+      }
+    }
+
+    #pragma endregion
+
+    #pragma region Uniform Grid
+
+    // Steps:
+    // 1. Insert each proxy into every cell its bounds touch
+    //    Proxies that span too many cells are set aside instead.
+    // 2. Counting sort the cell entries into hash buckets
+    // 3. Test the proxies that share a cell
+    //    A pair that shares several cells is only reported from the cell that holds
+    //    the min corner of the overlap, so no deduplication pass is needed.
+    // 4. Test the oversized proxies against every other proxy
+    void Broadphase::Internal_UniformGrid()
+    {
+      // 1. Insert into the cells
+      m_cell_entries.clear();
+      m_oversized.clear();
+      for (Proxy proxy = 0; proxy < m_flags.size(); proxy++)
+      {
+        m_flags[proxy] &= ~FLAG_OVERSIZED;
+        if (!(m_flags[proxy] & FLAG_ACTIVE)) continue;
+
+        int32_t x0 = Internal_GetCell(m_bounds.min_x[proxy], m_cell_size);
+        int32_t y0 = Internal_GetCell(m_bounds.min_y[proxy], m_cell_size);
+        int32_t x1 = Internal_GetCell(m_bounds.max_x[proxy], m_cell_size);
+        int32_t y1 = Internal_GetCell(m_bounds.max_y[proxy], m_cell_size);
+
+        // skip: too many cells, tested against every proxy in step 4
+        int64_t cells = (static_cast<int64_t>(x1) - x0 + 1) * (static_cast<int64_t>(y1) - y0 + 1);
+        if (x1 >= x0 && y1 >= y0 && cells > MAX_CELLS_PER_PROXY)
+        {
+          m_flags[proxy] |= FLAG_OVERSIZED;
+          m_oversized.push_back(proxy);
+          continue;
+        }
+
+        for (int32_t y = y0; y <= y1; y++)
+        {
+          for (int32_t x = x0; x <= x1; x++) m_cell_entries.push_back({ x, y, proxy });
+        }
+      }
+
+      // 2. Counting sort into buckets, at least twice as many buckets as entries
+      std::size_t bucket_count = 16;
+      while (bucket_count < m_cell_entries.size() * 2) bucket_count *= 2;
+      std::size_t mask = bucket_count - 1;
+
+      m_bucket_offsets.assign(bucket_count + 1, 0);
+      for (const CellEntry& entry : m_cell_entries) m_bucket_offsets[(Internal_HashCell(entry.x, entry.y) & mask) + 1]++;
+      for (std::size_t bucket = 0; bucket < bucket_count; bucket++) m_bucket_offsets[bucket + 1] += m_bucket_offsets[bucket];
+
+      m_cell_buckets.resize(m_cell_entries.size());
+      for (const CellEntry& entry : m_cell_entries)
+      {
+        m_cell_buckets[m_bucket_offsets[Internal_HashCell(entry.x, entry.y) & mask]++] = entry;
+      }
+      // the scatter moved each offset to the start of the next bucket
+      for (std::size_t bucket = bucket_count; bucket > 0; bucket--) m_bucket_offsets[bucket] = m_bucket_offsets[bucket - 1];
+      m_bucket_offsets[0] = 0;
+
+      // 3. Test the proxies that share a cell
+      for (std::size_t bucket = 0; bucket < bucket_count; bucket++)
+      {
+        uint32_t begin = m_bucket_offsets[bucket];
+        uint32_t end = m_bucket_offsets[bucket + 1];
+        for (uint32_t i = begin; i < end; i++)
+        {
+          const CellEntry& entry_a = m_cell_buckets[i];
+          Proxy a = entry_a.proxy;
+          for (uint32_t j = i + 1; j < end; j++)
+          {
+            const CellEntry& entry_b = m_cell_buckets[j];
+
+            // different cells can share a bucket
+            if (entry_a.x != entry_b.x || entry_a.y != entry_b.y) continue;
+
+            Proxy b = entry_b.proxy;
+            if ((m_flags[a] & m_flags[b] & FLAG_STATIC) != 0) continue;
+            if (m_bounds.max_x[a] < m_bounds.min_x[b] || m_bounds.max_y[a] < m_bounds.min_y[b] || m_bounds.min_x[a] > m_bounds.max_x[b] || m_bounds.min_y[a] > m_bounds.max_y[b]) continue;
+
+            // only the cell with the min corner of the overlap reports the pair
+            if (Internal_GetCell((std::max)(m_bounds.min_x[a], m_bounds.min_x[b]), m_cell_size) != entry_a.x) continue;
+            if (Internal_GetCell((std::max)(m_bounds.min_y[a], m_bounds.min_y[b]), m_cell_size) != entry_a.y) continue;
+
+            m_pairs.push_back(a < b ? Pair{ a, b } : Pair{ b, a });
+          }
+        }
+      }
+
+      // 4. Test the oversized proxies against every other proxy
+      // a pair of two oversized proxies is reported from the lower one
+      for (Proxy a : m_oversized)
+      {
+        m_oversized_overlaps.clear();
+        FindOverlaps(m_bounds.GetMin(a), m_bounds.GetMax(a), m_bounds, 0, m_flags.size(), m_oversized_overlaps);
+
+        for (uint32_t b : m_oversized_overlaps)
+        {
+          if (b == a || !(m_flags[b] & FLAG_ACTIVE)) continue;
+          if ((m_flags[b] & FLAG_OVERSIZED) && b < a) continue;
+          if ((m_flags[a] & m_flags[b] & FLAG_STATIC) != 0) continue;
+
+          m_pairs.push_back(a < b ? Pair{ a, b } : Pair{ b, a });
+        }
+      }
+    }
+
+    #pragma endregion
+
+  }
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "flx_api.h"
+
+#include "FlexMath/vector2.h"
+#include "bounds.h"
+
+#include <vector>
+#include <cstdint>
+
+namespace FlexEngine
+{
+  namespace Physics
+  {
+
+    // Finds the pairs of 2D bodies whose bounding boxes overlap.
+    //
+    // Each body is a proxy with an AABB, a user value (usually the EntityID) and a static flag.
+    // Pairs of two static bodies are never reported, and each pair is reported once
+    // with the lower proxy first.
+    // Touching boxes count as overlapping.
+    // Bounds that are NaN or infinite are rejected with a warning.
+    //
+    // The pair list is kept between frames sorted by proxy,
+    // so FindPairs can report the pairs that started and stopped overlapping since the last call.
+    // Removed proxies are only reused after the next FindPairs,
+    // so their pairs are always reported as ended before a new body takes the proxy.
+    //
+    // Two methods are supported:
+    // - SweepAndPrune sorts the proxies by min x and sweeps along the x axis.
+    //   The order is kept between frames, so bodies that moved a little are re-sorted
+    //   with an insertion sort in close to linear time.
+    // - UniformGrid hashes the proxies into square cells and only tests proxies that share a cell.
+    //   Use it when the bodies are spread out along x but packed along y.
+    //
+    // The bounds are stored as SoA float arrays so the sweep only touches the data it compares,
+    // and each body is tested against 8 others at a time with the SIMD kernels from bounds.h.
+    //
+    // Usage:
+    // Broadphase broadphase;
+    // Broadphase::Proxy proxy = broadphase.Add(min, max, entity_id, is_static);
+    // broadphase.Update(proxy, min, max);
+    // for (auto& pair : broadphase.FindPairs()) { broadphase.GetUserData(pair.a) ... }
+    // for (auto& pair : broadphase.GetAddedPairs()) { ... }
+    class __FLX_API Broadphase
+    {
+    public:
+      using Proxy = uint32_t;
+      static constexpr Proxy NO_PROXY = UINT32_MAX;
+
+      enum class Method
+      {
+        SweepAndPrune,
+        UniformGrid
+      };
+
+      // a < b
+      struct Pair
+      {
+        Proxy a;
+        Proxy b;
+      };
+
+    private:
+      // Bounds of each proxy, indexed by the proxy
+      BoundsSoA m_bounds;
+      std::vector<uint64_t> m_user_data;
+      std::vector<uint8_t> m_flags;
+
+      // Removed proxies are reused by Add after the next FindPairs
+      std::vector<Proxy> m_free_list;
+      std::vector<Proxy> m_removed;
+      std::size_t m_count = 0;
+
+      Method m_method = Method::SweepAndPrune;
+      float m_cell_size = 1.0f;
+
+      // SweepAndPrune
+      // The proxies sorted by min x, kept between frames.
+      // Removed proxies are dropped and added ones are appended the next time the pairs are found.
+      std::vector<Proxy> m_sorted;
+      bool m_is_sorted_dirty = false;
+
+      // The bounds in sorted order, rebuilt for each sweep
+      BoundsSoA m_sorted_bounds;
+      std::vector<uint32_t> m_overlaps;
+
+      // UniformGrid
+      struct CellEntry
+      {
+        int32_t x;
+        int32_t y;
+        Proxy proxy;
+      };
+      std::vector<CellEntry> m_cell_entries;
+      std::vector<CellEntry> m_cell_buckets;
+      std::vector<uint32_t> m_bucket_offsets;
+
+      // Proxies that span too many cells, tested against every proxy instead
+      std::vector<Proxy> m_oversized;
+      std::vector<uint32_t> m_oversized_overlaps;
+
+      // Sorted by a then b
+      std::vector<Pair> m_pairs;
+      std::vector<Pair> m_previous_pairs;
+      std::vector<Pair> m_added_pairs;
+      std::vector<Pair> m_removed_pairs;
+
+    public:
+      Broadphase() = default;
+
+      // Adds a body and returns its proxy.
+      Proxy Add(const Vector2& min, const Vector2& max, uint64_t user_data = 0, bool is_static = false);
+
+      // Moves the body, it does not have to be called for bodies that did not move.
+      // Non-finite bounds are rejected and the body keeps its previous bounds.
+      void Update(Proxy proxy, const Vector2& min, const Vector2& max);
+
+      void SetStatic(Proxy proxy, bool is_static);
+
+      // The proxy can be returned by an Add after the next FindPairs.
+      void Remove(Proxy proxy);
+
+      // Drops every proxy and pair, the dropped pairs are not reported as ended.
+      void Clear();
+
+      // Finds all the overlapping pairs, sorted by proxy.
+      // The returned list is reused, it is valid until the next call.
+      const std::vector<Pair>& FindPairs();
+
+      // The pairs found by the last FindPairs.
+      const std::vector<Pair>& GetPairs() const { return m_pairs; }
+
+      // The pairs the last FindPairs found that the one before it did not, and the other way around.
+      const std::vector<Pair>& GetAddedPairs() const { return m_added_pairs; }
+      const std::vector<Pair>& GetRemovedPairs() const { return m_removed_pairs; }
+
+      bool IsValid(Proxy proxy) const;
+      uint64_t GetUserData(Proxy proxy) const { return m_user_data[proxy]; }
+      bool IsStatic(Proxy proxy) const;
+      Vector2 GetMin(Proxy proxy) const { return m_bounds.GetMin(proxy); }
+      Vector2 GetMax(Proxy proxy) const { return m_bounds.GetMax(proxy); }
+
+      // Number of proxies that were added and not removed.
+      std::size_t size() const { return m_count; }
+
+      Method GetMethod() const { return m_method; }
+      void SetMethod(Method method);
+
+      // Side length of the UniformGrid cells.
+      // Pick something close to the size of a typical body,
+      // bodies that span a few cells are inserted into each of them.
+      // Bodies that span more than MAX_CELLS_PER_PROXY cells are kept out of the grid
+      // and tested against every other body.
+      static constexpr int64_t MAX_CELLS_PER_PROXY = 64;
+      float GetCellSize() const { return m_cell_size; }
+      void SetCellSize(float cell_size);
+
+    private:
+      // INTERNAL FUNCTION
+      // Drops removed proxies from the sorted order, appends new ones and re-sorts.
+      void Internal_SortProxies();
+
+      // INTERNAL FUNCTION
+      void Internal_SweepAndPrune();
+
+      // INTERNAL FUNCTION
+      void Internal_UniformGrid();
+
+      // INTERNAL FUNCTION
+      // Sorts the pairs and compares them with the last frame.
+      void Internal_DiffPairs();
+    };
+
+  }
+}
@@ -4,8 +4,11 @@
 
 #include "Wrapper/flexassert.h"
 #include "Wrapper/flexbase64.h"
+#include "DataStructures/bytestream.h"
 
 #include <rapidjson/document.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
 using namespace rapidjson;
 
 #include <cstddef>
@@ -16,6 +19,7 @@ using namespace rapidjson;
 #include <map>
 #include <unordered_map>
 #include <functional>
+#include <type_traits>
 
 // Reflection system for C++
 // 
@@ -71,6 +75,8 @@ using namespace rapidjson;
     using T = TYPE; \
     type_desc->name = #TYPE; \
     type_desc->size = sizeof(T); \
+    type_desc->alignment = alignof(T); \
+    type_desc->is_trivially_copyable = std::is_trivially_copyable_v<T>; \
     type_desc->members = {
 
 // Registers a member variable for reflection
@@ -84,6 +90,17 @@ using namespace rapidjson;
         FlexEngine::Reflection::TypeResolver<decltype(T::VARIABLE)>::Get() \
       },
 
+// Registers a member variable that holds a FlexECS::Scene::StringIndex
+// Same as FLX_REFL_REGISTER_PROPERTY, but the member is flagged so that
+// compacting the scene's string storage can rewrite the index
+#define FLX_REFL_REGISTER_STRING_INDEX(VARIABLE) \
+      { \
+        #VARIABLE, \
+        offsetof(T, VARIABLE), \
+        FlexEngine::Reflection::TypeResolver<decltype(T::VARIABLE)>::Get(), \
+        true \
+      },
+
 // Ends the reflection registration
 // Pair this with FLX_REFL_REGISTER_START
 #define FLX_REFL_REGISTER_END \
@@ -114,10 +131,13 @@ namespace FlexEngine
     struct __FLX_API TypeDescriptor
     { FLX_REFL_SERIALIZABLE
       using json = rapidjson::Value;
+      using json_writer = rapidjson::Writer<rapidjson::StringBuffer>;
 
       //const char* name; // The name of the type.
       std::string name; // The name of the type.
       size_t size;      // The size of the type in bytes.
+      size_t alignment; // The alignment requirement of the type in bytes.
+      bool is_trivially_copyable = false; // The type can be copied with memcpy, binary serialization copies it in bulk.
 
 
       // Store a umap of all the type descriptors.
@@ -135,7 +155,10 @@ namespace FlexEngine
 
 
       //TypeDescriptor(const char* name, size_t size) : name{ name }, size{ size } {}
-      TypeDescriptor(const std::string& name, size_t size) : name{ name }, size{ size } {}
+      TypeDescriptor(const std::string& name, size_t size, size_t alignment = alignof(std::max_align_t))
+        : name{ name }, size{ size }, alignment{ alignment }
+      {
+      }
       virtual ~TypeDescriptor() {}
 
       // Overload the comparison operator to compare the type name.
@@ -157,20 +180,64 @@ namespace FlexEngine
       // This recursively serializes the object into the json format.
       virtual void Serialize(const void* obj, std::ostream& out) const = 0;
 
+      // Serializes an object directly into a rapidjson writer.
+      // The whole object is written into the writer's buffer in one pass,
+      // so no intermediate strings are created for each member.
+      // Type descriptors that don't implement this fall back to the stream version.
+      virtual void Serialize(const void* obj, json_writer& writer) const
+      {
+        std::stringstream ss;
+        Serialize(obj, ss);
+        std::string str = ss.str();
+        writer.RawValue(str.c_str(), str.size(), kObjectType);
+      }
+
       // Serializes an object to a rapidjson document.
       // This recursively serializes the object into the json format.
       // It is an extension of Serialize() that uses rapidjson.
       virtual void SerializeJson(const void* obj, rapidjson::Document& out) const
       {
-        std::stringstream ss;
-        Serialize(obj, ss);
-        out.Parse(ss.str().c_str());
+        rapidjson::StringBuffer buffer;
+        json_writer writer(buffer);
+        Serialize(obj, writer);
+        out.Parse(buffer.GetString(), buffer.GetSize());
       }
 
       // Deserializes an object from a json document.
       // This recursively deserializes the object from the json format
       // The deserializer uses the rapidjson library.
       virtual void Deserialize(void* obj, const json& value) const = 0;
+
+      // Serializes an object into a compact binary buffer.
+      // There are no type names in the data, so it is only meant to be read back by the same build.
+      // Used for snapshots, undo history and replication.
+      // Type descriptors that don't implement this fall back to a length-prefixed json string.
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const
+      {
+        rapidjson::StringBuffer buffer;
+        json_writer string_writer(buffer);
+        Serialize(obj, string_writer);
+        writer.Write<uint64_t>(buffer.GetSize());
+        writer.WriteBytes(buffer.GetString(), buffer.GetSize());
+      }
+
+      // Deserializes an object from a binary buffer written by SerializeBinary().
+      // Corrupted data marks the reader as invalid instead of asserting.
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const
+      {
+        std::size_t length = static_cast<std::size_t>(reader.Read<uint64_t>());
+        const uint8_t* bytes = reader.ReadBytes(length);
+        if (bytes == nullptr) return;
+
+        rapidjson::Document document;
+        document.Parse(reinterpret_cast<const char*>(bytes), length);
+        if (document.HasParseError())
+        {
+          reader.is_valid = false;
+          return;
+        }
+        Deserialize(obj, document);
+      }
     };
 
 
@@ -288,6 +355,7 @@ namespace FlexEngine
         const char* name;
         size_t offset;
         TypeDescriptor* type;
+        bool is_string_index = false; // see FLX_REFL_REGISTER_STRING_INDEX
       };
 
       std::vector<Member> members;
@@ -328,23 +396,69 @@ namespace FlexEngine
         os << "]}";
       }
 
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        writer.StartObject();
+        writer.Key("type"); writer.String(name.c_str(), static_cast<SizeType>(name.size()));
+        writer.Key("data"); writer.StartArray();
+        for (const Member& member : members)
+        {
+          member.type->Serialize((char*)obj + member.offset, writer);
+        }
+        writer.EndArray();
+        writer.EndObject();
+      }
+
       virtual void Deserialize(void* obj, const json& value) const override
       {
         const auto& arr = value["data"].GetArray();
 
         // guard against array size mismatch
-        FLX_INTERNAL_ASSERT(arr.Size() == members.size(),
+        // Files saved before a member was added at the end of the registration have fewer entries,
+        // the missing members keep their default values.
+        FLX_INTERNAL_ASSERT(arr.Size() <= members.size(),
           "Array size mismatch while deserializing struct\n"
           "This is most likely caused by a corrupted .flx file"
         );
 
         // deserialize each member
-        for (SizeType i = 0; i < members.size(); i++)
+        for (SizeType i = 0; i < arr.Size(); i++)
         {
           members[i].type->Deserialize((char*)obj + members[i].offset, arr[i]);
         }
       }
 
+      // Trivially copyable structs are copied in one go instead of member by member.
+      // This includes members that aren't registered and the padding between them.
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        if (is_trivially_copyable)
+        {
+          writer.WriteBytes(obj, size);
+          return;
+        }
+
+        for (const Member& member : members)
+        {
+          member.type->SerializeBinary((const char*)obj + member.offset, writer);
+        }
+      }
+
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        if (is_trivially_copyable)
+        {
+          const uint8_t* bytes = reader.ReadBytes(size);
+          if (bytes != nullptr) std::memcpy(obj, bytes, size);
+          return;
+        }
+
+        for (const Member& member : members)
+        {
+          member.type->DeserializeBinary((char*)obj + member.offset, reader);
+        }
+      }
+
     };
 
 
@@ -357,10 +471,11 @@ namespace FlexEngine
       size_t (*get_size)(const void*);
       const void* (*get_item)(const void*, size_t);
       void* (*set_item)(void*, size_t);
+      void (*resize)(void*, size_t);
 
       template <typename ItemType>
       TypeDescriptor_StdVector(ItemType*)
-        : TypeDescriptor{ "std::vector<>", sizeof(std::vector<ItemType>) }
+        : TypeDescriptor{ "std::vector<>", sizeof(std::vector<ItemType>), alignof(std::vector<ItemType>) }
         , item_type{ TypeResolver<ItemType>::Get() }
       {
         get_size = [](const void* vec_ptr) -> size_t {
@@ -376,6 +491,10 @@ namespace FlexEngine
           if (index >= vec.size()) vec.resize(index + 1);
           return &vec[index];
         };
+        resize = [](void* vec_ptr, size_t new_size) {
+          auto& vec = *(std::vector<ItemType>*) vec_ptr;
+          vec.resize(new_size);
+        };
       }
 
       virtual std::string ToString() const override
@@ -424,6 +543,21 @@ namespace FlexEngine
         }
       }
 
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        std::string type_name = ToString();
+        size_t num_items = get_size(obj);
+        writer.StartObject();
+        writer.Key("type"); writer.String(type_name.c_str(), static_cast<SizeType>(type_name.size()));
+        writer.Key("data"); writer.StartArray();
+        for (size_t index = 0; index < num_items; index++)
+        {
+          item_type->Serialize(get_item(obj, index), writer);
+        }
+        writer.EndArray();
+        writer.EndObject();
+      }
+
       virtual void Deserialize(void* obj, const json& value) const override
       {
         const auto& arr = value["data"].GetArray();
@@ -434,6 +568,47 @@ namespace FlexEngine
         }
       }
 
+      // Vectors of trivially copyable items are copied with one memcpy.
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        size_t num_items = get_size(obj);
+        writer.Write<uint64_t>(num_items);
+        if (num_items == 0) return;
+
+        if (item_type->is_trivially_copyable)
+        {
+          writer.WriteBytes(get_item(obj, 0), num_items * item_type->size);
+          return;
+        }
+
+        for (size_t index = 0; index < num_items; index++)
+        {
+          item_type->SerializeBinary(get_item(obj, index), writer);
+        }
+      }
+
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        size_t num_items = static_cast<size_t>(reader.Read<uint64_t>());
+
+        if (item_type->is_trivially_copyable)
+        {
+          const uint8_t* bytes = reader.ReadArray(num_items, item_type->size);
+          if (bytes == nullptr) return;
+
+          resize(obj, num_items);
+          if (num_items != 0) std::memcpy(set_item(obj, 0), bytes, num_items * item_type->size);
+          return;
+        }
+
+        // grow one item at a time, the count can't be trusted until the items are read
+        resize(obj, 0);
+        for (size_t index = 0; index < num_items && reader.is_valid; index++)
+        {
+          item_type->DeserializeBinary(set_item(obj, index), reader);
+        }
+      }
+
     };
 
     // Partially specialize TypeResolver for std::vectors.
@@ -464,7 +639,7 @@ namespace FlexEngine
       TypeDescriptor* value_type;
 
       TypeDescriptor_StdUnorderedMap(std::unordered_map<KeyType, ValueType>*)
-        : TypeDescriptor{ "std::unordered_map<>", sizeof(std::unordered_map<KeyType, ValueType>) }
+        : TypeDescriptor{ "std::unordered_map<>", sizeof(std::unordered_map<KeyType, ValueType>), alignof(std::unordered_map<KeyType, ValueType>) }
         , key_type{ TypeResolver<KeyType>::Get() }
         , value_type{ TypeResolver<ValueType>::Get() }
       {
@@ -510,6 +685,24 @@ namespace FlexEngine
         os << "]}";
       }
 
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        const auto& map = *(const std::unordered_map<KeyType, ValueType>*)obj;
+        std::string type_name = ToString();
+        writer.StartObject();
+        writer.Key("type"); writer.String(type_name.c_str(), static_cast<SizeType>(type_name.size()));
+        writer.Key("data"); writer.StartArray();
+        for (const auto& pair : map)
+        {
+          writer.StartArray();
+          key_type->Serialize(&pair.first, writer);
+          value_type->Serialize(&pair.second, writer);
+          writer.EndArray();
+        }
+        writer.EndArray();
+        writer.EndObject();
+      }
+
       virtual void Deserialize(void* obj, const rapidjson::Value& value) const override
       {
         std::unordered_map<KeyType, ValueType>& map = *(std::unordered_map<KeyType, ValueType>*)obj;
@@ -525,6 +718,33 @@ namespace FlexEngine
           map[key] = val;
         }
       }
+
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        const auto& map = *(const std::unordered_map<KeyType, ValueType>*)obj;
+        writer.Write<uint64_t>(map.size());
+        for (const auto& pair : map)
+        {
+          key_type->SerializeBinary(&pair.first, writer);
+          value_type->SerializeBinary(&pair.second, writer);
+        }
+      }
+
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        std::unordered_map<KeyType, ValueType>& map = *(std::unordered_map<KeyType, ValueType>*)obj;
+        size_t num_items = static_cast<size_t>(reader.Read<uint64_t>());
+
+        map.clear();
+        for (size_t i = 0; i < num_items && reader.is_valid; i++)
+        {
+          KeyType key{};
+          ValueType val{};
+          key_type->DeserializeBinary(&key, reader);
+          value_type->DeserializeBinary(&val, reader);
+          map[key] = std::move(val);
+        }
+      }
     };
 
     // Partially specialize TypeResolver for std::unordered_maps.
@@ -552,7 +772,7 @@ namespace FlexEngine
       TypeDescriptor* item_type;
 
       TypeDescriptor_StdSharedPtr(T*)
-        : TypeDescriptor{ "std::shared_ptr<>", sizeof(std::shared_ptr<T>) }
+        : TypeDescriptor{ "std::shared_ptr<>", sizeof(std::shared_ptr<T>), alignof(std::shared_ptr<T>) }
         , item_type{ TypeResolver<T>::Get() }
       {
       }
@@ -592,6 +812,19 @@ namespace FlexEngine
         }
       }
 
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        const auto& shared_ptr = *reinterpret_cast<const std::shared_ptr<T>*>(obj);
+        if (shared_ptr)
+        {
+          item_type->Serialize(shared_ptr.get(), writer);
+        }
+        else
+        {
+          writer.Null();
+        }
+      }
+
       virtual void Deserialize(void* obj, const json& value) const override
       {
         if (value.IsNull())
@@ -608,6 +841,27 @@ namespace FlexEngine
         }
       }
 
+      // Stored as a flag byte followed by the object if the flag is set
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        const auto& shared_ptr = *reinterpret_cast<const std::shared_ptr<T>*>(obj);
+        writer.Write<uint8_t>(shared_ptr ? 1 : 0);
+        if (shared_ptr) item_type->SerializeBinary(shared_ptr.get(), writer);
+      }
+
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        if (reader.Read<uint8_t>() == 0)
+        {
+          *reinterpret_cast<std::shared_ptr<T>*>(obj) = nullptr;
+          return;
+        }
+
+        std::shared_ptr<T> shared_ptr = std::make_shared<T>();
+        item_type->DeserializeBinary(shared_ptr.get(), reader);
+        *reinterpret_cast<std::shared_ptr<T>*>(obj) = shared_ptr;
+      }
+
     };
 
     // Specialization for std::shared_ptr<void>.
@@ -618,7 +872,7 @@ namespace FlexEngine
       TypeDescriptor* item_type;
 
       TypeDescriptor_StdSharedPtr(void*)
-        : TypeDescriptor{ "std::shared_ptr<>", sizeof(std::shared_ptr<void>) }
+        : TypeDescriptor{ "std::shared_ptr<>", sizeof(std::shared_ptr<void>), alignof(std::shared_ptr<void>) }
         , item_type{ nullptr }
       {
       }
@@ -658,21 +912,12 @@ namespace FlexEngine
           // The serialized_str needs to be constructed from the raw pointer which needs the full size.
           // Thus, the shared_ptr stores the size of the data in the first sizeof(std::size_t) == 4 or 8 bytes.
           // This allows us to get the size of the data, add sizeof(std::size_t), which gives us the full size.
-          // Implemented in FlexECS::Internal_GetComponentData.
 
           void* ptr = shared_ptr.get();
           std::size_t data_size = *static_cast<std::size_t*>(ptr);
-          BYTE* byte_ptr = static_cast<BYTE*>(ptr);
-          
-          // Get the data as a std::vector<BYTE>
-          // We get everything to encode the full data
-          std::vector<BYTE> data(
-            byte_ptr,
-            byte_ptr + sizeof(std::size_t) + data_size
-          );
 
-          // Encode the data
-          std::string serialized_data = Base64::Encode(data);
+          // Encode the full data, including the size
+          std::string serialized_data = Base64::Encode(ptr, sizeof(std::size_t) + data_size);
 
           // Serialize as a json string
           os << R"({"type":")" << "std::shared_ptr<void>" << R"(","data":")" << serialized_data << R"("})";
@@ -683,6 +928,27 @@ namespace FlexEngine
         }
       }
 
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        const auto& shared_ptr = *reinterpret_cast<const std::shared_ptr<void>*>(obj);
+        if (shared_ptr)
+        {
+          // Same layout as the stream version, the size is stored in front of the data
+          const void* ptr = shared_ptr.get();
+          std::size_t data_size = *static_cast<const std::size_t*>(ptr);
+          std::string serialized_data = Base64::Encode(ptr, sizeof(std::size_t) + data_size);
+
+          writer.StartObject();
+          writer.Key("type"); writer.String("std::shared_ptr<void>");
+          writer.Key("data"); writer.String(serialized_data.c_str(), static_cast<SizeType>(serialized_data.size()));
+          writer.EndObject();
+        }
+        else
+        {
+          writer.Null();
+        }
+      }
+
       virtual void Deserialize(void* obj, const json& value) const override
       {
         if (value.IsNull())
@@ -722,6 +988,45 @@ namespace FlexEngine
         }
       }
 
+      // Stored as a flag byte followed by the size and the raw data
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        const auto& shared_ptr = *reinterpret_cast<const std::shared_ptr<void>*>(obj);
+        writer.Write<uint8_t>(shared_ptr ? 1 : 0);
+        if (!shared_ptr) return;
+
+        const BYTE* byte_ptr = static_cast<const BYTE*>(shared_ptr.get());
+        std::size_t data_size = *reinterpret_cast<const std::size_t*>(byte_ptr);
+        writer.Write<uint64_t>(data_size);
+        writer.WriteBytes(byte_ptr + sizeof(std::size_t), data_size);
+      }
+
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        if (reader.Read<uint8_t>() == 0)
+        {
+          *reinterpret_cast<std::shared_ptr<void>*>(obj) = nullptr;
+          return;
+        }
+
+        std::size_t data_size = static_cast<std::size_t>(reader.Read<uint64_t>());
+        const uint8_t* bytes = reader.ReadBytes(data_size);
+        if (bytes == nullptr) return;
+
+        // same layout as the json version, the size is stored in front of the data
+        char* ptr = new char[sizeof(std::size_t) + data_size];
+        std::memcpy(ptr, &data_size, sizeof(std::size_t));
+        if (data_size != 0) std::memcpy(ptr + sizeof(std::size_t), bytes, data_size);
+
+        *reinterpret_cast<std::shared_ptr<void>*>(obj) = std::shared_ptr<void>(
+          ptr,
+          [](void* ptr)
+          {
+            delete[] reinterpret_cast<char*>(ptr);
+          }
+        );
+      }
+
     };
 
     /// Partially specialize TypeResolver for std::shared_ptrs.
@@ -750,7 +1055,7 @@ namespace FlexEngine
       TypeDescriptor* second_type;
 
       TypeDescriptor_StdPair(std::pair<FirstType, SecondType>*)
-        : TypeDescriptor{ "std::pair<>", sizeof(std::pair<FirstType, SecondType>) }
+        : TypeDescriptor{ "std::pair<>", sizeof(std::pair<FirstType, SecondType>), alignof(std::pair<FirstType, SecondType>) }
         , first_type{ TypeResolver<FirstType>::Get() }
         , second_type{ TypeResolver<SecondType>::Get() }
       {
@@ -786,6 +1091,19 @@ namespace FlexEngine
         os << "]}";
       }
 
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        const auto& pair = *(const std::pair<FirstType, SecondType>*)obj;
+        std::string type_name = ToString();
+        writer.StartObject();
+        writer.Key("type"); writer.String(type_name.c_str(), static_cast<SizeType>(type_name.size()));
+        writer.Key("data"); writer.StartArray();
+        first_type->Serialize(&pair.first, writer);
+        second_type->Serialize(&pair.second, writer);
+        writer.EndArray();
+        writer.EndObject();
+      }
+
       virtual void Deserialize(void* obj, const json& value) const override
       {
         const auto& arr = value["data"].GetArray();
@@ -793,6 +1111,20 @@ namespace FlexEngine
         second_type->Deserialize(&((std::pair<FirstType, SecondType>*)obj)->second, arr[1]);
       }
 
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        const auto& pair = *(const std::pair<FirstType, SecondType>*)obj;
+        first_type->SerializeBinary(&pair.first, writer);
+        second_type->SerializeBinary(&pair.second, writer);
+      }
+
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        auto& pair = *(std::pair<FirstType, SecondType>*)obj;
+        first_type->DeserializeBinary(&pair.first, reader);
+        second_type->DeserializeBinary(&pair.second, reader);
+      }
+
     };
 
     // Partially specialize TypeResolver for std::pairs.
@@ -1,14 +1,17 @@
 #include "Reflection/base.h"
 
+#include <charconv> // std::to_chars
+
 #pragma region Macros
 
 // TypeDescriptor for primitive types
 // Supports the same types that rapidjson supports except const char*
+// WRITE is the rapidjson writer function for the type
 // Abstracted for easy editing
-#define TYPE_DESCRIPTOR(NAME, TYPE) \
+#define TYPE_DESCRIPTOR(NAME, TYPE, WRITE) \
   struct __FLX_API TypeDescriptor_##NAME : TypeDescriptor \
   { \
-    TypeDescriptor_##NAME() : TypeDescriptor{ #TYPE, sizeof(TYPE) } {} \
+    TypeDescriptor_##NAME() : TypeDescriptor{ #TYPE, sizeof(TYPE), alignof(TYPE) } { is_trivially_copyable = true; } \
     virtual void Dump(const void* obj, std::ostream& os, int) const override \
     { \
       os << #TYPE << "{" << *(const TYPE*)obj << "}"; \
@@ -17,12 +20,27 @@
     { \
       os << R"({"type":")" << #TYPE << R"(","data":)" << *(const TYPE*)obj << "}"; \
     } \
+    virtual void Serialize(const void* obj, json_writer& writer) const override \
+    { \
+      writer.StartObject(); \
+      writer.Key("type"); writer.String(#TYPE); \
+      writer.Key("data"); WRITE(writer, *(const TYPE*)obj); \
+      writer.EndObject(); \
+    } \
     virtual void Deserialize(void* obj, const json& value) const override \
     { \
       TYPE data = value["data"].Get<TYPE>(); \
       *(TYPE*)obj = data; \
       /**reinterpret_cast<TYPE*>(obj) = data;*/ \
     } \
+    virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override \
+    { \
+      writer.Write<TYPE>(*(const TYPE*)obj); \
+    } \
+    virtual void DeserializeBinary(void* obj, ByteReader& reader) const override \
+    { \
+      *(TYPE*)obj = reader.Read<TYPE>(); \
+    } \
   }; \
   template <> \
   __FLX_API TypeDescriptor* GetPrimitiveDescriptor<TYPE>() \
@@ -55,14 +73,33 @@ namespace FlexEngine
 
     #pragma endregion
 
+    #pragma region Writer Functions
+
+    static void Internal_WriteInt(TypeDescriptor::json_writer& writer, int value) { writer.Int(value); }
+    static void Internal_WriteUnsigned(TypeDescriptor::json_writer& writer, unsigned value) { writer.Uint(value); }
+    static void Internal_WriteInt64(TypeDescriptor::json_writer& writer, int64_t value) { writer.Int64(value); }
+    static void Internal_WriteUint64(TypeDescriptor::json_writer& writer, uint64_t value) { writer.Uint64(value); }
+    static void Internal_WriteDouble(TypeDescriptor::json_writer& writer, double value) { writer.Double(value); }
+
+    // Floats are written with the shortest representation that round-trips,
+    // writing them as doubles would print the widening error (0.1f -> 0.10000000149011612)
+    static void Internal_WriteFloat(TypeDescriptor::json_writer& writer, float value)
+    {
+      char buffer[32];
+      auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+      writer.RawValue(buffer, static_cast<std::size_t>(result.ptr - buffer), kNumberType);
+    }
+
+    #pragma endregion
+
     // Primitive type registration
     //TYPE_DESCRIPTOR(Bool, bool) // specialized below
-    TYPE_DESCRIPTOR(Int, int)
-    TYPE_DESCRIPTOR(Unsigned, unsigned)
-    TYPE_DESCRIPTOR(LongLong, int64_t) // long long
-    TYPE_DESCRIPTOR(UnsignedLongLong, uint64_t) // unsigned long long
-    TYPE_DESCRIPTOR(Double, double)
-    TYPE_DESCRIPTOR(Float, float)
+    TYPE_DESCRIPTOR(Int, int, Internal_WriteInt)
+    TYPE_DESCRIPTOR(Unsigned, unsigned, Internal_WriteUnsigned)
+    TYPE_DESCRIPTOR(LongLong, int64_t, Internal_WriteInt64) // long long
+    TYPE_DESCRIPTOR(UnsignedLongLong, uint64_t, Internal_WriteUint64) // unsigned long long
+    TYPE_DESCRIPTOR(Double, double, Internal_WriteDouble)
+    TYPE_DESCRIPTOR(Float, float, Internal_WriteFloat)
     // no support for const char*, just use std::string
     //TYPE_DESCRIPTOR(StdString, std::string) // specialized below
 
@@ -73,8 +110,9 @@ namespace FlexEngine
     struct __FLX_API TypeDescriptor_Bool : TypeDescriptor
     {
       TypeDescriptor_Bool()
-        : TypeDescriptor{ "bool", sizeof(bool) }
+        : TypeDescriptor{ "bool", sizeof(bool), alignof(bool) }
       {
+        is_trivially_copyable = true;
       }
       virtual void Dump(const void* obj, std::ostream& os, int) const override
       {
@@ -84,10 +122,25 @@ namespace FlexEngine
       {
         os << R"({"type":")" << "bool" << R"(","data":)" << ((*(const bool*)obj) ? "true" : "false") << "}";
       }
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        writer.StartObject();
+        writer.Key("type"); writer.String("bool");
+        writer.Key("data"); writer.Bool(*(const bool*)obj);
+        writer.EndObject();
+      }
       virtual void Deserialize(void* obj, const json& value) const override
       {
         bool data = value["data"].Get<bool>(); *(bool*)obj = data;
       }
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        writer.Write<uint8_t>((*(const bool*)obj) ? 1 : 0);
+      }
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        *(bool*)obj = (reader.Read<uint8_t>() != 0);
+      }
     };
     template <>
     __FLX_API TypeDescriptor* GetPrimitiveDescriptor<bool>()
@@ -108,7 +161,7 @@ namespace FlexEngine
     struct __FLX_API TypeDescriptor_StdString : TypeDescriptor
     {
       TypeDescriptor_StdString()
-        : TypeDescriptor{ "std::string", sizeof(std::string) }
+        : TypeDescriptor{ "std::string", sizeof(std::string), alignof(std::string) }
       {
       }
 
@@ -132,6 +185,15 @@ namespace FlexEngine
         // Serialize
         os << R"({"type":")" << "std::string" << R"(","data":")" << data << R"("})";
       }
+      virtual void Serialize(const void* obj, json_writer& writer) const override
+      {
+        // The writer escapes the string itself, the parsed value is the same as the stream version
+        const std::string& data = *(const std::string*)obj;
+        writer.StartObject();
+        writer.Key("type"); writer.String("std::string");
+        writer.Key("data"); writer.String(data.c_str(), static_cast<SizeType>(data.size()));
+        writer.EndObject();
+      }
       virtual void Deserialize(void* obj, const json& value) const override
       {
         std::string data = value["data"].Get<std::string>();
@@ -147,6 +209,19 @@ namespace FlexEngine
 
         *(std::string*)obj = data;
       }
+      virtual void SerializeBinary(const void* obj, ByteWriter& writer) const override
+      {
+        // Stored as the length followed by the characters, no escaping needed
+        const std::string& data = *(const std::string*)obj;
+        writer.Write<uint64_t>(data.size());
+        writer.WriteBytes(data.data(), data.size());
+      }
+      virtual void DeserializeBinary(void* obj, ByteReader& reader) const override
+      {
+        std::size_t length = static_cast<std::size_t>(reader.Read<uint64_t>());
+        const uint8_t* bytes = reader.ReadBytes(length);
+        if (bytes != nullptr) ((std::string*)obj)->assign(reinterpret_cast<const char*>(bytes), length);
+      }
     };
     template <>
     __FLX_API TypeDescriptor* GetPrimitiveDescriptor<std::string>()
@@ -3,6 +3,8 @@
 #include "FlexEngine/AssetManager/assetmanager.h" // FLX_ASSET_GET
 #include "FlexEngine/DataStructures/freequeue.h"
 
+#include <filesystem>
+
 namespace FlexEngine
 {
 
@@ -306,6 +308,160 @@ namespace FlexEngine
     glBindVertexArray(0);
   }
 
+  // Steps:
+  // 1. Create the quad, the instance buffer and the built-in shader on the first call
+  // 2. Upload the sorted instances into a fresh buffer
+  // 3. Draw each batch, switching the shader and texture only when they change
+  //    Batches of shaders that are not instanced are drawn one sprite at a time
+  void OpenGLSpriteRenderer::DrawSpriteBatch(SpriteBatch& batch, const Vector2& window_size)
+  {
+    // the instance attributes below depend on this layout
+    static_assert(sizeof(SpriteInstance) == 128, "SpriteInstance layout changed, update the instance attributes");
+
+    // unit square
+    // Flipped UVs for OpenGL, the same as DrawTexture2D
+    static const float vertices[] = {
+      // Position        // TexCoords
+      -0.5f, -0.5f, 0.0f,   1.0f, 0.0f, // Bottom-left
+       0.5f, -0.5f, 0.0f,   0.0f, 0.0f, // Bottom-right
+       0.5f,  0.5f, 0.0f,   0.0f, 1.0f, // Top-right
+       0.5f,  0.5f, 0.0f,   0.0f, 1.0f, // Top-right
+      -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, // Top-left
+      -0.5f, -0.5f, 0.0f,   1.0f, 0.0f  // Bottom-left
+    };
+
+    static GLuint vao = 0, vbo = 0, instance_vbo = 0;
+    static std::size_t instance_capacity = 0;
+    static Asset::Shader batch_shader;
+
+    // 1. Create on the first call
+    if (vao == 0)
+    {
+      glGenVertexArrays(1, &vao);
+      glGenBuffers(1, &vbo);
+      glGenBuffers(1, &instance_vbo);
+
+      glBindVertexArray(vao);
+      glBindBuffer(GL_ARRAY_BUFFER, vbo);
+      glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+      glEnableVertexAttribArray(0);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+      glEnableVertexAttribArray(1);
+      glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+
+      // one SpriteInstance per instance
+      // transform is 4 vec4 columns, then uv_rect, color, color_to_add and color_to_multiply, 16 bytes each
+      glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+      for (GLuint i = 0; i < 8; i++)
+      {
+        GLuint location = 2 + i;
+        GLint size = (location == 8 || location == 9) ? 3 : 4;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(i * 4 * sizeof(float)));
+        glVertexAttribDivisor(location, 1);
+      }
+
+      glBindVertexArray(0);
+
+      std::filesystem::path source_directory = std::filesystem::path(__FILE__).parent_path();
+      batch_shader.Create(source_directory / "spritebatch.vert", source_directory / "spritebatch.frag");
+
+      // free in freequeue
+      FreeQueue::Push(
+        [=]()
+        {
+          glDeleteBuffers(1, &instance_vbo);
+          glDeleteBuffers(1, &vbo);
+          glDeleteVertexArrays(1, &vao);
+          batch_shader.Destroy();
+        }
+      );
+    }
+
+    const std::vector<SpriteInstance>& instances = batch.GetSortedInstances();
+    const std::vector<SpriteBatch::Batch>& batches = batch.GetBatches();
+
+    // guard
+    if (vao == 0 || instances.empty()) return;
+
+    // 2. Upload
+    // Reallocating the store orphans the one the GPU may still be reading from the last frame,
+    // so the upload doesn't wait for those draws to finish.
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    instance_capacity = (std::max)(instance_capacity, instances.size());
+    glBufferData(GL_ARRAY_BUFFER, instance_capacity * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(SpriteInstance), instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    static const Matrix4x4 view_matrix = Matrix4x4::LookAt(Vector3::Zero, Vector3::Forward, Vector3::Up);
+    Matrix4x4 projection_view = Matrix4x4::Orthographic(
+      0.0f, window_size.x,
+      window_size.y, 0.0f,
+      -2.0f, 2.0f
+    ) * view_matrix;
+
+    // 3. Draw the batches
+    glBindVertexArray(vao);
+
+    Asset::Shader* shader = nullptr;
+    uint32_t shader_index = UINT32_MAX;
+    uint32_t texture_index = UINT32_MAX;
+    for (const SpriteBatch::Batch& draw : batches)
+    {
+      const SpriteBatch::Material& material = batch.GetMaterial(draw.material);
+
+      // the shader doesn't have the instance attributes
+      if (!material.is_instanced)
+      {
+        Renderer2DProps props;
+        props.shader = material.shader;
+        props.texture = material.texture;
+        props.window_size = window_size;
+        for (uint32_t i = draw.first; i < draw.first + draw.count; i++)
+        {
+          const SpriteInstance& instance = instances[i];
+          props.transform = instance.transform;
+          props.color = static_cast<Vector3>(instance.color);
+          props.color_to_add = instance.color_to_add;
+          props.color_to_multiply = instance.color_to_multiply;
+          DrawTexture2D(props);
+        }
+
+        // DrawTexture2D binds its own vertex array and shader
+        glBindVertexArray(vao);
+        shader_index = UINT32_MAX;
+        continue;
+      }
+
+      if (material.shader_index != shader_index)
+      {
+        shader_index = material.shader_index;
+        shader = material.shader.empty() ? &batch_shader : &FLX_ASSET_GET(Asset::Shader, material.shader);
+        shader->Use();
+        shader->SetUniform_mat4("u_projection_view", projection_view);
+
+        // the sampler uniform belongs to the program
+        texture_index = UINT32_MAX;
+      }
+
+      if (material.texture_index != texture_index)
+      {
+        texture_index = material.texture_index;
+        if (!material.texture.empty())
+        {
+          auto& asset_texture = FLX_ASSET_GET(Asset::Texture, material.texture);
+          asset_texture.Bind(*shader, "u_texture", 0);
+        }
+      }
+
+      glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(draw.count), draw.first);
+      m_draw_calls++;
+    }
+
+    glBindVertexArray(0);
+  }
+
   void OpenGLSpriteRenderer::DrawPostProcessingLayer()
   {
       // Step 1: Full-screen quad vertices for post-processing (unchanged)
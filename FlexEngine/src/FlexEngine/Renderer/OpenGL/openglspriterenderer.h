@@ -3,6 +3,7 @@
 #include "flx_api.h"
 #include "FlexMath/vector4.h"
 #include "opengltexture.h"
+#include "Renderer/spritebatch.h"
 #include <glad/glad.h>
 
 namespace FlexEngine
@@ -79,6 +80,12 @@ namespace FlexEngine
         // Draw the texture
         static void DrawTexture2D(const Renderer2DProps& props = {});
 
+        // Draws the sprites in the batch with one instanced draw call per batch.
+        // The instances are uploaded into an orphaned buffer, so the batch can be cleared and refilled right after.
+        // Materials with an empty shader use the built-in sprite batch shader,
+        // materials that are not instanced draw each sprite with DrawTexture2D.
+        static void DrawSpriteBatch(SpriteBatch& batch, const Vector2& window_size);
+
         // Draw Post Processing Layer
         static void DrawPostProcessingLayer();
     };
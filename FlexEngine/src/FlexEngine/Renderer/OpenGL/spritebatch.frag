@@ -0,0 +1,27 @@
+#version 460 core
+
+out vec4 fragment_color;
+
+in vec2 tex_coord;
+flat in vec4 color;
+flat in vec3 color_to_add;
+flat in vec3 color_to_multiply;
+
+// texture
+uniform sampler2D u_texture;
+
+void main()
+{
+  vec3 diffuse = color.rgb;
+  float alpha = 1.0;
+  if (color.w > 0.5)
+  {
+    vec4 tex = texture(u_texture, tex_coord);
+    diffuse = tex.rgb;
+    alpha = tex.a;
+  }
+
+  vec3 result = diffuse * color_to_multiply + color_to_add;
+  result = clamp(result, 0.0, 1.0);
+  fragment_color = vec4(result, alpha);
+}
@@ -0,0 +1,35 @@
+#version 460 core
+
+// Input vertex data
+layout (location = 0) in vec3 m_position;
+layout (location = 1) in vec2 m_tex_coord;
+
+// Input instance data, see SpriteInstance
+layout (location = 2) in mat4 i_model;              // uses locations 2 to 5
+layout (location = 6) in vec4 i_uv_rect;            // xy offset, zw size
+layout (location = 7) in vec4 i_color;              // w is use_texture
+layout (location = 8) in vec3 i_color_to_add;
+layout (location = 9) in vec3 i_color_to_multiply;
+
+// Uniforms
+uniform mat4 u_projection_view;
+
+// Output data
+out vec2 tex_coord;
+flat out vec4 color;
+flat out vec3 color_to_add;
+flat out vec3 color_to_multiply;
+
+void main()
+{
+  // multiplication is right to left
+  gl_Position = u_projection_view * i_model * vec4(m_position, 1.0);
+
+  // map the unit square onto the sprite's part of the texture
+  tex_coord = i_uv_rect.xy + m_tex_coord * i_uv_rect.zw;
+
+  // data passthrough
+  color = i_color;
+  color_to_add = i_color_to_add;
+  color_to_multiply = i_color_to_multiply;
+}
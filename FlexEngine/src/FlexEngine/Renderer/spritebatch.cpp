@@ -0,0 +1,164 @@
+#include "pch.h"
+
+#include "spritebatch.h"
+
+#include <algorithm>
+
+namespace FlexEngine
+{
+
+  #pragma region Helper Functions
+
+  // Interns the key and returns its index.
+  // Returns UINT16_MAX if the table is full.
+  static uint16_t Internal_GetIndex(std::unordered_map<std::string, uint16_t>& indexes, const std::string& key)
+  {
+    auto it = indexes.find(key);
+    if (it != indexes.end()) return it->second;
+
+    // guard: the index has to fit in the sort key
+    if (indexes.size() >= UINT16_MAX) return UINT16_MAX;
+
+    uint16_t index = static_cast<uint16_t>(indexes.size());
+    indexes.emplace(key, index);
+    return index;
+  }
+
+  // layer | shader | texture | depth
+  // The layer is biased so negative layers sort before positive ones.
+  static uint64_t Internal_GetSortKey(int32_t layer, const SpriteBatch::Material& material, float depth)
+  {
+    int32_t clamped_layer = (std::min)((std::max)(layer, static_cast<int32_t>(INT16_MIN)), static_cast<int32_t>(INT16_MAX));
+    uint64_t biased_layer = static_cast<uint64_t>(static_cast<uint16_t>(clamped_layer) ^ 0x8000u);
+
+    // written this way so NaN becomes 0
+    float clamped_depth = depth > 0.0f ? (std::min)(depth, 1.0f) : 0.0f;
+    uint64_t quantized_depth = static_cast<uint64_t>(clamped_depth * 65535.0f + 0.5f);
+
+    return (biased_layer << 48) | (static_cast<uint64_t>(material.shader_index) << 32) | (static_cast<uint64_t>(material.texture_index) << 16) | quantized_depth;
+  }
+
+  static int32_t Internal_GetLayer(uint64_t key)
+  {
+    return static_cast<int32_t>(static_cast<int16_t>(static_cast<uint16_t>(key >> 48) ^ 0x8000u));
+  }
+
+  // Sprites with the same layer and material share a batch, the depth only orders them
+  static uint64_t Internal_GetBatchKey(uint64_t key)
+  {
+    return key >> 16;
+  }
+
+  #pragma endregion
+
+  SpriteBatch::MaterialID SpriteBatch::AddMaterial(const std::string& shader, const std::string& texture, bool is_instanced)
+  {
+    uint16_t shader_index = Internal_GetIndex(m_shader_indexes, shader);
+    uint16_t texture_index = Internal_GetIndex(m_texture_indexes, texture);
+
+    // guard: too many shaders or textures, share the last material instead of failing the draw
+    if (shader_index == UINT16_MAX || texture_index == UINT16_MAX)
+    {
+      Log::Error("SpriteBatch supports up to 65535 shaders and textures, " + shader + " " + texture + " was not added");
+      return m_materials.empty() ? 0 : static_cast<MaterialID>(m_materials.size() - 1);
+    }
+
+    uint32_t pair = (static_cast<uint32_t>(shader_index) << 16) | texture_index;
+    auto it = m_material_ids.find(pair);
+    if (it != m_material_ids.end()) return it->second;
+
+    MaterialID material = static_cast<MaterialID>(m_materials.size());
+    m_materials.push_back({ shader, texture, shader_index, texture_index, is_instanced });
+    m_material_ids.emplace(pair, material);
+    return material;
+  }
+
+  void SpriteBatch::Add(MaterialID material, const SpriteInstance& instance, int32_t layer, float depth)
+  {
+    // guard: unknown material
+    if (material >= m_materials.size()) return;
+
+    m_commands.push_back({ Internal_GetSortKey(layer, m_materials[material], depth), static_cast<uint32_t>(m_instances.size()), material });
+    m_instances.push_back(instance);
+    m_is_sorted = false;
+  }
+
+  void SpriteBatch::Clear()
+  {
+    m_instances.clear();
+    m_commands.clear();
+    m_sorted_instances.clear();
+    m_batches.clear();
+    m_is_sorted = true;
+  }
+
+  // Steps:
+  // 1. Radix sort the commands by key, 8 bits per pass
+  //    Passes where every key has the same byte are skipped,
+  //    usually the depth and the layer when a scene doesn't use them.
+  // 2. Copy the instances into draw order
+  // 3. Split the sorted instances where the batch key changes
+  void SpriteBatch::Sort()
+  {
+    // 1. Radix sort
+    // LSD radix sort is stable, so ties keep the order the sprites were added in
+    std::size_t count = m_commands.size();
+    uint32_t histograms[8][256] = {};
+    for (const Command& command : m_commands)
+    {
+      for (int pass = 0; pass < 8; pass++) histograms[pass][(command.key >> (pass * 8)) & 0xFF]++;
+    }
+
+    m_commands_scratch.resize(count);
+    for (int pass = 0; pass < 8; pass++)
+    {
+      uint32_t* histogram = histograms[pass];
+      uint32_t shift = pass * 8;
+
+      // skip: all the keys have the same byte
+      if (count == 0 || histogram[(m_commands[0].key >> shift) & 0xFF] == count) continue;
+
+      uint32_t offset = 0;
+      for (int digit = 0; digit < 256; digit++)
+      {
+        uint32_t digit_count = histogram[digit];
+        histogram[digit] = offset;
+        offset += digit_count;
+      }
+
+      for (const Command& command : m_commands) m_commands_scratch[histogram[(command.key >> shift) & 0xFF]++] = command;
+      m_commands.swap(m_commands_scratch);
+    }
+
+    // 2. Copy into draw order
+    m_sorted_instances.resize(count);
+    for (std::size_t i = 0; i < count; i++) m_sorted_instances[i] = m_instances[m_commands[i].index];
+
+    // 3. Build the batches
+    m_batches.clear();
+    for (std::size_t i = 0; i < count; i++)
+    {
+      uint64_t key = m_commands[i].key;
+      if (i == 0 || Internal_GetBatchKey(key) != Internal_GetBatchKey(m_commands[i - 1].key))
+      {
+        m_batches.push_back({ m_commands[i].material, Internal_GetLayer(key), static_cast<uint32_t>(i), 0 });
+      }
+      m_batches.back().count++;
+    }
+
+    m_is_sorted = true;
+  }
+
+  const std::vector<SpriteInstance>& SpriteBatch::GetSortedInstances()
+  {
+    if (!m_is_sorted) Sort();
+    return m_sorted_instances;
+  }
+
+  const std::vector<SpriteBatch::Batch>& SpriteBatch::GetBatches()
+  {
+    if (!m_is_sorted) Sort();
+    return m_batches;
+  }
+
+}
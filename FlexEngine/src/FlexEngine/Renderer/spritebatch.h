@@ -0,0 +1,138 @@
+#pragma once
+
+#include "flx_api.h"
+
+#include "FlexMath/matrix4x4.h"
+#include "FlexMath/vector4.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace FlexEngine
+{
+
+  // Per-instance data for one sprite, uploaded to the GPU as is.
+  // The layout matches the instance attributes of the sprite batch shader,
+  // 128 bytes per sprite.
+  struct __FLX_API SpriteInstance
+  {
+    Matrix4x4 transform = Matrix4x4::Identity;
+
+    // Sub-rectangle of the texture, xy is the offset and zw is the size in UV space.
+    // Sprites that share an atlas texture are drawn in the same batch.
+    Vector4 uv_rect = Vector4(0.0f, 0.0f, 1.0f, 1.0f);
+
+    // Used instead of the texture when use_texture is 0
+    // w is use_texture, 1 samples the texture and 0 uses the color
+    Vector4 color = Vector4(1.0f, 0.0f, 1.0f, 1.0f);
+
+    Vector3 color_to_add = Vector3(0.0f, 0.0f, 0.0f);
+    Vector3 color_to_multiply = Vector3(1.0f, 1.0f, 1.0f);
+  };
+
+  // Collects sprites for a frame and groups them into batches that can be drawn with one instanced call each.
+  //
+  // Each sprite is a POD command with a 64-bit sort key:
+  // layer (16 bits) | shader (16 bits) | texture (16 bits) | depth (16 bits)
+  // Sprites are sorted by layer first so blending stays correct,
+  // then by shader and texture so each material in a layer is one batch,
+  // then by depth inside the batch.
+  // The keys are radix sorted once per frame, which is stable,
+  // so sprites with the same key keep the order they were added in.
+  //
+  // This class only does the CPU side, it doesn't touch OpenGL.
+  // OpenGLSpriteRenderer::DrawSpriteBatch uploads the instances and draws the batches.
+  //
+  // Usage:
+  // SpriteBatch batch;
+  // SpriteBatch::MaterialID material = batch.AddMaterial(R"(/shaders/sprite)", R"(/images/atlas.png)");
+  // batch.Add(material, instance, z_index);
+  // OpenGLSpriteRenderer::DrawSpriteBatch(batch, window_size);
+  // batch.Clear();
+  class __FLX_API SpriteBatch
+  {
+  public:
+    using MaterialID = uint32_t;
+
+    // Shader and texture asset keys.
+    // An empty shader uses the built-in sprite batch shader,
+    // an empty texture draws the sprites with their color.
+    // Shaders without the instance attributes are not instanced,
+    // their sprites are drawn one at a time in the same order.
+    struct Material
+    {
+      std::string shader;
+      std::string texture;
+      uint16_t shader_index;
+      uint16_t texture_index;
+      bool is_instanced;
+    };
+
+    // A run of sorted instances that share a layer and a material
+    struct Batch
+    {
+      MaterialID material;
+      int32_t layer;
+      uint32_t first;
+      uint32_t count;
+    };
+
+  private:
+    // Materials are kept between frames, only the sprites are cleared
+    std::vector<Material> m_materials;
+    std::unordered_map<std::string, uint16_t> m_shader_indexes;
+    std::unordered_map<std::string, uint16_t> m_texture_indexes;
+    std::unordered_map<uint32_t, MaterialID> m_material_ids;
+
+    // The sort key and where to find the sprite, 16 bytes so the radix passes move little data
+    struct Command
+    {
+      uint64_t key;
+      uint32_t index;
+      MaterialID material;
+    };
+
+    std::vector<SpriteInstance> m_instances;
+    std::vector<Command> m_commands;
+    std::vector<Command> m_commands_scratch;
+
+    std::vector<SpriteInstance> m_sorted_instances;
+    std::vector<Batch> m_batches;
+    bool m_is_sorted = true;
+
+  public:
+    SpriteBatch() = default;
+
+    // Returns the id of the shader and texture pair, adding it if it's new.
+    // Look it up once per material and reuse the id, it hashes both strings.
+    // is_instanced is kept from the first time the pair is added.
+    MaterialID AddMaterial(const std::string& shader, const std::string& texture, bool is_instanced = true);
+
+    const Material& GetMaterial(MaterialID material) const { return m_materials[material]; }
+    std::size_t GetMaterialCount() const { return m_materials.size(); }
+
+    // Queues a sprite, lower layers are drawn first.
+    // Layers are clamped to [-32768, 32767].
+    // Depth orders the sprites inside a batch, lower depth is drawn first.
+    // It is clamped to [0, 1] and kept to 16 bits.
+    void Add(MaterialID material, const SpriteInstance& instance, int32_t layer = 0, float depth = 0.0f);
+
+    // Drops the sprites, the materials are kept.
+    void Clear();
+
+    // Sorts the sprites and builds the batches.
+    // Called by the getters when sprites were added since the last sort.
+    void Sort();
+
+    // The instances in draw order, each batch is a contiguous range.
+    const std::vector<SpriteInstance>& GetSortedInstances();
+    const std::vector<Batch>& GetBatches();
+
+    // Number of sprites added since the last clear.
+    std::size_t size() const { return m_instances.size(); }
+    bool empty() const { return m_instances.empty(); }
+  };
+
+}
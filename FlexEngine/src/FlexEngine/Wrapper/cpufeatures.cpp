@@ -0,0 +1,49 @@
+#include "pch.h"
+
+#include "cpufeatures.h"
+
+#if defined(FLX_SIMD_X86) && defined(_MSC_VER)
+  #include <intrin.h> // __cpuid, __cpuidex, _xgetbv
+#endif
+
+namespace FlexEngine
+{
+
+  static CPUFeatures Internal_DetectCPUFeatures()
+  {
+    CPUFeatures features;
+
+  #ifdef FLX_SIMD_X86
+  #ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    features.has_ssse3 = (info[2] & (1 << 9)) != 0;
+    bool has_osxsave = (info[2] & (1 << 27)) != 0;
+    bool has_avx = (info[2] & (1 << 28)) != 0;
+
+    // the OS has to save the ymm registers too
+    if (max_leaf >= 7 && has_osxsave && has_avx && (_xgetbv(0) & 0x6) == 0x6)
+    {
+      __cpuidex(info, 7, 0);
+      features.has_avx2 = (info[1] & (1 << 5)) != 0;
+    }
+  #else
+    __builtin_cpu_init();
+    features.has_ssse3 = __builtin_cpu_supports("ssse3");
+    features.has_avx2 = __builtin_cpu_supports("avx2");
+  #endif
+  #endif
+
+    return features;
+  }
+
+  __FLX_API const CPUFeatures& GetCPUFeatures()
+  {
+    static const CPUFeatures features = Internal_DetectCPUFeatures();
+    return features;
+  }
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "flx_api.h"
+
+// Runtime CPU feature detection for the SIMD fast paths.
+//
+// The fast paths are compiled for their instruction set per function with FLX_SIMD_TARGET
+// and picked at runtime with GetCPUFeatures, the build itself doesn't need /arch:AVX2.
+// Used by Base64 and the Physics bounds kernels.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+  #define FLX_SIMD_X86
+  #include <immintrin.h>
+#endif
+
+// MSVC allows any intrinsic in any function, GCC and Clang need the target per function
+#if defined(__GNUC__) || defined(__clang__)
+  #define FLX_SIMD_TARGET(ISA) __attribute__((target(ISA)))
+#else
+  #define FLX_SIMD_TARGET(ISA)
+#endif
+
+namespace FlexEngine
+{
+
+  // The instruction sets the fast paths use.
+  // SSE2 is part of x64 and is not listed.
+  struct __FLX_API CPUFeatures
+  {
+    bool has_ssse3 = false;
+
+    // Only set if the OS also saves the ymm registers
+    bool has_avx2 = false;
+  };
+
+  // Detected on the first call, all false on other architectures.
+  __FLX_API const CPUFeatures& GetCPUFeatures();
+
+}
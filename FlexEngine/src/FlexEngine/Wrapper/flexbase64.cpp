@@ -1,122 +1,396 @@
 #include "pch.h"
 
 #include "flexbase64.h"
+#include "cpufeatures.h" // FLX_SIMD_X86, FLX_SIMD_TARGET
 
-#pragma comment(lib, "Crypt32.lib") // Links the Crypt32.lib library to the project.
-#include <wincrypt.h> // CryptBinaryToStringA, CryptStringToBinaryA
+#include <array>
+
+// Table-driven base64 codec with SSSE3 and AVX2 fast paths.
+//
+// The SIMD paths are picked at runtime, see cpufeatures.h.
+// They process whole blocks and leave the tail to the scalar path.
+// Decoding validates each block, a block with an invalid character is left to the
+// scalar path which reports the error.
+//
+// References:
+//  Base64 encoding with SIMD instructions, Wojciech Mula
+//    http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html
+//  Base64 decoding with SIMD instructions, Wojciech Mula
+//    http://0x80.pl/notesen/2016-01-17-sse-base64-decoding.html
+//  Faster Base64 Encoding and Decoding using AVX2 Instructions, Mula and Lemire
+//    https://arxiv.org/abs/1704.00605
 
 namespace FlexEngine
 {
   namespace Base64
   {
 
-    #pragma region Internal Function
+    #pragma region Internal Functions
+
+    static const char* ENCODE_TABLE = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    static constexpr uint8_t INVALID = 0xFF;
 
-    bool Internal_ValidateBase64(const std::string& data)
+    static const std::array<uint8_t, 256>& Internal_GetDecodeTable()
     {
-      // guard
-      if (data.empty()) return false;
+      static const std::array<uint8_t, 256> decode_table = []()
+      {
+        std::array<uint8_t, 256> table;
+        table.fill(INVALID);
+        for (uint8_t i = 0; i < 64; i++) table[static_cast<uint8_t>(ENCODE_TABLE[i])] = i;
+        return table;
+      }();
+      return decode_table;
+    }
+
+    static Implementation Internal_DetectImplementation()
+    {
+      const CPUFeatures& features = GetCPUFeatures();
+      if (features.has_avx2) return Implementation::AVX2;
+      if (features.has_ssse3) return Implementation::SSSE3;
+      return Implementation::Scalar;
+    }
+
+    static Implementation& Internal_GetImplementation()
+    {
+      static Implementation implementation = Internal_DetectImplementation();
+      return implementation;
+    }
+
+    // Encodes whole groups of 3 bytes, the tail is padded
+    static void Internal_EncodeScalar(const uint8_t* src, std::size_t size, char* dst)
+    {
+      std::size_t i = 0;
+      for (; i + 3 <= size; i += 3)
+      {
+        uint32_t value = (uint32_t(src[i]) << 16) | (uint32_t(src[i + 1]) << 8) | uint32_t(src[i + 2]);
+        *dst++ = ENCODE_TABLE[(value >> 18) & 63];
+        *dst++ = ENCODE_TABLE[(value >> 12) & 63];
+        *dst++ = ENCODE_TABLE[(value >> 6) & 63];
+        *dst++ = ENCODE_TABLE[value & 63];
+      }
 
-      static const std::string base64_chars =
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-        "abcdefghijklmnopqrstuvwxyz"
-        "0123456789+/"
-      ;
+      std::size_t remaining = size - i;
+      if (remaining == 0) return;
+
+      uint32_t value = uint32_t(src[i]) << 16;
+      if (remaining == 2) value |= uint32_t(src[i + 1]) << 8;
+      *dst++ = ENCODE_TABLE[(value >> 18) & 63];
+      *dst++ = ENCODE_TABLE[(value >> 12) & 63];
+      *dst++ = (remaining == 2) ? ENCODE_TABLE[(value >> 6) & 63] : '=';
+      *dst++ = '=';
+    }
 
-      // check if the data is a valid base64 string
-      for (char c : data)
+    // Decodes characters without padding, the size can't leave a single character in the last group
+    static bool Internal_DecodeScalar(const uint8_t* src, std::size_t size, uint8_t* dst)
+    {
+      const std::array<uint8_t, 256>& table = Internal_GetDecodeTable();
+
+      std::size_t i = 0;
+      for (; i + 4 <= size; i += 4)
       {
-        if (base64_chars.find(c) == std::string::npos && c != '=') return false;
+        uint8_t a = table[src[i]], b = table[src[i + 1]], c = table[src[i + 2]], d = table[src[i + 3]];
+        if (((a | b | c | d) & 0xC0) != 0) return false; // INVALID has the high bits set
+
+        uint32_t value = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6) | uint32_t(d);
+        *dst++ = static_cast<uint8_t>(value >> 16);
+        *dst++ = static_cast<uint8_t>(value >> 8);
+        *dst++ = static_cast<uint8_t>(value);
       }
 
+      std::size_t remaining = size - i;
+      if (remaining == 0) return true;
+
+      uint8_t a = table[src[i]], b = table[src[i + 1]];
+      uint8_t c = (remaining == 3) ? table[src[i + 2]] : 0;
+      if (((a | b | c) & 0xC0) != 0) return false;
+
+      uint32_t value = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6);
+      *dst++ = static_cast<uint8_t>(value >> 16);
+      if (remaining == 3) *dst++ = static_cast<uint8_t>(value >> 8);
       return true;
     }
 
-    std::string Internal_GetErrorMessage()
+  #ifdef FLX_SIMD_X86
+
+    #pragma region SSSE3
+
+    // Spreads 12 bytes into 16 lanes of 6-bit indices
+    FLX_SIMD_TARGET("ssse3")
+    static inline __m128i Internal_EncodeReshuffleSSSE3(__m128i input)
     {
-      DWORD error_code = GetLastError();
-      LPSTR message_buffer = nullptr;
-      DWORD size = FormatMessageA(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-        nullptr, error_code, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), (LPSTR)&message_buffer, 0, nullptr
+      input = _mm_shuffle_epi8(input, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+      const __m128i t0 = _mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00));
+      const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+      const __m128i t2 = _mm_and_si128(input, _mm_set1_epi32(0x003f03f0));
+      const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+      return _mm_or_si128(t1, t3);
+    }
+
+    // Maps 6-bit indices to characters by adding a per-range offset
+    FLX_SIMD_TARGET("ssse3")
+    static inline __m128i Internal_EncodeTranslateSSSE3(__m128i indices)
+    {
+      const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
       );
-      std::string message(message_buffer, size);
-      LocalFree(message_buffer);
-      return message;
+      __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+      const __m128i is_upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+      range = _mm_or_si128(range, _mm_and_si128(is_upper, _mm_set1_epi8(13)));
+      return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
     }
 
-    #pragma endregion
+    // Reads 16 bytes per 12 encoded, so it stops 4 bytes early
+    // Returns the number of bytes encoded
+    FLX_SIMD_TARGET("ssse3")
+    static std::size_t Internal_EncodeSSSE3(const uint8_t* src, std::size_t size, char* dst)
+    {
+      std::size_t i = 0;
+      for (; i + 16 <= size; i += 12)
+      {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i output = Internal_EncodeTranslateSSSE3(Internal_EncodeReshuffleSSSE3(input));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), output);
+        dst += 16;
+      }
+      return i;
+    }
 
-    __FLX_API std::string Encode(const std::vector<BYTE>& data)
+    // Returns false if any of the 16 characters are not in the alphabet
+    FLX_SIMD_TARGET("ssse3")
+    static inline bool Internal_DecodeTranslateSSSE3(__m128i input, __m128i& values)
     {
-      // guard
-      if (data.empty()) return "";
+      const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+      const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+      const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+      const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+
+      const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(input, 4), nibble_mask);
+      const __m128i lo_nibbles = _mm_and_si128(input, nibble_mask);
+      const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+      const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF) return false;
 
-      DWORD data_size = static_cast<DWORD>(data.size());
-      DWORD size = 0;
+      const __m128i is_slash = _mm_cmpeq_epi8(input, _mm_set1_epi8('/'));
+      const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(is_slash, hi_nibbles));
+      values = _mm_add_epi8(input, roll);
+      return true;
+    }
 
-      DWORD flags = CRYPT_STRING_BASE64 | CRYPT_STRING_NOCRLF;
+    // Packs 16 lanes of 6-bit values into the first 12 bytes
+    FLX_SIMD_TARGET("ssse3")
+    static inline __m128i Internal_DecodePackSSSE3(__m128i values)
+    {
+      const __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+      const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+      return _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    }
 
-      // get size
-      if (!CryptBinaryToStringA(data.data(), data_size, flags, nullptr, &size))
+    // Writes 16 bytes per 12 decoded, so it stops while the output has room for the extra bytes
+    // Returns the number of characters decoded
+    FLX_SIMD_TARGET("ssse3")
+    static std::size_t Internal_DecodeSSSE3(const uint8_t* src, std::size_t size, uint8_t* dst)
+    {
+      std::size_t i = 0;
+      for (; i + 24 <= size; i += 16)
       {
-        Log::Error("Base64 encoding: Failed to get the size of the encoded data." + Internal_GetErrorMessage());
-        return "";
+        __m128i values;
+        if (!Internal_DecodeTranslateSSSE3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), values)) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), Internal_DecodePackSSSE3(values));
+        dst += 12;
       }
+      return i;
+    }
+
+    #pragma endregion
+
+    #pragma region AVX2
+
+    // Same as the SSSE3 path with 12 bytes in each 128-bit lane
 
-      // allocate
-      std::string result(size, '\0');
+    FLX_SIMD_TARGET("avx2")
+    static std::size_t Internal_EncodeAVX2(const uint8_t* src, std::size_t size, char* dst)
+    {
+      const __m256i shuffle = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10
+      );
+      const __m256i offsets = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+      );
 
-      // encode
-      if (!CryptBinaryToStringA(data.data(), data_size, flags, &result[0], &size))
+      // the second lane reads bytes 12 to 27
+      std::size_t i = 0;
+      for (; i + 28 <= size; i += 24)
       {
-        Log::Error("Base64 encoding: Failed to encode the data." + Internal_GetErrorMessage());
-        return "";
+        __m256i input = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 12)), 1
+        );
+
+        input = _mm256_shuffle_epi8(input, shuffle);
+        const __m256i t0 = _mm256_and_si256(input, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(input, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t1, t3);
+
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i is_upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        range = _mm256_or_si256(range, _mm256_and_si256(is_upper, _mm256_set1_epi8(13)));
+        const __m256i output = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), output);
+        dst += 32;
       }
+      return i;
+    }
 
-      // CryptBinaryToStringA includes the null terminator in the string.
-      // This removes it.
-      result.pop_back();
+    FLX_SIMD_TARGET("avx2")
+    static std::size_t Internal_DecodeAVX2(const uint8_t* src, std::size_t size, uint8_t* dst)
+    {
+      const __m256i lut_lo = _mm256_broadcastsi128_si256(_mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A));
+      const __m256i lut_hi = _mm256_broadcastsi128_si256(_mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10));
+      const __m256i lut_roll = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0));
+      const __m256i pack_shuffle = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+      );
+      const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
 
-      return result;
+      // writes 32 bytes per 24 decoded
+      std::size_t i = 0;
+      for (; i + 48 <= size; i += 32)
+      {
+        const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+
+        const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(input, 4), nibble_mask);
+        const __m256i lo_nibbles = _mm256_and_si256(input, nibble_mask);
+        const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256())) != -1) break;
+
+        const __m256i is_slash = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('/'));
+        const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(is_slash, hi_nibbles));
+        const __m256i values = _mm256_add_epi8(input, roll);
+
+        const __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        packed = _mm256_shuffle_epi8(packed, pack_shuffle);
+
+        // move the 12 bytes of the second lane next to the first
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), packed);
+        dst += 24;
+      }
+      return i;
     }
 
-    __FLX_API std::vector<BYTE> Decode(const std::string& data)
+    #pragma endregion
+
+  #endif
+
+    #pragma endregion
+
+    __FLX_API Implementation GetImplementation()
     {
-      // guard
-      if (data.empty()) return {};
+      return Internal_GetImplementation();
+    }
+
+    __FLX_API void SetImplementation(Implementation implementation)
+    {
+      // clamp to what the CPU supports
+      Implementation supported = Internal_DetectImplementation();
+      Internal_GetImplementation() = (implementation > supported) ? supported : implementation;
+    }
+
+    __FLX_API std::size_t Encode(const void* data, std::size_t size, char* out)
+    {
+      const uint8_t* src = static_cast<const uint8_t*>(data);
 
-      // validate
-      if (!Internal_ValidateBase64(data))
+      // the fast paths encode whole blocks, the tail is encoded by the scalar path
+      std::size_t encoded = 0;
+    #ifdef FLX_SIMD_X86
+      switch (Internal_GetImplementation())
       {
-        Log::Error("Base64 decoding: The input data is not a valid base64 string.");
-        return {};
+      case Implementation::AVX2: encoded = Internal_EncodeAVX2(src, size, out); break;
+      case Implementation::SSSE3: encoded = Internal_EncodeSSSE3(src, size, out); break;
+      default: break;
       }
+    #endif
 
-      DWORD data_size = static_cast<DWORD>(data.size() + 1);
-      DWORD size = 0;
+      Internal_EncodeScalar(src + encoded, size - encoded, out + encoded / 3 * 4);
+      return EncodedSize(size);
+    }
 
-      DWORD flags = CRYPT_STRING_BASE64;// | CRYPT_STRING_NOCRLF;
+    // Steps:
+    // 1. Strip the padding, a group can't be left with a single character
+    // 2. Decode whole blocks with the fast path
+    // 3. Decode the rest with the scalar path, this also reports invalid characters
+    __FLX_API bool Decode(const char* data, std::size_t size, void* out, std::size_t& out_size)
+    {
+      const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+      uint8_t* dst = static_cast<uint8_t*>(out);
+      out_size = 0;
 
-      // get size
-      if (!CryptStringToBinaryA(data.c_str(), data_size, flags, nullptr, &size, nullptr, nullptr))
+      // 1. Strip the padding
+      if (size % 4 == 0 && size != 0)
       {
-        Log::Error("Base64 decoding: Failed to get the size of the decoded data. " + Internal_GetErrorMessage());
-        return {};
+        if (src[size - 1] == '=') size--;
+        if (src[size - 1] == '=') size--;
       }
+      if (size % 4 == 1) return false;
 
-      // allocate
-      std::vector<BYTE> result(size);
+      // 2. Decode whole blocks with the fast path
+      std::size_t decoded = 0;
+    #ifdef FLX_SIMD_X86
+      switch (Internal_GetImplementation())
+      {
+      case Implementation::AVX2: decoded = Internal_DecodeAVX2(src, size, dst); break;
+      case Implementation::SSSE3: decoded = Internal_DecodeSSSE3(src, size, dst); break;
+      default: break;
+      }
+    #endif
 
-      // decode
-      if (!CryptStringToBinaryA(data.c_str(), data_size, flags, result.data(), &size, nullptr, nullptr))
+      // 3. Decode the rest with the scalar path
+      if (!Internal_DecodeScalar(src + decoded, size - decoded, dst + decoded / 4 * 3)) return false;
+
+      out_size = size / 4 * 3 + ((size % 4 != 0) ? size % 4 - 1 : 0);
+      return true;
+    }
+
+    __FLX_API std::string Encode(const void* data, std::size_t size)
+    {
+      std::string result(EncodedSize(size), '\0');
+      if (size != 0) Encode(data, size, &result[0]);
+      return result;
+    }
+
+    __FLX_API std::string Encode(const std::vector<BYTE>& data)
+    {
+      return Encode(data.data(), data.size());
+    }
+
+    __FLX_API std::vector<BYTE> Decode(const std::string& data)
+    {
+      // guard
+      if (data.empty()) return {};
+
+      std::vector<BYTE> result(DecodedSize(data.size()));
+      std::size_t size = 0;
+      if (!Decode(data.data(), data.size(), result.data(), size))
       {
-        Log::Error("Base64 decoding: Failed to decode the data. " + Internal_GetErrorMessage());
+        Log::Error("Base64 decoding: The input data is not a valid base64 string.");
         return {};
       }
 
+      result.resize(size);
       return result;
     }
 
   }
-}
\ No newline at end of file
+}
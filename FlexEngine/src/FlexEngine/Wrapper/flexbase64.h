@@ -1,16 +1,53 @@
 #pragma once
 
 #include "flx_api.h"
-#include "flx_windows.h" // BYTE
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#ifdef _WIN32
+#include "flx_windows.h" // BYTE
+#else
+typedef unsigned char BYTE;
+#endif
+
 namespace FlexEngine
 {
   namespace Base64
   {
 
+    // The codec picks the fastest implementation the CPU supports.
+    // SetImplementation is for tests and benchmarks,
+    // asking for an unsupported implementation falls back to the best supported one.
+    enum class Implementation
+    {
+      Scalar,
+      SSSE3,
+      AVX2
+    };
+
+    __FLX_API Implementation GetImplementation();
+    __FLX_API void SetImplementation(Implementation implementation);
+
+    // Number of characters needed to encode size bytes, including the padding
+    constexpr std::size_t EncodedSize(std::size_t size) { return (size + 2) / 3 * 4; }
+
+    // Upper bound of bytes decoded from size characters, the exact size depends on the padding
+    constexpr std::size_t DecodedSize(std::size_t size) { return (size + 3) / 4 * 3; }
+
+    // Encodes into a caller-provided buffer of at least EncodedSize(size) characters.
+    // No null terminator is written.
+    // Returns the number of characters written.
+    __FLX_API std::size_t Encode(const void* data, std::size_t size, char* out);
+
+    // Decodes into a caller-provided buffer of at least DecodedSize(size) bytes.
+    // The input is validated while it is decoded, padding is optional.
+    // Returns false if the input is not a valid base64 string.
+    __FLX_API bool Decode(const char* data, std::size_t size, void* out, std::size_t& out_size);
+
+    __FLX_API std::string Encode(const void* data, std::size_t size);
     __FLX_API std::string Encode(const std::vector<BYTE>& data);
     __FLX_API std::vector<BYTE> Decode(const std::string& data);
 
@@ -0,0 +1,158 @@
+#include "pch.h"
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include "flx_windows.h" // CreateFileW, CreateFileMappingW, MapViewOfFile
+#else
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <fcntl.h> // open
+#include <unistd.h> // close
+#endif
+
+namespace FlexEngine
+{
+
+  MappedFile::MappedFile(const Path& path)
+  {
+    Open(path);
+  }
+
+  MappedFile::~MappedFile()
+  {
+    Close();
+  }
+
+  MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data(other.m_data)
+    , m_size(other.m_size)
+    , m_file_handle(other.m_file_handle)
+    , m_mapping_handle(other.m_mapping_handle)
+  {
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_file_handle = nullptr;
+    other.m_mapping_handle = nullptr;
+  }
+
+  MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+  {
+    if (this == &other) return *this;
+
+    Close();
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_file_handle, other.m_file_handle);
+    std::swap(m_mapping_handle, other.m_mapping_handle);
+
+    return *this;
+  }
+
+  // Steps:
+  // 1. Open the file
+  // 2. Get the file size, empty files cannot be mapped
+  // 3. Map the whole file as read-only
+  bool MappedFile::Open(const Path& path)
+  {
+    FLX_FLOW_FUNCTION();
+
+    Close();
+
+    // guard
+    if (!path.is_file())
+    {
+      Log::Warning("Attempted to map a non-file: " + path.string());
+      return false;
+    }
+
+  #ifdef _WIN32
+
+    // 1. Open the file
+    HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+      Log::Error("Failed to open file for mapping: " + path.string());
+      return false;
+    }
+
+    // 2. Get the file size
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+      CloseHandle(file);
+      return false;
+    }
+
+    // 3. Map the whole file
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = (mapping != nullptr) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr)
+    {
+      Log::Error("Failed to map file: " + path.string());
+      if (mapping != nullptr) CloseHandle(mapping);
+      CloseHandle(file);
+      return false;
+    }
+
+    m_file_handle = file;
+    m_mapping_handle = mapping;
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<std::size_t>(file_size.QuadPart);
+
+  #else
+
+    // 1. Open the file
+    int file = open(path.string().c_str(), O_RDONLY);
+    if (file < 0)
+    {
+      Log::Error("Failed to open file for mapping: " + path.string());
+      return false;
+    }
+
+    // 2. Get the file size
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+      close(file);
+      return false;
+    }
+
+    // 3. Map the whole file
+    // the mapping stays valid after the file is closed
+    void* view = mmap(nullptr, static_cast<std::size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (view == MAP_FAILED)
+    {
+      Log::Error("Failed to map file: " + path.string());
+      return false;
+    }
+
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<std::size_t>(file_stat.st_size);
+
+  #endif
+
+    return true;
+  }
+
+  void MappedFile::Close()
+  {
+    // guard
+    if (m_data == nullptr) return;
+
+  #ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_mapping_handle));
+    CloseHandle(static_cast<HANDLE>(m_file_handle));
+  #else
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+  #endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_file_handle = nullptr;
+    m_mapping_handle = nullptr;
+  }
+
+}
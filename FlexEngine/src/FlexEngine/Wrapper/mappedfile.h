@@ -0,0 +1,55 @@
+#pragma once
+
+#include "flx_api.h"
+
+#include "path.h" // <filesystem> <iostream> <string> <exception> <unordered_map> <set>
+
+#include <cstdint>
+
+namespace FlexEngine
+{
+
+  // Read-only memory map of a file
+  // The file is mapped into the address space instead of being copied into a buffer,
+  // the OS pages the data in as it is accessed.
+  // The mapping is released when the object is destroyed.
+  //
+  // Usage:
+  // MappedFile mapped_file(path);
+  // if (mapped_file.IsOpen()) Parse(mapped_file.data(), mapped_file.size());
+  class __FLX_API MappedFile
+  {
+    const uint8_t* m_data = nullptr;
+    std::size_t m_size = 0;
+
+    // platform handles, only used on Windows
+    void* m_file_handle = nullptr;
+    void* m_mapping_handle = nullptr;
+
+  public:
+    MappedFile() = default;
+    explicit MappedFile(const Path& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Maps the file, closing the previous mapping.
+    // Returns false if the file could not be mapped.
+    bool Open(const Path& path);
+    void Close();
+
+    bool IsOpen() const { return m_data != nullptr; }
+
+    #pragma region Passthrough Functions
+
+    const uint8_t* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+    #pragma endregion
+
+  };
+
+}
@@ -39,6 +39,9 @@ namespace ChronoShift {
     const Vector3 color_player_slot = { 0.45f, 0.58f, 0.32f };
     const Vector3 color_enemy_slot = { 0.77f, 0.12f, 0.23f };
 
+    // record the slots and buttons so each entity is moved into its final archetype once
+    FlexECS::EntityCommandBuffer commands;
+
     for (int i = 0; i < m_slots.size(); i++)
     {
       bool is_player_slot = (i < 4);
@@ -46,22 +49,22 @@ namespace ChronoShift {
       if (is_player_slot) position = { 200.f + 120.f * i, 600.f };
       else                position = { 700.f + 120.f * (i - 4), 200.f };
 
-      FlexECS::Entity slot = FlexECS::Scene::CreateEntity();
-      slot.AddComponent<BattleSlot>({ i, FlexECS::Entity::Null });
-      slot.AddComponent<OnHover>({});
-      slot.AddComponent<OnClick>({});
-      slot.AddComponent<IsActive>({ true });
-      slot.AddComponent<Position>({ position });
-      slot.AddComponent<Scale>({ { 100,100 } });
-      slot.AddComponent<ZIndex>({ 9 });
-      slot.AddComponent<Sprite>({
+      FlexECS::EntityID slot = commands.CreateEntity();
+      commands.AddComponent<BattleSlot>(slot, { i, FlexECS::Entity::Null });
+      commands.AddComponent<OnHover>(slot, {});
+      commands.AddComponent<OnClick>(slot, {});
+      commands.AddComponent<IsActive>(slot, { true });
+      commands.AddComponent<Position>(slot, { position });
+      commands.AddComponent<Scale>(slot, { { 100,100 } });
+      commands.AddComponent<ZIndex>(slot, { 9 });
+      commands.AddComponent<Sprite>(slot, {
         scene->Internal_StringStorage_New(R"()"),
         is_player_slot ? color_player_slot : color_enemy_slot,
         Vector3::Zero,
         Vector3::One,
         Renderer2DProps::Alignment_Center
        });
-      slot.AddComponent<Shader>({ scene->Internal_StringStorage_New(R"(\shaders\texture)") });
+      commands.AddComponent<Shader>(slot, { scene->Internal_StringStorage_New(R"(\shaders\texture)") });
 
       m_slots[i] = slot;
     }
@@ -70,23 +73,25 @@ namespace ChronoShift {
     {
       Vector2 position = { 900.f, 450.f + (80.f * i) };
 
-      FlexECS::Entity move_button = FlexECS::Scene::CreateEntity();
-      move_button.AddComponent<MoveButton>({ i });
-      move_button.AddComponent<OnHover>({});
-      move_button.AddComponent<OnClick>({});
-      move_button.AddComponent<IsActive>({ false });
-      move_button.AddComponent<Position>({ position });
-      move_button.AddComponent<Scale>({ { 350,70 } });
-      move_button.AddComponent<ZIndex>({ 9 });
-      move_button.AddComponent<Sprite>({
+      FlexECS::EntityID move_button = commands.CreateEntity();
+      commands.AddComponent<MoveButton>(move_button, { i });
+      commands.AddComponent<OnHover>(move_button, {});
+      commands.AddComponent<OnClick>(move_button, {});
+      commands.AddComponent<IsActive>(move_button, { false });
+      commands.AddComponent<Position>(move_button, { position });
+      commands.AddComponent<Scale>(move_button, { { 350,70 } });
+      commands.AddComponent<ZIndex>(move_button, { 9 });
+      commands.AddComponent<Sprite>(move_button, {
         scene->Internal_StringStorage_New(R"()"),
         Vector3::One,
         Vector3::Zero,
         Vector3::One - Vector3(0.10f * i, 0.10f * i , 0.10f * i),
         Renderer2DProps::Alignment_Center
        });
-      move_button.AddComponent<Shader>({ scene->Internal_StringStorage_New(R"(\shaders\texture)") });
+      commands.AddComponent<Shader>(move_button, { scene->Internal_StringStorage_New(R"(\shaders\texture)") });
     }
+
+    commands.Playback();
   }
 
   void BattleSystem::SetMovesForWeapon(FlexECS::Entity weapon)
@@ -134,8 +139,8 @@ namespace ChronoShift {
     }
     std::cout << "\n";
 
-    FlexECS::Entity battle_state = FlexECS::Scene::GetActiveScene()->View<BattleState>()[0];
-    battle_state.GetComponent<BattleState>()->phase = BP_PROCESSING;
+    BattleState& battle_state = *FlexECS::Scene::GetActiveSceneRef().GetResource<BattleState>();
+    battle_state.phase = BP_PROCESSING;
   }
 
   void BattleSystem::UpdateSpeedStack()
@@ -151,21 +156,21 @@ namespace ChronoShift {
     }
     std::cout << "\n";
 
-    FlexECS::Entity battle_state = FlexECS::Scene::GetActiveScene()->View<BattleState>()[0];
-    battle_state.GetComponent<BattleState>()->active_character = m_speedstack.front();
+    BattleState& battle_state = *FlexECS::Scene::GetActiveSceneRef().GetResource<BattleState>();
+    battle_state.active_character = m_speedstack.front();
 
     if (m_speedstack.front().GetComponent<IsPlayer>()->is_player) {
-      battle_state.GetComponent<BattleState>()->phase = BP_PLAYER_TURN;
+      battle_state.phase = BP_PLAYER_TURN;
     }
     else {
-      battle_state.GetComponent<BattleState>()->phase = BP_ENEMY_TURN;
+      battle_state.phase = BP_ENEMY_TURN;
     }
   }
 
   void BattleSystem::Update()
   {
-    FlexECS::Entity battle_state = FlexECS::Scene::GetActiveScene()->View<BattleState>()[0];
-    int battle_phase = battle_state.GetComponent<BattleState>()->phase;
+    BattleState& battle_state = *FlexECS::Scene::GetActiveSceneRef().GetResource<BattleState>();
+    int battle_phase = battle_state.phase;
 
     if (battle_phase == BP_PROCESSING) {
       UpdateSpeedStack();
@@ -177,9 +182,9 @@ namespace ChronoShift {
     else if (battle_phase == BP_ENEMY_TURN) {
       m_speedstack.front().GetComponent<Action>()->move_to_use = 
         static_cast<FlexECS::Entity>(m_speedstack.front().GetComponent<CharacterWeapon>()->equipped_weapon).GetComponent<Weapon>()->weapon_move_one;
-      battle_state.GetComponent<BattleState>()->current_target_count = 1;
-      battle_state.GetComponent<BattleState>()->target_one = 0;
-      battle_state.GetComponent<BattleState>()->phase = BP_MOVE_EXECUTION;
+      battle_state.current_target_count = 1;
+      battle_state.target_one = 0;
+      battle_state.phase = BP_MOVE_EXECUTION;
 
     }
     else if (battle_phase == BP_MOVE_TARGET_SELECTION) {
@@ -193,12 +198,12 @@ namespace ChronoShift {
   void BattleSystem::PlayerMoveSelection()
   {
     FlexECS::Entity move_to_use = FlexECS::Entity::Null;
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, MoveButton>()) {
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, MoveButton>()) {
       entity.GetComponent<IsActive>()->is_active = true;
     }
     //move selection system
     GetMoveSelection();
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<OnClick, MoveButton>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<OnClick, MoveButton>())
     {
       auto& click_status = entity.GetComponent<OnClick>()->is_clicked;
       if (click_status == true)
@@ -224,16 +229,16 @@ namespace ChronoShift {
 
     m_speedstack.front().GetComponent<Action>()->move_to_use = move_to_use;
 
-    FlexECS::Entity battle_state = FlexECS::Scene::GetActiveScene()->View<BattleState>()[0];
-    battle_state.GetComponent<BattleState>()->phase = BP_MOVE_TARGET_SELECTION;
+    BattleState& battle_state = *FlexECS::Scene::GetActiveSceneRef().GetResource<BattleState>();
+    battle_state.phase = BP_MOVE_TARGET_SELECTION;
 
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, MoveButton>()) {
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, MoveButton>()) {
       entity.GetComponent<IsActive>()->is_active = false;
     }
 
 
     //printing info
-    FlexECS::Entity player = battle_state.GetComponent<BattleState>()->active_character;
+    FlexECS::Entity player = battle_state.active_character;
     FlexECS::Entity selected_move = player.GetComponent<Action>()->move_to_use;
     Move move = MoveRegistry::GetMove(selected_move.GetComponent<MoveID>()->move_name);
     std::cout << "Move Selected: " << move.name << std::endl;
@@ -241,17 +246,17 @@ namespace ChronoShift {
 
   void BattleSystem::PlayerTargetSelection()
   {
-    FlexECS::Entity battle_state = FlexECS::Scene::GetActiveScene()->View<BattleState>()[0];
-    auto& target_count = battle_state.GetComponent<BattleState>()->current_target_count;
+    BattleState& battle_state = *FlexECS::Scene::GetActiveSceneRef().GetResource<BattleState>();
+    auto& target_count = battle_state.current_target_count;
 
-    FlexECS::Entity player = battle_state.GetComponent<BattleState>()->active_character;
+    FlexECS::Entity player = battle_state.active_character;
     FlexECS::Entity move_to_use = player.GetComponent<Action>()->move_to_use;
     Move move = MoveRegistry::GetMove(move_to_use.GetComponent<MoveID>()->move_name);
 
     if (target_count < move.target_count) {
       GetTargetSelection();
 
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<OnClick, BattleSlot>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<OnClick, BattleSlot>())
       {
         auto& click_status = entity.GetComponent<OnClick>()->is_clicked;
         if (click_status == true)
@@ -260,26 +265,26 @@ namespace ChronoShift {
           target_count += 1;
           switch (target_count) {
           case 1:
-            battle_state.GetComponent<BattleState>()->target_one = selection;
+            battle_state.target_one = selection;
             break;
           case 2:
-            battle_state.GetComponent<BattleState>()->target_two = selection;
+            battle_state.target_two = selection;
             break;
           case 3:
-            battle_state.GetComponent<BattleState>()->target_three = selection;
+            battle_state.target_three = selection;
             break;
           case 4:
-            battle_state.GetComponent<BattleState>()->target_four = selection;
+            battle_state.target_four = selection;
             break;
           case 5:
-            battle_state.GetComponent<BattleState>()->target_five = selection;
+            battle_state.target_five = selection;
             break;
           }
         }
       }
     }
     if (target_count >= move.target_count) {
-      battle_state.GetComponent<BattleState>()->phase = BP_MOVE_EXECUTION;
+      battle_state.phase = BP_MOVE_EXECUTION;
     }
   }
 
@@ -288,8 +293,8 @@ namespace ChronoShift {
   void BattleSystem::ExecuteMove()
   {
     //get the move user
-    FlexECS::Entity battle_state = FlexECS::Scene::GetActiveScene()->View<BattleState>()[0];
-    FlexECS::Entity user = battle_state.GetComponent<BattleState>()->active_character;
+    BattleState& battle_state = *FlexECS::Scene::GetActiveSceneRef().GetResource<BattleState>();
+    FlexECS::Entity user = battle_state.active_character;
     FlexECS::Entity move_to_use = user.GetComponent<Action>()->move_to_use;
     Move move = MoveRegistry::GetMove(move_to_use.GetComponent<MoveID>()->move_name);
 
@@ -299,15 +304,15 @@ namespace ChronoShift {
     {
       switch (move.target_count) {
       case 5:
-        targets.insert(targets.begin(), static_cast<FlexECS::Entity>(m_slots[battle_state.GetComponent<BattleState>()->target_five].GetComponent<BattleSlot>()->character));
+        targets.insert(targets.begin(), static_cast<FlexECS::Entity>(m_slots[battle_state.target_five].GetComponent<BattleSlot>()->character));
       case 4:
-        targets.insert(targets.begin(), static_cast<FlexECS::Entity>(m_slots[battle_state.GetComponent<BattleState>()->target_four].GetComponent<BattleSlot>()->character));
+        targets.insert(targets.begin(), static_cast<FlexECS::Entity>(m_slots[battle_state.target_four].GetComponent<BattleSlot>()->character));
       case 3:
-        targets.insert(targets.begin(), static_cast<FlexECS::Entity>(m_slots[battle_state.GetComponent<BattleState>()->target_three].GetComponent<BattleSlot>()->character));
+        targets.insert(targets.begin(), static_cast<FlexECS::Entity>(m_slots[battle_state.target_three].GetComponent<BattleSlot>()->character));
       case 2:
-        targets.insert(targets.begin(), static_cast<FlexECS::Entity>(m_slots[battle_state.GetComponent<BattleState>()->target_two].GetComponent<BattleSlot>()->character));
+        targets.insert(targets.begin(), static_cast<FlexECS::Entity>(m_slots[battle_state.target_two].GetComponent<BattleSlot>()->character));
       case 1:
-        targets.insert(targets.begin(), static_cast<FlexECS::Entity>(m_slots[battle_state.GetComponent<BattleState>()->target_one].GetComponent<BattleSlot>()->character));
+        targets.insert(targets.begin(), static_cast<FlexECS::Entity>(m_slots[battle_state.target_one].GetComponent<BattleSlot>()->character));
         break;
       }
     }
@@ -344,9 +349,9 @@ namespace ChronoShift {
         << "  Spd: " << entity.GetComponent<CharacterSpeed>()->current_speed << std::endl;
     }
     std::cout << "\n";
-    battle_state.GetComponent<BattleState>()->current_target_count = 0;
-    battle_state.GetComponent<BattleState>()->active_character = FlexECS::Entity::Null;
-    battle_state.GetComponent<BattleState>()->phase = BP_PROCESSING;
+    battle_state.current_target_count = 0;
+    battle_state.active_character = FlexECS::Entity::Null;
+    battle_state.phase = BP_PROCESSING;
   }
 
 }
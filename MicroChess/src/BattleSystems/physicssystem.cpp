@@ -5,6 +5,7 @@
 #include <FlexEngine.h>
 
 #include <vector>
+#include <unordered_map>
 #include <cmath>
 #include <algorithm>
 
@@ -15,83 +16,122 @@ namespace ChronoShift
 
 	void RecomputeBounds(FlexECS::Entity entity) 
 	{
-		auto& position = entity.GetComponent<Position>()->position;
-		auto& scale = entity.GetComponent<Scale>()->scale;
-		auto& size = entity.GetComponent<BoundingBox2D>()->size;
-		entity.GetComponent<BoundingBox2D>()->max.x = position.x + scale.x / 2 * size.x;
-		entity.GetComponent<BoundingBox2D>()->max.y = position.y + scale.y / 2 * size.y;
-		entity.GetComponent<BoundingBox2D>()->min.x = position.x - scale.x / 2 * size.x;
-		entity.GetComponent<BoundingBox2D>()->min.y = position.y - scale.y / 2 * size.y;
+		auto& position = entity.GetComponent<const Position>()->position;
+		auto& scale = entity.GetComponent<const Scale>()->scale;
+		auto& bounding_box = *entity.GetComponent<BoundingBox2D>();
+		bounding_box.max.x = position.x + scale.x / 2 * bounding_box.size.x;
+		bounding_box.max.y = position.y + scale.y / 2 * bounding_box.size.y;
+		bounding_box.min.x = position.x - scale.x / 2 * bounding_box.size.x;
+		bounding_box.min.y = position.y - scale.y / 2 * bounding_box.size.y;
 	}
 
-	void UpdatePositions() 
+	void StorePreviousPositions()
 	{
-		float dt = FlexEngine::Application::GetCurrentWindow()->GetDeltaTime();
-		for (auto& entity : FlexECS::Scene::GetActiveScene()->View<Position, Rigidbody>())
-		{
-			auto& velocity = entity.GetComponent<Rigidbody>()->velocity;
-			auto& position = entity.GetComponent<Position>()->position;
+		FlexECS::Scene::GetActiveSceneRef().ParallelEach<PreviousPosition, const Position>(
+			[](PreviousPosition& previous_position, const Position& position)
+			{
+				previous_position.position = position.position;
+			}
+		);
+	}
 
-			position.x += velocity.x * dt;
-			position.y += velocity.y * dt;
-		}
+	void UpdatePositions() 
+	{
+		float dt = FlexEngine::Application::GetCurrentWindow()->GetFixedDeltaTime();
+		FlexECS::Scene::GetActiveSceneRef().ParallelEach<Position, const Rigidbody>(
+			[dt](Position& position, const Rigidbody& rigidbody)
+			{
+				position.position.x += rigidbody.velocity.x * dt;
+				position.position.y += rigidbody.velocity.y * dt;
+			}
+		);
 	}
 	
 	void UpdateBounds()
 	{
-		for (auto& entity : FlexECS::Scene::GetActiveScene()->View<Position, Scale, Rigidbody, BoundingBox2D>()) 
-		{
-			auto& position = entity.GetComponent<Position>()->position;
-			auto& scale = entity.GetComponent<Scale>()->scale;
-			auto& size = entity.GetComponent<BoundingBox2D>()->size;
-			entity.GetComponent<BoundingBox2D>()->max.x = position.x + scale.x / 2 * size.x;
-			entity.GetComponent<BoundingBox2D>()->max.y = position.y + scale.y / 2 * size.y;
-			entity.GetComponent<BoundingBox2D>()->min.x = position.x - scale.x / 2 * size.x;
-			entity.GetComponent<BoundingBox2D>()->min.y = position.y - scale.y / 2 * size.y;
-		}
-
+		// Only the chunks where the position, scale or size changed since the last update are rebuilt
+		FlexECS::Scene::GetActiveSceneRef().ParallelEach<FlexECS::Changed<const Position>, FlexECS::Changed<const Scale>, const Rigidbody, FlexECS::Changed<BoundingBox2D>>(
+			[](const Position& position, const Scale& scale, const Rigidbody&, BoundingBox2D& bounding_box)
+			{
+				auto& size = bounding_box.size;
+				bounding_box.max.x = position.position.x + scale.scale.x / 2 * size.x;
+				bounding_box.max.y = position.position.y + scale.scale.y / 2 * size.y;
+				bounding_box.min.x = position.position.x - scale.scale.x / 2 * size.x;
+				bounding_box.min.y = position.position.y - scale.scale.y / 2 * size.y;
+			}
+		);
 	}
 
+	// The bodies are copied into the broadphase every frame.
+	// Each entity keeps its proxy so the sorted order carries over between frames.
+	static FlexEngine::Physics::Broadphase broadphase;
+	static std::unordered_map<FlexECS::EntityID, FlexEngine::Physics::Broadphase::Proxy> proxies {};
+	static std::vector<uint64_t> proxy_last_seen {}; // indexed by proxy
+	static uint64_t sync_frame = 0;
+
 	void FindCollisions() 
 	{
+		using FlexEngine::Physics::Broadphase;
+
 		collisions.clear();
-		
-		for (auto& entity_a : FlexECS::Scene::GetActiveScene()->View<Position, Scale, Rigidbody, BoundingBox2D>())
-		{
-			if(entity_a.GetComponent<Rigidbody>()->is_static) continue;
-			//construct aabb
-			auto& max_a = entity_a.GetComponent<BoundingBox2D>()->max;
-			auto& min_a = entity_a.GetComponent<BoundingBox2D>()->min;
-			
-			for (auto& entity_b : FlexECS::Scene::GetActiveScene()->View<Position, Scale, Rigidbody, BoundingBox2D>()) 
-			{
-				if (entity_a == entity_b) continue;
+		sync_frame++;
 
-				auto& max_b = entity_b.GetComponent<BoundingBox2D>()->max;
-				auto& min_b = entity_b.GetComponent<BoundingBox2D>()->min;
+		// add the new bodies and move the existing ones
+		FlexECS::Scene::GetActiveSceneRef().EachChunk<const Position, const Scale, const Rigidbody, const BoundingBox2D>(
+			[](std::size_t count, const FlexECS::EntityID* entities, const Position*, const Scale*, const Rigidbody* rigidbodies, const BoundingBox2D* bounding_boxes)
+			{
+				for (std::size_t i = 0; i < count; i++)
+				{
+					auto [it, is_new] = proxies.try_emplace(entities[i], Broadphase::NO_PROXY);
+					if (is_new)
+					{
+						it->second = broadphase.Add(bounding_boxes[i].min, bounding_boxes[i].max, entities[i], rigidbodies[i].is_static);
+					}
+					else
+					{
+						broadphase.Update(it->second, bounding_boxes[i].min, bounding_boxes[i].max);
+						broadphase.SetStatic(it->second, rigidbodies[i].is_static);
+					}
+
+					if (proxy_last_seen.size() <= it->second) proxy_last_seen.resize(it->second + 1);
+					proxy_last_seen[it->second] = sync_frame;
+				}
+			}
+		);
 
-				//AABB check
-				if (max_a.x < min_b.x || max_a.y < min_b.y || min_a.x > max_b.x || min_a.y > max_b.y) continue;
-				else collisions.push_back({ entity_a, entity_b });
+		// remove the bodies that were destroyed or lost a component
+		for (auto it = proxies.begin(); it != proxies.end();)
+		{
+			if (proxy_last_seen[it->second] == sync_frame)
+			{
+				++it;
+				continue;
 			}
+
+			broadphase.Remove(it->second);
+			it = proxies.erase(it);
 		}
 
+		// each pair is reported once and static-static pairs are skipped
+		for (const Broadphase::Pair& pair : broadphase.FindPairs())
+		{
+			collisions.push_back({ FlexECS::Entity(broadphase.GetUserData(pair.a)), FlexECS::Entity(broadphase.GetUserData(pair.b)) });
+		}
 	}
 
 	void ResolveCollisions() 
 	{
-		float dt = FlexEngine::Application::GetCurrentWindow()->GetDeltaTime();
 		for (auto collision : collisions)
 		{
-			auto& a_velocity = collision.first.GetComponent<Rigidbody>()->velocity;
+			auto& a_velocity = collision.first.GetComponent<const Rigidbody>()->velocity;
 			auto& a_position = collision.first.GetComponent<Position>()->position;
-			auto& b_velocity = collision.second.GetComponent<Rigidbody>()->velocity;
+			auto& b_velocity = collision.second.GetComponent<const Rigidbody>()->velocity;
 			auto& b_position = collision.second.GetComponent<Position>()->position;
 
-			auto& a_max = collision.first.GetComponent<BoundingBox2D>()->max;
-			auto& a_min = collision.first.GetComponent<BoundingBox2D>()->min;
-			auto& b_max = collision.second.GetComponent<BoundingBox2D>()->max;
-			auto& b_min = collision.second.GetComponent<BoundingBox2D>()->min;
+			auto& a_max = collision.first.GetComponent<const BoundingBox2D>()->max;
+			auto& a_min = collision.first.GetComponent<const BoundingBox2D>()->min;
+			auto& b_max = collision.second.GetComponent<const BoundingBox2D>()->max;
+			auto& b_min = collision.second.GetComponent<const BoundingBox2D>()->min;
 
 			//Check if already resolved
 			if (a_max.x < b_min.x || a_max.y < b_min.y || a_min.x > b_max.x || a_min.y > b_max.y) continue;
@@ -114,7 +154,7 @@ namespace ChronoShift
 			const float down = b_max.y - a_min.y;
 			const float largest = std::min({ left, right, up, down });
 
-			if (!(collision.first.GetComponent<Rigidbody>()->is_static))
+			if (!(collision.first.GetComponent<const Rigidbody>()->is_static))
 			{
 				if (largest == left) {
 					a_position.x -= x_penetration;
@@ -131,7 +171,7 @@ namespace ChronoShift
 				RecomputeBounds(collision.first);
 			}
 			
-			if (!(collision.second.GetComponent<Rigidbody>()->is_static))
+			if (!(collision.second.GetComponent<const Rigidbody>()->is_static))
 			{
 				if (largest == left) {
 					b_position.x += x_penetration;
@@ -153,11 +193,24 @@ namespace ChronoShift
 
 	void UpdatePhysicsSystem()
 	{
-		UpdatePositions();
-		UpdateBounds();
-		FindCollisions();
-		ResolveCollisions();
-
+		// the scheduler orders the systems by the components they touch,
+		// systems that don't share components run in parallel
+		static FlexECS::SystemScheduler scheduler = []()
+		{
+			using FlexECS::Read;
+			using FlexECS::Write;
+
+			FlexECS::SystemScheduler physics_scheduler;
+			physics_scheduler.AddSystem<Read<Position>, Write<PreviousPosition>>("StorePreviousPositions", StorePreviousPositions);
+			physics_scheduler.AddSystem<Read<Rigidbody>, Write<Position>>("UpdatePositions", UpdatePositions);
+			physics_scheduler.AddSystem<Read<Position, Scale, Rigidbody>, Write<BoundingBox2D>>("UpdateBounds", UpdateBounds);
+			// collisions is only used by ResolveCollisions, which conflicts with this system through Position
+			physics_scheduler.AddSystem<Read<Position, Scale, Rigidbody, BoundingBox2D>>("FindCollisions", FindCollisions);
+			physics_scheduler.AddSystem<Read<Rigidbody>, Write<Position, BoundingBox2D>>("ResolveCollisions", ResolveCollisions);
+			return physics_scheduler;
+		}();
+
+		scheduler.Run();
 	}
 
 }
\ No newline at end of file
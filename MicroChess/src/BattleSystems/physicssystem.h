@@ -4,7 +4,8 @@
 namespace ChronoShift
 {
 	/*
-	Just runs the physics system.
+	Runs one fixed step of the physics system.
+	Call it from Layer::FixedUpdate, it steps with the window's fixed delta time.
 	Needs: 
 	> Rigidbody component on the entity
 	> Position, Scale
@@ -12,6 +13,8 @@ namespace ChronoShift
 	
 	- Updates positions based on rigidbody.velocity
 	- Finds and resolves collisions
+		- Overlapping pairs come from the engine broadphase (sweep and prune),
+			each pair once
 		- No elasticity or anything, just pushes back the 
 			minimum amount to avoid overlap
 
@@ -14,7 +14,7 @@ namespace ChronoShift
 		Vector2 mouse_position = Input::GetMousePosition();
 		bool mouse_clicked = Input::GetMouseButtonDown(GLFW_MOUSE_BUTTON_LEFT);
 
-		for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, Position, Scale, OnHover, BattleSlot>())
+		for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, Position, Scale, OnHover, BattleSlot>())
 		{
 			if (!entity.GetComponent<IsActive>()->is_active) continue;
 
@@ -48,7 +48,7 @@ namespace ChronoShift
 		}
 	
   
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, Position, Scale, OnHover, OnClick, BattleSlot>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, Position, Scale, OnHover, OnClick, BattleSlot>())
     {
       if (!entity.GetComponent<IsActive>()->is_active) continue;
 
@@ -75,7 +75,7 @@ namespace ChronoShift
     Vector2 mouse_position = Input::GetMousePosition();
     bool mouse_clicked = Input::GetMouseButtonDown(GLFW_MOUSE_BUTTON_LEFT);
 
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, Position, Scale, OnHover, MoveButton>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, Position, Scale, OnHover, MoveButton>())
     {
       if (!entity.GetComponent<IsActive>()->is_active) continue;
 
@@ -109,7 +109,7 @@ namespace ChronoShift
     }
 
 
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, Position, Scale, OnHover, OnClick, MoveButton>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, Position, Scale, OnHover, OnClick, MoveButton>())
     {
       if (!entity.GetComponent<IsActive>()->is_active) continue;
 
@@ -25,7 +25,7 @@ namespace ChronoShift
   FLX_REFL_REGISTER_END;*/
 
   FLX_REFL_REGISTER_START(CharacterStatus)
-    FLX_REFL_REGISTER_PROPERTY(character_status)
+    FLX_REFL_REGISTER_STRING_INDEX(character_status)
   FLX_REFL_REGISTER_END;
 
   #pragma endregion
@@ -84,8 +84,8 @@ namespace ChronoShift
   #pragma endregion
 
   FLX_REFL_REGISTER_START(ChronoGear)
-    FLX_REFL_REGISTER_PROPERTY(chrono_gear_name)
-    FLX_REFL_REGISTER_PROPERTY(chrono_gear_description)
+    FLX_REFL_REGISTER_STRING_INDEX(chrono_gear_name)
+    FLX_REFL_REGISTER_STRING_INDEX(chrono_gear_description)
     FLX_REFL_REGISTER_PROPERTY(main_stat)
     FLX_REFL_REGISTER_PROPERTY(sub_stat_one)
     FLX_REFL_REGISTER_PROPERTY(sub_stat_two)
@@ -93,8 +93,8 @@ namespace ChronoShift
   FLX_REFL_REGISTER_END;
 
   FLX_REFL_REGISTER_START(Weapon)
-    FLX_REFL_REGISTER_PROPERTY(weapon_name)
-    FLX_REFL_REGISTER_PROPERTY(weapon_description)
+    FLX_REFL_REGISTER_STRING_INDEX(weapon_name)
+    FLX_REFL_REGISTER_STRING_INDEX(weapon_description)
     FLX_REFL_REGISTER_PROPERTY(weapon_type)
     FLX_REFL_REGISTER_PROPERTY(weapon_move_one)
     FLX_REFL_REGISTER_PROPERTY(weapon_move_two)
@@ -102,7 +102,7 @@ namespace ChronoShift
   FLX_REFL_REGISTER_END;
 
   FLX_REFL_REGISTER_START(Stat)
-    FLX_REFL_REGISTER_PROPERTY(stat_name)
+    FLX_REFL_REGISTER_STRING_INDEX(stat_name)
     FLX_REFL_REGISTER_PROPERTY(base_stat_value)
     FLX_REFL_REGISTER_PROPERTY(current_stat_value)
   FLX_REFL_REGISTER_END;
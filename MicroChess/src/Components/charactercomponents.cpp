@@ -6,7 +6,7 @@ namespace ChronoShift {
     FLX_REFL_REGISTER_END;
 
   FLX_REFL_REGISTER_START(CharacterName)
-    FLX_REFL_REGISTER_PROPERTY(character_name)
+    FLX_REFL_REGISTER_STRING_INDEX(character_name)
     FLX_REFL_REGISTER_END;
 
   FLX_REFL_REGISTER_START(CharacterSpeed)
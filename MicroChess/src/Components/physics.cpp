@@ -23,4 +23,8 @@ namespace ChronoShift
     FLX_REFL_REGISTER_PROPERTY(is_static)
   FLX_REFL_REGISTER_END;
 
+  FLX_REFL_REGISTER_START(PreviousPosition)
+    FLX_REFL_REGISTER_PROPERTY(position)
+  FLX_REFL_REGISTER_END;
+
 }
@@ -41,4 +41,14 @@ namespace ChronoShift
     Vector2 velocity;
     bool is_static;
   };
+
+  // Position before the last physics step.
+  // The renderer blends it with the current position by the interpolation alpha,
+  // so bodies move smoothly when the frame rate and the physics rate differ.
+  // Bodies without it are drawn at their current position.
+  class PreviousPosition
+  { FLX_REFL_SERIALIZABLE
+  public:
+    Vector2 position = Vector2::Zero;
+  };
 }
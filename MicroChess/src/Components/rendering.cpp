@@ -33,11 +33,11 @@ namespace ChronoShift
   FLX_REFL_REGISTER_END;
 
   FLX_REFL_REGISTER_START(Shader)
-    FLX_REFL_REGISTER_PROPERTY(shader)
+    FLX_REFL_REGISTER_STRING_INDEX(shader)
   FLX_REFL_REGISTER_END;
   
   FLX_REFL_REGISTER_START(Sprite)
-    FLX_REFL_REGISTER_PROPERTY(texture)
+    FLX_REFL_REGISTER_STRING_INDEX(texture)
     FLX_REFL_REGISTER_PROPERTY(color)
     FLX_REFL_REGISTER_PROPERTY(color_to_add)
     FLX_REFL_REGISTER_PROPERTY(color_to_multiply)
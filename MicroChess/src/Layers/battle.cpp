@@ -221,8 +221,7 @@ namespace ChronoShift {
 
     MoveRegistry::RegisterMoves();
 
-    FlexECS::Entity battle_state = FlexECS::Scene::CreateEntity("BattleState");
-    battle_state.AddComponent<BattleState>({});
+    FlexECS::Scene::GetActiveSceneRef().SetResource<BattleState>({});
 
     m_battlesystem.BeginBattle();
   }
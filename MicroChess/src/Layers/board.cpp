@@ -164,7 +164,7 @@ namespace MicroChess
   void BoardLayer::Update()
   {
     // display a custom cursor
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, CustomCursor, Position, Sprite>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, CustomCursor, Position, Sprite>())
     {
       auto& is_active = entity.GetComponent<IsActive>()->is_active;
       auto& cursor = entity.GetComponent<CustomCursor>()->type;
@@ -212,7 +212,7 @@ namespace MicroChess
       default: break;
       }
 
-      texture = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_New(texture_path);
+      texture = FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_New(texture_path);
 
       position = Input::GetCursorPosition() + Vector2(7, 12);
     }
@@ -241,14 +241,14 @@ namespace MicroChess
 
     //Altering entities scale and rotation while game is in debug mode
     // TEST ON EVERYTHING
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, Scale, Rotation>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, Scale, Rotation>())
     {
         if (!entity.GetComponent<IsActive>()->is_active) continue;
 
         //Search function for a specific object to test and NOT everything
         auto entity_name_component = entity.GetComponent<EntityName>();
         //Change "" to whatever object or comment the line to affect everything
-        if ("test" != FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(*entity_name_component)) continue;
+        if ("test" != FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(*entity_name_component)) continue;
         
         auto& scale = entity.GetComponent<Scale>()->scale;
         auto& rotation = entity.GetComponent<Rotation>()->rotation;
@@ -264,7 +264,7 @@ namespace MicroChess
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Mouse Interactions
     // make the piece bigger when hovered
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, OnHover, Scale>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, OnHover, Scale>())
     {
       if (!entity.GetComponent<IsActive>()->is_active) continue;
     
@@ -277,7 +277,7 @@ namespace MicroChess
 
     // remove the piece when clicked
     FunctionQueue destroy_queue;
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, OnClick>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, OnClick>())
     {
       if (!entity.GetComponent<IsActive>()->is_active) continue;
     
@@ -285,7 +285,7 @@ namespace MicroChess
     
       if (on_click->is_clicked)
       {
-        destroy_queue.Insert({ [entity]() { FlexECS::Scene::GetActiveScene()->DestroyEntity(entity); }, "", 0 });
+        destroy_queue.Insert({ [entity]() { FlexECS::Scene::GetActiveSceneRef().DestroyEntity(entity); }, "", 0 });
       }
     }
     destroy_queue.Flush();
@@ -22,7 +22,7 @@ namespace ChronoShift
     ImGui::ShowDemoWindow();
 
     int i = 0;
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<BoundingBox2D>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<BoundingBox2D>())
     {
 
       const Vector3& max = entity.GetComponent<BoundingBox2D>()->max;
@@ -28,6 +28,7 @@ namespace ChronoShift {
         player1.AddComponent<BoundingBox2D>({ });
         player1.AddComponent<IsActive>({ true });
         player1.AddComponent<Position>({ {200, 600} });
+        player1.AddComponent<PreviousPosition>({ {200, 600} });
         player1.AddComponent<Rotation>({ });
         player1.AddComponent<Scale>({ { 100,100 } });
         player1.AddComponent<Transform>({ {} });
@@ -66,6 +67,7 @@ namespace ChronoShift {
         box.AddComponent<BoundingBox2D>({ });
         box.AddComponent<IsActive>({ true });
         box.AddComponent<Position>({ {350, 500 } });
+        box.AddComponent<PreviousPosition>({ {350, 500 } });
         box.AddComponent<Rotation>({ });
         box.AddComponent<Scale>({ { 150,150 } });
         box.AddComponent<Transform>({ {} });
@@ -203,9 +205,14 @@ namespace ChronoShift {
     FLX_FLOW_ENDSCOPE();
   }
 
+  void OverworldLayer::FixedUpdate()
+  {
+    UpdatePhysicsSystem();
+  }
+
   void OverworldLayer::Update()
   {
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<CharacterInput>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<CharacterInput>())
     {
       entity.GetComponent<CharacterInput>()->up = Input::GetKey(GLFW_KEY_W);
       entity.GetComponent<CharacterInput>()->down = Input::GetKey(GLFW_KEY_S);
@@ -213,7 +220,7 @@ namespace ChronoShift {
       entity.GetComponent<CharacterInput>()->right = Input::GetKey(GLFW_KEY_D);
     }
 
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<CharacterInput, Rigidbody>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<CharacterInput, Rigidbody>())
     {
       auto& velocity = entity.GetComponent<Rigidbody>()->velocity;
       velocity.x = 0.0f;
@@ -264,14 +271,14 @@ namespace ChronoShift {
 
     //Altering entities scale and rotation while game is in debug mode
     // TEST ON EVERYTHING
-    for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, Scale, Rotation>())
+    for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, Scale, Rotation>())
     {
         if (!entity.GetComponent<IsActive>()->is_active) continue;
 
         //Search function for a specific object to test and NOT everything
         auto entity_name_component = entity.GetComponent<EntityName>();
         //Change "" to whatever object or comment the line to affect everything
-        if ("box" != FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(*entity_name_component)) continue;
+        if ("box" != FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(*entity_name_component)) continue;
 
         auto& scale = entity.GetComponent<Scale>()->scale;
         auto& rotation = entity.GetComponent<Rotation>()->rotation;
@@ -281,7 +288,6 @@ namespace ChronoShift {
     }
     #endif
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
-    UpdatePhysicsSystem();
 
     //Update Transformation Matrix of All Entities
     UpdateSprite2DMatrix();
@@ -16,6 +16,7 @@ namespace ChronoShift
     virtual void OnAttach() override;
     virtual void OnDetach() override;
     virtual void Update() override;
+    virtual void FixedUpdate() override;
 
   private:
     void SetupWorld();
@@ -395,7 +395,7 @@ ImGui::EndMainMenuBar();
       if (ImGui::CollapsingHeader("Scene", tree_node_flags))
       {
         ImGui::Text("Active Scene: %s", current_save_name.c_str());
-        ImGui::Text("Entities: %d", FlexECS::Scene::GetActiveScene()->View<EntityName>().size());
+        ImGui::Text("Entities: %d", FlexECS::Scene::GetActiveSceneRef().View<EntityName>().size());
         ImGui::Text("Archetypes: %d", ARCHETYPE_INDEX.size());
       }
 
@@ -517,7 +517,7 @@ ImGui::EndMainMenuBar();
       ImGui::SeparatorText("Entities");
 
       // entities
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, LocalPosition, GlobalPosition, Rotation, Scale, Transform>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, LocalPosition, GlobalPosition, Rotation, Scale, Transform>())
       {
         auto entity_name_component = entity.GetComponent<EntityName>();
         auto is_active = &entity.GetComponent<IsActive>()->is_active;
@@ -527,11 +527,11 @@ ImGui::EndMainMenuBar();
         auto& scale = entity.GetComponent<Scale>()->scale;
         auto transform = entity.GetComponent<Transform>();
 
-        std::string& entity_name = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(*entity_name_component);
+        std::string_view entity_name = FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(*entity_name_component);
 
-        if (ImGui::CollapsingHeader(entity_name.c_str(), tree_node_flags))
+        if (ImGui::CollapsingHeader(entity_name.data(), tree_node_flags))
         {
-          ImGui::PushID(entity_name.c_str());
+          ImGui::PushID(entity_name.data());
 
           if (ImGui::Checkbox("Active", is_active))
           {
@@ -627,13 +627,13 @@ ImGui::EndMainMenuBar();
         // click to set the model
         if (ImGui::IsItemClicked())
         {
-          FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Delete(object.GetComponent<Model>()->model);
+          FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Delete(object.GetComponent<Model>()->model);
           // set the model
-          object.GetComponent<Model>()->model = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_New(assetkey);
+          object.GetComponent<Model>()->model = FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_New(assetkey);
         }
 
         // model is active
-        if (FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(object.GetComponent<Model>()->model) == assetkey)
+        if (FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(object.GetComponent<Model>()->model) == assetkey)
         {
           ImGui::SameLine();
           if (ImGui::SmallButton("Active")) {}
@@ -653,7 +653,7 @@ ImGui::EndMainMenuBar();
     #if 1
     {
       // Rotate all entities in the scene (except cameras)
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, GlobalPosition, Rotation, Transform>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, GlobalPosition, Rotation, Transform>())
       {
         if (entity.HasComponent<Camera>()) continue;
         if (!entity.GetComponent<IsActive>()->is_active) continue;
@@ -690,7 +690,7 @@ ImGui::EndMainMenuBar();
     #if 1
     {
       // Updates the transform component
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, LocalPosition, GlobalPosition, Rotation, Scale, Transform>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, LocalPosition, GlobalPosition, Rotation, Scale, Transform>())
       {
         if (!entity.GetComponent<IsActive>()->is_active) continue;
 
@@ -724,7 +724,7 @@ ImGui::EndMainMenuBar();
     #if 1
     {
       // Updates the camera component
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<GlobalPosition, Rotation, Camera>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<GlobalPosition, Rotation, Camera>())
       {
         auto& global_position = entity.GetComponent<GlobalPosition>()->position;
         auto& rotation = entity.GetComponent<Rotation>()->rotation;
@@ -801,7 +801,7 @@ ImGui::EndMainMenuBar();
       }
 
       // Render all entities
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<Transform, Mesh, Material, Shader>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<Transform, Mesh, Material, Shader>())
       {
         auto& transform = entity.GetComponent<Transform>()->transform;
         auto& mesh = entity.GetComponent<Mesh>()->mesh;
@@ -814,7 +814,7 @@ ImGui::EndMainMenuBar();
         mesh.IBO->Bind();
 
         // shader setup
-        auto& shader_asset = FLX_ASSET_GET(Asset::Shader, FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(shader));
+        auto& shader_asset = FLX_ASSET_GET(Asset::Shader, FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(shader));
         shader_asset.Use();
 
         // TODO: accumulate transformations
@@ -838,13 +838,13 @@ ImGui::EndMainMenuBar();
         }
 
         // setup material
-        auto& diffuse = FLX_ASSET_GET(Asset::Texture, FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(material->diffuse));
+        auto& diffuse = FLX_ASSET_GET(Asset::Texture, FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(material->diffuse));
         if (diffuse)
         {
           diffuse.Bind(shader_asset, "u_material_diffuse", 0);
         }
         auto specular_pair = material->specular;
-        auto& specular = FLX_ASSET_GET(Asset::Texture, FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(specular_pair.first));
+        auto& specular = FLX_ASSET_GET(Asset::Texture, FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(specular_pair.first));
         if (specular)
         {
           specular.Bind(shader_asset, "u_material_specular", 1);
@@ -884,7 +884,7 @@ ImGui::EndMainMenuBar();
       }
 
       // Render all entities
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, Transform, Model, Shader>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, Transform, Model, Shader>())
       {
         if (!entity.GetComponent<IsActive>()->is_active) continue;
 
@@ -893,7 +893,7 @@ ImGui::EndMainMenuBar();
         auto& shader = entity.GetComponent<Shader>()->shader;
 
         // shader setup
-        auto& shader_asset = FLX_ASSET_GET(Asset::Shader, FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(shader));
+        auto& shader_asset = FLX_ASSET_GET(Asset::Shader, FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(shader));
         shader_asset.Use();
 
         //shader_asset.SetUniform_mat4("u_view", camera->view);
@@ -924,7 +924,7 @@ ImGui::EndMainMenuBar();
         }
 
         // get model
-        auto& model_asset = FLX_ASSET_GET(Asset::Model, FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(model));
+        auto& model_asset = FLX_ASSET_GET(Asset::Model, FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(model));
 
         // render all meshes
         for (auto& mesh : model_asset.meshes)
@@ -986,19 +986,19 @@ ImGui::EndMainMenuBar();
       if (!blending) OpenGLRenderer::EnableBlending();
 
       // Render all entities
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, GlobalPosition, Scale, Shader, Sprite>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, GlobalPosition, Scale, Shader, Sprite>())
       {
         if (!entity.GetComponent<IsActive>()->is_active) continue;
 
         auto& global_position = entity.GetComponent<GlobalPosition>()->position;
         auto& scale = entity.GetComponent<Scale>()->scale;
-        auto& shader = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(entity.GetComponent<Shader>()->shader);
+        auto shader = FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(entity.GetComponent<Shader>()->shader);
         auto _sprite = entity.GetComponent<Sprite>();
 
         props.shader = shader;
         props.position = global_position;
         props.scale = scale;
-        props.texture = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(_sprite->texture);
+        props.texture = FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(_sprite->texture);
         props.color = _sprite->color;
         props.color_to_add = _sprite->color_to_add;
         props.color_to_multiply = _sprite->color_to_multiply;
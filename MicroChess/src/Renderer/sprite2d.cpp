@@ -1,101 +1,86 @@
 #include "Renderer/sprite2d.h"
 
 #include "Components/rendering.h"
+#include "Components/physics.h"
 
 #define PostProcessing 0
 namespace ChronoShift
 {
     //If u want this function to be callable, tell wei jie, otherwise not supposed to be called outside of sprite2D
-    static void UpdateTransformationMatrix(FlexECS::Entity& currEntity, const Matrix4x4 parent_entity_matrix = Matrix4x4::Identity)
+    static Matrix4x4 CalculateLocalMatrix(const Position& position, const Scale& scale, const Rotation& rotation)
     {
-        auto& local_transform = currEntity.GetComponent<Transform>()->transform;
-        //if (!currEntity.GetComponent<Transform>()->is_dirty) return; //SOMETHING WRONG WITH IS_DIRTY
-
-        auto& local_position = currEntity.GetComponent<Position>()->position;
-        auto& local_scale = currEntity.GetComponent<Scale>()->scale;
-        auto& local_rotation = currEntity.GetComponent<Rotation>()->rotation;
+        auto& local_position = position.position;
+        auto& local_scale = scale.scale;
+        auto& local_rotation = rotation.rotation;
 
         // calculate the transform
         Matrix4x4 translation_matrix = Matrix4x4::Translate(Matrix4x4::Identity, Vector3(-local_position.x, local_position.y, 0.0f));
         Matrix4x4 rotation_matrix = Quaternion::FromEulerAnglesDeg(local_rotation).ToRotationMatrix();
         Matrix4x4 scale_matrix = Matrix4x4::Scale(Matrix4x4::Identity, local_scale);
 
-        Matrix4x4 curr_entity_matrix = translation_matrix * rotation_matrix * scale_matrix;
-        local_transform = parent_entity_matrix * curr_entity_matrix;
+        return translation_matrix * rotation_matrix * scale_matrix;
     }
 
     void UpdateSprite2DMatrix()
     {
-        //Uncomment log for debug testing
-        static std::vector<FlexECS::Entity*> t_entitystack;
-        t_entitystack.clear();  // Clear stack at the beginning of each update
-        // Unordered set to track processed entities (avoid redundant updates)
-        static std::unordered_set<FlexECS::EntityID> t_processedEntities;
-        t_processedEntities.clear();
-
-        for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, Transform>())
-        {
-            // Check if this entity has already been processed
-            if (t_processedEntities.find(entity.Get()) != t_processedEntities.end() || 
-                !entity.GetComponent<IsActive>()->is_active)
-            {
-                continue;  // Skip
-            }
+        FlexECS::Scene& scene = FlexECS::Scene::GetActiveSceneRef();
+        FlexECS::TransformHierarchy& hierarchy = scene.transform_hierarchy;
 
-            // Traverse up the hierarchy and collect parent entities in a stack
-            FlexECS::Entity* t_currentEntity = &entity;
+        // Drop the entities that were destroyed since the last update
+        hierarchy.RemoveDestroyed(scene.entity_index);
 
-            //Update the parent order
-            while (true)
+        // Push the local matrices of the entities that moved
+        scene.Each<FlexECS::Changed<const Position>, FlexECS::Changed<const Scale>, FlexECS::Changed<const Rotation>, const Transform>(
+            [&hierarchy](FlexECS::Entity entity, const Position& position, const Scale& scale, const Rotation& rotation, const Transform&)
             {
-                // Push the entity into the stack to process later
-                t_entitystack.push_back(t_currentEntity);
+                hierarchy.SetLocalMatrix(entity, CalculateLocalMatrix(position, scale, rotation));
+            }
+        );
 
-                // Get the parent of the current entity
-                Parent* t_parententity = nullptr;
-                if ((*t_currentEntity).TryGetComponent<Parent>(t_parententity))
-                {
-                    t_parententity = (*t_currentEntity).GetComponent<Parent>();
-                    // Move up to the parent entity
-                    t_currentEntity = &t_parententity->parent;
-                }
-                else
-                {
-                    break;
-                }
+        // Blend the bodies between their last two physics steps.
+        // These change every frame, the alpha moves even when the physics did not step.
+        float alpha = Application::GetCurrentWindow()->GetInterpolationAlpha();
+        scene.Each<const Position, const PreviousPosition, const Scale, const Rotation, const Transform>(
+            [&hierarchy, alpha](FlexECS::Entity entity, const Position& position, const PreviousPosition& previous_position, const Scale& scale, const Rotation& rotation, const Transform&)
+            {
+                Position blended = { previous_position.position + (position.position - previous_position.position) * alpha };
+                hierarchy.SetLocalMatrix(entity, CalculateLocalMatrix(blended, scale, rotation));
             }
-            // At this point, `t_entitystack` contains the chain of entities from the child up to the root
+        );
 
-            Matrix4x4 globaltransform = Matrix4x4::Identity;  // Start with identity matrix for the root entity
-            for (auto it = t_entitystack.rbegin(); it != t_entitystack.rend(); ++it)
+        // Push the parents that changed
+        scene.Each<FlexECS::Changed<const Parent>>(
+            [&hierarchy](FlexECS::Entity entity, const Parent& parent)
             {
-                // Check if the parent has already been processed, don't update matrix
-                if (t_processedEntities.find((*it)->Get()) == t_processedEntities.end())
-                {
-                    //Update current obj transform
-                    UpdateTransformationMatrix(**it, globaltransform);
-                    // Mark the entity as processed
-                    t_processedEntities.insert((*it)->Get());
-                }
-                // Update the parent's global transform to pass it down to the next child
-                globaltransform = (*it)->GetComponent<Transform>()->transform;
+                hierarchy.SetParent(entity, parent.parent);
+            }
+        );
 
-                //Log::Debug(FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(*(*it)->GetComponent<EntityName>()));
+        // Parents come before their children, so this is one pass over the dirty subtrees
+        hierarchy.Update();
 
+        // Copy the world matrices that changed into the transforms for the renderer
+        hierarchy.EachChanged(
+            [&scene](FlexECS::EntityID entity_id, const Matrix4x4& world_matrix)
+            {
+                FlexECS::Entity entity(entity_id);
+                if (entity.HasComponent<Transform>(scene)) entity.GetComponent<Transform>(scene)->transform = world_matrix;
             }
-           // Log::Debug(" ");
-            t_entitystack.clear();
-        }
-        //Log::Debug("****************************************************************");
+        );
     }
 
     void RendererSprite2D()
     {
         WindowProps window_props = Application::GetCurrentWindow()->GetProps();
-        Renderer2DProps props;
-        props.window_size = { static_cast<float>(window_props.width), static_cast<float>(window_props.height) };
+        Vector2 window_size = { static_cast<float>(window_props.width), static_cast<float>(window_props.height) };
+
+        // Materials are kept between frames, only the sprites are cleared
+        static SpriteBatch sprite_batch;
+        sprite_batch.Clear();
 
-        FunctionQueue render_queue;
+        // The texture shader draws one sprite at a time, the batch uses its built-in instanced version instead.
+        // Other shaders don't have the instance attributes, their sprites are drawn one at a time in the same order.
+        static const std::string_view texture_shader = R"(\shaders\texture)";
 
         if (PostProcessing)
         {
@@ -104,28 +89,48 @@ namespace ChronoShift
         }
 
         // Render all entities
-        for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, ZIndex, Position, Scale, Rotation, Transform, Shader, Sprite>())
-        {
-            if (!entity.GetComponent<IsActive>()->is_active) continue;
+        auto scene = FlexECS::Scene::GetActiveScene();
 
-            auto& z_index = entity.GetComponent<ZIndex>()->z;
-            Matrix4x4 transform = entity.GetComponent<Transform>()->transform;
-            auto& shader = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(entity.GetComponent<Shader>()->shader);
-            auto sprite = entity.GetComponent<Sprite>();
+        // Most sprites share a few materials, so look each shader and texture pair up once per frame
+        std::unordered_map<uint64_t, SpriteBatch::MaterialID> materials;
 
-            props.shader = shader;
-            props.transform = transform;
-            props.texture = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(sprite->texture);
-            props.color = sprite->color;
-            props.color_to_add = sprite->color_to_add;
-            props.color_to_multiply = sprite->color_to_multiply;
-            props.alignment = static_cast<Renderer2DProps::Alignment>(sprite->alignment);
+        // Everything is only read here, so the components are const and are not marked as changed
+        scene->Each<const IsActive, const ZIndex, const Position, const Scale, const Rotation, const Transform, const Shader, const Sprite>(
+            [&](const IsActive& is_active, const ZIndex& z_index, const Position&, const Scale& scale, const Rotation&, const Transform& transform, const Shader& shader, const Sprite& sprite)
+            {
+                if (!is_active.is_active || scale.scale == Vector2::Zero) return;
 
-            //auto testfn = [&props]() { props.transform.Dump(); };
-            //testfn();
+                uint64_t material_key = (static_cast<uint64_t>(shader.shader) << 32) | static_cast<uint64_t>(sprite.texture);
+                auto it = materials.find(material_key);
+                if (it == materials.end())
+                {
+                    std::string_view shader_key = scene->Internal_StringStorage_Get(shader.shader);
+                    bool is_instanced = shader_key == texture_shader;
+                    if (is_instanced) shader_key = "";
+                    SpriteBatch::MaterialID material = sprite_batch.AddMaterial(std::string(shader_key), std::string(scene->Internal_StringStorage_Get(sprite.texture)), is_instanced);
+                    it = materials.emplace(material_key, material).first;
+                }
 
-            render_queue.Insert({ [props]() { OpenGLSpriteRenderer::DrawTexture2D(props); }, "", z_index });
-        }
+                const SpriteBatch::Material& material = sprite_batch.GetMaterial(it->second);
+
+                // guard: sprites without a shader are not drawn
+                if (!material.is_instanced && material.shader.empty()) return;
+
+                if (material.texture.empty() && sprite.color == Vector3::Zero)
+                {
+                    Log::Fatal("No texture or color specified for texture shader.");
+                    return;
+                }
+
+                SpriteInstance instance;
+                instance.transform = transform.transform;
+                instance.color = Vector4(sprite.color, material.texture.empty() ? 0.0f : 1.0f);
+                instance.color_to_add = sprite.color_to_add;
+                instance.color_to_multiply = sprite.color_to_multiply;
+
+                sprite_batch.Add(it->second, instance, z_index.z);
+            }
+        );
 
         // push settings
         bool depth_test = OpenGLRenderer::IsDepthTestEnabled();
@@ -136,7 +141,7 @@ namespace ChronoShift
 
         // batch-render
 
-        render_queue.Flush();
+        OpenGLSpriteRenderer::DrawSpriteBatch(sprite_batch, window_size);
         if (PostProcessing)
         {
             OpenGLSpriteRenderer::DisablePostProcessing();
@@ -29,7 +29,7 @@ namespace OpenGLRendering
   FLX_REFL_REGISTER_END;
 
   FLX_REFL_REGISTER_START(Shader)
-    FLX_REFL_REGISTER_PROPERTY(shader)
+    FLX_REFL_REGISTER_STRING_INDEX(shader)
   FLX_REFL_REGISTER_END;
 
   //FLX_REFL_REGISTER_START(Texture)
@@ -46,7 +46,7 @@ namespace OpenGLRendering
   //FLX_REFL_REGISTER_END;
   
   FLX_REFL_REGISTER_START(Sprite)
-    FLX_REFL_REGISTER_PROPERTY(texture)
+    FLX_REFL_REGISTER_STRING_INDEX(texture)
     FLX_REFL_REGISTER_PROPERTY(color)
     FLX_REFL_REGISTER_PROPERTY(color_to_add)
     FLX_REFL_REGISTER_PROPERTY(color_to_multiply)
@@ -54,13 +54,13 @@ namespace OpenGLRendering
   FLX_REFL_REGISTER_END;
 
   FLX_REFL_REGISTER_START(Text)
-    FLX_REFL_REGISTER_PROPERTY(font)
+    FLX_REFL_REGISTER_STRING_INDEX(font)
     FLX_REFL_REGISTER_PROPERTY(font_size)
     FLX_REFL_REGISTER_PROPERTY(text)
   FLX_REFL_REGISTER_END;
 
   FLX_REFL_REGISTER_START(Model)
-    FLX_REFL_REGISTER_PROPERTY(model)
+    FLX_REFL_REGISTER_STRING_INDEX(model)
   FLX_REFL_REGISTER_END;
 
   FLX_REFL_REGISTER_START(Camera)
@@ -9,7 +9,7 @@
                 From there, you can use the entityID handle to manipulate the entity as you wish.
 
          Note: The prefab creation function is available from the Scene class and can be invoked as follows:
-                FlexECS::Scene::GetActiveScene()->SaveEntityAsPrefab(object.Get() , "test");
+                FlexECS::Scene::GetActiveSceneRef().SaveEntityAsPrefab(object.Get() , "test");
 */
 #pragma once
 #include <FlexEngine.h> // Utility functions
@@ -47,7 +47,7 @@ FlexECS::Entity& SpawnEntityFromPrefab(const std::string& prefabName)
   FlexECS::Entity new_entity;
   if (document.IsArray())
   {
-    new_entity = FlexECS::Scene::GetActiveScene()->CreateEntity(prefabName); // Should be safe to create a new entity with this name now
+    new_entity = FlexECS::Scene::GetActiveSceneRef().CreateEntity(prefabName); // Should be safe to create a new entity with this name now
 
     // Loop through each member
     for (auto& member : document.GetArray())
@@ -151,6 +151,7 @@ namespace OpenGLRendering
   void MainLayer::Update()
   {
     OpenGLRenderer::ClearFrameBuffer();
+    FlexECS::Scene::GetActiveSceneRef().ResetQueryMatchCounts();
 
     FunctionQueue function_queue;
 
@@ -404,8 +405,26 @@ ImGui::EndMainMenuBar();
       if (ImGui::CollapsingHeader("Scene", tree_node_flags))
       {
         ImGui::Text("Active Scene: %s", current_save_name.c_str());
-        ImGui::Text("Entities: %d", FlexECS::Scene::GetActiveScene()->View<EntityName>().size());
+        ImGui::Text("Entities: %d", FlexECS::Scene::GetActiveSceneRef().Count<EntityName>());
         ImGui::Text("Archetypes: %d", ARCHETYPE_INDEX.size());
+
+        // archetypes tested against each cached query last frame, should stay at 0
+        if (ImGui::TreeNode("Query Matches"))
+        {
+          for (auto& cache : FlexECS::Scene::GetActiveSceneRef().GetQueryCaches())
+          {
+            if (!cache.is_initialized) continue;
+
+            std::string query_name;
+            for (auto component : cache.components)
+            {
+              if (!query_name.empty()) query_name += ", ";
+              query_name += FlexECS::GetComponentName(component);
+            }
+            ImGui::Text("%d: %s", cache.match_count_last_frame, query_name.c_str());
+          }
+          ImGui::TreePop();
+        }
       }
 
       if (ImGui::CollapsingHeader("Renderer", tree_node_flags))
@@ -526,7 +545,7 @@ ImGui::EndMainMenuBar();
       ImGui::SeparatorText("Entities");
 
       // entities
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, LocalPosition, GlobalPosition, Rotation, Scale, Transform, Model>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, LocalPosition, GlobalPosition, Rotation, Scale, Transform, Model>())
       {
         auto entity_name_component = entity.GetComponent<EntityName>();
         auto is_active = &entity.GetComponent<IsActive>()->is_active;
@@ -537,11 +556,11 @@ ImGui::EndMainMenuBar();
         auto transform = entity.GetComponent<Transform>();
         auto& model = entity.GetComponent<Model>()->model;
 
-        std::string& entity_name = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(*entity_name_component);
+        std::string_view entity_name = FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(*entity_name_component);
 
-        if (ImGui::CollapsingHeader(entity_name.c_str(), tree_node_flags))
+        if (ImGui::CollapsingHeader(entity_name.data(), tree_node_flags))
         {
-          ImGui::PushID(entity_name.c_str());
+          ImGui::PushID(entity_name.data());
 
           if (ImGui::Checkbox("Active", is_active))
           {
@@ -585,7 +604,7 @@ ImGui::EndMainMenuBar();
             ImGui::PushID("materials");
 
             // display the model
-            std::string& model_name = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(model);
+            std::string_view model_name = FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(model);
             auto& model_asset = FLX_ASSET_GET(Asset::Model, model_name);
             
             // list all materials
@@ -691,13 +710,13 @@ ImGui::EndMainMenuBar();
         // click to set the model
         if (ImGui::IsItemClicked())
         {
-          FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Delete(object.GetComponent<Model>()->model);
+          FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Delete(object.GetComponent<Model>()->model);
           // set the model
-          object.GetComponent<Model>()->model = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_New(assetkey);
+          object.GetComponent<Model>()->model = FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_New(assetkey);
         }
 
         // model is active
-        if (FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(object.GetComponent<Model>()->model) == assetkey)
+        if (FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(object.GetComponent<Model>()->model) == assetkey)
         {
           ImGui::SameLine();
           if (ImGui::SmallButton("Active")) {}
@@ -717,7 +736,7 @@ ImGui::EndMainMenuBar();
     #if 0
     {
       // Rotate all entities in the scene (except cameras)
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, GlobalPosition, Rotation, Transform>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, GlobalPosition, Rotation, Transform>())
       {
         if (entity.HasComponent<Camera>()) continue;
         if (!entity.GetComponent<IsActive>()->is_active) continue;
@@ -754,7 +773,7 @@ ImGui::EndMainMenuBar();
     #if 0
     {
       // move the camera with WASD
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<Camera, GlobalPosition, Rotation>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<Camera, GlobalPosition, Rotation>())
       {
         auto& global_position = entity.GetComponent<GlobalPosition>()->position;
         auto& rotation = entity.GetComponent<Rotation>()->rotation;
@@ -851,7 +870,7 @@ ImGui::EndMainMenuBar();
     #if 1
     {
       // move the camera with mouse (orbiting)
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<Camera, GlobalPosition, Rotation>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<Camera, GlobalPosition, Rotation>())
       {
         auto& global_position = entity.GetComponent<GlobalPosition>()->position;
         auto& rotation = entity.GetComponent<Rotation>()->rotation;
@@ -917,29 +936,50 @@ ImGui::EndMainMenuBar();
     #if 1
     {
       // Updates the transform component
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, LocalPosition, GlobalPosition, Rotation, Scale, Transform>())
-      {
-        if (!entity.GetComponent<IsActive>()->is_active) continue;
+      // The matrices go through the scene's transform hierarchy, which only recomputes the entities
+      // whose local matrix changed and hands the results back in one pass
+      FlexECS::Scene& scene = FlexECS::Scene::GetActiveSceneRef();
+      FlexECS::TransformHierarchy& hierarchy = scene.transform_hierarchy;
+
+      hierarchy.RemoveDestroyed(scene.entity_index);
+
+      // Push the local matrices of the entities where one of the inputs changed since the last update
+      scene.Each<
+        FlexECS::Changed<const IsActive>, FlexECS::Changed<const LocalPosition>, FlexECS::Changed<const GlobalPosition>,
+        FlexECS::Changed<const Rotation>, FlexECS::Changed<const Scale>, const Transform
+      >(
+        [&hierarchy](FlexECS::Entity entity, const IsActive& is_active, const LocalPosition& local_position_component, const GlobalPosition& global_position_component, const Rotation& rotation_component, const Scale& scale_component, const Transform& transform)
+        {
+          if (!is_active.is_active) return;
+          if (!transform.is_dirty) return;
 
-        auto transform = entity.GetComponent<Transform>();
-        if (!transform->is_dirty) continue;
+          auto& local_position = local_position_component.position;
+          auto& global_position = global_position_component.position;
+          auto& rotation = rotation_component.rotation;
+          auto& scale = scale_component.scale;
 
-        auto& local_position = entity.GetComponent<LocalPosition>()->position;
-        auto& global_position = entity.GetComponent<GlobalPosition>()->position;
-        auto& rotation = entity.GetComponent<Rotation>()->rotation;
-        auto& scale = entity.GetComponent<Scale>()->scale;
+          // calculate the transform
 
-        // calculate the transform
+          Matrix4x4 local_translation_matrix = Matrix4x4::Translate(Matrix4x4::Identity, local_position);
+          Matrix4x4 global_translation_matrix = Matrix4x4::Translate(Matrix4x4::Identity, global_position);
+          Matrix4x4 rotation_matrix = Quaternion::FromEulerAnglesDeg(rotation).ToRotationMatrix();
+          Matrix4x4 scale_matrix = Matrix4x4::Scale(Matrix4x4::Identity, scale);
 
-        Matrix4x4 local_translation_matrix = Matrix4x4::Translate(Matrix4x4::Identity, local_position);
-        Matrix4x4 global_translation_matrix = Matrix4x4::Translate(Matrix4x4::Identity, global_position);
-        Matrix4x4 rotation_matrix = Quaternion::FromEulerAnglesDeg(rotation).ToRotationMatrix();
-        Matrix4x4 scale_matrix = Matrix4x4::Scale(Matrix4x4::Identity, scale);
-        
-        // right to left
-        // local transforms apply first before placing it in the world
-        transform->transform = global_translation_matrix * rotation_matrix * scale_matrix * local_translation_matrix;
-      }
+          // right to left
+          // local transforms apply first before placing it in the world
+          hierarchy.SetLocalMatrix(entity, global_translation_matrix * rotation_matrix * scale_matrix * local_translation_matrix);
+        }
+      );
+
+      hierarchy.Update();
+
+      // Copy the world matrices that changed into the transforms for the renderers
+      hierarchy.EachChanged(
+        [&scene](FlexECS::EntityID entity, const Matrix4x4& world_matrix)
+        {
+          FlexECS::Entity(entity).GetComponent<Transform>(scene)->transform = world_matrix;
+        }
+      );
     }
     #endif
 
@@ -951,7 +991,7 @@ ImGui::EndMainMenuBar();
     #if 1
     {
       // Updates the camera component
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<GlobalPosition, Rotation, Camera>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<GlobalPosition, Rotation, Camera>())
       {
         auto& global_position = entity.GetComponent<GlobalPosition>()->position;
         auto& rotation = entity.GetComponent<Rotation>()->rotation;
@@ -1028,7 +1068,7 @@ ImGui::EndMainMenuBar();
       }
 
       // Render all entities
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<Transform, Mesh, Material, Shader>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<Transform, Mesh, Material, Shader>())
       {
         auto& transform = entity.GetComponent<Transform>()->transform;
         auto& mesh = entity.GetComponent<Mesh>()->mesh;
@@ -1041,7 +1081,7 @@ ImGui::EndMainMenuBar();
         mesh.IBO->Bind();
 
         // shader setup
-        auto& shader_asset = FLX_ASSET_GET(Asset::Shader, FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(shader));
+        auto& shader_asset = FLX_ASSET_GET(Asset::Shader, FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(shader));
         shader_asset.Use();
 
         // TODO: accumulate transformations
@@ -1065,13 +1105,13 @@ ImGui::EndMainMenuBar();
         }
 
         // setup material
-        auto& diffuse = FLX_ASSET_GET(Asset::Texture, FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(material->diffuse));
+        auto& diffuse = FLX_ASSET_GET(Asset::Texture, FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(material->diffuse));
         if (diffuse)
         {
           diffuse.Bind(shader_asset, "u_material_diffuse", 0);
         }
         auto specular_pair = material->specular;
-        auto& specular = FLX_ASSET_GET(Asset::Texture, FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(specular_pair.first));
+        auto& specular = FLX_ASSET_GET(Asset::Texture, FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(specular_pair.first));
         if (specular)
         {
           specular.Bind(shader_asset, "u_material_specular", 1);
@@ -1111,7 +1151,7 @@ ImGui::EndMainMenuBar();
       }
 
       // Render all entities
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, Transform, Model, Shader>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, Transform, Model, Shader>())
       {
         if (!entity.GetComponent<IsActive>()->is_active) continue;
 
@@ -1120,7 +1160,7 @@ ImGui::EndMainMenuBar();
         auto& shader = entity.GetComponent<Shader>()->shader;
 
         // shader setup
-        auto& shader_asset = FLX_ASSET_GET(Asset::Shader, FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(shader));
+        auto& shader_asset = FLX_ASSET_GET(Asset::Shader, FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(shader));
         shader_asset.Use();
 
         //shader_asset.SetUniform_mat4("u_view", camera->view);
@@ -1151,7 +1191,7 @@ ImGui::EndMainMenuBar();
         }
 
         // get model
-        auto& model_asset = FLX_ASSET_GET(Asset::Model, FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(model));
+        auto& model_asset = FLX_ASSET_GET(Asset::Model, FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(model));
 
         // render all meshes
         for (auto& mesh : model_asset.meshes)
@@ -1224,19 +1264,19 @@ ImGui::EndMainMenuBar();
       if (!blending) OpenGLRenderer::EnableBlending();
 
       // Render all entities
-      for (auto& entity : FlexECS::Scene::GetActiveScene()->View<IsActive, GlobalPosition, Scale, Shader, Sprite>())
+      for (auto& entity : FlexECS::Scene::GetActiveSceneRef().View<IsActive, GlobalPosition, Scale, Shader, Sprite>())
       {
         if (!entity.GetComponent<IsActive>()->is_active) continue;
 
         auto& global_position = entity.GetComponent<GlobalPosition>()->position;
         auto& scale = entity.GetComponent<Scale>()->scale;
-        auto& shader = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(entity.GetComponent<Shader>()->shader);
+        auto shader = FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(entity.GetComponent<Shader>()->shader);
         auto _sprite = entity.GetComponent<Sprite>();
 
         props.shader = shader;
         props.position = global_position;
         props.scale = scale;
-        props.texture = FlexECS::Scene::GetActiveScene()->Internal_StringStorage_Get(_sprite->texture);
+        props.texture = FlexECS::Scene::GetActiveSceneRef().Internal_StringStorage_Get(_sprite->texture);
         props.color = _sprite->color;
         props.color_to_add = _sprite->color_to_add;
         props.color_to_multiply = _sprite->color_to_multiply;
@@ -6,6 +6,9 @@ using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 #include <FlexEngine.h>
 using namespace FlexEngine;
 
+#include <random>
+#include <set>
+
 #pragma warning(disable: 4189) // local variable is initialized but not referenced
 
 
@@ -2980,3 +2983,1918 @@ namespace T_FlexID
   };
 
 }
+
+
+namespace T_FlexECS
+{
+
+  // Shared fixture for the tests that need an active scene.
+  // The test framework creates the test class again for each test method,
+  // so each test gets a fresh scene that stays active until the test is done.
+  // Usage: TestScene scene; as the first member of the test class
+  class TestScene : public std::shared_ptr<FlexECS::Scene>
+  {
+  public:
+    TestScene() : std::shared_ptr<FlexECS::Scene>(FlexECS::Scene::CreateScene()) { FlexECS::Scene::SetActiveScene(*this); }
+    ~TestScene() { FlexECS::Scene::SetActiveScene(FlexECS::Scene::CreateScene()); }
+
+    TestScene(const TestScene&) = delete;
+    TestScene& operator=(const TestScene&) = delete;
+  };
+
+  TEST_CLASS(T_Column)
+  {
+    struct Data
+    {
+      int a;
+      float b;
+    };
+
+    FlexECS::Column column{ sizeof(Data), alignof(Data) };
+  public:
+
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+      column = FlexECS::Column(sizeof(Data), alignof(Data));
+      for (int i = 0; i < 4; i++)
+      {
+        Data data = { i, static_cast<float>(i) * 0.5f };
+        column.PushBack(&data);
+      }
+    }
+
+    TEST_METHOD_CLEANUP(Cleanup)
+    {
+    }
+
+    TEST_METHOD(T_Column_Contiguous)
+    {
+      Data* first = reinterpret_cast<Data*>(column.Get(0));
+      for (int i = 0; i < 4; i++)
+      {
+        Assert::AreEqual(i, first[i].a);
+        Assert::AreEqual(static_cast<float>(i) * 0.5f, first[i].b);
+      }
+    }
+
+    TEST_METHOD(T_Column_SwapRemove)
+    {
+      column.SwapRemove(1);
+      Assert::AreEqual((size_t)3, column.size());
+      Assert::AreEqual(3, reinterpret_cast<Data*>(column.Get(1))->a);
+      column.SwapRemove(2);
+      Assert::AreEqual((size_t)2, column.size());
+      Assert::AreEqual(0, reinterpret_cast<Data*>(column.Get(0))->a);
+    }
+
+    TEST_METHOD(T_Column_PushBackSelf)
+    {
+      // pushing an element that lives in the column must survive reallocation
+      for (int i = 0; i < 64; i++) column.PushBack(column.Get(2));
+      Assert::AreEqual((size_t)68, column.size());
+      Assert::AreEqual(2, reinterpret_cast<Data*>(column.Get(67))->a);
+    }
+
+    TEST_METHOD(T_Column_Copy)
+    {
+      FlexECS::Column copy = column;
+      reinterpret_cast<Data*>(copy.Get(0))->a = 42;
+      Assert::AreEqual((size_t)4, copy.size());
+      Assert::AreEqual(0, reinterpret_cast<Data*>(column.Get(0))->a);
+      Assert::AreEqual(42, reinterpret_cast<Data*>(copy.Get(0))->a);
+    }
+
+  };
+
+  struct QPosition
+  {
+    FLX_REFL_SERIALIZABLE
+    float x;
+  };
+  FLX_REFL_REGISTER_START(QPosition)
+    FLX_REFL_REGISTER_PROPERTY(x)
+  FLX_REFL_REGISTER_END;
+
+  struct QVelocity
+  {
+    FLX_REFL_SERIALIZABLE
+    float x;
+  };
+  FLX_REFL_REGISTER_START(QVelocity)
+    FLX_REFL_REGISTER_PROPERTY(x)
+  FLX_REFL_REGISTER_END;
+
+  TEST_CLASS(T_Query)
+  {
+    TestScene scene;
+  public:
+
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+      for (int i = 0; i < 10; i++)
+      {
+        FlexECS::Entity entity = FlexECS::Scene::CreateEntity();
+        entity.AddComponent<QPosition>({ static_cast<float>(i) });
+        if (i % 2 == 0) entity.AddComponent<QVelocity>({ 1.0f });
+      }
+    }
+
+    TEST_METHOD(T_Query_Each)
+    {
+      int count = 0;
+      scene->Each<QPosition, QVelocity>(
+        [&count](QPosition& position, QVelocity& velocity)
+        {
+          position.x += velocity.x;
+          count++;
+        }
+      );
+      Assert::AreEqual(5, count);
+      Assert::AreEqual((size_t)5, scene->Count<QVelocity>());
+      Assert::AreEqual((size_t)10, FlexECS::Query<QPosition>(*scene).Count());
+    }
+
+    TEST_METHOD(T_Query_Cache)
+    {
+      // once the query is cached, only new archetypes are tested against it
+      FlexECS::Query<QPosition, QVelocity> query(*scene);
+      Assert::AreEqual((size_t)5, query.Count());
+      scene->ResetQueryMatchCounts();
+      Assert::AreEqual((size_t)5, query.Count());
+      scene->ResetQueryMatchCounts();
+      Assert::AreEqual((size_t)0, query.GetMatchCountLastFrame());
+
+      FlexECS::Entity entity = FlexECS::Scene::CreateEntity();
+      entity.AddComponent<QVelocity>({ 1.0f });
+      scene->ResetQueryMatchCounts();
+      Assert::AreEqual((size_t)1, query.GetMatchCountLastFrame());
+      Assert::AreEqual((size_t)5, query.Count());
+      Assert::AreEqual((size_t)6, scene->Count<QVelocity>());
+    }
+
+    TEST_METHOD(T_Query_EachEntity)
+    {
+      // the references passed in must be the same as the ones from GetComponent
+      scene->Each<QPosition>(
+        [](FlexECS::Entity entity, QPosition& position)
+        {
+          Assert::IsTrue(entity.GetComponent<QPosition>() == &position);
+        }
+      );
+    }
+
+  };
+
+  TEST_CLASS(T_EntityIndex)
+  {
+    TestScene scene;
+  public:
+
+    TEST_METHOD(T_EntityIndex_StaleHandle)
+    {
+      FlexECS::EntityID entity = FlexECS::Scene::CreateEntity();
+      FlexECS::EntityID stale = entity;
+      FlexECS::Scene::DestroyEntity(entity);
+
+      // the slot is reused with a newer generation
+      FlexECS::EntityID reused = FlexECS::Scene::CreateEntity();
+      Assert::AreEqual(ID::GetID(stale), ID::GetID(reused));
+      Assert::IsFalse(scene->entity_index.Contains(stale));
+      Assert::IsTrue(scene->entity_index.Contains(reused));
+      Assert::IsNull(scene->entity_index.Find(stale));
+
+      // destroying through the stale handle must not touch the new entity
+      FlexECS::Scene::DestroyEntity(stale);
+      Assert::IsTrue(scene->entity_index.Contains(reused));
+      Assert::AreEqual((size_t)1, scene->entity_index.size());
+    }
+
+    TEST_METHOD(T_EntityIndex_SetEntityFlags)
+    {
+      FlexECS::Entity entity = FlexECS::Scene::CreateEntity();
+      entity.AddComponent<QPosition>({ 3.0f });
+
+      // handles with the old flags are still valid
+      FlexECS::EntityID old_handle = entity;
+      FlexECS::Scene::SetEntityFlags(entity.Get(), ID::Flag_IsActive);
+      Assert::IsTrue(ID::IsActive(entity));
+      Assert::IsTrue(scene->entity_index.Contains(old_handle));
+      Assert::AreEqual(3.0f, FlexECS::Entity(old_handle).GetComponent<QPosition>()->x);
+      Assert::AreEqual((size_t)1, scene->entity_index.size());
+    }
+
+  };
+
+  TEST_CLASS(T_EntityCommandBuffer)
+  {
+    TestScene scene;
+  public:
+
+    TEST_METHOD(T_EntityCommandBuffer_Create)
+    {
+      FlexECS::EntityCommandBuffer commands;
+      FlexECS::EntityID entity = commands.CreateEntity();
+      commands.AddComponent<QPosition>(entity, { 1.0f });
+      commands.AddComponent<QVelocity>(entity, { 2.0f });
+      commands.AddComponent<QPosition>(entity, { 3.0f });
+
+      // nothing is applied until playback
+      Assert::AreEqual((size_t)0, scene->entity_index.size());
+
+      std::size_t archetype_count = scene->archetype_index.size();
+      commands.Playback();
+      Assert::IsTrue(commands.IsEmpty());
+
+      // the entity goes straight to its final archetype
+      Assert::AreEqual(archetype_count + 1, scene->archetype_index.size());
+      Assert::AreEqual(3.0f, FlexECS::Entity(entity).GetComponent<QPosition>()->x);
+      Assert::AreEqual(2.0f, FlexECS::Entity(entity).GetComponent<QVelocity>()->x);
+    }
+
+    TEST_METHOD(T_EntityCommandBuffer_Name)
+    {
+      FlexECS::EntityCommandBuffer commands;
+      FlexECS::EntityID named = commands.CreateEntity("Named");
+
+      // names are only interned on playback, so dropped entities don't hold a string
+      FlexECS::EntityID destroyed = commands.CreateEntity("Destroyed");
+      commands.DestroyEntity(destroyed);
+      Assert::AreEqual((size_t)0, scene->Internal_StringStorage_GetSize());
+
+      commands.Playback();
+      Assert::AreEqual(sizeof("Named"), scene->Internal_StringStorage_GetSize());
+      Assert::AreEqual(std::string("Named"), std::string(scene->Internal_StringStorage_Get(*FlexECS::Entity(named).GetComponent<FlexECS::Scene::StringIndex>())));
+
+      commands.CreateEntity("Cleared");
+      commands.Clear();
+      commands.Playback();
+      Assert::AreEqual(sizeof("Named"), scene->Internal_StringStorage_GetSize());
+    }
+
+    TEST_METHOD(T_EntityCommandBuffer_Flags)
+    {
+      FlexECS::EntityCommandBuffer commands;
+      FlexECS::EntityID entity = commands.CreateEntity();
+
+      // a handle with different flags is still the same entity
+      FlexECS::EntityID flagged = entity;
+      ID::SetFlags(flagged, false, true, false, true);
+      commands.AddComponent<QPosition>(flagged, { 1.0f });
+      commands.Playback();
+
+      Assert::AreEqual((size_t)1, scene->entity_index.size());
+      Assert::AreEqual(1.0f, FlexECS::Entity(entity).GetComponent<QPosition>()->x);
+    }
+
+    TEST_METHOD(T_EntityCommandBuffer_ReleaseIds)
+    {
+      FlexECS::EntityID cleared = 0;
+      FlexECS::EntityID destroyed = 0;
+      {
+        FlexECS::EntityCommandBuffer commands;
+        cleared = commands.CreateEntity();
+        commands.Clear();
+
+        // the cleared id is reused
+        destroyed = commands.CreateEntity();
+        Assert::AreEqual(ID::GetID(cleared), ID::GetID(destroyed));
+      }
+
+      // the buffer was destroyed without playback
+      FlexECS::Entity entity = FlexECS::Scene::CreateEntity();
+      Assert::AreEqual(ID::GetID(destroyed), ID::GetID(entity));
+      Assert::AreEqual((size_t)1, scene->entity_index.size());
+
+      // played back entities keep their ids
+      FlexECS::EntityID created = 0;
+      {
+        FlexECS::EntityCommandBuffer commands;
+        created = commands.CreateEntity();
+        commands.Playback();
+      }
+      Assert::IsTrue(scene->entity_index.Contains(created));
+      Assert::AreNotEqual(ID::GetID(created), ID::GetID(FlexECS::Scene::CreateEntity()));
+    }
+
+    TEST_METHOD(T_EntityCommandBuffer_DuringIteration)
+    {
+      for (int i = 0; i < 10; i++)
+      {
+        FlexECS::Entity entity = FlexECS::Scene::CreateEntity();
+        entity.AddComponent<QPosition>({ static_cast<float>(i) });
+      }
+
+      FlexECS::EntityCommandBuffer commands;
+      scene->Each<QPosition>(
+        [&commands](FlexECS::Entity entity, QPosition& position)
+        {
+          if (static_cast<int>(position.x) % 2 == 0) commands.DestroyEntity(entity);
+          else commands.AddComponent<QVelocity>(entity, { position.x });
+        }
+      );
+      commands.Playback();
+
+      Assert::AreEqual((size_t)5, scene->Count<QPosition>());
+      scene->Each<QPosition, QVelocity>(
+        [](QPosition& position, QVelocity& velocity)
+        {
+          Assert::AreEqual(position.x, velocity.x);
+        }
+      );
+    }
+
+  };
+
+  TEST_CLASS(T_BulkSpawn)
+  {
+    TestScene scene;
+  public:
+
+    TEST_METHOD(T_BulkSpawn_CreateEntities)
+    {
+      std::vector<FlexECS::EntityID> entities = FlexECS::Scene::CreateEntities(1000, QPosition{ 1.0f }, QVelocity{ 2.0f });
+      Assert::AreEqual((size_t)1000, entities.size());
+      Assert::AreEqual((size_t)1000, scene->entity_index.size());
+      Assert::AreEqual((size_t)1000, scene->Count<QPosition, QVelocity>());
+      Assert::AreEqual(2.0f, FlexECS::Entity(entities[999]).GetComponent<QVelocity>()->x);
+
+      // every entity gets the name component
+      Assert::IsTrue(FlexECS::Entity(entities[0]).HasComponent<FlexECS::Scene::StringIndex>());
+    }
+
+    TEST_METHOD(T_BulkSpawn_CloneEntity)
+    {
+      FlexECS::Entity entity = FlexECS::Scene::CreateEntity();
+      entity.AddComponent<QPosition>({ 5.0f });
+
+      std::vector<FlexECS::EntityID> clones = FlexECS::Scene::CloneEntity(entity, 500);
+      Assert::AreEqual((size_t)501, scene->Count<QPosition>());
+      for (FlexECS::EntityID clone : clones)
+      {
+        FlexECS::EntityRecord& entity_record = scene->entity_index[clone];
+        Assert::IsTrue(entity_record.archetype->entities[entity_record.row] == clone);
+        Assert::AreEqual(5.0f, FlexECS::Entity(clone).GetComponent<QPosition>()->x);
+      }
+    }
+
+  };
+
+  TEST_CLASS(T_ArchetypeEdges)
+  {
+    TestScene scene;
+  public:
+
+    TEST_METHOD(T_ArchetypeEdges_BothDirections)
+    {
+      FlexECS::Entity entity = FlexECS::Scene::CreateEntity();
+      FlexECS::Archetype* name_archetype = scene->entity_index[entity].archetype;
+      entity.AddComponent<QPosition>({ 1.0f });
+      FlexECS::Archetype* position_archetype = scene->entity_index[entity].archetype;
+
+      // the remove edge exists before the component is ever removed
+      FlexECS::ComponentID component = FlexECS::GetComponentID<QPosition>();
+      Assert::IsTrue(name_archetype->edges[component].add == position_archetype);
+      Assert::IsTrue(position_archetype->edges[component].remove == name_archetype);
+      Assert::AreEqual(position_archetype->type.size(), position_archetype->edges[component].remove_columns.size());
+    }
+
+    TEST_METHOD(T_ArchetypeEdges_Churn)
+    {
+      FlexECS::Entity entity = FlexECS::Scene::CreateEntity();
+      entity.AddComponent<QVelocity>({ 2.0f });
+
+      for (int i = 0; i < 100; i++)
+      {
+        entity.AddComponent<QPosition>({ static_cast<float>(i) });
+        Assert::AreEqual(static_cast<float>(i), entity.GetComponent<QPosition>()->x);
+        Assert::AreEqual(2.0f, entity.GetComponent<QVelocity>()->x);
+
+        entity.RemoveComponent<QPosition>();
+        Assert::IsFalse(entity.HasComponent<QPosition>());
+        Assert::AreEqual(2.0f, entity.GetComponent<QVelocity>()->x);
+      }
+    }
+
+  };
+
+  TEST_CLASS(T_MultipleScenes)
+  {
+    TestScene scene;
+    std::shared_ptr<FlexECS::Scene> other_scene = FlexECS::Scene::CreateScene();
+  public:
+
+    TEST_METHOD(T_MultipleScenes_SideBySide)
+    {
+      FlexECS::Entity entity = FlexECS::Scene::CreateEntity();
+      entity.AddComponent<QPosition>({ 1.0f });
+
+      // the other scene is never made active
+      FlexECS::Entity other_entity = FlexECS::Scene::CreateEntity(*other_scene);
+      other_entity.AddComponent<QPosition>(*other_scene, { 2.0f });
+      other_entity.AddComponent<QVelocity>(*other_scene, { 3.0f });
+      other_entity.RemoveComponent<QPosition>(*other_scene);
+      FlexECS::Scene::CreateEntities(*other_scene, 10, QPosition{ 4.0f });
+
+      Assert::IsTrue(FlexECS::Scene::GetActiveScene() == scene);
+      Assert::AreEqual(std::size_t(1), scene->entity_index.size());
+      Assert::AreEqual(std::size_t(11), other_scene->entity_index.size());
+      Assert::AreEqual(1.0f, entity.GetComponent<QPosition>()->x);
+      Assert::IsFalse(other_entity.HasComponent<QPosition>(*other_scene));
+      Assert::AreEqual(3.0f, other_entity.GetComponent<QVelocity>(*other_scene)->x);
+
+      int count = 0;
+      other_scene->Each<QPosition>([&count](QPosition& position) { count++; Assert::AreEqual(4.0f, position.x); });
+      Assert::AreEqual(10, count);
+    }
+
+    TEST_METHOD(T_MultipleScenes_CommandBuffer)
+    {
+      FlexECS::EntityCommandBuffer commands(*other_scene);
+      FlexECS::EntityID entity = commands.CreateEntity();
+      commands.AddComponent<QPosition>(entity, { 5.0f });
+      commands.Playback();
+
+      Assert::AreEqual(std::size_t(0), scene->entity_index.size());
+      Assert::AreEqual(5.0f, FlexECS::Entity(entity).GetComponent<QPosition>(*other_scene)->x);
+    }
+
+  };
+
+  TEST_CLASS(T_ParallelEach)
+  {
+    TestScene scene;
+  public:
+
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+      FlexECS::Scene::CreateEntities(10000, QPosition{ 0.0f }, QVelocity{ 2.0f });
+      FlexECS::Scene::CreateEntities(3, QPosition{ 0.0f });
+    }
+
+    TEST_METHOD(T_ParallelEach_MatchesEach)
+    {
+      ThreadPool pool(3);
+      scene->ParallelEach<QPosition, QVelocity>([](QPosition& position, QVelocity& velocity) { position.x += velocity.x; }, 100, pool);
+      scene->ParallelEach<QPosition>(
+        [](FlexECS::Entity entity, QPosition& position)
+        {
+          Assert::IsTrue(entity.GetComponent<QPosition>() == &position);
+          position.x += 1.0f;
+        },
+        7, pool
+      );
+
+      float sum = 0.0f;
+      scene->Each<QPosition>([&sum](QPosition& position) { sum += position.x; });
+      Assert::AreEqual(30003.0f, sum);
+    }
+
+    TEST_METHOD(T_ParallelEach_SingleChunk)
+    {
+      // a query that fits in one chunk runs on the calling thread
+      std::thread::id calling_thread = std::this_thread::get_id();
+      bool is_inline = true;
+      scene->ParallelEach<QVelocity>(
+        [&](QVelocity&) { if (std::this_thread::get_id() != calling_thread) is_inline = false; },
+        20000
+      );
+      Assert::IsTrue(is_inline);
+    }
+
+  };
+
+  TEST_CLASS(T_SystemScheduler)
+  {
+    TestScene scene;
+  public:
+
+    TEST_METHOD(T_SystemScheduler_Dependencies)
+    {
+      using FlexECS::Read;
+      using FlexECS::Write;
+
+      FlexECS::SystemScheduler scheduler;
+      scheduler.AddSystem<Read<QVelocity>, Write<QPosition>>("Move", []() {});
+      scheduler.AddSystem<Read<QVelocity>>("ReadVelocity", []() {});
+      scheduler.AddSystem<Read<QPosition>>("ReadPosition", []() {});
+      scheduler.AddExclusiveSystem("Exclusive", []() {});
+
+      // readers of the same component do not conflict
+      Assert::AreEqual((size_t)0, scheduler.GetDependencies("ReadVelocity").size());
+      Assert::AreEqual((size_t)1, scheduler.GetDependencies("ReadPosition").size());
+      Assert::IsTrue(scheduler.GetDependencies("ReadPosition")[0] == "Move");
+      Assert::AreEqual((size_t)3, scheduler.GetDependencies("Exclusive").size());
+    }
+
+    TEST_METHOD(T_SystemScheduler_Run)
+    {
+      using FlexECS::Read;
+      using FlexECS::Write;
+
+      FlexECS::Scene::CreateEntities(10000, QPosition{ 0.0f }, QVelocity{ 1.0f });
+
+      ThreadPool pool(3);
+      FlexECS::SystemScheduler scheduler(pool);
+      float sum = 0.0f;
+      scheduler.AddSystem<Read<QVelocity>, Write<QPosition>>(
+        "Move",
+        [this, &pool]()
+        {
+          scene->ParallelEachChunk<QPosition, QVelocity>(
+            [](std::size_t count, const FlexECS::EntityID*, QPosition* positions, QVelocity* velocities)
+            {
+              for (std::size_t i = 0; i < count; i++) positions[i].x += velocities[i].x;
+            },
+            512, pool
+          );
+        }
+      );
+      scheduler.AddSystem<Read<QPosition>>("Sum", [this, &sum]() { sum = 0.0f; scene->Each<QPosition>([&sum](QPosition& position) { sum += position.x; }); });
+
+      for (int frame = 0; frame < 3; frame++) scheduler.Run();
+
+      // Sum always runs after Move
+      Assert::AreEqual(30000.0f, sum);
+    }
+
+    TEST_METHOD(T_SystemScheduler_Exception)
+    {
+      using FlexECS::Read;
+      using FlexECS::Write;
+
+      ThreadPool pool(3);
+
+      // a throwing task still finishes its group, the waiting thread rethrows
+      std::atomic<int> ranges = 0;
+      auto parallel_for = [&]()
+      {
+        pool.ParallelFor(
+          100, 10,
+          [&ranges](std::size_t begin, std::size_t) { ranges++; if (begin == 50) throw std::runtime_error("range"); }
+        );
+      };
+      Assert::ExpectException<std::runtime_error>(parallel_for);
+      Assert::AreEqual(10, ranges.load());
+
+      // an untracked task that throws is logged, the pool keeps running tasks
+      TaskGroup group;
+      group.Add(3);
+      for (int i = 0; i < 3; i++) pool.Submit([]() { throw std::runtime_error("untracked"); });
+      for (int i = 0; i < 3; i++) pool.Submit([&pool, &group]() { pool.Done(group); });
+      pool.Wait(group);
+
+      FlexECS::SystemScheduler scheduler(pool);
+      bool is_dependent_run = false;
+      scheduler.AddSystem<Write<QPosition>>("Throw", []() { throw std::runtime_error("system"); });
+      scheduler.AddSystem<Read<QPosition>>("Dependent", [&is_dependent_run]() { is_dependent_run = true; });
+
+      Assert::ExpectException<std::runtime_error>([&scheduler]() { scheduler.Run(); });
+      Assert::IsTrue(is_dependent_run);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(T_SystemScheduler_ScalingBenchmark)
+      TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(T_SystemScheduler_ScalingBenchmark)
+    {
+      // synthetic 1M entity scene, the same work is timed with 1 to N threads
+      constexpr std::size_t entity_count = 1000000;
+      FlexECS::Scene::CreateEntities(entity_count, QPosition{ 0.0f }, QVelocity{ 1.0f });
+
+      std::size_t hardware_threads = (std::max)(std::thread::hardware_concurrency(), 1u);
+      for (std::size_t thread_count = 1; thread_count <= hardware_threads; thread_count *= 2)
+      {
+        ThreadPool pool(thread_count - 1);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < 10; frame++)
+        {
+          scene->ParallelEachChunk<QPosition, QVelocity>(
+            [](std::size_t count, const FlexECS::EntityID*, QPosition* positions, QVelocity* velocities)
+            {
+              for (std::size_t i = 0; i < count; i++) positions[i].x = std::sqrt(positions[i].x * positions[i].x + velocities[i].x);
+            },
+            FlexECS::Scene::DEFAULT_CHUNK_SIZE, pool
+          );
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / 10.0;
+        Logger::WriteMessage(("ParallelEachChunk 1M entities, " + std::to_string(thread_count) + " threads: " + std::to_string(milliseconds) + " ms/frame\n").c_str());
+      }
+
+      Assert::AreEqual(entity_count, scene->Count<QPosition, QVelocity>());
+    }
+
+  };
+
+  TEST_CLASS(T_SceneBinary)
+  {
+    TestScene scene;
+  public:
+
+    TEST_METHOD(T_SceneBinary_RoundTrip)
+    {
+      std::vector<FlexECS::EntityID> entities = FlexECS::Scene::CreateEntities(100, QPosition{ 1.0f }, QVelocity{ 2.0f });
+      FlexECS::Entity(entities[50]).GetComponent<QPosition>()->x = 3.0f;
+      FlexECS::Scene::DestroyEntity(entities[10]);
+      FlexECS::Entity named = FlexECS::Scene::CreateEntity("Named");
+
+      File& file = File::Open(Path(std::filesystem::temp_directory_path() / "T_SceneBinary_RoundTrip.flbscene"));
+      scene->SaveBinary(file);
+      std::shared_ptr<FlexECS::Scene> loaded = FlexECS::Scene::LoadBinary(file);
+
+      Assert::AreEqual(scene->entity_index.size(), loaded->entity_index.size());
+      Assert::IsFalse(loaded->entity_index.Contains(entities[10]));
+      Assert::AreEqual(3.0f, FlexECS::Entity(entities[50]).GetComponent<QPosition>(*loaded)->x);
+      Assert::AreEqual(2.0f, FlexECS::Entity(entities[99]).GetComponent<QVelocity>(*loaded)->x);
+      Assert::AreEqual(std::string("Named"), std::string(loaded->Internal_StringStorage_Get(*named.GetComponent<FlexECS::Scene::StringIndex>(*loaded))));
+
+      // the loaded scene is fully usable
+      FlexECS::Entity(entities[0]).RemoveComponent<QVelocity>(*loaded);
+      Assert::IsFalse(FlexECS::Entity(entities[0]).HasComponent<QVelocity>(*loaded));
+    }
+
+    TEST_METHOD(T_SceneBinary_CorruptedColumnCount)
+    {
+      FlexECS::Scene::CreateEntities(10, QPosition{ 1.0f });
+
+      File& file = File::Open(Path(std::filesystem::temp_directory_path() / "T_SceneBinary_CorruptedColumnCount.flbscene"));
+      scene->SaveBinary(file);
+
+      // skip the header and the component table to the column count of the first archetype
+      std::string data = file.Read();
+      std::size_t offset = 16;
+      uint32_t component_count = 0;
+      std::memcpy(&component_count, data.data() + offset, sizeof(uint32_t));
+      offset += sizeof(uint32_t);
+      for (uint32_t i = 0; i < component_count; i++)
+      {
+        uint32_t name_length = 0;
+        std::memcpy(&name_length, data.data() + offset, sizeof(uint32_t));
+        offset += sizeof(uint32_t) + name_length + sizeof(uint64_t);
+      }
+      offset += sizeof(uint32_t);
+
+      uint32_t column_count = component_count + 1;
+      std::memcpy(data.data() + offset, &column_count, sizeof(uint32_t));
+      file.Write(data);
+
+      std::shared_ptr<FlexECS::Scene> loaded = FlexECS::Scene::LoadBinary(file);
+      Assert::AreEqual((size_t)0, loaded->entity_index.size());
+      Assert::AreEqual((size_t)0, loaded->archetype_index.size());
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(T_SceneBinary_Benchmark)
+      TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(T_SceneBinary_Benchmark)
+    {
+      // 100k entities, the binary format against the json format
+      constexpr std::size_t entity_count = 100000;
+      FlexECS::Scene::CreateEntities(entity_count / 2, QPosition{ 1.0f }, QVelocity{ 2.0f });
+      FlexECS::Scene::CreateEntities(entity_count / 2, QPosition{ 3.0f });
+
+      std::filesystem::path directory = std::filesystem::temp_directory_path();
+      File& binary_file = File::Open(Path(directory / "T_SceneBinary_Benchmark.flbscene"));
+      File& json_file = File::Open(Path(directory / "T_SceneBinary_Benchmark.flxscene"));
+
+      auto time = [](auto&& fn)
+      {
+        auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+      };
+
+      std::shared_ptr<FlexECS::Scene> binary_scene;
+      std::shared_ptr<FlexECS::Scene> json_scene;
+      double binary_save = time([&]() { scene->SaveBinary(binary_file); });
+      double binary_load = time([&]() { binary_scene = FlexECS::Scene::LoadBinary(binary_file); });
+      double json_save = time([&]() { scene->Save(json_file); });
+      double json_load = time([&]() { json_scene = FlexECS::Scene::Load(json_file); });
+
+      Logger::WriteMessage((
+        "Binary: save " + std::to_string(binary_save) + " ms, load " + std::to_string(binary_load) + " ms, " +
+        std::to_string(std::filesystem::file_size(binary_file.path.get())) + " bytes\n"
+      ).c_str());
+      Logger::WriteMessage((
+        "Json: save " + std::to_string(json_save) + " ms, load " + std::to_string(json_load) + " ms, " +
+        std::to_string(std::filesystem::file_size(json_file.path.get())) + " bytes\n"
+      ).c_str());
+
+      Assert::AreEqual(entity_count, binary_scene->Count<QPosition>());
+      Assert::AreEqual(json_scene->Count<QPosition>(), binary_scene->Count<QPosition>());
+    }
+
+    TEST_METHOD(T_SceneBinary_JsonLoadRelinks)
+    {
+      std::vector<FlexECS::EntityID> entities = FlexECS::Scene::CreateEntities(100, QPosition{ 1.0f });
+      FlexECS::Scene::CreateEntities(100, QPosition{ 1.0f }, QVelocity{ 2.0f });
+
+      File& file = File::Open(Path(std::filesystem::temp_directory_path() / "T_SceneBinary_JsonLoadRelinks.flxscene"));
+      scene->Save(file);
+      std::shared_ptr<FlexECS::Scene> loaded = FlexECS::Scene::Load(file);
+
+      for (auto& [entity, entity_record] : loaded->entity_index)
+      {
+        Assert::IsTrue(entity_record.archetype->entities[entity_record.row] == entity);
+      }
+
+      // the edges are rebuilt on load instead of being discovered later
+      FlexECS::Archetype* position_archetype = loaded->entity_index[entities[0]].archetype;
+      FlexECS::ComponentID component = FlexECS::GetComponentID<QVelocity>();
+      Assert::IsNotNull(position_archetype->edges[component].add);
+      Assert::IsTrue(position_archetype->edges[component].add->edges[component].remove == position_archetype);
+    }
+
+  };
+
+  TEST_CLASS(T_JsonWriter)
+  {
+    TestScene scene;
+  public:
+
+    TEST_METHOD(T_JsonWriter_MatchesStream)
+    {
+      FlexECS::Scene::CreateEntities(100, QPosition{ 1.0f }, QVelocity{ 2.0f });
+      FlexECS::Scene::CreateEntity("Named");
+
+      Reflection::TypeDescriptor* type_desc = Reflection::TypeResolver<FlexECS::Scene>::Get();
+
+      std::stringstream ss;
+      type_desc->Serialize(scene.get(), ss);
+      rapidjson::Document stream_document;
+      stream_document.Parse(ss.str().c_str());
+
+      rapidjson::StringBuffer buffer;
+      Reflection::TypeDescriptor::json_writer writer(buffer);
+      type_desc->Serialize(scene.get(), writer);
+      rapidjson::Document writer_document;
+      writer_document.Parse(buffer.GetString(), buffer.GetSize());
+
+      Assert::IsFalse(stream_document.HasParseError());
+      Assert::IsFalse(writer_document.HasParseError());
+      Assert::IsTrue(stream_document == writer_document);
+    }
+
+    TEST_METHOD(T_JsonWriter_EscapesStrings)
+    {
+      // the stream path only escaped backslashes
+      std::string name = "Quote \"\\ \n";
+      FlexECS::Entity entity = FlexECS::Scene::CreateEntity(name);
+
+      File& file = File::Open(Path(std::filesystem::temp_directory_path() / "T_JsonWriter_EscapesStrings.flxscene"));
+      scene->Save(file);
+      std::shared_ptr<FlexECS::Scene> loaded = FlexECS::Scene::Load(file);
+
+      Assert::AreEqual(name, std::string(loaded->Internal_StringStorage_Get(*entity.GetComponent<FlexECS::Scene::StringIndex>(*loaded))));
+    }
+
+  };
+
+  struct BPrefab
+  {
+    FLX_REFL_SERIALIZABLE
+    std::string name;
+    std::vector<QPosition> points;
+    std::unordered_map<std::string, int> tags;
+    std::shared_ptr<QVelocity> velocity;
+  };
+  FLX_REFL_REGISTER_START(BPrefab)
+    FLX_REFL_REGISTER_PROPERTY(name)
+    FLX_REFL_REGISTER_PROPERTY(points)
+    FLX_REFL_REGISTER_PROPERTY(tags)
+    FLX_REFL_REGISTER_PROPERTY(velocity)
+  FLX_REFL_REGISTER_END;
+
+  TEST_CLASS(T_BinarySerialization)
+  {
+  public:
+
+    TEST_METHOD(T_BinarySerialization_RoundTrip)
+    {
+      BPrefab prefab{ "Prefab \"1\"", { { 1.0f }, { 2.0f } }, { { "a", 1 }, { "b", 2 } }, std::make_shared<QVelocity>(QVelocity{ 3.0f }) };
+      Reflection::TypeDescriptor* type_desc = Reflection::TypeResolver<BPrefab>::Get();
+
+      ByteWriter writer;
+      type_desc->SerializeBinary(&prefab, writer);
+
+      BPrefab loaded{};
+      ByteReader reader(writer);
+      type_desc->DeserializeBinary(&loaded, reader);
+
+      Assert::IsTrue(reader.is_valid);
+      Assert::AreEqual(writer.size(), reader.offset);
+      Assert::AreEqual(prefab.name, loaded.name);
+      Assert::AreEqual((size_t)2, loaded.points.size());
+      Assert::AreEqual(2.0f, loaded.points[1].x);
+      Assert::IsTrue(prefab.tags == loaded.tags);
+      Assert::AreEqual(3.0f, loaded.velocity->x);
+    }
+
+    TEST_METHOD(T_BinarySerialization_TriviallyCopyable)
+    {
+      Assert::IsTrue(QPosition::Reflection.is_trivially_copyable);
+      Assert::IsFalse(BPrefab::Reflection.is_trivially_copyable);
+
+      // the vector is stored as its count followed by the raw items
+      std::vector<QPosition> points(100, QPosition{ 5.0f });
+      ByteWriter writer;
+      Reflection::TypeResolver<std::vector<QPosition>>::Get()->SerializeBinary(&points, writer);
+      Assert::AreEqual(sizeof(uint64_t) + points.size() * sizeof(QPosition), writer.size());
+    }
+
+    TEST_METHOD(T_BinarySerialization_Truncated)
+    {
+      BPrefab prefab{ "Prefab", { { 1.0f } }, { { "a", 1 } }, nullptr };
+      Reflection::TypeDescriptor* type_desc = Reflection::TypeResolver<BPrefab>::Get();
+
+      ByteWriter writer;
+      type_desc->SerializeBinary(&prefab, writer);
+
+      BPrefab loaded{};
+      ByteReader reader(writer.data(), writer.size() - 1);
+      type_desc->DeserializeBinary(&loaded, reader);
+      Assert::IsFalse(reader.is_valid);
+    }
+
+  };
+
+  TEST_CLASS(T_Base64)
+  {
+    Base64::Implementation detected_implementation = Base64::Implementation::Scalar;
+  public:
+
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+      detected_implementation = Base64::GetImplementation();
+    }
+
+    TEST_METHOD_CLEANUP(Cleanup)
+    {
+      Base64::SetImplementation(detected_implementation);
+    }
+
+    TEST_METHOD(T_Base64_RoundTrip)
+    {
+      // every implementation against the same known string and random data of every tail length
+      for (Base64::Implementation implementation : { Base64::Implementation::Scalar, Base64::Implementation::SSSE3, Base64::Implementation::AVX2 })
+      {
+        Base64::SetImplementation(implementation);
+
+        std::string text = "FlexEngine";
+        Assert::AreEqual(std::string("RmxleEVuZ2luZQ=="), Base64::Encode(text.data(), text.size()));
+
+        for (std::size_t size = 0; size < 200; size++)
+        {
+          std::vector<BYTE> data(size);
+          for (std::size_t i = 0; i < size; i++) data[i] = static_cast<BYTE>(i * 31 + size);
+
+          std::string encoded = Base64::Encode(data);
+          Assert::AreEqual(Base64::EncodedSize(size), encoded.size());
+          Assert::IsTrue(Base64::Decode(encoded) == data);
+        }
+      }
+    }
+
+    TEST_METHOD(T_Base64_Invalid)
+    {
+      std::vector<BYTE> data(100, 0xAB);
+      std::string encoded = Base64::Encode(data);
+
+      // the bad character lands in the middle of a simd block
+      for (std::size_t position : { std::size_t(0), std::size_t(20), std::size_t(70) })
+      {
+        std::string corrupted = encoded;
+        corrupted[position] = '*';
+
+        std::vector<BYTE> out(Base64::DecodedSize(corrupted.size()));
+        std::size_t out_size = 0;
+        Assert::IsFalse(Base64::Decode(corrupted.data(), corrupted.size(), out.data(), out_size));
+      }
+
+      // a single character can't be decoded
+      std::vector<BYTE> out(3);
+      std::size_t out_size = 0;
+      Assert::IsFalse(Base64::Decode("QUJDR", 5, out.data(), out_size));
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(T_Base64_Benchmark)
+      TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(T_Base64_Benchmark)
+    {
+      std::vector<BYTE> data(16 << 20);
+      for (std::size_t i = 0; i < data.size(); i++) data[i] = static_cast<BYTE>(i * 2654435761u >> 24);
+
+      std::string encoded(Base64::EncodedSize(data.size()), '\0');
+      std::vector<BYTE> decoded(Base64::DecodedSize(encoded.size()));
+
+      for (Base64::Implementation implementation : { Base64::Implementation::Scalar, Base64::Implementation::SSSE3, Base64::Implementation::AVX2 })
+      {
+        Base64::SetImplementation(implementation);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        Base64::Encode(data.data(), data.size(), &encoded[0]);
+        auto middle = std::chrono::high_resolution_clock::now();
+        std::size_t decoded_size = 0;
+        Base64::Decode(encoded.data(), encoded.size(), decoded.data(), decoded_size);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double encode_seconds = std::chrono::duration<double>(middle - start).count();
+        double decode_seconds = std::chrono::duration<double>(end - middle).count();
+        Logger::WriteMessage((
+          "Base64 implementation " + std::to_string(static_cast<int>(Base64::GetImplementation())) +
+          ": encode " + std::to_string(data.size() / encode_seconds / 1e9) + " GB/s, decode " +
+          std::to_string(data.size() / decode_seconds / 1e9) + " GB/s\n"
+        ).c_str());
+
+        Assert::AreEqual(data.size(), decoded_size);
+        Assert::IsTrue(std::equal(data.begin(), data.end(), decoded.begin()));
+      }
+    }
+
+  };
+
+  TEST_CLASS(T_ChangeDetection)
+  {
+    TestScene scene;
+    std::vector<FlexECS::EntityID> entities;
+
+    // Number of rows the query visits
+    template <typename... Ts>
+    std::size_t Visit()
+    {
+      std::size_t count = 0;
+      scene->EachChunk<Ts...>([&count](std::size_t chunk_count, const FlexECS::EntityID*, auto*...) { count += chunk_count; });
+      return count;
+    }
+
+  public:
+
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+      entities = FlexECS::Scene::CreateEntities(3000, QPosition{ 0.0f }, QVelocity{ 1.0f });
+    }
+
+    TEST_METHOD(T_ChangeDetection_SkipsUnchanged)
+    {
+      using FlexECS::Changed;
+      constexpr std::size_t chunk_size = FlexECS::Column::CHANGE_CHUNK_SIZE;
+
+      // the first run sees everything, the next run nothing
+      Assert::AreEqual((size_t)3000, Visit<Changed<const QPosition>>());
+      Assert::AreEqual((size_t)0, Visit<Changed<const QPosition>>());
+
+      // only the change chunk of the written entity is visited
+      FlexECS::Entity(entities[1500]).GetComponent<QPosition>()->x = 5.0f;
+      Assert::AreEqual(chunk_size, Visit<Changed<const QPosition>>());
+
+      // any changed term passes the filter
+      FlexECS::Entity(entities[2999]).GetComponent<QVelocity>();
+      Assert::AreEqual((size_t)3000, Visit<Changed<const QPosition>, Changed<const QVelocity>>());
+      FlexECS::Entity(entities[2999]).GetComponent<QVelocity>();
+      Assert::AreEqual(3000 - 2 * chunk_size, Visit<Changed<const QPosition>, Changed<const QVelocity>>());
+
+      // a query does not see its own writes
+      Assert::AreEqual((size_t)3000, Visit<Changed<QPosition>>());
+      Assert::AreEqual((size_t)0, Visit<Changed<QPosition>>());
+
+      // Count ignores the filter
+      Assert::AreEqual((size_t)3000, scene->Count<Changed<const QPosition>>());
+    }
+
+    TEST_METHOD(T_ChangeDetection_ConstAccess)
+    {
+      using FlexECS::Changed;
+
+      Visit<Changed<const QPosition>>();
+
+      // reading through const does not mark the rows
+      Assert::AreEqual(0.0f, FlexECS::Entity(entities[10]).GetComponent<const QPosition>()->x);
+      scene->Each<const QPosition, QVelocity>([](const QPosition&, QVelocity&) {});
+      Assert::AreEqual((size_t)0, Visit<Changed<const QPosition>>());
+
+      // mutable iteration marks every row
+      scene->Each<QPosition>([](QPosition& position) { position.x += 1.0f; });
+      Assert::AreEqual((size_t)3000, Visit<Changed<const QPosition>>());
+
+      // structural changes count as writes
+      FlexECS::Scene::DestroyEntity(entities[3]);
+      Assert::AreEqual(FlexECS::Column::CHANGE_CHUNK_SIZE, Visit<Changed<const QPosition>>());
+    }
+
+    TEST_METHOD(T_ChangeDetection_ParallelEach)
+    {
+      using FlexECS::Changed;
+
+      std::atomic<std::size_t> count = 0;
+      auto count_rows = [&count](const QPosition&, QVelocity&) { count++; };
+
+      scene->ParallelEach<Changed<const QPosition>, QVelocity>(count_rows, 100);
+      Assert::AreEqual((size_t)3000, count.load());
+
+      count = 0;
+      scene->ParallelEach<Changed<const QPosition>, QVelocity>(count_rows, 100);
+      Assert::AreEqual((size_t)0, count.load());
+
+      count = 0;
+      FlexECS::Entity(entities[5]).GetComponent<QPosition>();
+      scene->ParallelEach<Changed<const QPosition>, QVelocity>(count_rows, 100);
+      Assert::AreEqual(FlexECS::Column::CHANGE_CHUNK_SIZE, count.load());
+    }
+
+    TEST_METHOD(T_ChangeDetection_PerCaller)
+    {
+      using FlexECS::Changed;
+      const FlexECS::QueryCallerID first = FlexECS::Internal_NextQueryCallerID();
+      const FlexECS::QueryCallerID second = FlexECS::Internal_NextQueryCallerID();
+
+      // each caller sees every row on its first run
+      {
+        FlexECS::QueryCallerScope scope(first);
+        Assert::AreEqual((size_t)3000, Visit<Changed<const QPosition>>());
+      }
+      {
+        FlexECS::QueryCallerScope scope(second);
+        Assert::AreEqual((size_t)3000, Visit<Changed<const QPosition>>());
+      }
+      Assert::AreEqual((size_t)0, (size_t)FlexECS::GetQueryCaller());
+
+      // a change is seen once by each caller
+      FlexECS::Entity(entities[10]).GetComponent<QPosition>();
+      {
+        FlexECS::QueryCallerScope scope(first);
+        Assert::AreEqual(FlexECS::Column::CHANGE_CHUNK_SIZE, Visit<Changed<const QPosition>>());
+        Assert::AreEqual((size_t)0, Visit<Changed<const QPosition>>());
+      }
+      {
+        FlexECS::QueryCallerScope scope(second);
+        Assert::AreEqual(FlexECS::Column::CHANGE_CHUNK_SIZE, Visit<Changed<const QPosition>>());
+      }
+    }
+
+  };
+
+  TEST_CLASS(T_TransformHierarchy)
+  {
+    TestScene scene;
+    std::vector<FlexECS::EntityID> entities;
+
+    static Matrix4x4 Translation(float x)
+    {
+      return Matrix4x4::Translate(Matrix4x4::Identity, Vector3(x, 0.0f, 0.0f));
+    }
+
+  public:
+
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+      for (int i = 0; i < 4; i++) entities.push_back(FlexECS::Scene::CreateEntity());
+    }
+
+    TEST_METHOD(T_TransformHierarchy_WorldMatrices)
+    {
+      FlexECS::TransformHierarchy& hierarchy = scene->transform_hierarchy;
+
+      // the child is added before its parent, so the hierarchy has to sort them
+      hierarchy.SetLocalMatrix(entities[2], Translation(3.0f));
+      hierarchy.SetLocalMatrix(entities[1], Translation(2.0f));
+      hierarchy.SetLocalMatrix(entities[0], Translation(1.0f));
+      hierarchy.SetParent(entities[2], entities[1]);
+      hierarchy.SetParent(entities[1], entities[0]);
+      hierarchy.Update();
+
+      Assert::AreEqual((size_t)3, hierarchy.GetChangedCount());
+      Assert::IsTrue(hierarchy.GetEntities()[0] == entities[0]);
+      AreEqualMatrix(Translation(6.0f), hierarchy.GetWorldMatrix(entities[2]), 0.0001f);
+
+      // the simd multiply must match the matrix operator
+      Matrix4x4 local = Quaternion::FromEulerAnglesDeg(Vector3(10.0f, 20.0f, 30.0f)).ToRotationMatrix();
+      hierarchy.SetLocalMatrix(entities[0], local);
+      hierarchy.Update();
+      AreEqualMatrix(local * Translation(2.0f) * Translation(3.0f), hierarchy.GetWorldMatrix(entities[2]), 0.0001f);
+    }
+
+    TEST_METHOD(T_TransformHierarchy_DirtySubtree)
+    {
+      FlexECS::TransformHierarchy& hierarchy = scene->transform_hierarchy;
+      hierarchy.SetParent(entities[1], entities[0]);
+      hierarchy.SetParent(entities[2], entities[1]);
+      hierarchy.Update();
+
+      // nothing changed
+      hierarchy.Update();
+      Assert::AreEqual((size_t)0, hierarchy.GetChangedCount());
+
+      // only the entity and its descendants are recomputed
+      hierarchy.SetLocalMatrix(entities[1], Translation(5.0f));
+      hierarchy.Update();
+      Assert::AreEqual((size_t)2, hierarchy.GetChangedCount());
+      AreEqualMatrix(Translation(5.0f), hierarchy.GetWorldMatrix(entities[2]), 0.0001f);
+    }
+
+    TEST_METHOD(T_TransformHierarchy_Remove)
+    {
+      FlexECS::TransformHierarchy& hierarchy = scene->transform_hierarchy;
+      hierarchy.SetLocalMatrix(entities[0], Translation(1.0f));
+      hierarchy.SetLocalMatrix(entities[1], Translation(2.0f));
+      hierarchy.SetParent(entities[1], entities[0]);
+      hierarchy.Update();
+
+      // the children of a removed entity become roots
+      // the entity is flagged right away and compacted by the next Update
+      hierarchy.Remove(entities[0]);
+      Assert::IsFalse(hierarchy.Contains(entities[0]));
+      Assert::AreEqual((size_t)1, hierarchy.GetChangedCount());
+      hierarchy.Update();
+      Assert::AreEqual((size_t)1, hierarchy.size());
+      Assert::IsFalse(hierarchy.Contains(entities[0]));
+      AreEqualMatrix(Translation(2.0f), hierarchy.GetWorldMatrix(entities[1]), 0.0001f);
+
+      // a cycle detaches one of the entities instead of looping forever
+      hierarchy.SetParent(entities[2], entities[1]);
+      hierarchy.SetParent(entities[1], entities[2]);
+      hierarchy.Update();
+      Assert::AreEqual((size_t)2, hierarchy.size());
+
+      FlexECS::Scene::DestroyEntity(entities[1]);
+      hierarchy.RemoveDestroyed(scene->entity_index);
+      Assert::IsFalse(hierarchy.Contains(entities[1]));
+      Assert::AreEqual((size_t)1, hierarchy.size());
+    }
+
+    TEST_METHOD(T_TransformHierarchy_RemoveAndAddParent)
+    {
+      FlexECS::TransformHierarchy& hierarchy = scene->transform_hierarchy;
+      hierarchy.SetLocalMatrix(entities[0], Translation(1.0f));
+      hierarchy.SetLocalMatrix(entities[1], Translation(2.0f));
+      hierarchy.SetParent(entities[1], entities[0]);
+      hierarchy.Update();
+
+      // the parent is added again after its child, the child keeps it
+      hierarchy.Remove(entities[0]);
+      hierarchy.Add(entities[0]);
+      hierarchy.SetLocalMatrix(entities[0], Translation(5.0f));
+      hierarchy.Update();
+      Assert::IsTrue(hierarchy.GetEntities()[0] == entities[0]);
+      AreEqualMatrix(Translation(7.0f), hierarchy.GetWorldMatrix(entities[1]), 0.0001f);
+    }
+
+  };
+
+  struct SPath
+  {
+    FLX_REFL_SERIALIZABLE
+    float x;
+    FlexECS::Scene::StringIndex path;
+  };
+  FLX_REFL_REGISTER_START(SPath)
+    FLX_REFL_REGISTER_PROPERTY(x)
+    FLX_REFL_REGISTER_STRING_INDEX(path)
+  FLX_REFL_REGISTER_END;
+
+  TEST_CLASS(T_StringStorage)
+  {
+    TestScene scene;
+  public:
+
+    TEST_METHOD(T_StringStorage_Interning)
+    {
+      FlexECS::Scene::StringIndex a = scene->Internal_StringStorage_New("/shaders/texture");
+      FlexECS::Scene::StringIndex b = scene->Internal_StringStorage_New(std::string("/shaders/texture"));
+      FlexECS::Scene::StringIndex c = scene->Internal_StringStorage_New("/images/box.png");
+
+      Assert::AreEqual(a, b);
+      Assert::AreNotEqual(a, c);
+      Assert::AreEqual(std::string("/images/box.png"), std::string(scene->Internal_StringStorage_Get(c)));
+
+      // the characters are stored once, each with a null terminator
+      Assert::AreEqual(sizeof("/shaders/texture") + sizeof("/images/box.png"), scene->Internal_StringStorage_GetSize());
+
+      // entities with the same name share the string
+      FlexECS::Entity first = FlexECS::Scene::CreateEntity("Tile");
+      FlexECS::Entity second = FlexECS::Scene::CreateEntity("Tile");
+      Assert::AreEqual(*first.GetComponent<FlexECS::Scene::StringIndex>(), *second.GetComponent<FlexECS::Scene::StringIndex>());
+    }
+
+    TEST_METHOD(T_StringStorage_DeleteIsSafe)
+    {
+      FlexECS::Scene::StringIndex a = scene->Internal_StringStorage_New("shared");
+      FlexECS::Scene::StringIndex b = scene->Internal_StringStorage_New("shared");
+
+      // the other reference keeps the string
+      scene->Internal_StringStorage_Delete(a);
+      Assert::AreEqual(std::string("shared"), std::string(scene->Internal_StringStorage_Get(b)));
+
+      // a released index is not reused before the compaction
+      scene->Internal_StringStorage_Delete(b);
+      scene->Internal_StringStorage_Delete(b);
+      FlexECS::Scene::StringIndex c = scene->Internal_StringStorage_New("other");
+      Assert::AreNotEqual(a, c);
+      Assert::AreEqual(std::string("shared"), std::string(scene->Internal_StringStorage_Get(a)));
+    }
+
+    TEST_METHOD(T_StringStorage_Compact)
+    {
+      for (int i = 0; i < 100; i++) scene->Internal_StringStorage_New("unused " + std::to_string(i));
+
+      std::vector<FlexECS::Entity> entities;
+      for (int i = 0; i < 10; i++)
+      {
+        FlexECS::Entity entity = FlexECS::Scene::CreateEntity("Entity " + std::to_string(i % 2));
+        entity.AddComponent<SPath>({ static_cast<float>(i), scene->Internal_StringStorage_New("/images/" + std::to_string(i % 3) + ".png") });
+        entities.push_back(entity);
+      }
+      FlexECS::Scene::DestroyEntity(entities.back());
+      entities.pop_back();
+
+      std::size_t size = scene->Internal_StringStorage_GetSize();
+      scene->Internal_StringStorage_Compact();
+      Assert::IsTrue(scene->Internal_StringStorage_GetSize() < size);
+
+      // the indexes in the components were rewritten
+      for (std::size_t i = 0; i < entities.size(); i++)
+      {
+        std::string name(scene->Internal_StringStorage_Get(*entities[i].GetComponent<FlexECS::Scene::StringIndex>()));
+        std::string path(scene->Internal_StringStorage_Get(entities[i].GetComponent<SPath>()->path));
+        Assert::AreEqual("Entity " + std::to_string(i % 2), name);
+        Assert::AreEqual("/images/" + std::to_string(i % 3) + ".png", path);
+      }
+
+      // the strings are still interned after the compaction
+      Assert::AreEqual(entities[0].GetComponent<SPath>()->path, scene->Internal_StringStorage_New("/images/0.png"));
+      Assert::AreEqual(std::string("unused 5"), std::string(scene->Internal_StringStorage_Get(scene->Internal_StringStorage_New("unused 5"))));
+    }
+
+    TEST_METHOD(T_StringStorage_CompactResources)
+    {
+      for (int i = 0; i < 10; i++) scene->Internal_StringStorage_New("unused " + std::to_string(i));
+      scene->SetResource<SPath>({ 1.0f, scene->Internal_StringStorage_New("/levels/1.json") });
+
+      // the string is only referenced by the resource, it moves to the front
+      scene->Internal_StringStorage_Compact();
+      Assert::AreEqual(std::string("/levels/1.json"), std::string(scene->Internal_StringStorage_Get(scene->GetResource<SPath>()->path)));
+      Assert::AreEqual(sizeof("/levels/1.json"), scene->Internal_StringStorage_GetSize());
+    }
+
+  };
+
+  struct RSettings
+  {
+    FLX_REFL_SERIALIZABLE
+    int difficulty;
+    float volume;
+  };
+  FLX_REFL_REGISTER_START(RSettings)
+    FLX_REFL_REGISTER_PROPERTY(difficulty)
+    FLX_REFL_REGISTER_PROPERTY(volume)
+  FLX_REFL_REGISTER_END;
+
+  TEST_CLASS(T_Resources)
+  {
+    TestScene scene;
+  public:
+
+    TEST_METHOD(T_Resources_SetGet)
+    {
+      Assert::IsNull(scene->GetResource<RSettings>());
+
+      RSettings& settings = scene->SetResource<RSettings>({ 2, 0.5f });
+      Assert::IsTrue(&settings == scene->GetResource<RSettings>());
+      Assert::IsTrue(scene->HasResource<RSettings>());
+
+      // setting it again overwrites the same resource
+      scene->SetResource<RSettings>({ 3, 1.0f });
+      Assert::AreEqual(3, scene->GetResource<RSettings>()->difficulty);
+      Assert::AreEqual((size_t)1, scene->resources.size());
+
+      // resources are not entities
+      Assert::AreEqual((size_t)0, scene->Count<RSettings>());
+
+      scene->RemoveResource<RSettings>();
+      Assert::IsFalse(scene->HasResource<RSettings>());
+    }
+
+    TEST_METHOD(T_Resources_Serialization)
+    {
+      scene->SetResource<RSettings>({ 4, 0.25f });
+      FlexECS::Scene::CreateEntity("Entity");
+
+      File& json_file = File::Open(Path(std::filesystem::temp_directory_path() / "T_Resources_Serialization.flxscene"));
+      scene->Save(json_file);
+      std::shared_ptr<FlexECS::Scene> json_loaded = FlexECS::Scene::Load(json_file);
+      Assert::AreEqual(4, json_loaded->GetResource<RSettings>()->difficulty);
+      Assert::AreEqual(0.25f, json_loaded->GetResource<RSettings>()->volume);
+
+      File& binary_file = File::Open(Path(std::filesystem::temp_directory_path() / "T_Resources_Serialization.flbscene"));
+      scene->SaveBinary(binary_file);
+      std::shared_ptr<FlexECS::Scene> binary_loaded = FlexECS::Scene::LoadBinary(binary_file);
+      Assert::AreEqual(4, binary_loaded->GetResource<RSettings>()->difficulty);
+      Assert::AreEqual(0.25f, binary_loaded->GetResource<RSettings>()->volume);
+    }
+
+  };
+
+}
+
+
+namespace T_Physics
+{
+
+  TEST_CLASS(T_Bounds)
+  {
+    Physics::Implementation default_implementation = Physics::GetImplementation();
+
+    static Physics::BoundsSoA RandomBounds(std::size_t count, unsigned int seed)
+    {
+      std::mt19937 rng(seed);
+      std::uniform_real_distribution<float> position(0.0f, 100.0f);
+      std::uniform_real_distribution<float> scale(0.1f, 5.0f);
+
+      Physics::BoundsSoA bounds;
+      bounds.Resize(count);
+      for (std::size_t i = 0; i < count; i++)
+      {
+        Vector2 min(position(rng), position(rng));
+        bounds.Set(i, min, min + Vector2(scale(rng), scale(rng)));
+      }
+      return bounds;
+    }
+
+  public:
+
+    TEST_METHOD_CLEANUP(Cleanup)
+    {
+      Physics::SetImplementation(default_implementation);
+    }
+
+    TEST_METHOD(T_Bounds_KernelsMatchScalar)
+    {
+      constexpr std::size_t count = 1003; // not a multiple of 8
+      Physics::BoundsSoA bounds = RandomBounds(count, 11);
+      Vector2 query_min(40.0f, 40.0f);
+      Vector2 query_max(60.0f, 45.0f);
+
+      std::vector<float> center_x(count), center_y(count), half_x(count), half_y(count);
+      for (std::size_t i = 0; i < count; i++)
+      {
+        center_x[i] = (bounds.min_x[i] + bounds.max_x[i]) / 2;
+        center_y[i] = (bounds.min_y[i] + bounds.max_y[i]) / 2;
+        half_x[i] = (bounds.max_x[i] - bounds.min_x[i]) / 2;
+        half_y[i] = (bounds.max_y[i] - bounds.min_y[i]) / 2;
+      }
+
+      // scalar reference
+      Physics::SetImplementation(Physics::Implementation::Scalar);
+      Physics::BoundsSoA expected_bounds;
+      expected_bounds.Resize(count);
+      Physics::ComputeBounds(count, center_x.data(), center_y.data(), half_x.data(), half_y.data(), expected_bounds.min_x.data(), expected_bounds.min_y.data(), expected_bounds.max_x.data(), expected_bounds.max_y.data());
+      std::vector<uint32_t> expected_overlaps;
+      Physics::FindOverlaps(query_min, query_max, bounds, 0, count, expected_overlaps);
+      Assert::IsFalse(expected_overlaps.empty());
+
+      for (auto implementation : { Physics::Implementation::SSE, Physics::Implementation::AVX2 })
+      {
+        Physics::SetImplementation(implementation);
+
+        Physics::BoundsSoA computed;
+        computed.Resize(count);
+        Physics::ComputeBounds(count, center_x.data(), center_y.data(), half_x.data(), half_y.data(), computed.min_x.data(), computed.min_y.data(), computed.max_x.data(), computed.max_y.data());
+        Assert::IsTrue(expected_bounds.min_x == computed.min_x && expected_bounds.min_y == computed.min_y);
+        Assert::IsTrue(expected_bounds.max_x == computed.max_x && expected_bounds.max_y == computed.max_y);
+
+        for (std::size_t index = 0; index < count; index += 8)
+        {
+          Physics::SetImplementation(Physics::Implementation::Scalar);
+          uint32_t expected_mask = Physics::OverlapMask8(query_min, query_max, bounds, index);
+          Physics::SetImplementation(implementation);
+          Assert::AreEqual(expected_mask, Physics::OverlapMask8(query_min, query_max, bounds, index));
+        }
+
+        // the range doesn't have to start on a block
+        std::vector<uint32_t> overlaps;
+        Physics::FindOverlaps(query_min, query_max, bounds, 0, count, overlaps);
+        Assert::IsTrue(expected_overlaps == overlaps);
+      }
+    }
+
+    TEST_METHOD(T_Bounds_FindOverlapsSorted)
+    {
+      Physics::BoundsSoA bounds = RandomBounds(500, 5);
+
+      // sort by min x
+      std::vector<std::size_t> order(bounds.size());
+      for (std::size_t i = 0; i < order.size(); i++) order[i] = i;
+      std::sort(order.begin(), order.end(), [&bounds](std::size_t a, std::size_t b) { return bounds.min_x[a] < bounds.min_x[b]; });
+      Physics::BoundsSoA sorted;
+      sorted.Resize(bounds.size());
+      for (std::size_t i = 0; i < order.size(); i++) sorted.Set(i, bounds.GetMin(order[i]), bounds.GetMax(order[i]));
+
+      for (auto implementation : { Physics::Implementation::Scalar, Physics::Implementation::SSE, Physics::Implementation::AVX2 })
+      {
+        Physics::SetImplementation(implementation);
+        for (std::size_t i = 0; i < sorted.size(); i += 7)
+        {
+          std::vector<uint32_t> expected;
+          std::vector<uint32_t> actual;
+          Physics::FindOverlaps(sorted.GetMin(i), sorted.GetMax(i), sorted, i + 1, sorted.size(), expected, false);
+          Physics::FindOverlaps(sorted.GetMin(i), sorted.GetMax(i), sorted, i + 1, sorted.size(), actual, true);
+          Assert::IsTrue(expected == actual);
+        }
+      }
+
+      // shrinking turns the removed boxes into padding
+      sorted.Resize(3);
+      Assert::AreEqual(0u, Physics::OverlapMask8(Vector2(-1000.0f, -1000.0f), Vector2(1000.0f, 1000.0f), sorted, 0) & ~0x7u);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(T_Bounds_Benchmark)
+      TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(T_Bounds_Benchmark)
+    {
+      constexpr std::size_t count = 1000000;
+      Physics::BoundsSoA bounds = RandomBounds(count, 3);
+      std::vector<float> center_x(count, 1.0f), center_y(count, 2.0f), half_x(count, 0.5f), half_y(count, 0.5f);
+      std::vector<uint32_t> overlaps;
+      overlaps.reserve(count);
+
+      for (auto implementation : { Physics::Implementation::Scalar, Physics::Implementation::SSE, Physics::Implementation::AVX2 })
+      {
+        Physics::SetImplementation(implementation);
+        std::string name = implementation == Physics::Implementation::Scalar ? "Scalar" : (implementation == Physics::Implementation::SSE ? "SSE" : "AVX2");
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int run = 0; run < 10; run++)
+        {
+          Physics::ComputeBounds(count, center_x.data(), center_y.data(), half_x.data(), half_y.data(), bounds.min_x.data(), bounds.min_y.data(), bounds.max_x.data(), bounds.max_y.data());
+        }
+        double compute_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / 10.0;
+
+        bounds = RandomBounds(count, 3);
+        start = std::chrono::high_resolution_clock::now();
+        for (int run = 0; run < 10; run++)
+        {
+          overlaps.clear();
+          Physics::FindOverlaps(Vector2(40.0f, 40.0f), Vector2(60.0f, 60.0f), bounds, 0, count, overlaps);
+        }
+        double overlap_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / 10.0;
+
+        Logger::WriteMessage((name + " 1M boxes: ComputeBounds " + std::to_string(compute_milliseconds) + " ms, FindOverlaps " + std::to_string(overlap_milliseconds) + " ms\n").c_str());
+      }
+    }
+
+  };
+
+  TEST_CLASS(T_Broadphase)
+  {
+    struct Box
+    {
+      Vector2 min;
+      Vector2 max;
+      bool is_static;
+    };
+
+    // O(n^2) reference, each pair once with the lower index first
+    static std::set<std::pair<uint32_t, uint32_t>> BruteForce(const std::vector<Box>& boxes)
+    {
+      std::set<std::pair<uint32_t, uint32_t>> pairs;
+      for (uint32_t a = 0; a < boxes.size(); a++)
+      {
+        for (uint32_t b = a + 1; b < boxes.size(); b++)
+        {
+          if (boxes[a].is_static && boxes[b].is_static) continue;
+          if (boxes[a].max.x < boxes[b].min.x || boxes[a].max.y < boxes[b].min.y || boxes[a].min.x > boxes[b].max.x || boxes[a].min.y > boxes[b].max.y) continue;
+          pairs.insert({ a, b });
+        }
+      }
+      return pairs;
+    }
+
+    static std::set<std::pair<uint32_t, uint32_t>> ToSet(const std::vector<Physics::Broadphase::Pair>& found)
+    {
+      std::set<std::pair<uint32_t, uint32_t>> pairs;
+      for (const auto& pair : found)
+      {
+        Assert::IsTrue(pair.a < pair.b);
+        Assert::IsTrue(pairs.insert({ pair.a, pair.b }).second, L"Pair reported twice");
+      }
+      return pairs;
+    }
+
+    static std::vector<Box> RandomBoxes(std::size_t count, float extent, float size, unsigned int seed)
+    {
+      std::mt19937 rng(seed);
+      std::uniform_real_distribution<float> position(0.0f, extent);
+      std::uniform_real_distribution<float> scale(0.2f, size);
+
+      std::vector<Box> boxes(count);
+      for (std::size_t i = 0; i < count; i++)
+      {
+        Vector2 min(position(rng), position(rng));
+        boxes[i] = { min, min + Vector2(scale(rng), scale(rng)), i % 5 == 0 };
+      }
+      return boxes;
+    }
+
+  public:
+
+    TEST_METHOD(T_Broadphase_MatchesBruteForce)
+    {
+      for (auto method : { Physics::Broadphase::Method::SweepAndPrune, Physics::Broadphase::Method::UniformGrid })
+      {
+        std::vector<Box> boxes = RandomBoxes(500, 100.0f, 6.0f, 7);
+
+        // too big for the grid, tested against every box
+        boxes.push_back({ Vector2(10, 10), Vector2(60, 60), false });
+        boxes.push_back({ Vector2(40, 0), Vector2(90, 40), true });
+
+        Physics::Broadphase broadphase;
+        broadphase.SetMethod(method);
+        broadphase.SetCellSize(4.0f);
+        for (uint32_t i = 0; i < boxes.size(); i++) broadphase.Add(boxes[i].min, boxes[i].max, i, boxes[i].is_static);
+
+        // move the dynamic boxes a little each frame so the sorted order is reused
+        for (int frame = 0; frame < 10; frame++)
+        {
+          for (uint32_t i = 0; i < boxes.size(); i++)
+          {
+            if (boxes[i].is_static) continue;
+
+            Vector2 offset(((i + frame) % 3) - 1.0f, ((i * 7 + frame) % 3) - 1.0f);
+            boxes[i].min += offset;
+            boxes[i].max += offset;
+            broadphase.Update(i, boxes[i].min, boxes[i].max);
+          }
+
+          Assert::IsTrue(BruteForce(boxes) == ToSet(broadphase.FindPairs()));
+        }
+      }
+    }
+
+    TEST_METHOD(T_Broadphase_AddRemove)
+    {
+      Physics::Broadphase broadphase;
+      auto a = broadphase.Add(Vector2(0, 0), Vector2(1, 1), 10);
+      auto b = broadphase.Add(Vector2(1, 1), Vector2(2, 2), 20); // touching counts
+      auto c = broadphase.Add(Vector2(0, 0), Vector2(2, 2), 30, true);
+      auto d = broadphase.Add(Vector2(0, 0), Vector2(2, 2), 40, true); // static-static is skipped
+
+      Assert::AreEqual((size_t)5, broadphase.FindPairs().size());
+
+      broadphase.Remove(a);
+      Assert::IsFalse(broadphase.IsValid(a));
+      Assert::AreEqual((size_t)2, broadphase.FindPairs().size());
+
+      // the removed proxy is reused
+      auto e = broadphase.Add(Vector2(5, 5), Vector2(6, 6), 50);
+      Assert::AreEqual(a, e);
+      Assert::AreEqual((uint64_t)50, broadphase.GetUserData(e));
+      Assert::AreEqual((size_t)2, broadphase.FindPairs().size());
+
+      broadphase.SetMethod(Physics::Broadphase::Method::UniformGrid);
+      Assert::AreEqual((size_t)2, broadphase.FindPairs().size());
+      Assert::AreEqual((size_t)4, broadphase.size());
+    }
+
+    TEST_METHOD(T_Broadphase_AddedRemovedPairs)
+    {
+      Physics::Broadphase broadphase;
+      auto a = broadphase.Add(Vector2(0, 0), Vector2(1, 1));
+      auto b = broadphase.Add(Vector2(0.5f, 0.5f), Vector2(1.5f, 1.5f));
+      auto c = broadphase.Add(Vector2(5, 5), Vector2(6, 6));
+
+      broadphase.FindPairs();
+      Assert::AreEqual((size_t)1, broadphase.GetAddedPairs().size());
+      Assert::AreEqual(a, broadphase.GetAddedPairs()[0].a);
+      Assert::AreEqual(b, broadphase.GetAddedPairs()[0].b);
+      Assert::IsTrue(broadphase.GetRemovedPairs().empty());
+
+      // nothing moved
+      broadphase.FindPairs();
+      Assert::IsTrue(broadphase.GetAddedPairs().empty());
+      Assert::IsTrue(broadphase.GetRemovedPairs().empty());
+
+      // b leaves a and enters c
+      broadphase.Update(b, Vector2(5.5f, 5.5f), Vector2(6.5f, 6.5f));
+      broadphase.FindPairs();
+      Assert::AreEqual((size_t)1, broadphase.GetAddedPairs().size());
+      Assert::AreEqual(b, broadphase.GetAddedPairs()[0].a);
+      Assert::AreEqual(c, broadphase.GetAddedPairs()[0].b);
+      Assert::AreEqual((size_t)1, broadphase.GetRemovedPairs().size());
+      Assert::AreEqual(a, broadphase.GetRemovedPairs()[0].a);
+
+      // the removed proxy isn't reused until its pairs are reported as ended
+      broadphase.Remove(c);
+      auto d = broadphase.Add(Vector2(5, 5), Vector2(6, 6));
+      Assert::AreNotEqual(c, d);
+      broadphase.FindPairs();
+      Assert::AreEqual((size_t)1, broadphase.GetRemovedPairs().size());
+      Assert::AreEqual(c, broadphase.GetRemovedPairs()[0].b);
+      Assert::AreEqual(c, broadphase.Add(Vector2(20, 20), Vector2(21, 21)));
+    }
+
+    TEST_METHOD(T_Broadphase_NonFiniteBounds)
+    {
+      const float inf = std::numeric_limits<float>::infinity();
+      const float nan = std::numeric_limits<float>::quiet_NaN();
+
+      for (auto method : { Physics::Broadphase::Method::SweepAndPrune, Physics::Broadphase::Method::UniformGrid })
+      {
+        Physics::Broadphase broadphase;
+        broadphase.SetMethod(method);
+        auto a = broadphase.Add(Vector2(0, 0), Vector2(1, 1));
+        auto b = broadphase.Add(Vector2(nan, 0), Vector2(1, 1));
+        broadphase.Add(Vector2(-inf, -inf), Vector2(inf, inf));
+        broadphase.Add(Vector2(-1e30f, -1e30f), Vector2(1e30f, 1e30f)); // finite, but past the grid
+
+        // the rejected bodies overlap nothing, the huge one only overlaps a
+        Assert::AreEqual((size_t)1, broadphase.FindPairs().size());
+
+        // rejected updates keep the previous bounds
+        broadphase.Update(b, Vector2(0, 0), Vector2(1, 1));
+        broadphase.Update(a, Vector2(nan, nan), Vector2(nan, nan));
+        Assert::AreEqual(0.0f, broadphase.GetMin(a).x);
+        Assert::AreEqual((size_t)3, broadphase.FindPairs().size());
+      }
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(T_Broadphase_Benchmark)
+      TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(T_Broadphase_Benchmark)
+    {
+      // bodies spread over a square world at a constant density, moving a little each frame
+      for (std::size_t count : { 1000, 10000, 50000 })
+      {
+        std::vector<Box> boxes = RandomBoxes(count, std::sqrt(static_cast<float>(count)) * 4.0f, 1.5f, 3);
+
+        for (auto method : { Physics::Broadphase::Method::SweepAndPrune, Physics::Broadphase::Method::UniformGrid })
+        {
+          Physics::Broadphase broadphase;
+          broadphase.SetMethod(method);
+          broadphase.SetCellSize(2.0f);
+          for (uint32_t i = 0; i < boxes.size(); i++) broadphase.Add(boxes[i].min, boxes[i].max, i, boxes[i].is_static);
+          broadphase.FindPairs();
+
+          auto start = std::chrono::high_resolution_clock::now();
+          for (int frame = 0; frame < 10; frame++)
+          {
+            for (uint32_t i = 0; i < boxes.size(); i++)
+            {
+              Vector2 offset(0.01f * ((i % 3) - 1.0f), 0.0f);
+              broadphase.Update(i, boxes[i].min + offset * static_cast<float>(frame), boxes[i].max + offset * static_cast<float>(frame));
+            }
+            broadphase.FindPairs();
+          }
+          auto end = std::chrono::high_resolution_clock::now();
+
+          double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / 10.0;
+          std::string name = method == Physics::Broadphase::Method::SweepAndPrune ? "SweepAndPrune" : "UniformGrid";
+          Logger::WriteMessage((name + " " + std::to_string(count) + " bodies: " + std::to_string(milliseconds) + " ms/frame, " + std::to_string(broadphase.GetPairs().size()) + " pairs\n").c_str());
+        }
+      }
+    }
+
+  };
+
+}
+
+namespace T_Core
+{
+
+  TEST_CLASS(T_FixedTimestep)
+  {
+  public:
+
+    TEST_METHOD(T_FixedTimestep_StepsAndAlpha)
+    {
+      FixedTimestep timestep;
+      timestep.SetDeltaTime(0.25f);
+
+      // not enough time for a step
+      timestep.Advance(0.125f);
+      Assert::AreEqual(0u, timestep.GetStepCount());
+      Assert::AreEqual(0.5f, timestep.GetAlpha(), 1e-5f);
+
+      // the leftover from the last frame completes a step
+      timestep.Advance(0.5f);
+      Assert::AreEqual(2u, timestep.GetStepCount());
+      Assert::AreEqual(0.5f, timestep.GetAlpha(), 1e-5f);
+
+      // a negative delta doesn't take time away
+      timestep.Advance(-1.0f);
+      Assert::AreEqual(0u, timestep.GetStepCount());
+      Assert::AreEqual(0.5f, timestep.GetAlpha(), 1e-5f);
+
+      timestep.Reset();
+      Assert::AreEqual(0u, timestep.GetStepCount());
+      Assert::AreEqual(0.0f, timestep.GetAlpha());
+    }
+
+    TEST_METHOD(T_FixedTimestep_MaxSteps)
+    {
+      FixedTimestep timestep;
+      timestep.SetDeltaTime(0.25f);
+      timestep.SetMaxSteps(4);
+
+      // a long frame is clamped and the time that didn't fit is dropped
+      timestep.Advance(10.125f);
+      Assert::AreEqual(4u, timestep.GetStepCount());
+      Assert::AreEqual(0.5f, timestep.GetAlpha(), 1e-5f);
+
+      timestep.Advance(0.0f);
+      Assert::AreEqual(0u, timestep.GetStepCount());
+
+      timestep.SetMaxSteps(0);
+      Assert::AreEqual(1u, timestep.GetMaxSteps());
+    }
+
+    TEST_METHOD(T_FixedTimestep_SetRate)
+    {
+      FixedTimestep timestep;
+      timestep.SetRate(50);
+      Assert::AreEqual(0.02f, timestep.GetDeltaTime(), 1e-6f);
+
+      // invalid rates keep the last one
+      timestep.SetRate(0);
+      timestep.SetDeltaTime(-1.0f);
+      Assert::AreEqual(0.02f, timestep.GetDeltaTime(), 1e-6f);
+
+      // one second at 50 Hz is 50 steps, fed in uneven frames
+      timestep.SetMaxSteps(100);
+      unsigned int total_steps = 0;
+      for (float frame : { 0.013f, 0.4f, 0.007f, 0.33f, 0.25f })
+      {
+        timestep.Advance(frame);
+        total_steps += timestep.GetStepCount();
+      }
+      Assert::AreEqual(50u, total_steps);
+    }
+
+  };
+
+}
+
+namespace T_Renderer
+{
+
+  TEST_CLASS(T_SpriteBatch)
+  {
+  public:
+
+    static SpriteInstance MakeInstance(float id)
+    {
+      SpriteInstance instance;
+      instance.transform.data[12] = id;
+      return instance;
+    }
+
+    TEST_METHOD(T_SpriteBatch_Materials)
+    {
+      SpriteBatch batch;
+      SpriteBatch::MaterialID a = batch.AddMaterial("", R"(\images\a.png)");
+      SpriteBatch::MaterialID b = batch.AddMaterial("", R"(\images\b.png)");
+      SpriteBatch::MaterialID c = batch.AddMaterial(R"(\shaders\other)", R"(\images\a.png)", false);
+
+      Assert::AreNotEqual(a, b);
+      Assert::AreNotEqual(a, c);
+      Assert::AreEqual(a, batch.AddMaterial("", R"(\images\a.png)"));
+      Assert::AreEqual(std::size_t(3), batch.GetMaterialCount());
+
+      // the first add decides if the material is instanced
+      Assert::IsTrue(batch.GetMaterial(a).is_instanced);
+      Assert::IsFalse(batch.GetMaterial(c).is_instanced);
+      Assert::AreEqual(c, batch.AddMaterial(R"(\shaders\other)", R"(\images\a.png)", true));
+      Assert::IsFalse(batch.GetMaterial(c).is_instanced);
+
+      // the materials outlive the sprites
+      batch.Add(a, MakeInstance(0.0f));
+      batch.Clear();
+      Assert::IsTrue(batch.empty());
+      Assert::AreEqual(std::size_t(0), batch.GetBatches().size());
+      Assert::AreEqual(b, batch.AddMaterial("", R"(\images\b.png)"));
+    }
+
+    TEST_METHOD(T_SpriteBatch_SortOrder)
+    {
+      SpriteBatch batch;
+      SpriteBatch::MaterialID a = batch.AddMaterial("", R"(\images\a.png)");
+      SpriteBatch::MaterialID b = batch.AddMaterial("", R"(\images\b.png)");
+
+      // interleaved materials on two layers, added top layer first
+      batch.Add(a, MakeInstance(0.0f), 1);
+      batch.Add(b, MakeInstance(1.0f), 1);
+      batch.Add(a, MakeInstance(2.0f), 1);
+      batch.Add(b, MakeInstance(3.0f), -1);
+      batch.Add(a, MakeInstance(4.0f), -1);
+      batch.Add(b, MakeInstance(5.0f), -1);
+
+      // one batch per material per layer, lower layers first
+      const auto& batches = batch.GetBatches();
+      Assert::AreEqual(std::size_t(4), batches.size());
+      Assert::AreEqual(-1, batches[0].layer);
+      Assert::AreEqual(a, batches[0].material);
+      Assert::AreEqual(-1, batches[1].layer);
+      Assert::AreEqual(b, batches[1].material);
+      Assert::AreEqual(1, batches[2].layer);
+      Assert::AreEqual(a, batches[2].material);
+      Assert::AreEqual(1, batches[3].layer);
+      Assert::AreEqual(b, batches[3].material);
+
+      // sprites in a batch keep the order they were added in
+      const auto& instances = batch.GetSortedInstances();
+      float expected[] = { 4.0f, 3.0f, 5.0f, 0.0f, 2.0f, 1.0f };
+      for (std::size_t i = 0; i < 6; i++) Assert::AreEqual(expected[i], instances[i].transform.data[12]);
+
+      uint32_t first = 0;
+      for (const auto& draw : batches)
+      {
+        Assert::AreEqual(first, draw.first);
+        first += draw.count;
+      }
+      Assert::AreEqual(uint32_t(6), first);
+    }
+
+    TEST_METHOD(T_SpriteBatch_DrawCallsPerMaterial)
+    {
+      // 10k sprites spread over 4 textures on one layer is 4 draws instead of 10k
+      SpriteBatch batch;
+      SpriteBatch::MaterialID materials[4];
+      for (int i = 0; i < 4; i++) materials[i] = batch.AddMaterial("", R"(\images\)" + std::to_string(i) + ".png");
+
+      std::mt19937 rng(7);
+      for (int i = 0; i < 10000; i++) batch.Add(materials[rng() % 4], MakeInstance(static_cast<float>(i)));
+
+      Assert::AreEqual(std::size_t(4), batch.GetBatches().size());
+      Assert::AreEqual(std::size_t(10000), batch.GetSortedInstances().size());
+    }
+
+    TEST_METHOD(T_SpriteBatch_Depth)
+    {
+      SpriteBatch batch;
+      SpriteBatch::MaterialID a = batch.AddMaterial("", R"(\images\a.png)");
+
+      // depth orders the sprites in a batch without splitting it
+      batch.Add(a, MakeInstance(0.0f), 0, 0.75f);
+      batch.Add(a, MakeInstance(1.0f), 0, 0.25f);
+      batch.Add(a, MakeInstance(2.0f), 0, 2.0f);   // clamped to 1
+      batch.Add(a, MakeInstance(3.0f), 0, -1.0f);  // clamped to 0
+      batch.Add(a, MakeInstance(4.0f), 0, 0.25f);
+
+      Assert::AreEqual(std::size_t(1), batch.GetBatches().size());
+
+      const auto& instances = batch.GetSortedInstances();
+      float expected[] = { 3.0f, 1.0f, 4.0f, 0.0f, 2.0f };
+      for (std::size_t i = 0; i < 5; i++) Assert::AreEqual(expected[i], instances[i].transform.data[12]);
+
+      // layers outside 16 bits are clamped, not wrapped
+      batch.Clear();
+      batch.Add(a, MakeInstance(0.0f), 100000);
+      batch.Add(a, MakeInstance(1.0f), -100000);
+      Assert::AreEqual(-32768, batch.GetBatches()[0].layer);
+      Assert::AreEqual(32767, batch.GetBatches()[1].layer);
+    }
+
+    BEGIN_TEST_METHOD_ATTRIBUTE(T_SpriteBatch_Benchmark)
+      TEST_IGNORE()
+    END_TEST_METHOD_ATTRIBUTE()
+    TEST_METHOD(T_SpriteBatch_Benchmark)
+    {
+      // 100k sprites over 16 textures and 8 layers, the sprite layer of a busy scene
+      const int count = 100000;
+      SpriteBatch batch;
+      SpriteBatch::MaterialID materials[16];
+      for (int i = 0; i < 16; i++) materials[i] = batch.AddMaterial("", R"(\images\)" + std::to_string(i) + ".png");
+
+      std::mt19937 rng(11);
+      std::vector<int> layers(count);
+      std::vector<SpriteBatch::MaterialID> sprite_materials(count);
+      for (int i = 0; i < count; i++)
+      {
+        layers[i] = static_cast<int>(rng() % 8);
+        sprite_materials[i] = materials[rng() % 16];
+      }
+
+      double total_milliseconds = 0.0;
+      const int frames = 10;
+      for (int frame = 0; frame < frames; frame++)
+      {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        batch.Clear();
+        for (int i = 0; i < count; i++) batch.Add(sprite_materials[i], MakeInstance(static_cast<float>(i)), layers[i]);
+        batch.Sort();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        total_milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+      }
+
+      Assert::AreEqual(std::size_t(8 * 16), batch.GetBatches().size());
+      Logger::WriteMessage(("SpriteBatch " + std::to_string(count) + " sprites: " + std::to_string(total_milliseconds / frames) + " ms/frame, " + std::to_string(batch.GetBatches().size()) + " batches\n").c_str());
+    }
+
+  };
+
+}